@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <any>
+#include <array>
 #include <csignal>
 #include <cstdio>
+#include <cstring>
 #include <iomanip>
 #include <ncurses.h>
 #include <sstream>
@@ -8,7 +11,11 @@
 
 #include "app/MonitorApp.h"
 #include "Logger.h"
+#include "common/Config.h"
+#include "common/MonotonicClock.h"
+#include "common/SamplingPolicy.h"
 #include "ipc/BinderProtocol.h"
+#include "ipc/MetricSchema.h"
 
 namespace xmonitor {
 namespace {
@@ -31,6 +38,142 @@ std::string formatBytes(std::uint64_t bytes) {
 void signalHandler(int) {
     gStopRequested = 1;
 }
+
+const char* kLatencyStageNames[] = {
+    "sample -> ingest ",
+    "ingest -> receive",
+    "receive -> draw  ",
+    "sample -> draw   ",
+};
+
+const char* kPanelNames[] = {
+    "overview",
+    "overhead",
+    "memory",
+    "disk",
+    "network",
+    "cgroups",
+    "threads",
+    "processes",
+    "interrupts",
+    "cores",
+    "fleet",
+};
+
+const char* kCgroupSortNames[] = {
+    "cpu",
+    "memory",
+    "io",
+    "pressure",
+};
+
+const char* kProcessRoleNames[] = {
+    "xMonitor",
+    "xMonitorLifecycle",
+    "xMonitorCpuService",
+    "xMonitorRamService",
+    "xMonitorMemoryService",
+    "xMonitorDiskService",
+    "xMonitorNetService",
+    "xMonitorCgroupService",
+    "xMonitorThreadService",
+    "xMonitorProcessService",
+};
+
+constexpr std::uint64_t kSelfUsageIntervalNs = 1000000000ull;
+// Percentiles move slowly; only fetched while the overlay is shown.
+constexpr std::uint64_t kPercentileQueryIntervalNs = 1000000000ull;
+constexpr std::uint64_t kFleetQueryIntervalNs = 1000000000ull;
+// Shown on the overhead panel; refreshed while it is open so changes made
+// with `xMonitor --policy` show up.
+constexpr std::uint64_t kPolicyQueryIntervalNs = 1000000000ull;
+constexpr int kPolicyUpdateAttempts = 3;
+
+// Column headers for FleetData::metrics, in the aggregator's order.
+const char* kFleetColumnLabels[kFleetMetricCount] = {
+    "cpu%",
+    "core%",
+    "ram%",
+    "load1",
+    "psi.cpu",
+    "psi.mem",
+    "psi.io",
+    "disk%",
+};
+constexpr double kDefaultCpuBudgetPercent = 2.0;
+
+// The thread table is meant to be watched live, at the thread service's 10 Hz.
+constexpr auto kRedrawPeriod = std::chrono::milliseconds(200);
+constexpr auto kThreadRedrawPeriod = std::chrono::milliseconds(100);
+
+double nsToMs(std::uint64_t ns) {
+    return static_cast<double>(ns) / 1000000.0;
+}
+
+// Cores of one node (or all of them) four to a row, in CPU order.
+int drawCoreGrid(int row, const TopologyData& topology, bool allNodes, std::uint32_t node) {
+    constexpr int kCoresPerRow = 4;
+    std::string line;
+    int column = 0;
+    for (std::uint32_t i = 0; i < topology.coreCount && i < kMaxTopologyCpus; ++i) {
+        const CoreStats& core = topology.cores[i];
+        if (!allNodes && core.node != node) {
+            continue;
+        }
+        char cell[48];
+        std::snprintf(cell, sizeof(cell), "cpu%-4u s%u/c%-3u %5.1f%% %5uMHz   ",
+                      core.cpu, core.package, core.core, core.usagePercent, core.frequencyMhz);
+        line += cell;
+        if (++column == kCoresPerRow) {
+            mvprintw(row++, 0, "%s", line.c_str());
+            line.clear();
+            column = 0;
+        }
+    }
+    if (!line.empty()) {
+        mvprintw(row++, 0, "%s", line.c_str());
+    }
+    return row;
+}
+
+int drawPressureRow(int row, const char* name, const PressureResource& resource) {
+    if (resource.available == 0) {
+        mvprintw(row, 0, "  %-7s        n/a", name);
+        return row + 1;
+    }
+
+    mvprintw(row, 0, "  %-7s  %6.2f %6.2f %6.2f      %6.2f %6.2f %6.2f",
+             name,
+             resource.some.avg10,
+             resource.some.avg60,
+             resource.some.avg300,
+             resource.full.avg10,
+             resource.full.avg60,
+             resource.full.avg300);
+    return row + 1;
+}
+using SectionHandler = void (*)(BinderSnapshot&, const std::any&);
+
+// publishSnapshot() posts Section::Payload under Section::messageId, so the
+// cast only fails for a message some other sender got wrong.
+template <typename Section>
+void applySection(BinderSnapshot& data, const std::any& obj) {
+    using Payload = typename Section::Payload;
+    const Payload* payload = std::any_cast<Payload>(&obj);
+    if (payload == nullptr) {
+        return;
+    }
+    if (Payload* slot = Section::Slots::slotFor(Section::field(data), *payload)) {
+        *slot = *payload;
+    }
+}
+
+template <typename Section>
+struct SectionHandlerOf {
+    static constexpr SectionHandler value = &applySection<Section>;
+};
+
+constexpr auto kSectionHandlers = MetricSchema::byMessageId<SectionHandler, SectionHandlerOf>();
 } // namespace
 
 MonitorApp::MonitorApp() = default;
@@ -41,28 +184,32 @@ MonitorApp::~MonitorApp() {
 }
 
 void MonitorApp::handleMessage(const Message& message) {
-    {
-        std::lock_guard<std::mutex> lock(mDataMutex);
-
-        switch (message.what) {
-            case CPU_UPDATE:
-                if (message.obj.type() == typeid(CpuData)) {
-                    mCpuData = std::any_cast<CpuData>(message.obj);
-                }
-                break;
-            case RAM_UPDATE:
-                if (message.obj.type() == typeid(RamData)) {
-                    mRamData = std::any_cast<RamData>(message.obj);
-                }
-                break;
-            case MEMORY_UPDATE:
-                if (message.obj.type() == typeid(MemoryData)) {
-                    mMemoryData = std::any_cast<MemoryData>(message.obj);
-                }
-                break;
-            default:
-                break;
-        }
+    std::lock_guard<std::mutex> lock(mDataMutex);
+
+    if (message.what > 0 && static_cast<std::size_t>(message.what) < kSectionHandlers.size() &&
+        kSectionHandlers[static_cast<std::size_t>(message.what)] != nullptr) {
+        kSectionHandlers[static_cast<std::size_t>(message.what)](mData, message.obj);
+        return;
+    }
+
+    switch (message.what) {
+        case PERCENTILE_UPDATE:
+            if (message.obj.type() == typeid(PercentileData)) {
+                mPercentileData = std::any_cast<PercentileData>(message.obj);
+            }
+            break;
+        case FLEET_UPDATE:
+            if (message.obj.type() == typeid(FleetData)) {
+                mFleetData = std::any_cast<FleetData>(message.obj);
+            }
+            break;
+        case POLICY_UPDATE:
+            if (message.obj.type() == typeid(SamplingPolicy)) {
+                mPolicy = std::any_cast<SamplingPolicy>(message.obj);
+            }
+            break;
+        default:
+            break;
     }
 }
 
@@ -71,6 +218,7 @@ void MonitorApp::run() {
     LOG_I("MonitorApp start");
 
     gStopRequested = 0;
+    mCpuBudgetPercent = envDouble("XMONITOR_CPU_BUDGET_PERCENT", kDefaultCpuBudgetPercent);
 
     std::signal(SIGINT, signalHandler);
     std::signal(SIGTERM, signalHandler);
@@ -86,38 +234,271 @@ void MonitorApp::run() {
         return;
     }
 
+    if (mWatchPid != 0 && !sendWatchTarget(mWatchPid)) {
+        LOG_E("MonitorApp watch target pid=%u rejected", mWatchPid);
+    }
+
     initscr();
     cbreak();
     noecho();
     keypad(stdscr, TRUE);
+    nodelay(stdscr, TRUE);
     curs_set(0);
 
     while (gStopRequested == 0) {
+        for (int key = getch(); key != ERR; key = getch()) {
+            handleKey(key);
+        }
+
         BinderSnapshot snapshot{};
-        if (querySnapshot(snapshot)) {
+        const bool remote = mViewHostId != 0;
+        if (remote ? queryHostSnapshot(mViewHostId, snapshot) : querySnapshot(snapshot)) {
             publishSnapshot(snapshot);
+        } else if (remote) {
+            LOG_W("MonitorApp host %u no longer available, back to local view", mViewHostId);
+            std::lock_guard<std::mutex> lock(mDataMutex);
+            mViewHostId = 0;
         }
 
+        if (mPolicyPresetPending) {
+            mPolicyPresetPending = false;
+            SamplingPolicy policy{};
+            std::string error;
+            if (updatePolicy(policyPresetName(mPolicyPreset), policy, error)) {
+                postPolicy(policy);
+            } else {
+                LOG_W("MonitorApp sampling preset %s not applied: %s", policyPresetName(mPolicyPreset), error.c_str());
+            }
+        }
+
+        const std::uint64_t nowNs = monotonicNowNs();
+        if (mActivePanel == PANEL_OVERHEAD && nowNs - mLastPolicyQueryNs >= kPolicyQueryIntervalNs) {
+            mLastPolicyQueryNs = nowNs;
+            SamplingPolicy policy{};
+            if (queryPolicy(policy)) {
+                postPolicy(policy);
+            }
+        }
+        if (mShowPercentileOverlay && nowNs - mLastPercentileQueryNs >= kPercentileQueryIntervalNs) {
+            mLastPercentileQueryNs = nowNs;
+            PercentileData percentiles{};
+            if (queryPercentiles(percentiles)) {
+                Message percentileMessage;
+                percentileMessage.what = PERCENTILE_UPDATE;
+                percentileMessage.obj = percentiles;
+                postMessage(percentileMessage);
+            }
+        }
+        if (mActivePanel == PANEL_FLEET && nowNs - mLastFleetQueryNs >= kFleetQueryIntervalNs) {
+            mLastFleetQueryNs = nowNs;
+            FleetData fleet{};
+            if (queryFleet(mFleetCursor / kFleetPageHosts * kFleetPageHosts, fleet)) {
+                Message fleetMessage;
+                fleetMessage.what = FLEET_UPDATE;
+                fleetMessage.obj = fleet;
+                postMessage(fleetMessage);
+            }
+        }
+
+        ++mRedrawCount;
+        sampleSelfUsage();
+
         {
             std::lock_guard<std::mutex> lock(mDataMutex);
+            const std::uint64_t drawNs = monotonicNowNs();
+            // A federated host's sample times come from another clock.
+            if (mViewHostId == 0) {
+                std::size_t index = 0;
+                MetricSchema::forEach([&](auto section) {
+                    using Section = decltype(section);
+                    if (Section::slotCount == 1) {
+                        traceDrawUnlocked(Section::trace(mData, 0), mLastTracedNs[index], drawNs);
+                    }
+                    ++index;
+                });
+            }
             redrawUnlocked();
         }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        std::this_thread::sleep_for(mActivePanel == PANEL_THREADS ? kThreadRedrawPeriod : kRedrawPeriod);
     }
 
     LOG_W("Stop requested by signal");
 
     endwin();
 
+    if (mWatchPid != 0) {
+        sendWatchTarget(0);
+    }
+
     mBinderAdapter.shutdown();
     LOG_I("MonitorApp stop");
 }
 
+void MonitorApp::setWatchTarget(std::uint32_t pid) {
+    mWatchPid = pid;
+    if (pid != 0) {
+        mActivePanel = PANEL_THREADS;
+    }
+}
+
+bool MonitorApp::runPolicyCommand(const std::string& spec) {
+    if (!mBinderAdapter.initialize()) {
+        std::fprintf(stderr, "xMonitor: cannot reach lifecycle\n");
+        return false;
+    }
+
+    SamplingPolicy policy{};
+    std::string error;
+    const bool ok = spec == "show" ? queryPolicy(policy) : updatePolicy(spec, policy, error);
+    mBinderAdapter.shutdown();
+    if (!ok) {
+        std::fprintf(stderr, "xMonitor: policy not applied: %s\n", error.empty() ? "lifecycle query failed" : error.c_str());
+        return false;
+    }
+
+    std::printf("sampling policy v%llu: %s\n",
+                static_cast<unsigned long long>(policy.version),
+                formatPolicy(policy).c_str());
+    return true;
+}
+
 void MonitorApp::requestStop() {
     gStopRequested = 1;
 }
 
+void MonitorApp::handleKey(int key) {
+    std::lock_guard<std::mutex> lock(mDataMutex);
+
+    switch (key) {
+        case 'd':
+        case 'D':
+            mShowLatencyOverlay = !mShowLatencyOverlay;
+            break;
+        case 'p':
+        case 'P':
+            mShowPercentileOverlay = !mShowPercentileOverlay;
+            mLastPercentileQueryNs = 0;
+            break;
+        case '\t':
+            mActivePanel = (mActivePanel + 1) % PANEL_COUNT;
+            break;
+        case '1':
+            mActivePanel = PANEL_OVERVIEW;
+            break;
+        case '2':
+            mActivePanel = PANEL_OVERHEAD;
+            break;
+        case '3':
+            mActivePanel = PANEL_MEMORY;
+            break;
+        case '4':
+            mActivePanel = PANEL_DISK;
+            break;
+        case '5':
+            mActivePanel = PANEL_NETWORK;
+            break;
+        case '6':
+            mActivePanel = PANEL_CGROUPS;
+            break;
+        case '7':
+            mActivePanel = PANEL_THREADS;
+            break;
+        case '8':
+            mActivePanel = PANEL_PROCESSES;
+            break;
+        case '9':
+            mActivePanel = PANEL_INTERRUPTS;
+            break;
+        case '0':
+            mActivePanel = PANEL_CORES;
+            break;
+        case 'n':
+        case 'N':
+            mGroupCoresByNode = !mGroupCoresByNode;
+            break;
+        case 'f':
+        case 'F':
+            mActivePanel = PANEL_FLEET;
+            mLastFleetQueryNs = 0;
+            break;
+        case KEY_UP:
+            if (mActivePanel == PANEL_FLEET && mFleetCursor > 0) {
+                --mFleetCursor;
+                mLastFleetQueryNs = 0;
+            }
+            break;
+        case KEY_DOWN:
+            if (mActivePanel == PANEL_FLEET && mFleetCursor + 1 < mFleetData.hostCount) {
+                ++mFleetCursor;
+                mLastFleetQueryNs = 0;
+            }
+            break;
+        case '\n':
+        case KEY_ENTER:
+            if (mActivePanel == PANEL_FLEET && mFleetCursor >= mFleetData.firstHost &&
+                mFleetCursor - mFleetData.firstHost < mFleetData.rowCount) {
+                const FleetHost& host = mFleetData.hosts[mFleetCursor - mFleetData.firstHost];
+                mViewHostId = host.id;
+                std::memcpy(mViewHostName, host.name, sizeof(mViewHostName));
+                mActivePanel = PANEL_OVERVIEW;
+            }
+            break;
+        case 'l':
+        case 'L':
+            mViewHostId = 0;
+            break;
+        case 's':
+        case 'S':
+            mCgroupSortKey = (mCgroupSortKey + 1) % CGROUP_SORT_COUNT;
+            break;
+        case 'r':
+        case 'R':
+            mPolicyPreset = (mPolicyPreset + 1) % kPolicyPresetCount;
+            mPolicyPresetPending = true;
+            break;
+        default:
+            break;
+    }
+}
+
+void MonitorApp::sampleSelfUsage() {
+    const std::uint64_t nowNs = monotonicNowNs();
+    if (nowNs - mLastSelfUsageNs < kSelfUsageIntervalNs) {
+        return;
+    }
+    mLastSelfUsageNs = nowNs;
+
+    SelfUsageData usage{};
+    if (!mSelfUsageSampler.sample(mRedrawCount, mBinderAdapter.transactionCount(), usage)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mDataMutex);
+    mData.self[static_cast<std::size_t>(ProcessRole::App)] = usage;
+}
+
+void MonitorApp::traceDrawUnlocked(const SampleTrace& trace, std::uint64_t& lastTracedSampleNs, std::uint64_t drawNs) {
+    // Each sample is traced once, on the first redraw that shows it.
+    if (trace.sampleNs == 0 || trace.sampleNs == lastTracedSampleNs) {
+        return;
+    }
+    lastTracedSampleNs = trace.sampleNs;
+
+    if (trace.ingestNs >= trace.sampleNs) {
+        mLatency[STAGE_SAMPLE_TO_INGEST].record(trace.ingestNs - trace.sampleNs);
+    }
+    if (trace.ingestNs != 0 && trace.receiveNs >= trace.ingestNs) {
+        mLatency[STAGE_INGEST_TO_RECEIVE].record(trace.receiveNs - trace.ingestNs);
+    }
+    if (trace.receiveNs != 0 && drawNs >= trace.receiveNs) {
+        mLatency[STAGE_RECEIVE_TO_DRAW].record(drawNs - trace.receiveNs);
+    }
+    if (drawNs >= trace.sampleNs) {
+        mLatency[STAGE_SAMPLE_TO_DRAW].record(drawNs - trace.sampleNs);
+    }
+}
+
 bool MonitorApp::registerToLifecycle() {
     BinderAck ack{};
     const std::uint32_t request = 1;
@@ -138,6 +519,88 @@ bool MonitorApp::registerToLifecycle() {
     return ack.ok != 0;
 }
 
+bool MonitorApp::sendWatchTarget(std::uint32_t pid) {
+    WatchTarget target{};
+    target.pid = pid;
+    BinderAck ack{};
+    std::size_t replySize = 0;
+
+    const bool ok = mBinderAdapter.transact(
+        static_cast<std::uint32_t>(BinderTransactionCode::SetWatchTarget),
+        &target,
+        sizeof(target),
+        &ack,
+        sizeof(ack),
+        replySize);
+
+    return ok && replySize == sizeof(ack) && ack.ok != 0;
+}
+
+bool MonitorApp::queryPolicy(SamplingPolicy& policy) {
+    const std::uint32_t request = 1;
+    std::size_t replySize = 0;
+    const bool ok = mBinderAdapter.transact(
+        static_cast<std::uint32_t>(BinderTransactionCode::QueryPolicy),
+        &request,
+        sizeof(request),
+        &policy,
+        sizeof(policy),
+        replySize);
+
+    return ok && replySize == sizeof(policy);
+}
+
+bool MonitorApp::updatePolicy(const std::string& spec, SamplingPolicy& outPolicy, std::string& outError) {
+    for (int attempt = 0; attempt < kPolicyUpdateAttempts; ++attempt) {
+        SamplingPolicy current{};
+        if (!queryPolicy(current)) {
+            outError = "lifecycle query failed";
+            return false;
+        }
+
+        SamplingPolicy policy = current;
+        if (!applyPolicySpec(spec, policy, outError)) {
+            return false;
+        }
+
+        BinderAck ack{};
+        std::size_t replySize = 0;
+        const bool ok = mBinderAdapter.transact(
+            static_cast<std::uint32_t>(BinderTransactionCode::SetPolicy),
+            &policy,
+            sizeof(policy),
+            &ack,
+            sizeof(ack),
+            replySize);
+        if (ok && replySize == sizeof(ack) && ack.ok != 0) {
+            outPolicy = policy;
+            outPolicy.version = current.version + 1;
+            return true;
+        }
+        if (!ok || replySize != sizeof(ack)) {
+            outError = "SetPolicy transaction failed";
+            return false;
+        }
+
+        // Rejected: either someone else changed the policy first (retry on
+        // top of theirs) or lifecycle found it invalid.
+        SamplingPolicy latest{};
+        if (!queryPolicy(latest) || latest.version == current.version) {
+            outError = "rejected by lifecycle";
+            return false;
+        }
+    }
+    outError = "policy kept changing underneath";
+    return false;
+}
+
+void MonitorApp::postPolicy(const SamplingPolicy& policy) {
+    Message policyMessage;
+    policyMessage.what = POLICY_UPDATE;
+    policyMessage.obj = policy;
+    postMessage(policyMessage);
+}
+
 bool MonitorApp::querySnapshot(BinderSnapshot& snapshot) {
     const std::uint32_t request = 1;
     std::size_t replySize = 0;
@@ -149,47 +612,794 @@ bool MonitorApp::querySnapshot(BinderSnapshot& snapshot) {
         sizeof(snapshot),
         replySize);
 
-    return ok && replySize == sizeof(snapshot);
+    if (!ok || replySize != sizeof(snapshot)) {
+        return false;
+    }
+
+    stampReceive(snapshot);
+    return true;
 }
 
-void MonitorApp::publishSnapshot(const BinderSnapshot& snapshot) {
-    Message cpuMessage;
-    cpuMessage.what = CPU_UPDATE;
-    cpuMessage.obj = snapshot.cpu;
-    postMessage(cpuMessage);
+bool MonitorApp::queryHostSnapshot(std::uint32_t hostId, BinderSnapshot& snapshot) {
+    std::size_t replySize = 0;
+    const bool ok = mBinderAdapter.transact(
+        static_cast<std::uint32_t>(BinderTransactionCode::QueryHostSnapshot),
+        &hostId,
+        sizeof(hostId),
+        &snapshot,
+        sizeof(snapshot),
+        replySize);
+
+    // Unknown hosts are answered with a short BinderAck.
+    if (!ok || replySize != sizeof(snapshot)) {
+        return false;
+    }
+
+    stampReceive(snapshot);
+    return true;
+}
+
+void MonitorApp::stampReceive(BinderSnapshot& snapshot) const {
+    const std::uint64_t receiveNs = monotonicNowNs();
+    MetricSchema::forEach([&](auto section) {
+        using Section = decltype(section);
+        for (std::size_t slot = 0; slot < Section::slotCount; ++slot) {
+            Section::Slots::at(Section::field(snapshot), slot).trace.receiveNs = receiveNs;
+        }
+    });
+}
 
-    Message ramMessage;
-    ramMessage.what = RAM_UPDATE;
-    ramMessage.obj = snapshot.ram;
-    postMessage(ramMessage);
+bool MonitorApp::queryPercentiles(PercentileData& data) {
+    const std::uint32_t request = 1;
+    std::size_t replySize = 0;
+    const bool ok = mBinderAdapter.transact(
+        static_cast<std::uint32_t>(BinderTransactionCode::QueryPercentiles),
+        &request,
+        sizeof(request),
+        &data,
+        sizeof(data),
+        replySize);
 
-    Message memoryMessage;
-    memoryMessage.what = MEMORY_UPDATE;
-    memoryMessage.obj = snapshot.memory;
-    postMessage(memoryMessage);
+    return ok && replySize == sizeof(data);
+}
+
+bool MonitorApp::queryFleet(std::uint32_t firstHost, FleetData& data) {
+    std::size_t replySize = 0;
+    const bool ok = mBinderAdapter.transact(
+        static_cast<std::uint32_t>(BinderTransactionCode::QueryFleet),
+        &firstHost,
+        sizeof(firstHost),
+        &data,
+        sizeof(data),
+        replySize);
+
+    return ok && replySize == sizeof(data);
+}
+
+void MonitorApp::publishSnapshot(const BinderSnapshot& snapshot) {
+    MetricSchema::forEach([&](auto section) {
+        using Section = decltype(section);
+        for (std::size_t slot = 0; slot < Section::slotCount; ++slot) {
+            const auto& payload = Section::Slots::at(Section::field(snapshot), slot);
+            // Role slots lifecycle never filled are skipped; that includes
+            // the app's own, which it samples locally.
+            if (Section::slotCount > 1 && payload.trace.ingestNs == 0) {
+                continue;
+            }
+
+            Message message;
+            message.what = Section::messageId;
+            message.obj = payload;
+            postMessage(message);
+        }
+    });
 }
 
 void MonitorApp::redrawUnlocked() const {
     erase();
 
-    mvprintw(0, 0, "xMonitor - Linux System Monitor (ncurses)");
+    if (mViewHostId != 0) {
+        mvprintw(0, 0, "xMonitor - Linux System Monitor (ncurses) - host %s ('l': local)", mViewHostName);
+    } else {
+        mvprintw(0, 0, "xMonitor - Linux System Monitor (ncurses)");
+    }
     mvprintw(1, 0, "=======================================");
+    drawAlertBannerUnlocked(2);
+
+    int row = 3;
+    switch (mActivePanel) {
+        case PANEL_OVERHEAD:
+            row = drawOverheadPanelUnlocked(row);
+            break;
+        case PANEL_MEMORY:
+            row = drawMemoryPanelUnlocked(row);
+            break;
+        case PANEL_DISK:
+            row = drawDiskPanelUnlocked(row);
+            break;
+        case PANEL_NETWORK:
+            row = drawNetworkPanelUnlocked(row);
+            break;
+        case PANEL_CGROUPS:
+            row = drawCgroupPanelUnlocked(row);
+            break;
+        case PANEL_THREADS:
+            row = drawThreadPanelUnlocked(row);
+            break;
+        case PANEL_PROCESSES:
+            row = drawProcessPanelUnlocked(row);
+            break;
+        case PANEL_INTERRUPTS:
+            row = drawInterruptPanelUnlocked(row);
+            break;
+        case PANEL_CORES:
+            row = drawCorePanelUnlocked(row);
+            break;
+        case PANEL_FLEET:
+            row = drawFleetPanelUnlocked(row);
+            break;
+        case PANEL_OVERVIEW:
+        default:
+            row = drawOverviewUnlocked(row);
+            break;
+    }
+
+    std::string panels;
+    for (int panel = 0; panel < PANEL_COUNT; ++panel) {
+        const std::string key = panel == PANEL_FLEET ? "f" : std::to_string((panel + 1) % 10);
+        panels += "[" + key + "] " + kPanelNames[panel] + " ";
+    }
+    mvprintw(row + 1, 0, "%s Tab: next panel, 'd': latency overlay, 's': cgroup sort, 'n': node grouping, 'p': percentiles, 'r': sampling preset, Ctrl+C: exit.", panels.c_str());
+
+    int overlayRow = row + 3;
+    if (mShowPercentileOverlay) {
+        overlayRow = drawPercentileOverlayUnlocked(overlayRow) + 1;
+    }
+    if (mShowLatencyOverlay) {
+        drawLatencyOverlayUnlocked(overlayRow);
+    }
 
-    mvprintw(3, 0, "CPU Usage      : %.2f%%", mCpuData.usagePercent);
+    refresh();
+}
 
-    const std::string used = formatBytes(mRamData.usedBytes);
-    const std::string total = formatBytes(mRamData.totalBytes);
-    mvprintw(4, 0, "RAM Usage      : %.2f%% (Used %s / Total %s)",
-             mRamData.usagePercent,
+// One line above every panel: firing alerts first, then pending ones.
+void MonitorApp::drawAlertBannerUnlocked(int row) const {
+    if (mData.alerts.alertCount == 0) {
+        return;
+    }
+
+    const std::uint64_t nowNs = monotonicNowNs();
+    std::string banner = mData.alerts.firingCount != 0 ? "ALERT " : "pending ";
+    for (std::uint32_t i = 0; i < mData.alerts.alertCount && i < kMaxAlerts; ++i) {
+        const AlertStatus& alert = mData.alerts.alerts[i];
+        char entry[160];
+        std::snprintf(entry,
+                      sizeof(entry),
+                      "%s%s: %s %.4g %s %.4g (%s %llus)",
+                      i == 0 ? "" : " | ",
+                      alert.name,
+                      alert.metric,
+                      alert.value,
+                      alert.op,
+                      alert.threshold,
+                      alert.state == ALERT_FIRING ? "firing" : "pending",
+                      static_cast<unsigned long long>((nowNs - alert.sinceNs) / 1000000000ull));
+        banner += entry;
+    }
+    mvprintw(row, 0, "%s", banner.c_str());
+}
+
+int MonitorApp::drawOverviewUnlocked(int row) const {
+    mvprintw(row++, 0, "CPU Usage      : %.2f%%", mData.cpu.usagePercent);
+    mvprintw(row++, 0, "  user %5.1f  nice %5.1f  sys %5.1f  idle %5.1f  iowait %5.1f",
+             mData.cpu.userPercent,
+             mData.cpu.nicePercent,
+             mData.cpu.systemPercent,
+             mData.cpu.idlePercent,
+             mData.cpu.iowaitPercent);
+    mvprintw(row++, 0, "  irq  %5.1f  soft %5.1f  steal %4.1f  guest %4.1f  gnice  %5.1f",
+             mData.cpu.irqPercent,
+             mData.cpu.softirqPercent,
+             mData.cpu.stealPercent,
+             mData.cpu.guestPercent,
+             mData.cpu.guestNicePercent);
+    mvprintw(row++, 0, "Load           : %.2f %.2f %.2f  running %u  blocked %u  tasks %u/%u",
+             mData.interrupts.load1,
+             mData.interrupts.load5,
+             mData.interrupts.load15,
+             mData.interrupts.procsRunning,
+             mData.interrupts.procsBlocked,
+             mData.interrupts.runnableTasks,
+             mData.interrupts.totalTasks);
+
+    const std::string used = formatBytes(mData.ram.usedBytes);
+    const std::string total = formatBytes(mData.ram.totalBytes);
+    mvprintw(row++, 0, "RAM Usage      : %.2f%% (Used %s / Total %s)",
+             mData.ram.usagePercent,
              used.c_str(),
              total.c_str());
 
-    const std::string rss = formatBytes(mMemoryData.residentBytes);
-    const std::string virt = formatBytes(mMemoryData.virtualBytes);
-    mvprintw(5, 0, "Process Memory : RSS %s, VIRT %s", rss.c_str(), virt.c_str());
+    const std::string rss = formatBytes(mData.memory.residentBytes);
+    const std::string virt = formatBytes(mData.memory.virtualBytes);
+    mvprintw(row++, 0, "Process Memory : RSS %s, VIRT %s", rss.c_str(), virt.c_str());
 
-    mvprintw(7, 0, "Press Ctrl+C to exit.");
-    refresh();
+    row++;
+    mvprintw(row++, 0, "Pressure (PSI)   some avg10/60/300        full avg10/60/300");
+    row = drawPressureRow(row, "cpu", mData.pressure.cpu);
+    row = drawPressureRow(row, "memory", mData.pressure.memory);
+    row = drawPressureRow(row, "io", mData.pressure.io);
+    return row;
+}
+
+int MonitorApp::drawOverheadPanelUnlocked(int row) const {
+    mvprintw(row++, 0, "%-22s %7s %7s %10s %8s %8s %10s %9s %9s %7s",
+             "Process", "PID", "CPU%", "RSS", "vcsw/s", "ivcsw/s", "sys/sample", "binder/s", "coalesced", "dropped");
+
+    double totalCpuPercent = 0.0;
+    std::uint64_t totalRssBytes = 0;
+    for (std::size_t role = 0; role < kProcessRoleCount; ++role) {
+        const SelfUsageData& usage = mData.self[role];
+        if (usage.pid == 0) {
+            mvprintw(row++, 0, "%-22s %7s", kProcessRoleNames[role], "-");
+            continue;
+        }
+
+        totalCpuPercent += usage.cpuPercent;
+        totalRssBytes += usage.rssBytes;
+        const std::string rss = formatBytes(usage.rssBytes);
+        mvprintw(row++, 0, "%-22s %7u %7.2f %10s %8.1f %8.1f %10.1f %9.1f %9llu %7llu",
+                 kProcessRoleNames[role],
+                 usage.pid,
+                 usage.cpuPercent,
+                 rss.c_str(),
+                 usage.voluntarySwitchesPerSec,
+                 usage.involuntarySwitchesPerSec,
+                 usage.syscallsPerSample,
+                 usage.binderTransactionsPerSec,
+                 static_cast<unsigned long long>(usage.sendsCoalesced),
+                 static_cast<unsigned long long>(usage.sendsDropped));
+    }
+
+    const std::string totalRss = formatBytes(totalRssBytes);
+    mvprintw(row++, 0, "%-22s %7s %7.2f %10s", "Total", "", totalCpuPercent, totalRss.c_str());
+    mvprintw(row++, 0, "CPU budget     : %.2f%% -> %s",
+             mCpuBudgetPercent,
+             totalCpuPercent <= mCpuBudgetPercent ? "within budget" : "OVER BUDGET");
+    mvprintw(row++, 0, "Sampling policy: v%llu %s ('r': next preset, %s)",
+             static_cast<unsigned long long>(mPolicy.version),
+             formatPolicy(mPolicy).c_str(),
+             policyPresetName((mPolicyPreset + 1) % kPolicyPresetCount));
+
+    // The process service waits on events rather than ticks, so it has no row.
+    row++;
+    mvprintw(row++, 0, "%-22s %4s %9s %9s %9s %9s %9s",
+             "Tick wakeup (us)", "mode", "p50", "p99", "max", "jitter", "overruns");
+    for (std::size_t role = static_cast<std::size_t>(ProcessRole::CpuService); role < kProcessRoleCount; ++role) {
+        const SelfUsageData& usage = mData.self[role];
+        if (usage.pid == 0 || usage.wakeupMaxUs == 0.0) {
+            continue;
+        }
+        mvprintw(row++, 0, "%-22s %4s %9.1f %9.1f %9.1f %9.1f %9u",
+                 kProcessRoleNames[role],
+                 usage.lowJitter != 0 ? "low" : "std",
+                 usage.wakeupP50Us,
+                 usage.wakeupP99Us,
+                 usage.wakeupMaxUs,
+                 usage.wakeupJitterUs,
+                 usage.tickOverruns);
+    }
+    return row;
+}
+
+int MonitorApp::drawMemoryPanelUnlocked(int row) const {
+    const RamData& ram = mData.ram;
+    mvprintw(row++, 0, "Memory         : %.2f%% used (%s of %s, %s available)",
+             ram.usagePercent,
+             formatBytes(ram.usedBytes).c_str(),
+             formatBytes(ram.totalBytes).c_str(),
+             formatBytes(ram.availableBytes).c_str());
+    mvprintw(row++, 0, "  free %-11s buffers %-11s cached %-11s shmem %s",
+             formatBytes(ram.freeBytes).c_str(),
+             formatBytes(ram.buffersBytes).c_str(),
+             formatBytes(ram.cachedBytes).c_str(),
+             formatBytes(ram.shmemBytes).c_str());
+    mvprintw(row++, 0, "  anon %-11s mapped  %-11s active %-11s inactive %s",
+             formatBytes(ram.anonBytes).c_str(),
+             formatBytes(ram.mappedBytes).c_str(),
+             formatBytes(ram.activeBytes).c_str(),
+             formatBytes(ram.inactiveBytes).c_str());
+    mvprintw(row++, 0, "  dirty %-10s writeback %-9s slab %-11s (reclaimable %s, unreclaimable %s)",
+             formatBytes(ram.dirtyBytes).c_str(),
+             formatBytes(ram.writebackBytes).c_str(),
+             formatBytes(ram.slabBytes).c_str(),
+             formatBytes(ram.slabReclaimableBytes).c_str(),
+             formatBytes(ram.slabUnreclaimableBytes).c_str());
+    mvprintw(row++, 0, "  commit %s of limit %s",
+             formatBytes(ram.committedBytes).c_str(),
+             formatBytes(ram.commitLimitBytes).c_str());
+
+    const std::uint64_t swapUsed = ram.swapTotalBytes >= ram.swapFreeBytes ? ram.swapTotalBytes - ram.swapFreeBytes : 0;
+    mvprintw(row++, 0, "Swap           : %s used of %s (cached %s)",
+             formatBytes(swapUsed).c_str(),
+             formatBytes(ram.swapTotalBytes).c_str(),
+             formatBytes(ram.swapCachedBytes).c_str());
+
+    row++;
+    mvprintw(row++, 0, "Reclaim/swap activity (pages/s)");
+    mvprintw(row++, 0, "  faults %10.0f  major %8.0f  scanned %10.0f  stolen %10.0f",
+             ram.pageFaultsPerSec,
+             ram.majorFaultsPerSec,
+             ram.pagesScannedPerSec,
+             ram.pagesStolenPerSec);
+    mvprintw(row++, 0, "  swap in %9.0f  swap out %5.0f  OOM kills since boot %llu",
+             ram.swapInPagesPerSec,
+             ram.swapOutPagesPerSec,
+             static_cast<unsigned long long>(ram.oomKills));
+
+    row++;
+    mvprintw(row++, 0, "Pressure (PSI)   some avg10/60/300        full avg10/60/300");
+    row = drawPressureRow(row, "memory", mData.pressure.memory);
+
+    if (mData.memoryDetail.processCount > 0) {
+        row++;
+        mvprintw(row++, 0, "%-8s %-16s %10s %10s %10s %10s %10s %10s",
+                 "PID", "Process", "RSS", "PSS", "USS", "PSS anon", "PSS file", "Swap");
+        for (std::uint32_t i = 0; i < mData.memoryDetail.processCount && i < kMaxMemoryDetailProcesses; ++i) {
+            const ProcessMemoryDetail& detail = mData.memoryDetail.processes[i];
+            if (detail.available == 0) {
+                mvprintw(row++, 0, "%-8u %-16s %10s", detail.pid, detail.name, "n/a");
+                continue;
+            }
+            mvprintw(row++, 0, "%-8u %-16s %10s %10s %10s %10s %10s %10s",
+                     detail.pid,
+                     detail.name,
+                     formatBytes(detail.rssBytes).c_str(),
+                     formatBytes(detail.pssBytes).c_str(),
+                     formatBytes(detail.ussBytes).c_str(),
+                     formatBytes(detail.pssAnonBytes).c_str(),
+                     formatBytes(detail.pssFileBytes).c_str(),
+                     formatBytes(detail.swapBytes).c_str());
+        }
+    }
+    return row;
+}
+
+int MonitorApp::drawDiskPanelUnlocked(int row) const {
+    mvprintw(row++, 0, "%-16s %8s %8s %10s %10s %8s %8s %6s %6s",
+             "Device", "r/s", "w/s", "rMB/s", "wMB/s", "r_await", "w_await", "aqu", "util%");
+
+    for (std::uint32_t i = 0; i < mData.disk.deviceCount && i < kMaxDiskDevices; ++i) {
+        const DiskDeviceStats& device = mData.disk.devices[i];
+        mvprintw(row++, 0, "%-16s %8.1f %8.1f %10.2f %10.2f %8.2f %8.2f %6.2f %6.1f",
+                 device.name,
+                 device.readsPerSec,
+                 device.writesPerSec,
+                 device.readBytesPerSec / (1024.0 * 1024.0),
+                 device.writeBytesPerSec / (1024.0 * 1024.0),
+                 device.readAwaitMs,
+                 device.writeAwaitMs,
+                 device.queueDepth,
+                 device.utilizationPercent);
+    }
+
+    if (mData.disk.matchedDevices > mData.disk.deviceCount) {
+        mvprintw(row++, 0, "... %u more devices (busiest %u shown)",
+                 mData.disk.matchedDevices - mData.disk.deviceCount,
+                 mData.disk.deviceCount);
+    }
+    if (mData.disk.deviceCount == 0) {
+        mvprintw(row++, 0, "(no disk data yet)");
+    }
+
+    row++;
+    mvprintw(row++, 0, "Pressure (PSI)   some avg10/60/300        full avg10/60/300");
+    row = drawPressureRow(row, "io", mData.pressure.io);
+
+    row++;
+    mvprintw(row++, 0, "%-28s %-8s %9s %9s %9s %6s %6s",
+             "Mount", "Type", "Size", "Used", "Avail", "Use%", "Inode%");
+    for (std::uint32_t i = 0; i < mData.filesystems.filesystemCount && i < kMaxFilesystems; ++i) {
+        const FilesystemStats& fs = mData.filesystems.filesystems[i];
+        if (fs.state != FS_STATE_OK) {
+            const char* state = "pending";
+            if (fs.state == FS_STATE_HUNG) {
+                state = "HUNG (statvfs timed out)";
+            } else if (fs.state == FS_STATE_ERROR) {
+                state = "error";
+            }
+            mvprintw(row++, 0, "%-28.28s %-8.8s %s", fs.mountPoint, fs.fsType, state);
+            continue;
+        }
+        mvprintw(row++, 0, "%-28.28s %-8.8s %9s %9s %9s %6.1f %6.1f",
+                 fs.mountPoint,
+                 fs.fsType,
+                 formatBytes(fs.totalBytes).c_str(),
+                 formatBytes(fs.usedBytes).c_str(),
+                 formatBytes(fs.availableBytes).c_str(),
+                 fs.usedPercent,
+                 fs.inodeUsedPercent);
+    }
+
+    if (mData.filesystems.matchedFilesystems > mData.filesystems.filesystemCount) {
+        mvprintw(row++, 0, "... %u more filesystems (fullest %u shown)",
+                 mData.filesystems.matchedFilesystems - mData.filesystems.filesystemCount,
+                 mData.filesystems.filesystemCount);
+    }
+    if (mData.filesystems.filesystemCount == 0) {
+        mvprintw(row++, 0, "(no filesystem data yet)");
+    }
+    return row;
+}
+
+int MonitorApp::drawNetworkPanelUnlocked(int row) const {
+    mvprintw(row++, 0, "%-16s %10s %10s %9s %9s %7s %7s %7s %7s",
+             "Interface", "rxMB/s", "txMB/s", "rxpkt/s", "txpkt/s", "rxerr/s", "txerr/s", "rxdrp/s", "txdrp/s");
+
+    for (std::uint32_t i = 0; i < mData.net.interfaceCount && i < kMaxNetInterfaces; ++i) {
+        const NetInterfaceStats& link = mData.net.interfaces[i];
+        mvprintw(row++, 0, "%-16s %10.2f %10.2f %9.0f %9.0f %7.1f %7.1f %7.1f %7.1f",
+                 link.name,
+                 link.rxBytesPerSec / (1024.0 * 1024.0),
+                 link.txBytesPerSec / (1024.0 * 1024.0),
+                 link.rxPacketsPerSec,
+                 link.txPacketsPerSec,
+                 link.rxErrorsPerSec,
+                 link.txErrorsPerSec,
+                 link.rxDropsPerSec,
+                 link.txDropsPerSec);
+    }
+
+    if (mData.net.matchedInterfaces > mData.net.interfaceCount) {
+        mvprintw(row++, 0, "... %u more interfaces (busiest %u shown)",
+                 mData.net.matchedInterfaces - mData.net.interfaceCount,
+                 mData.net.interfaceCount);
+    }
+    if (mData.net.interfaceCount == 0) {
+        mvprintw(row++, 0, "(no network data yet)");
+    }
+
+    const TcpHealth& tcp = mData.net.tcp;
+    row++;
+    mvprintw(row++, 0, "TCP            : %llu established, %.0f seg/s out",
+             static_cast<unsigned long long>(tcp.currentEstablished),
+             tcp.outSegmentsPerSec);
+    mvprintw(row++, 0, "  retrans %8.1f/s (%5.2f%%)  timeouts %8.1f/s  in errors %8.1f/s",
+             tcp.retransSegmentsPerSec,
+             tcp.retransPercent,
+             tcp.timeoutsPerSec,
+             tcp.inErrorsPerSec);
+    mvprintw(row++, 0, "  resets out %5.1f/s  estab resets %5.1f/s  failed connects %5.1f/s",
+             tcp.outResetsPerSec,
+             tcp.establishedResetsPerSec,
+             tcp.attemptFailsPerSec);
+    mvprintw(row++, 0, "  listen overflows %5.1f/s  listen drops %5.1f/s",
+             tcp.listenOverflowsPerSec,
+             tcp.listenDropsPerSec);
+    return row;
+}
+
+int MonitorApp::drawCgroupPanelUnlocked(int row) const {
+    std::array<CgroupStats, kMaxCgroups> sorted;
+    const std::size_t count = std::min<std::size_t>(mData.cgroup.cgroupCount, kMaxCgroups);
+    std::copy(mData.cgroup.cgroups, mData.cgroup.cgroups + count, sorted.begin());
+    const int sortKey = mCgroupSortKey;
+    std::sort(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(count),
+              [sortKey](const CgroupStats& left, const CgroupStats& right) {
+                  return cgroupRanksBefore(left, right, sortKey);
+              });
+
+    mvprintw(row++, 0, "Sorted by %s ('s' to change)", kCgroupSortNames[mCgroupSortKey]);
+    mvprintw(row++, 0, "%-36s %6s %5s %10s %10s %8s %8s %6s %17s",
+             "Cgroup", "CPU%", "thr%", "Memory", "Anon", "rMB/s", "wMB/s", "iops", "PSI cpu/mem/io");
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const CgroupStats& cgroup = sorted[i];
+        // Keep the tail of long paths: the scope/container name is at the end.
+        const std::size_t pathLength = std::strlen(cgroup.path);
+        const char* path = pathLength > 36 ? cgroup.path + pathLength - 36 : cgroup.path;
+        mvprintw(row++, 0, "%-36s %6.1f %5.1f %10s %10s %8.2f %8.2f %6.0f %5.1f/%5.1f/%5.1f",
+                 path,
+                 cgroup.cpuPercent,
+                 cgroup.cpuThrottledPercent,
+                 formatBytes(cgroup.memoryCurrentBytes).c_str(),
+                 formatBytes(cgroup.memoryAnonBytes).c_str(),
+                 cgroup.ioReadBytesPerSec / (1024.0 * 1024.0),
+                 cgroup.ioWriteBytesPerSec / (1024.0 * 1024.0),
+                 cgroup.ioOpsPerSec,
+                 cgroup.cpuPressureSome,
+                 cgroup.memoryPressureSome,
+                 cgroup.ioPressureSome);
+    }
+
+    if (mData.cgroup.matchedCgroups > mData.cgroup.cgroupCount) {
+        mvprintw(row++, 0, "... %u more cgroups (top %u by cpu/memory/io/pressure shown)",
+                 mData.cgroup.matchedCgroups - mData.cgroup.cgroupCount,
+                 mData.cgroup.cgroupCount);
+    }
+    if (mData.cgroup.cgroupCount == 0) {
+        mvprintw(row++, 0, "(no cgroup data yet)");
+    }
+    return row;
+}
+
+int MonitorApp::drawThreadPanelUnlocked(int row) const {
+    const ThreadData& threads = mData.thread;
+    if (threads.pid == 0) {
+        mvprintw(row++, 0, "No process watched. Start the app with: xMonitor --watch <pid>");
+        return row;
+    }
+    if (threads.available == 0) {
+        mvprintw(row++, 0, "PID %u: not running or not readable", threads.pid);
+        return row;
+    }
+
+    mvprintw(row++, 0, "PID %u (%s): %u threads, busiest %u shown",
+             threads.pid,
+             threads.processName,
+             threads.totalThreads,
+             threads.threadCount);
+    mvprintw(row++, 0, "%-8s %-16s %7s %7s %7s %7s %9s %9s %4s",
+             "TID", "Name", "CPU%", "usr%", "sys%", "wait%", "vcsw/s", "ivcsw/s", "CPU");
+
+    for (std::uint32_t i = 0; i < threads.threadCount && i < kMaxWatchedThreads; ++i) {
+        const ThreadStats& thread = threads.threads[i];
+        mvprintw(row++, 0, "%-8u %-16s %7.1f %7.1f %7.1f %7.1f %9.1f %9.1f %4d",
+                 thread.tid,
+                 thread.name,
+                 thread.cpuPercent,
+                 thread.userPercent,
+                 thread.systemPercent,
+                 thread.runQueueWaitPercent,
+                 thread.voluntarySwitchesPerSec,
+                 thread.involuntarySwitchesPerSec,
+                 thread.lastCpu);
+    }
+    return row;
+}
+
+int MonitorApp::drawProcessPanelUnlocked(int row) const {
+    const ProcessData& processes = mData.process;
+    if (processes.totalProcesses == 0) {
+        mvprintw(row++, 0, "(no process data yet)");
+        return row;
+    }
+
+    const bool events = processes.eventSource == PROCESS_SOURCE_NETLINK;
+    mvprintw(row++, 0, "%u processes, source: %s   fork/s %.1f  exec/s %.1f  exit/s %.1f",
+             processes.totalProcesses,
+             events ? "proc connector" : "/proc polling",
+             processes.forksPerSec,
+             processes.execsPerSec,
+             processes.exitsPerSec);
+    if (events) {
+        mvprintw(row++, 0, "Short-lived (exited unsampled): %llu   overflows: %llu   full rescans: %llu",
+                 static_cast<unsigned long long>(processes.shortLivedProcesses),
+                 static_cast<unsigned long long>(processes.eventOverflows),
+                 static_cast<unsigned long long>(processes.fullRescans));
+    }
+    mvprintw(row++, 0, "%-8s %-8s %-16s %2s %7s %5s %10s",
+             "PID", "PPID", "Name", "S", "CPU%", "thr", "RSS");
+
+    for (std::uint32_t i = 0; i < processes.processCount && i < kMaxProcesses; ++i) {
+        const ProcessStats& process = processes.processes[i];
+        mvprintw(row++, 0, "%-8u %-8u %-16s %2c %7.1f %5u %10s",
+                 process.pid,
+                 process.ppid,
+                 process.name,
+                 static_cast<char>(process.state),
+                 process.cpuPercent,
+                 process.threadCount,
+                 formatBytes(process.rssBytes).c_str());
+    }
+    return row;
+}
+
+int MonitorApp::drawInterruptPanelUnlocked(int row) const {
+    const InterruptData& interrupts = mData.interrupts;
+    if (interrupts.cpuCount == 0) {
+        mvprintw(row++, 0, "(no interrupt data yet)");
+        return row;
+    }
+
+    // Imbalance: busiest CPU against the mean, 1.0 means perfectly spread.
+    const std::size_t cpus = std::min<std::size_t>(interrupts.cpuCount, kMaxInterruptCpus);
+    double busiestCpuRate = 0.0;
+    for (std::size_t cpu = 0; cpu < cpus; ++cpu) {
+        busiestCpuRate = std::max(busiestCpuRate, interrupts.cpuInterruptsPerSec[cpu]);
+    }
+    const double meanCpuRate = interrupts.interruptsPerSec / static_cast<double>(interrupts.cpuCount);
+    mvprintw(row++, 0, "Load %.2f %.2f %.2f   running %u  blocked %u   irq/s %.0f  softirq/s %.0f  on %u CPUs (max/mean %.1f)",
+             interrupts.load1,
+             interrupts.load5,
+             interrupts.load15,
+             interrupts.procsRunning,
+             interrupts.procsBlocked,
+             interrupts.interruptsPerSec,
+             interrupts.softirqsPerSec,
+             interrupts.cpuCount,
+             meanCpuRate > 0.0 ? busiestCpuRate / meanCpuRate : 0.0);
+
+    row++;
+    mvprintw(row++, 0, "%-6s %-36s %10s %6s %7s", "IRQ", "Source", "per sec", "CPU", "share%");
+    for (std::uint32_t i = 0; i < interrupts.hotCount && i < kMaxHotInterrupts; ++i) {
+        const InterruptLineStats& line = interrupts.hot[i];
+        mvprintw(row++, 0, "%-6s %-36s %10.0f %6u %7.1f",
+                 line.name,
+                 line.label,
+                 line.perSec,
+                 line.busiestCpu,
+                 line.busiestCpuPercent);
+    }
+
+    row++;
+    std::string softirqs;
+    for (std::uint32_t i = 0; i < interrupts.softirqCount && i < kMaxSoftirqTypes; ++i) {
+        char cell[48];
+        std::snprintf(cell, sizeof(cell), "%s %.0f  ", interrupts.softirqs[i].name, interrupts.softirqs[i].perSec);
+        softirqs += cell;
+    }
+    mvprintw(row++, 0, "Softirq/s: %s", softirqs.c_str());
+
+    row++;
+    mvprintw(row++, 0, "Per-CPU irq/s | softirq/s");
+    constexpr std::size_t kCpusPerRow = 4;
+    for (std::size_t first = 0; first < cpus; first += kCpusPerRow) {
+        std::string line;
+        for (std::size_t cpu = first; cpu < std::min(first + kCpusPerRow, cpus); ++cpu) {
+            char cell[48];
+            std::snprintf(cell, sizeof(cell), "cpu%-4zu %8.0f | %-8.0f  ",
+                          cpu,
+                          interrupts.cpuInterruptsPerSec[cpu],
+                          interrupts.cpuSoftirqsPerSec[cpu]);
+            line += cell;
+        }
+        mvprintw(row++, 0, "%s", line.c_str());
+    }
+    return row;
+}
+
+int MonitorApp::drawCorePanelUnlocked(int row) const {
+    const TopologyData& topology = mData.topology;
+    if (topology.coreCount == 0) {
+        mvprintw(row++, 0, "(no topology data yet)");
+        return row;
+    }
+
+    mvprintw(row++, 0, "%u CPUs on %u sockets, %u NUMA nodes ('n': %s)",
+             topology.cpuCount,
+             topology.packageCount,
+             topology.nodeCount,
+             mGroupCoresByNode ? "flat view" : "group by node");
+    if (!mGroupCoresByNode) {
+        return drawCoreGrid(row, topology, true, 0);
+    }
+
+    for (std::uint32_t i = 0; i < topology.nodeCount && i < kMaxNumaNodes; ++i) {
+        const NumaNodeStats& node = topology.nodes[i];
+        row++;
+        mvprintw(row++, 0, "node%u: %u CPUs %5.1f%% %5.0fMHz  free %s / %s (file %s, anon %s)",
+                 node.node,
+                 node.cpuCount,
+                 node.usagePercent,
+                 node.averageFrequencyMhz,
+                 formatBytes(node.memFreeBytes).c_str(),
+                 formatBytes(node.memTotalBytes).c_str(),
+                 formatBytes(node.filePagesBytes).c_str(),
+                 formatBytes(node.anonPagesBytes).c_str());
+        mvprintw(row++, 0, "  page allocs/s: local %.0f  remote %.0f  miss %.0f  foreign %.0f",
+                 node.localAllocsPerSec,
+                 node.remoteAllocsPerSec,
+                 node.missesPerSec,
+                 node.foreignPerSec);
+        row = drawCoreGrid(row, topology, false, node.node);
+    }
+    if (topology.cpuCount > topology.coreCount) {
+        mvprintw(row++, 0, "... %u more CPUs not shown", topology.cpuCount - topology.coreCount);
+    }
+    return row;
+}
+
+void MonitorApp::drawLatencyOverlayUnlocked(int row) const {
+    mvprintw(row++, 0, "Pipeline latency      p50 ms     p99 ms     max ms    samples");
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        const LatencyHistogram& histogram = mLatency[stage];
+        mvprintw(row++, 0, "%s  %9.3f  %9.3f  %9.3f  %9llu",
+                 kLatencyStageNames[stage],
+                 nsToMs(histogram.valueAtPercentile(50.0)),
+                 nsToMs(histogram.valueAtPercentile(99.0)),
+                 nsToMs(histogram.max()),
+                 static_cast<unsigned long long>(histogram.count()));
+    }
+}
+
+int MonitorApp::drawPercentileOverlayUnlocked(int row) const {
+    if (mPercentileData.metricCount == 0) {
+        mvprintw(row++, 0, "Percentiles: none tracked (XMONITOR_SKETCH_METRICS)");
+        return row;
+    }
+
+    char title[32];
+    std::snprintf(title, sizeof(title), "Percentiles (+/-%.0f%%)", mPercentileData.relativeAccuracy * 100.0);
+    char header[256];
+    int length = std::snprintf(header, sizeof(header), "%-22s", title);
+    for (std::size_t w = 0; w < kPercentileWindowCount; ++w) {
+        length += std::snprintf(header + length, sizeof(header) - length, "  %-27s",
+                                (std::to_string(mPercentileData.windowSeconds[w] / 60) + "m p50/p95/p99/max").c_str());
+    }
+    mvprintw(row++, 0, "%s", header);
+
+    for (std::uint32_t m = 0; m < mPercentileData.metricCount && m < kMaxPercentileMetrics; ++m) {
+        char line[256];
+        length = std::snprintf(line, sizeof(line), "%-22s", mPercentileData.metrics[m]);
+        for (std::size_t w = 0; w < kPercentileWindowCount; ++w) {
+            const PercentileSummary& summary = mPercentileData.summaries[m][w];
+            if (summary.count == 0) {
+                length += std::snprintf(line + length, sizeof(line) - length, "  %-27s", "-");
+                continue;
+            }
+            length += std::snprintf(line + length,
+                                    sizeof(line) - length,
+                                    "  %6.1f %6.1f %6.1f %6.1f",
+                                    summary.p50,
+                                    summary.p95,
+                                    summary.p99,
+                                    summary.max);
+        }
+        mvprintw(row++, 0, "%s", line);
+    }
+    return row;
+}
+
+int MonitorApp::drawFleetPanelUnlocked(int row) const {
+    if (mFleetData.hostCount == 0) {
+        mvprintw(row++, 0, "No federated hosts (set XMONITOR_FEDERATION_LISTEN on this lifecycle,");
+        mvprintw(row++, 0, "XMONITOR_FEDERATION_UPSTREAM=<this host>:<port> on the others)");
+        return row;
+    }
+
+    mvprintw(row++, 0, "Fleet: %u hosts, %u connected   Up/Down: select, Enter: view host, 'l': local",
+             mFleetData.hostCount, mFleetData.connectedCount);
+    mvprintw(row++, 0, "%-24s %10s %10s %10s %6s", "Metric", "min", "mean", "max", "hosts");
+    for (std::size_t m = 0; m < kFleetMetricCount; ++m) {
+        const FleetRollup& rollup = mFleetData.rollups[m];
+        mvprintw(row++, 0, "%-24s %10.2f %10.2f %10.2f %6u",
+                 mFleetData.metrics[m], rollup.min, rollup.mean, rollup.max, rollup.hostCount);
+    }
+    row++;
+
+    char header[256];
+    int length = std::snprintf(header, sizeof(header), "  %-20s", "Host");
+    for (const char* label : kFleetColumnLabels) {
+        length += std::snprintf(header + length, sizeof(header) - length, " %7s", label);
+    }
+    std::snprintf(header + length, sizeof(header) - length, " %6s %7s %9s", "alerts", "age", "B/frame");
+    mvprintw(row++, 0, "%s", header);
+
+    for (std::uint32_t i = 0; i < mFleetData.rowCount && i < kFleetPageHosts; ++i) {
+        const FleetHost& host = mFleetData.hosts[i];
+        char line[256];
+        length = std::snprintf(line, sizeof(line), "%c %-20.20s",
+                               mFleetData.firstHost + i == mFleetCursor ? '>' : ' ', host.name);
+        for (std::size_t m = 0; m < kFleetMetricCount; ++m) {
+            if ((host.valueMask & (1u << m)) == 0) {
+                length += std::snprintf(line + length, sizeof(line) - length, " %7s", "-");
+            } else {
+                length += std::snprintf(line + length, sizeof(line) - length, " %7.1f", host.values[m]);
+            }
+        }
+        char age[16];
+        if (host.connected != 0) {
+            std::snprintf(age, sizeof(age), "%.1fs", static_cast<double>(host.lastFrameAgeMs) / 1000.0);
+        } else {
+            std::snprintf(age, sizeof(age), "down");
+        }
+        std::snprintf(line + length, sizeof(line) - length, " %6u %7s %9llu",
+                      host.firingAlerts,
+                      age,
+                      static_cast<unsigned long long>(host.frames == 0 ? 0 : host.bytes / host.frames));
+        mvprintw(row++, 0, "%s", line);
+    }
+    return row;
 }
 
 } // namespace xmonitor
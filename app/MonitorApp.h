@@ -1,9 +1,16 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <mutex>
+#include <string>
 
+#include "common/LatencyHistogram.h"
+#include "common/SelfUsage.h"
 #include "ipc/BinderProtocol.h"
 #include "ipc/BinderClientAdapter.h"
+#include "ipc/MetricSchema.h"
 #include "Processor.h"
 
 namespace xmonitor {
@@ -15,19 +22,106 @@ public:
 
     void handleMessage(const Message& message) override;
 
+    // `xMonitor --watch <pid>`: call before run(); the thread panel opens
+    // first and the target is cleared again on exit.
+    void setWatchTarget(std::uint32_t pid);
+
+    // `xMonitor --policy <spec>`: applies a SamplingPolicy spec (see
+    // common/SamplingPolicy.h) on top of lifecycle's current policy and
+    // prints the result, without starting the UI.
+    bool runPolicyCommand(const std::string& spec);
+
     void run();
     void requestStop();
 
 private:
+    enum AppPanel : int {
+        PANEL_OVERVIEW = 0,
+        PANEL_OVERHEAD,
+        PANEL_MEMORY,
+        PANEL_DISK,
+        PANEL_NETWORK,
+        PANEL_CGROUPS,
+        PANEL_THREADS,
+        PANEL_PROCESSES,
+        PANEL_INTERRUPTS,
+        PANEL_CORES,
+        PANEL_FLEET,
+        PANEL_COUNT
+    };
+
+    enum LatencyStage : int {
+        STAGE_SAMPLE_TO_INGEST = 0,
+        STAGE_INGEST_TO_RECEIVE,
+        STAGE_RECEIVE_TO_DRAW,
+        STAGE_SAMPLE_TO_DRAW,
+        STAGE_COUNT
+    };
+
     bool registerToLifecycle();
     bool querySnapshot(BinderSnapshot& snapshot);
+    bool queryPercentiles(PercentileData& data);
+    bool queryFleet(std::uint32_t firstHost, FleetData& data);
+    bool queryHostSnapshot(std::uint32_t hostId, BinderSnapshot& snapshot);
+    void stampReceive(BinderSnapshot& snapshot) const;
+    bool sendWatchTarget(std::uint32_t pid);
+    bool queryPolicy(SamplingPolicy& policy);
+    // Read-modify-write of lifecycle's policy; retried when another editor
+    // got in between.
+    bool updatePolicy(const std::string& spec, SamplingPolicy& outPolicy, std::string& outError);
+    void postPolicy(const SamplingPolicy& policy);
     void publishSnapshot(const BinderSnapshot& snapshot);
+    void handleKey(int key);
+    void traceDrawUnlocked(const SampleTrace& trace, std::uint64_t& lastTracedSampleNs, std::uint64_t drawNs);
+    void sampleSelfUsage();
     void redrawUnlocked() const;
+    int drawOverviewUnlocked(int row) const;
+    int drawOverheadPanelUnlocked(int row) const;
+    int drawMemoryPanelUnlocked(int row) const;
+    int drawDiskPanelUnlocked(int row) const;
+    void drawAlertBannerUnlocked(int row) const;
+    int drawNetworkPanelUnlocked(int row) const;
+    int drawCgroupPanelUnlocked(int row) const;
+    int drawThreadPanelUnlocked(int row) const;
+    int drawProcessPanelUnlocked(int row) const;
+    int drawInterruptPanelUnlocked(int row) const;
+    int drawCorePanelUnlocked(int row) const;
+    int drawFleetPanelUnlocked(int row) const;
+    void drawLatencyOverlayUnlocked(int row) const;
+    int drawPercentileOverlayUnlocked(int row) const;
 
     mutable std::mutex mDataMutex;
-    CpuData mCpuData{};
-    RamData mRamData{};
-    MemoryData mMemoryData{};
+    // Every snapshot section, as generated from MetricSchema.
+    BinderSnapshot mData{};
+    PercentileData mPercentileData{};
+    FleetData mFleetData{};
+    SamplingPolicy mPolicy{};
+
+    std::array<LatencyHistogram, STAGE_COUNT> mLatency{};
+    // Per MetricSchema section.
+    std::array<std::uint64_t, MetricSchema::kCount> mLastTracedNs{};
+    bool mShowLatencyOverlay{false};
+    bool mShowPercentileOverlay{false};
+    std::uint64_t mLastPercentileQueryNs{0};
+    std::uint64_t mLastFleetQueryNs{0};
+    std::uint64_t mLastPolicyQueryNs{0};
+    // Preset last picked with 'r'; applied by the run loop, outside the lock.
+    std::size_t mPolicyPreset{0};
+    bool mPolicyPresetPending{false};
+    // Position in the aggregator's name-sorted host list.
+    std::uint32_t mFleetCursor{0};
+    // Non-zero while the panels show a federated host instead of this one.
+    std::uint32_t mViewHostId{0};
+    char mViewHostName[kFleetHostNameLength]{};
+    int mActivePanel{PANEL_OVERVIEW};
+    int mCgroupSortKey{CGROUP_SORT_CPU};
+    bool mGroupCoresByNode{true};
+    std::uint32_t mWatchPid{0};
+    double mCpuBudgetPercent{0.0};
+
+    SelfUsageSampler mSelfUsageSampler{ProcessRole::App};
+    std::uint64_t mRedrawCount{0};
+    std::uint64_t mLastSelfUsageNs{0};
 
     BinderClientAdapter mBinderAdapter;
 };
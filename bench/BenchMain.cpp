@@ -0,0 +1,54 @@
+#include <cstdio>
+#include <cstring>
+
+#include "Logger.h"
+#include "bench/CollectorBench.h"
+#include "bench/FederationBench.h"
+#include "bench/IpcBench.h"
+#include "bench/JitterBench.h"
+#include "bench/ProcfsRecorder.h"
+
+namespace {
+
+void printUsage() {
+    std::fprintf(stderr,
+                 "usage: xMonitorBench <suite> [options]\n"
+                 "suites:\n"
+                 "  ipc         binder send/transact/reply latency and throughput\n"
+                 "  record      capture procfs/sysfs into a fixture directory\n"
+                 "  collectors  replay a fixture through every collector parser\n"
+                 "  federation  snapshot delta codec and loopback leaf->aggregator push\n"
+                 "  jitter      sampling tick wakeup latency, default vs low-jitter mode\n"
+                 "Results are written as one JSON object per line.\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return 2;
+    }
+
+    setLogFilePath("logs/xMonitor-bench.log");
+
+    if (std::strcmp(argv[1], "ipc") == 0) {
+        return xmonitor::bench::runIpcBench(argc - 2, argv + 2);
+    }
+    if (std::strcmp(argv[1], "record") == 0) {
+        return xmonitor::bench::runProcfsRecorder(argc - 2, argv + 2);
+    }
+    if (std::strcmp(argv[1], "collectors") == 0) {
+        return xmonitor::bench::runCollectorBench(argc - 2, argv + 2);
+    }
+
+    if (std::strcmp(argv[1], "federation") == 0) {
+        return xmonitor::bench::runFederationBench(argc - 2, argv + 2);
+    }
+    if (std::strcmp(argv[1], "jitter") == 0) {
+        return xmonitor::bench::runJitterBench(argc - 2, argv + 2);
+    }
+
+    printUsage();
+    return 2;
+}
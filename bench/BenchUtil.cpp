@@ -0,0 +1,96 @@
+#include "bench/BenchUtil.h"
+
+#include <cerrno>
+#include <cstdlib>
+
+#include <unistd.h>
+
+namespace xmonitor {
+namespace bench {
+
+bool parseSizeList(const char* text, std::vector<std::size_t>& outValues) {
+    outValues.clear();
+    const char* cursor = text;
+    while (*cursor != '\0') {
+        char* end = nullptr;
+        const unsigned long long value = std::strtoull(cursor, &end, 10);
+        if (end == cursor || value == 0) {
+            return false;
+        }
+
+        outValues.push_back(static_cast<std::size_t>(value));
+        cursor = end;
+        if (*cursor == ',') {
+            ++cursor;
+        } else if (*cursor != '\0') {
+            return false;
+        }
+    }
+    return !outValues.empty();
+}
+
+bool writeAll(int fd, const void* data, std::size_t size) {
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    while (size > 0) {
+        const ssize_t written = ::write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+bool readAll(int fd, void* data, std::size_t size) {
+    auto* bytes = static_cast<std::uint8_t*>(data);
+    while (size > 0) {
+        const ssize_t bytesRead = ::read(fd, bytes, size);
+        if (bytesRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (bytesRead == 0) {
+            return false;
+        }
+        bytes += bytesRead;
+        size -= static_cast<std::size_t>(bytesRead);
+    }
+    return true;
+}
+
+std::string latencyJson(const LatencyHistogram& histogram) {
+    char buffer[256];
+    std::snprintf(buffer,
+                  sizeof(buffer),
+                  "{\"p50\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu,\"count\":%llu}",
+                  static_cast<unsigned long long>(histogram.valueAtPercentile(50.0)),
+                  static_cast<unsigned long long>(histogram.valueAtPercentile(99.0)),
+                  static_cast<unsigned long long>(histogram.valueAtPercentile(99.9)),
+                  static_cast<unsigned long long>(histogram.max()),
+                  static_cast<unsigned long long>(histogram.count()));
+    return buffer;
+}
+
+std::FILE* openOutput(const std::string& path) {
+    if (path.empty()) {
+        return stdout;
+    }
+    return std::fopen(path.c_str(), "w");
+}
+
+void closeOutput(std::FILE* output) {
+    if (output != nullptr && output != stdout) {
+        std::fclose(output);
+    } else if (output == stdout) {
+        std::fflush(stdout);
+    }
+}
+
+} // namespace bench
+} // namespace xmonitor
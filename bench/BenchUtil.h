@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "common/LatencyHistogram.h"
+
+namespace xmonitor {
+namespace bench {
+
+// Parses "1,2,4" into {1, 2, 4}; returns false on malformed input.
+bool parseSizeList(const char* text, std::vector<std::size_t>& outValues);
+
+bool writeAll(int fd, const void* data, std::size_t size);
+bool readAll(int fd, void* data, std::size_t size);
+
+// Emits {"p50":..,"p99":..,"p999":..,"max":..,"count":..} for a histogram.
+std::string latencyJson(const LatencyHistogram& histogram);
+
+// Opens path for writing, or returns stdout when path is empty.
+std::FILE* openOutput(const std::string& path);
+void closeOutput(std::FILE* output);
+
+} // namespace bench
+} // namespace xmonitor
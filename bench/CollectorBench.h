@@ -0,0 +1,11 @@
+#pragma once
+
+namespace xmonitor {
+namespace bench {
+
+// `xMonitorBench collectors`: replays a recorded procfs/sysfs fixture through
+// every collector and reports parse latency and throughput per collector.
+int runCollectorBench(int argc, char** argv);
+
+} // namespace bench
+} // namespace xmonitor
@@ -0,0 +1,332 @@
+#include "bench/FederationBench.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Logger.h"
+#include "bench/BenchUtil.h"
+#include "common/LatencyHistogram.h"
+#include "common/MonotonicClock.h"
+#include "ipc/BinderProtocol.h"
+#include "lifecycle/FederationCodec.h"
+#include "lifecycle/FederationServer.h"
+#include "lifecycle/FederationUplink.h"
+
+namespace xmonitor {
+namespace bench {
+namespace {
+
+constexpr std::uint64_t kSampleIntervalNs = 1000000000ull;
+constexpr std::uint64_t kConvergeTimeoutNs = 10000000000ull;
+
+struct FederationBenchOptions {
+    std::vector<std::size_t> hosts{1, 16, 64};
+    std::size_t frames{50};
+    std::size_t intervalMs{20};
+    std::string outputPath;
+};
+
+void printUsage() {
+    std::fprintf(stderr,
+                 "usage: xMonitorBench federation [--hosts 1,16,64] [--frames N] [--interval-ms N]\n"
+                 "                                [--output file.jsonl]\n");
+}
+
+bool parseOptions(int argc, char** argv, FederationBenchOptions& options) {
+    for (int i = 0; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--hosts" && hasValue) {
+            if (!parseSizeList(argv[++i], options.hosts)) {
+                return false;
+            }
+        } else if (arg == "--frames" && hasValue) {
+            options.frames = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+            if (options.frames == 0) {
+                return false;
+            }
+        } else if (arg == "--interval-ms" && hasValue) {
+            options.intervalMs = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+            if (options.intervalMs == 0) {
+                return false;
+            }
+        } else if (arg == "--output" && hasValue) {
+            options.outputPath = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A busy host as the services would report it: full process table, a few
+// disks, per-core usage; every tick moves the rates, counters and sample
+// times and a quarter of the process rows.
+class SyntheticHost {
+public:
+    explicit SyntheticHost(std::uint32_t seed)
+        : mRandom(seed),
+          mSnapshot(std::make_unique<BinderSnapshot>()) {
+        BinderSnapshot& s = *mSnapshot;
+        s.ram.totalBytes = 64ull << 30;
+        s.topology.cpuCount = 16;
+        s.topology.coreCount = 8;
+        s.topology.nodeCount = 1;
+        s.topology.packageCount = 1;
+        for (std::uint32_t cpu = 0; cpu < s.topology.cpuCount; ++cpu) {
+            s.topology.cores[cpu].cpu = cpu;
+            s.topology.cores[cpu].core = cpu / 2;
+            s.topology.cores[cpu].frequencyMhz = 2400;
+        }
+        s.disk.deviceCount = 4;
+        s.process.processCount = static_cast<std::uint32_t>(kMaxProcesses);
+        s.process.totalProcesses = 400;
+        for (std::size_t i = 0; i < kMaxProcesses; ++i) {
+            ProcessStats& process = s.process.processes[i];
+            process.pid = 1000 + static_cast<std::uint32_t>(i) * 7;
+            process.ppid = 1;
+            process.threadCount = 4;
+            std::snprintf(process.name, sizeof(process.name), "worker-%zu", i);
+        }
+        mNowNs = 1000000000ull * (seed + 1);
+    }
+
+    void tick() {
+        BinderSnapshot& s = *mSnapshot;
+        std::uniform_real_distribution<double> percent(0.0, 100.0);
+        mNowNs += kSampleIntervalNs + mRandom() % 1000000;
+
+        s.cpu.totalJiffies += 1600;
+        s.cpu.idleJiffies += mRandom() % 1600;
+        s.cpu.usagePercent = percent(mRandom);
+        s.cpu.userPercent = percent(mRandom);
+        s.cpu.systemPercent = percent(mRandom);
+        s.cpu.idlePercent = 100.0 - s.cpu.usagePercent;
+        s.cpu.trace.sampleNs = mNowNs;
+        s.cpu.trace.ingestNs = mNowNs + 20000;
+
+        s.ram.usedBytes = (s.ram.totalBytes / 2) + (mRandom() % (1ull << 30));
+        s.ram.availableBytes = s.ram.totalBytes - s.ram.usedBytes;
+        s.ram.usagePercent = 100.0 * static_cast<double>(s.ram.usedBytes) / static_cast<double>(s.ram.totalBytes);
+        s.ram.trace.sampleNs = mNowNs;
+        s.ram.trace.ingestNs = mNowNs + 20000;
+
+        s.pressure.cpu.available = 1;
+        s.pressure.cpu.some.avg10 = percent(mRandom) / 10.0;
+        s.pressure.cpu.some.totalUs += mRandom() % 10000;
+        s.pressure.trace.sampleNs = mNowNs;
+
+        s.interrupts.load1 = percent(mRandom) / 10.0;
+        s.interrupts.interruptsPerSec = percent(mRandom) * 1000.0;
+        s.interrupts.trace.sampleNs = mNowNs;
+
+        for (std::uint32_t cpu = 0; cpu < s.topology.cpuCount; ++cpu) {
+            s.topology.cores[cpu].usagePercent = percent(mRandom);
+        }
+        s.topology.trace.sampleNs = mNowNs;
+
+        for (std::size_t i = 0; i < kMaxProcesses; ++i) {
+            if (mRandom() % 4 == 0) {
+                s.process.processes[i].cpuPercent = percent(mRandom) / 4.0;
+                s.process.processes[i].rssBytes = (64ull << 20) + (mRandom() % (1ull << 26));
+            }
+        }
+        s.process.forksPerSec = percent(mRandom);
+        s.process.trace.sampleNs = mNowNs;
+    }
+
+    const BinderSnapshot& snapshot() const {
+        return *mSnapshot;
+    }
+
+private:
+    std::mt19937_64 mRandom;
+    std::unique_ptr<BinderSnapshot> mSnapshot;
+    std::uint64_t mNowNs{0};
+};
+
+void runCodec(const FederationBenchOptions& options, std::FILE* output) {
+    SyntheticHost host(1);
+    SnapshotDeltaEncoder encoder;
+    auto decoded = std::make_unique<BinderSnapshot>();
+    std::vector<std::uint8_t> payload;
+    LatencyHistogram encodeNs;
+    LatencyHistogram decodeNs;
+
+    std::size_t keyBytes = 0;
+    std::uint64_t deltaBytes = 0;
+    bool ok = true;
+    const std::size_t frames = options.frames * 20;
+    for (std::size_t frame = 0; frame <= frames; ++frame) {
+        host.tick();
+
+        const std::uint64_t encodeStartNs = monotonicNowNs();
+        encoder.encode(host.snapshot(), payload);
+        const std::uint64_t decodeStartNs = monotonicNowNs();
+        ok = applySnapshotDelta(payload.data(), payload.size(), *decoded) && ok;
+        const std::uint64_t endNs = monotonicNowNs();
+
+        if (frame == 0) {
+            keyBytes = payload.size();
+            continue;
+        }
+        deltaBytes += payload.size();
+        encodeNs.record(decodeStartNs - encodeStartNs);
+        decodeNs.record(endNs - decodeStartNs);
+    }
+    ok = ok && std::memcmp(decoded.get(), &host.snapshot(), sizeof(BinderSnapshot)) == 0;
+
+    std::fprintf(output,
+                 "{\"bench\":\"federation\",\"case\":\"codec\",\"ok\":%s,\"snapshot_bytes\":%zu,"
+                 "\"key_bytes\":%zu,\"delta_bytes_avg\":%.1f,\"frames\":%zu,\"encode_ns\":%s,\"decode_ns\":%s}\n",
+                 ok ? "true" : "false",
+                 sizeof(BinderSnapshot),
+                 keyBytes,
+                 static_cast<double>(deltaBytes) / static_cast<double>(frames),
+                 frames,
+                 latencyJson(encodeNs).c_str(),
+                 latencyJson(decodeNs).c_str());
+    std::fflush(output);
+}
+
+bool runLoopback(std::size_t hostCount, const FederationBenchOptions& options, std::FILE* output) {
+    FederationServer::Options serverOptions;
+    serverOptions.address = "127.0.0.1";
+    serverOptions.port = 0;
+    FederationServer server(serverOptions);
+    if (!server.start()) {
+        std::fprintf(stderr, "federation server failed to start\n");
+        return false;
+    }
+
+    std::vector<std::unique_ptr<SyntheticHost>> hosts;
+    std::vector<std::unique_ptr<FederationUplink>> uplinks;
+    for (std::size_t i = 0; i < hostCount; ++i) {
+        hosts.push_back(std::make_unique<SyntheticHost>(static_cast<std::uint32_t>(i + 1)));
+
+        FederationUplink::Options uplinkOptions;
+        uplinkOptions.host = "127.0.0.1";
+        uplinkOptions.port = server.port();
+        uplinkOptions.name = "bench-" + std::to_string(i);
+        uplinkOptions.intervalMs = static_cast<std::uint32_t>(options.intervalMs);
+        uplinks.push_back(std::make_unique<FederationUplink>(uplinkOptions));
+        uplinks.back()->start();
+    }
+
+    // Several snapshot changes per send interval, as a busy lifecycle sees.
+    const auto tickPeriod = std::chrono::milliseconds(options.intervalMs) / 4;
+    std::uint64_t generation = 0;
+    for (std::size_t tick = 0; tick < options.frames * 4; ++tick) {
+        ++generation;
+        for (std::size_t i = 0; i < hostCount; ++i) {
+            hosts[i]->tick();
+            uplinks[i]->publish(hosts[i]->snapshot(), generation, monotonicNowNs());
+        }
+        std::this_thread::sleep_for(tickPeriod);
+    }
+
+    // Converged once every host's aggregated snapshot equals its source.
+    const std::uint64_t settleStartNs = monotonicNowNs();
+    auto received = std::make_unique<BinderSnapshot>();
+    std::vector<std::uint32_t> hostIds(hostCount, 0);
+    std::size_t converged = 0;
+    while (converged < hostCount && monotonicNowNs() - settleStartNs < kConvergeTimeoutNs) {
+        FleetData fleet{};
+        for (std::uint32_t first = 0; first == 0 || first < fleet.hostCount; first += kFleetPageHosts) {
+            server.fleet(first, monotonicNowNs(), fleet);
+            for (std::uint32_t row = 0; row < fleet.rowCount; ++row) {
+                const std::size_t index = std::strtoul(fleet.hosts[row].name + std::strlen("bench-"), nullptr, 10);
+                if (index < hostCount) {
+                    hostIds[index] = fleet.hosts[row].id;
+                }
+            }
+            if (fleet.rowCount == 0) {
+                break;
+            }
+        }
+
+        converged = 0;
+        for (std::size_t i = 0; i < hostCount; ++i) {
+            // A publish that lost the try_lock race is retried here.
+            uplinks[i]->publish(hosts[i]->snapshot(), generation, monotonicNowNs());
+            if (hostIds[i] != 0 && server.hostSnapshot(hostIds[i], *received) &&
+                std::memcmp(received.get(), &hosts[i]->snapshot(), sizeof(BinderSnapshot)) == 0) {
+                ++converged;
+            }
+        }
+        if (converged < hostCount) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(options.intervalMs));
+        }
+    }
+    const double settleMs = static_cast<double>(monotonicNowNs() - settleStartNs) / 1e6;
+
+    std::uint64_t framesSent = 0;
+    std::uint64_t keyframesSent = 0;
+    std::uint64_t bytesSent = 0;
+    for (const std::unique_ptr<FederationUplink>& uplink : uplinks) {
+        uplink->stop();
+        framesSent += uplink->framesSent();
+        keyframesSent += uplink->keyframesSent();
+        bytesSent += uplink->bytesSent();
+    }
+    const std::uint64_t framesReceived = server.framesReceived();
+    const std::uint64_t decodeNs = server.decodeNs();
+    server.stop();
+
+    const bool ok = converged == hostCount;
+    std::fprintf(output,
+                 "{\"bench\":\"federation\",\"case\":\"loopback\",\"hosts\":%zu,\"ok\":%s,\"converged\":%zu,"
+                 "\"interval_ms\":%zu,\"frames_sent\":%llu,\"keyframes\":%llu,\"frames_received\":%llu,"
+                 "\"bytes_per_frame\":%.1f,\"decode_ns_avg\":%.0f,\"settle_ms\":%.1f}\n",
+                 hostCount,
+                 ok ? "true" : "false",
+                 converged,
+                 options.intervalMs,
+                 static_cast<unsigned long long>(framesSent),
+                 static_cast<unsigned long long>(keyframesSent),
+                 static_cast<unsigned long long>(framesReceived),
+                 framesSent == 0 ? 0.0 : static_cast<double>(bytesSent) / static_cast<double>(framesSent),
+                 framesReceived == 0 ? 0.0 : static_cast<double>(decodeNs) / static_cast<double>(framesReceived),
+                 settleMs);
+    std::fflush(output);
+    return ok;
+}
+
+} // namespace
+
+int runFederationBench(int argc, char** argv) {
+    FederationBenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+
+    std::FILE* output = openOutput(options.outputPath);
+    if (output == nullptr) {
+        std::fprintf(stderr, "bench setup failed\n");
+        return 1;
+    }
+
+    runCodec(options, output);
+
+    int status = 0;
+    for (std::size_t hostCount : options.hosts) {
+        if (!runLoopback(hostCount, options, output)) {
+            status = 1;
+        }
+    }
+
+    closeOutput(output);
+    return status;
+}
+
+} // namespace bench
+} // namespace xmonitor
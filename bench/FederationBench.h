@@ -0,0 +1,12 @@
+#pragma once
+
+namespace xmonitor {
+namespace bench {
+
+// `xMonitorBench federation`: snapshot delta codec cost and size, then N
+// leaf uplinks pushing synthetic snapshots to one aggregator on loopback.
+// Needs no binder, so it runs next to a live lifecycle.
+int runFederationBench(int argc, char** argv);
+
+} // namespace bench
+} // namespace xmonitor
@@ -0,0 +1,456 @@
+#include "bench/IpcBench.h"
+
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Logger.h"
+#include "bench/BenchUtil.h"
+#include "common/LatencyHistogram.h"
+#include "common/MonotonicClock.h"
+#include "ipc/BinderClientAdapter.h"
+#include "ipc/BinderServerAdapter.h"
+
+namespace xmonitor {
+namespace bench {
+namespace {
+
+// Codes outside the xMonitor protocol range. With binder the bench server
+// owns the context manager slot, so lifecycle must not be running; the
+// seqpacket server listens on a private abstract socket instead.
+constexpr std::uint32_t kBenchOneWay = 900;
+constexpr std::uint32_t kBenchRoundTrip = 901;
+constexpr std::uint32_t kBenchCollect = 902;
+// kAsyncKeys one-way codes starting here.
+constexpr std::uint32_t kBenchAsyncBase = 910;
+
+// Messages per sendBatch() call for the "batch" op.
+constexpr std::size_t kBatchSize = 32;
+// Codes the "async" op cycles through, like a service's update codes.
+constexpr std::uint32_t kAsyncKeys = 8;
+
+enum class BenchOp {
+    OneWay,
+    RoundTrip,
+    Batch,
+    Async
+};
+
+struct IpcBenchOptions {
+    std::vector<TransportKind> transports{TransportKind::Binder, TransportKind::Seqpacket};
+    std::vector<BenchOp> ops{BenchOp::OneWay, BenchOp::RoundTrip};
+    std::vector<std::size_t> payloads{16, 64, 256, 1024, 4096};
+    std::vector<std::size_t> clients{1, 2, 4};
+    std::size_t iterations{20000};
+    // Busy time per one-way message on the server, to model a slow lifecycle.
+    std::uint64_t serverWorkNs{0};
+    std::string outputPath;
+};
+
+struct ClientResult {
+    std::uint32_t ok{0};
+    std::uint64_t ops{0};
+    std::uint64_t startNs{0};
+    std::uint64_t endNs{0};
+    std::uint64_t coalesced{0};
+    std::uint64_t dropped{0};
+    LatencyHistogram latency;
+};
+
+static_assert(std::is_trivially_copyable<ClientResult>::value, "ClientResult is sent through a pipe");
+
+const char* opName(BenchOp op) {
+    switch (op) {
+        case BenchOp::OneWay:
+            return "oneway";
+        case BenchOp::RoundTrip:
+            return "roundtrip";
+        case BenchOp::Batch:
+            return "batch";
+        case BenchOp::Async:
+        default:
+            return "async";
+    }
+}
+
+void printUsage() {
+    std::fprintf(stderr,
+                 "usage: xMonitorBench ipc [--transports binder,seqpacket] [--ops oneway,roundtrip,batch,async]\n"
+                 "                         [--payloads 16,64,...] [--clients 1,2,4] [--iterations N]\n"
+                 "                         [--server-work-us N] [--output file.jsonl]\n");
+}
+
+bool parseOptions(int argc, char** argv, IpcBenchOptions& options) {
+    for (int i = 0; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--payloads" && hasValue) {
+            if (!parseSizeList(argv[++i], options.payloads)) {
+                return false;
+            }
+        } else if (arg == "--clients" && hasValue) {
+            if (!parseSizeList(argv[++i], options.clients)) {
+                return false;
+            }
+        } else if (arg == "--iterations" && hasValue) {
+            options.iterations = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+            if (options.iterations == 0) {
+                return false;
+            }
+        } else if (arg == "--server-work-us" && hasValue) {
+            options.serverWorkNs = std::strtoull(argv[++i], nullptr, 10) * 1000ull;
+        } else if (arg == "--output" && hasValue) {
+            options.outputPath = argv[++i];
+        } else if (arg == "--ops" && hasValue) {
+            const std::string ops = argv[++i];
+            options.ops.clear();
+            if (ops.find("oneway") != std::string::npos) {
+                options.ops.push_back(BenchOp::OneWay);
+            }
+            if (ops.find("roundtrip") != std::string::npos) {
+                options.ops.push_back(BenchOp::RoundTrip);
+            }
+            if (ops.find("batch") != std::string::npos) {
+                options.ops.push_back(BenchOp::Batch);
+            }
+            if (ops.find("async") != std::string::npos) {
+                options.ops.push_back(BenchOp::Async);
+            }
+            if (options.ops.empty()) {
+                return false;
+            }
+        } else if (arg == "--transports" && hasValue) {
+            const std::string transports = argv[++i];
+            options.transports.clear();
+            if (transports.find("binder") != std::string::npos) {
+                options.transports.push_back(TransportKind::Binder);
+            }
+            if (transports.find("seqpacket") != std::string::npos) {
+                options.transports.push_back(TransportKind::Seqpacket);
+            }
+            if (options.transports.empty()) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+[[noreturn]] void runServer(std::uint64_t workNs, int readyFd, int statsFd) {
+    BinderServerAdapter server;
+    const std::uint8_t ready = server.initializeContextManager() ? 1 : 0;
+    writeAll(readyFd, &ready, sizeof(ready));
+    if (ready == 0) {
+        _exit(1);
+    }
+
+    LatencyHistogram replyLatency;
+    server.setTransactionCallback([&](std::uint32_t code, const void* payload, std::size_t payloadSize) {
+        switch (code) {
+            case kBenchRoundTrip: {
+                const std::uint64_t startNs = monotonicNowNs();
+                server.reply(code, payload, payloadSize);
+                replyLatency.record(monotonicNowNs() - startNs);
+                break;
+            }
+            case kBenchCollect: {
+                writeAll(statsFd, &replyLatency, sizeof(replyLatency));
+                replyLatency.reset();
+                const std::uint32_t ok = 1;
+                server.reply(code, &ok, sizeof(ok));
+                break;
+            }
+            case kBenchOneWay:
+            default: {
+                const std::uint64_t startNs = workNs != 0 ? monotonicNowNs() : 0;
+                while (workNs != 0 && monotonicNowNs() - startNs < workNs) {
+                }
+                break;
+            }
+        }
+    });
+
+    server.loop();
+    _exit(0);
+}
+
+[[noreturn]] void runClient(BenchOp op,
+                            std::size_t payloadSize,
+                            std::size_t iterations,
+                            int warmFd,
+                            int goFd,
+                            int resultFd) {
+    ClientResult result;
+    BinderClientAdapter client;
+    if (!client.initialize()) {
+        writeAll(resultFd, &result, sizeof(result));
+        _exit(1);
+    }
+
+    std::vector<std::uint8_t> payload(payloadSize, 0xA5);
+    std::vector<std::uint8_t> reply(payloadSize);
+    std::vector<OutgoingMessage> batch(kBatchSize, OutgoingMessage{kBenchOneWay, payload.data(), payload.size()});
+    const std::uint64_t messagesPerCall = op == BenchOp::Batch ? kBatchSize : 1;
+    if (op == BenchOp::Async && !client.startAsyncSender()) {
+        writeAll(resultFd, &result, sizeof(result));
+        _exit(1);
+    }
+    std::uint32_t asyncKey = 0;
+    const auto callOnce = [&]() {
+        if (op == BenchOp::OneWay) {
+            return client.send(kBenchOneWay, payload.data(), payload.size());
+        }
+        if (op == BenchOp::Async) {
+            asyncKey = (asyncKey + 1) % kAsyncKeys;
+            return client.send(kBenchAsyncBase + asyncKey, payload.data(), payload.size());
+        }
+        if (op == BenchOp::Batch) {
+            return client.sendBatch(batch.data(), batch.size()) == batch.size();
+        }
+        std::size_t replySize = 0;
+        return client.transact(kBenchRoundTrip, payload.data(), payload.size(), reply.data(), reply.size(), replySize) &&
+               replySize == payload.size();
+    };
+
+    const std::size_t warmup = iterations / 10 < 1000 ? iterations / 10 : 1000;
+    for (std::size_t i = 0; i < warmup; ++i) {
+        callOnce();
+    }
+
+    // Start barrier: the parent closes the write end once every client is warm.
+    const std::uint8_t warm = 1;
+    writeAll(warmFd, &warm, sizeof(warm));
+    std::uint8_t go = 0;
+    while (::read(goFd, &go, sizeof(go)) > 0) {
+    }
+
+    const BinderClientAdapter::AsyncSendStats warmStats = client.asyncSendStats();
+    result.ok = 1;
+    result.startNs = monotonicNowNs();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        const std::uint64_t callStartNs = monotonicNowNs();
+        if (!callOnce()) {
+            result.ok = 0;
+            break;
+        }
+        result.latency.record(monotonicNowNs() - callStartNs);
+        result.ops += messagesPerCall;
+    }
+    result.endNs = monotonicNowNs();
+
+    // Flushes the async sender, so every update is either delivered or
+    // counted below.
+    client.shutdown();
+    const BinderClientAdapter::AsyncSendStats stats = client.asyncSendStats();
+    result.coalesced = stats.coalesced - warmStats.coalesced;
+    result.dropped = stats.dropped - warmStats.dropped;
+    writeAll(resultFd, &result, sizeof(result));
+    _exit(result.ok != 0 ? 0 : 1);
+}
+
+bool collectServerStats(BinderClientAdapter& control, int statsFd, LatencyHistogram& outReplyLatency) {
+    const std::uint32_t request = 1;
+    std::uint32_t ack = 0;
+    std::size_t replySize = 0;
+    if (!control.transact(kBenchCollect, &request, sizeof(request), &ack, sizeof(ack), replySize)) {
+        return false;
+    }
+    return readAll(statsFd, &outReplyLatency, sizeof(outReplyLatency));
+}
+
+bool runConfiguration(TransportKind transport,
+                      BenchOp op,
+                      std::size_t payloadSize,
+                      std::size_t clientCount,
+                      const IpcBenchOptions& options,
+                      BinderClientAdapter& control,
+                      int statsFd,
+                      std::FILE* output) {
+    int warmPipe[2];
+    int goPipe[2];
+    int resultPipe[2];
+    if (::pipe(warmPipe) != 0 || ::pipe(goPipe) != 0 || ::pipe(resultPipe) != 0) {
+        LOG_E("bench pipe failed");
+        return false;
+    }
+
+    std::vector<pid_t> children;
+    for (std::size_t i = 0; i < clientCount; ++i) {
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            ::close(warmPipe[0]);
+            ::close(goPipe[1]);
+            ::close(resultPipe[0]);
+            runClient(op, payloadSize, options.iterations, warmPipe[1], goPipe[0], resultPipe[1]);
+        }
+        if (pid > 0) {
+            children.push_back(pid);
+        }
+    }
+
+    ::close(warmPipe[1]);
+    ::close(goPipe[0]);
+    ::close(resultPipe[1]);
+
+    for (std::size_t i = 0; i < children.size(); ++i) {
+        std::uint8_t warm = 0;
+        if (!readAll(warmPipe[0], &warm, sizeof(warm))) {
+            break;
+        }
+    }
+    ::close(warmPipe[0]);
+    ::close(goPipe[1]);
+
+    LatencyHistogram latency;
+    std::uint64_t totalOps = 0;
+    std::uint64_t coalesced = 0;
+    std::uint64_t dropped = 0;
+    std::uint64_t firstStartNs = UINT64_MAX;
+    std::uint64_t lastEndNs = 0;
+    bool ok = children.size() == clientCount;
+    for (std::size_t i = 0; i < children.size(); ++i) {
+        ClientResult result;
+        if (!readAll(resultPipe[0], &result, sizeof(result)) || result.ok == 0) {
+            ok = false;
+            continue;
+        }
+        latency.merge(result.latency);
+        totalOps += result.ops;
+        coalesced += result.coalesced;
+        dropped += result.dropped;
+        firstStartNs = result.startNs < firstStartNs ? result.startNs : firstStartNs;
+        lastEndNs = result.endNs > lastEndNs ? result.endNs : lastEndNs;
+    }
+    ::close(resultPipe[0]);
+
+    for (pid_t pid : children) {
+        ::waitpid(pid, nullptr, 0);
+    }
+
+    LatencyHistogram replyLatency;
+    if (!collectServerStats(control, statsFd, replyLatency)) {
+        LOG_E("bench server stats collect failed");
+    }
+
+    const double elapsedSec = lastEndNs > firstStartNs ? static_cast<double>(lastEndNs - firstStartNs) / 1e9 : 0.0;
+    const double opsPerSec = elapsedSec > 0.0 ? static_cast<double>(totalOps) / elapsedSec : 0.0;
+    std::fprintf(output,
+                 "{\"bench\":\"ipc\",\"transport\":\"%s\",\"op\":\"%s\",\"payload_bytes\":%zu,\"clients\":%zu,"
+                 "\"ok\":%s,\"ops\":%llu,\"elapsed_s\":%.6f,\"ops_per_sec\":%.1f,\"mib_per_sec\":%.3f,"
+                 "\"coalesced\":%llu,\"dropped\":%llu,\"latency_ns\":%s,\"server_reply_ns\":%s}\n",
+                 transportName(transport),
+                 opName(op),
+                 payloadSize,
+                 clientCount,
+                 ok ? "true" : "false",
+                 static_cast<unsigned long long>(totalOps),
+                 elapsedSec,
+                 opsPerSec,
+                 opsPerSec * static_cast<double>(payloadSize) / (1024.0 * 1024.0),
+                 static_cast<unsigned long long>(coalesced),
+                 static_cast<unsigned long long>(dropped),
+                 latencyJson(latency).c_str(),
+                 latencyJson(replyLatency).c_str());
+    std::fflush(output);
+    return ok;
+}
+
+// Forks the bench server on `transport` and runs every configuration
+// against it. The children inherit the transport through XMONITOR_IPC.
+bool runTransport(TransportKind transport, const IpcBenchOptions& options, std::FILE* output) {
+    const std::string socketPath = "@xmonitor-bench-" + std::to_string(::getpid());
+    ::setenv("XMONITOR_IPC", transportName(transport), 1);
+    ::setenv("XMONITOR_IPC_SOCKET", socketPath.c_str(), 1);
+
+    int readyPipe[2];
+    int statsPipe[2];
+    if (::pipe(readyPipe) != 0 || ::pipe(statsPipe) != 0) {
+        LOG_E("bench pipe failed");
+        return false;
+    }
+
+    const pid_t serverPid = ::fork();
+    if (serverPid == 0) {
+        ::close(readyPipe[0]);
+        ::close(statsPipe[0]);
+        runServer(options.serverWorkNs, readyPipe[1], statsPipe[1]);
+    }
+    ::close(readyPipe[1]);
+    ::close(statsPipe[1]);
+
+    std::uint8_t ready = 0;
+    if (serverPid < 0 || !readAll(readyPipe[0], &ready, sizeof(ready)) || ready == 0) {
+        std::fprintf(stderr,
+                     "bench %s server failed to start (binder: is xMonitorLifecycle running?)\n",
+                     transportName(transport));
+        if (serverPid > 0) {
+            ::waitpid(serverPid, nullptr, 0);
+        }
+        ::close(readyPipe[0]);
+        ::close(statsPipe[0]);
+        return false;
+    }
+    ::close(readyPipe[0]);
+
+    BinderClientAdapter control;
+    bool ok = true;
+    if (!control.initialize()) {
+        std::fprintf(stderr, "bench %s control client failed\n", transportName(transport));
+        ok = false;
+    } else {
+        for (BenchOp op : options.ops) {
+            for (std::size_t payloadSize : options.payloads) {
+                for (std::size_t clientCount : options.clients) {
+                    if (!runConfiguration(transport, op, payloadSize, clientCount, options, control, statsPipe[0], output)) {
+                        ok = false;
+                    }
+                }
+            }
+        }
+    }
+
+    control.shutdown();
+    ::kill(serverPid, SIGTERM);
+    ::waitpid(serverPid, nullptr, 0);
+    ::close(statsPipe[0]);
+    return ok;
+}
+
+} // namespace
+
+int runIpcBench(int argc, char** argv) {
+    IpcBenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+
+    std::FILE* output = openOutput(options.outputPath);
+    if (output == nullptr) {
+        std::fprintf(stderr, "bench setup failed\n");
+        return 1;
+    }
+
+    int status = 0;
+    for (TransportKind transport : options.transports) {
+        if (!runTransport(transport, options, output)) {
+            status = 1;
+        }
+    }
+
+    closeOutput(output);
+    return status;
+}
+
+} // namespace bench
+} // namespace xmonitor
@@ -0,0 +1,13 @@
+#pragma once
+
+namespace xmonitor {
+namespace bench {
+
+// `xMonitorBench ipc`: one-way, round-trip and batched one-way
+// latency/throughput of the IPC adapters versus payload size and concurrent
+// client count, for each selected transport (binder, seqpacket). Batch
+// latency is per sendBatch() call; ops count messages.
+int runIpcBench(int argc, char** argv);
+
+} // namespace bench
+} // namespace xmonitor
@@ -0,0 +1,248 @@
+#include "bench/JitterBench.h"
+
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench/BenchUtil.h"
+#include "common/LatencyHistogram.h"
+#include "common/LowJitter.h"
+#include "common/MonotonicClock.h"
+#include "common/TickTimer.h"
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+namespace bench {
+namespace {
+
+// Each hog alternates a CPU burst with a pass over its own buffer, like
+// `stress --cpu N --vm N`, so both the run queue and the page cache/TLB
+// are contended.
+constexpr std::size_t kHogBufferBytes = 32u << 20;
+constexpr std::size_t kHogSpinIterations = 1u << 20;
+
+struct JitterBenchOptions {
+    std::vector<std::string> modes{"default", "low-jitter"};
+    std::size_t periodUs{1000};
+    std::size_t seconds{5};
+    // Hogs per loaded run; 0 runs idle only.
+    std::size_t load{0};
+    std::string outputPath;
+};
+
+// Sent back from the measuring child.
+struct JitterResult {
+    LatencyHistogram latency;
+    double jitterUs{0.0};
+    std::uint32_t overruns{0};
+    std::uint32_t applied{0};
+};
+
+void printUsage() {
+    std::fprintf(stderr,
+                 "usage: xMonitorBench jitter [--modes default,low-jitter] [--period-us N] [--seconds N]\n"
+                 "                            [--load N] [--output file.jsonl]\n"
+                 "--load defaults to twice the online CPUs; low-jitter mode takes its settings from\n"
+                 "XMONITOR_LOW_JITTER_* like the services do.\n");
+}
+
+bool parseModes(const std::string& text, std::vector<std::string>& outModes) {
+    outModes.clear();
+    std::size_t begin = 0;
+    while (begin <= text.size()) {
+        std::size_t end = text.find(',', begin);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        const std::string mode = text.substr(begin, end - begin);
+        if (mode != "default" && mode != "low-jitter") {
+            return false;
+        }
+        outModes.push_back(mode);
+        begin = end + 1;
+    }
+    return !outModes.empty();
+}
+
+bool parseOptions(int argc, char** argv, JitterBenchOptions& options) {
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    options.load = static_cast<std::size_t>(cpus > 0 ? cpus * 2 : 2);
+
+    for (int i = 0; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--modes" && hasValue) {
+            if (!parseModes(argv[++i], options.modes)) {
+                return false;
+            }
+        } else if (arg == "--period-us" && hasValue) {
+            options.periodUs = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+            if (options.periodUs == 0) {
+                return false;
+            }
+        } else if (arg == "--seconds" && hasValue) {
+            options.seconds = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+            if (options.seconds == 0) {
+                return false;
+            }
+        } else if (arg == "--load" && hasValue) {
+            options.load = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--output" && hasValue) {
+            options.outputPath = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+[[noreturn]] void runHog() {
+    std::unique_ptr<unsigned char[]> buffer(new unsigned char[kHogBufferBytes]);
+    volatile double sink = 0.0;
+    for (unsigned char round = 0;; ++round) {
+        for (std::size_t i = 0; i < kHogSpinIterations; ++i) {
+            sink = sink + std::sqrt(static_cast<double>(i));
+        }
+        for (std::size_t offset = 0; offset < kHogBufferBytes; offset += 64) {
+            buffer[offset] = round;
+        }
+    }
+}
+
+std::vector<pid_t> startHogs(std::size_t count) {
+    std::vector<pid_t> hogs;
+    for (std::size_t i = 0; i < count; ++i) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            runHog();
+        }
+        if (pid > 0) {
+            hogs.push_back(pid);
+        }
+    }
+    return hogs;
+}
+
+void stopHogs(const std::vector<pid_t>& hogs) {
+    for (pid_t pid : hogs) {
+        kill(pid, SIGKILL);
+    }
+    for (pid_t pid : hogs) {
+        waitpid(pid, nullptr, 0);
+    }
+}
+
+// Runs in a child so scheduling class and memory locks never leak into the
+// next configuration.
+[[noreturn]] void measure(bool lowJitter, const JitterBenchOptions& options, int resultFd) {
+    std::unique_ptr<JitterResult> result = std::make_unique<JitterResult>();
+    if (lowJitter) {
+        setenv("XMONITOR_LOW_JITTER", "1", 1);
+        const LowJitterOptions lowJitterOptions = lowJitterOptionsFromEnv();
+        const bool scheduled = applyLowJitterScheduling(lowJitterOptions);
+        const bool locked = lockLowJitterMemory(lowJitterOptions);
+        result->applied = scheduled && locked ? 1u : 0u;
+    }
+
+    TickTimer ticker;
+    const auto period = std::chrono::microseconds(options.periodUs);
+    const std::uint64_t endNs = monotonicNowNs() + static_cast<std::uint64_t>(options.seconds) * 1000000000ull;
+    while (monotonicNowNs() < endNs) {
+        ticker.wait(period);
+    }
+
+    result->latency = ticker.latency();
+    SelfUsageData usage{};
+    ticker.report(usage);
+    result->jitterUs = usage.wakeupJitterUs;
+    result->overruns = usage.tickOverruns;
+
+    _exit(writeAll(resultFd, result.get(), sizeof(JitterResult)) ? 0 : 1);
+}
+
+bool runCase(const std::string& mode, std::size_t load, const JitterBenchOptions& options, std::FILE* output) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+
+    const std::vector<pid_t> hogs = startHogs(load);
+    const pid_t child = fork();
+    if (child == 0) {
+        close(fds[0]);
+        measure(mode == "low-jitter", options, fds[1]);
+    }
+    close(fds[1]);
+
+    std::unique_ptr<JitterResult> result = std::make_unique<JitterResult>();
+    const bool ok = child > 0 && readAll(fds[0], result.get(), sizeof(JitterResult));
+    close(fds[0]);
+    if (child > 0) {
+        waitpid(child, nullptr, 0);
+    }
+    stopHogs(hogs);
+
+    if (!ok) {
+        std::fprintf(stderr, "jitter %s load=%zu: measuring child failed\n", mode.c_str(), load);
+        return false;
+    }
+
+    std::fprintf(output,
+                 "{\"bench\":\"jitter\",\"mode\":\"%s\",\"applied\":%s,\"load\":%zu,\"period_us\":%zu,"
+                 "\"wakeup_ns\":%s,\"jitter_us\":%.2f,\"overruns\":%u}\n",
+                 mode.c_str(),
+                 mode == "default" || result->applied != 0 ? "true" : "false",
+                 load,
+                 options.periodUs,
+                 latencyJson(result->latency).c_str(),
+                 result->jitterUs,
+                 result->overruns);
+    std::fflush(output);
+    return true;
+}
+
+} // namespace
+
+int runJitterBench(int argc, char** argv) {
+    JitterBenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+
+    std::FILE* output = openOutput(options.outputPath);
+    if (output == nullptr) {
+        std::fprintf(stderr, "bench setup failed\n");
+        return 1;
+    }
+
+    std::vector<std::size_t> loads{0};
+    if (options.load != 0) {
+        loads.push_back(options.load);
+    }
+
+    int status = 0;
+    for (std::size_t load : loads) {
+        for (const std::string& mode : options.modes) {
+            if (!runCase(mode, load, options, output)) {
+                status = 1;
+            }
+        }
+    }
+
+    closeOutput(output);
+    return status;
+}
+
+} // namespace bench
+} // namespace xmonitor
@@ -0,0 +1,12 @@
+#pragma once
+
+namespace xmonitor {
+namespace bench {
+
+// `xMonitorBench jitter`: the services' tick loop (TickTimer) run in a child
+// process in default and low-jitter mode, idle and next to stress-style
+// CPU/memory hogs, reporting how late each tick woke up.
+int runJitterBench(int argc, char** argv);
+
+} // namespace bench
+} // namespace xmonitor
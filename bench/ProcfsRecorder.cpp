@@ -0,0 +1,259 @@
+#include "bench/ProcfsRecorder.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bench/BenchUtil.h"
+
+namespace xmonitor {
+namespace bench {
+namespace {
+
+// glob(3) patterns relative to /proc and /sys. New collectors add the files
+// they read here so recorded fixtures stay replayable by CollectorBench.
+const char* kProcPatterns[] = {
+    "stat",
+    "meminfo",
+    "vmstat",
+    "loadavg",
+    "diskstats",
+    "interrupts",
+    "softirqs",
+    "net/dev",
+    "net/snmp",
+    "net/netstat",
+    "pressure/cpu",
+    "pressure/memory",
+    "pressure/io",
+    "self/stat",
+    "self/statm",
+    "self/io",
+    "self/mountinfo",
+};
+
+const char* kPerPidPatterns[] = {
+    "comm",
+    "smaps_rollup",
+    "stat",
+    "statm",
+    "status",
+    "schedstat",
+};
+
+const char* kSysPatterns[] = {
+    "devices/system/cpu/online",
+    "devices/system/cpu/cpu[0-9]*/topology/physical_package_id",
+    "devices/system/cpu/cpu[0-9]*/topology/core_id",
+    "devices/system/cpu/cpu[0-9]*/cpufreq/scaling_cur_freq",
+    "devices/system/node/node[0-9]*/cpulist",
+    "devices/system/node/node[0-9]*/meminfo",
+    "devices/system/node/node[0-9]*/numastat",
+    "block/*",
+};
+
+const char* kCgroupFiles[] = {
+    "cgroup.procs",
+    "cpu.stat",
+    "memory.current",
+    "memory.stat",
+    "io.stat",
+    "cpu.pressure",
+    "memory.pressure",
+    "io.pressure",
+};
+
+struct RecorderOptions {
+    std::string outputDir;
+    std::size_t maxPids{0};
+    std::size_t cgroupDepth{3};
+};
+
+struct RecorderStats {
+    std::size_t files{0};
+    std::size_t directories{0};
+    std::size_t failures{0};
+    std::size_t bytes{0};
+};
+
+void printUsage() {
+    std::fprintf(stderr, "usage: xMonitorBench record --output DIR [--max-pids N] [--cgroup-depth N]\n");
+}
+
+bool makeDirectories(const std::string& path) {
+    std::string partial;
+    partial.reserve(path.size());
+    for (std::size_t i = 0; i < path.size(); ++i) {
+        partial.push_back(path[i]);
+        if ((path[i] == '/' || i + 1 == path.size()) && partial.size() > 1) {
+            if (::mkdir(partial.c_str(), 0755) != 0 && errno != EEXIST) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::string parentOf(const std::string& path) {
+    const std::size_t slash = path.rfind('/');
+    return slash == std::string::npos ? std::string() : path.substr(0, slash);
+}
+
+// procfs reports st_size == 0, so files are streamed rather than sized.
+bool copyFile(const std::string& source, const std::string& destination, RecorderStats& stats) {
+    const int in = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return false;
+    }
+
+    if (!makeDirectories(parentOf(destination))) {
+        ::close(in);
+        return false;
+    }
+
+    const int out = ::open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+
+    char buffer[64 * 1024];
+    bool ok = true;
+    for (;;) {
+        const ssize_t bytesRead = ::read(in, buffer, sizeof(buffer));
+        if (bytesRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytesRead <= 0) {
+            ok = bytesRead == 0;
+            break;
+        }
+        if (!writeAll(out, buffer, static_cast<std::size_t>(bytesRead))) {
+            ok = false;
+            break;
+        }
+        stats.bytes += static_cast<std::size_t>(bytesRead);
+    }
+
+    ::close(in);
+    ::close(out);
+    return ok;
+}
+
+void recordPattern(const std::string& sourceRoot,
+                   const std::string& destinationRoot,
+                   const std::string& pattern,
+                   std::size_t limit,
+                   RecorderStats& stats) {
+    const std::string fullPattern = sourceRoot + "/" + pattern;
+    glob_t matches{};
+    if (::glob(fullPattern.c_str(), GLOB_NOSORT, nullptr, &matches) != 0) {
+        ::globfree(&matches);
+        return;
+    }
+
+    for (std::size_t i = 0; i < matches.gl_pathc && (limit == 0 || i < limit); ++i) {
+        const std::string source = matches.gl_pathv[i];
+        const std::string destination = destinationRoot + source.substr(sourceRoot.size());
+
+        struct stat info {};
+        if (::stat(source.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+            if (makeDirectories(destination)) {
+                ++stats.directories;
+            }
+            continue;
+        }
+
+        if (copyFile(source, destination, stats)) {
+            ++stats.files;
+        } else {
+            ++stats.failures;
+        }
+    }
+
+    ::globfree(&matches);
+}
+
+} // namespace
+
+int runProcfsRecorder(int argc, char** argv) {
+    RecorderOptions options;
+    for (int i = 0; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--output" && hasValue) {
+            options.outputDir = argv[++i];
+        } else if (arg == "--max-pids" && hasValue) {
+            options.maxPids = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--cgroup-depth" && hasValue) {
+            options.cgroupDepth = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    if (options.outputDir.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    const std::string procOut = options.outputDir + "/proc";
+    const std::string sysOut = options.outputDir + "/sys";
+    if (!makeDirectories(procOut) || !makeDirectories(sysOut)) {
+        std::fprintf(stderr, "cannot create %s\n", options.outputDir.c_str());
+        return 1;
+    }
+
+    RecorderStats stats;
+    for (const char* pattern : kProcPatterns) {
+        recordPattern("/proc", procOut, pattern, 0, stats);
+    }
+    for (const char* file : kPerPidPatterns) {
+        recordPattern("/proc", procOut, std::string("[0-9]*/") + file, options.maxPids, stats);
+    }
+    for (const char* pattern : kSysPatterns) {
+        recordPattern("/sys", sysOut, pattern, 0, stats);
+    }
+
+    std::string cgroupPrefix = "fs/cgroup/";
+    for (std::size_t depth = 0; depth <= options.cgroupDepth; ++depth) {
+        for (const char* file : kCgroupFiles) {
+            recordPattern("/sys", sysOut, cgroupPrefix + file, 0, stats);
+        }
+        cgroupPrefix += "*/";
+    }
+
+    char hostName[256] = {};
+    ::gethostname(hostName, sizeof(hostName) - 1);
+    const std::string metaPath = options.outputDir + "/fixture.txt";
+    std::FILE* meta = std::fopen(metaPath.c_str(), "w");
+    if (meta != nullptr) {
+        std::fprintf(meta,
+                     "host=%s\ncpus=%ld\nfiles=%zu\nbytes=%zu\n",
+                     hostName,
+                     ::sysconf(_SC_NPROCESSORS_CONF),
+                     stats.files,
+                     stats.bytes);
+        std::fclose(meta);
+    }
+
+    std::printf("{\"bench\":\"record\",\"output\":\"%s\",\"files\":%zu,\"directories\":%zu,\"failures\":%zu,\"bytes\":%zu}\n",
+                options.outputDir.c_str(),
+                stats.files,
+                stats.directories,
+                stats.failures,
+                stats.bytes);
+    return 0;
+}
+
+} // namespace bench
+} // namespace xmonitor
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace xmonitor {
+namespace bench {
+
+// `xMonitorBench record`: copies the procfs/sysfs files the collectors read
+// into a fixture tree (<dir>/proc, <dir>/sys) for deterministic replay.
+int runProcfsRecorder(int argc, char** argv);
+
+} // namespace bench
+} // namespace xmonitor
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+namespace xmonitor {
+
+// Deployment knobs are passed as XMONITOR_* environment variables so every
+// process picks them up without changing how `make run` starts them.
+inline std::string envString(const char* name, const char* defaultValue) {
+    const char* value = std::getenv(name);
+    return value != nullptr && *value != '\0' ? std::string(value) : std::string(defaultValue);
+}
+
+inline double envDouble(const char* name, double defaultValue) {
+    const char* value = std::getenv(name);
+    if (value == nullptr || *value == '\0') {
+        return defaultValue;
+    }
+
+    char* end = nullptr;
+    const double parsed = std::strtod(value, &end);
+    return end != value ? parsed : defaultValue;
+}
+
+// A plain decimal integer (optional leading '-') in [minimum, maximum];
+// whitespace, junk after the digits and overflow are rejected.
+inline bool parseInteger(const std::string& text, long minimum, long maximum, long& outValue) {
+    const std::size_t digits = !text.empty() && text[0] == '-' ? 1 : 0;
+    if (text.size() == digits || text[digits] < '0' || text[digits] > '9') {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    const long value = std::strtol(text.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE || value < minimum || value > maximum) {
+        return false;
+    }
+    outValue = value;
+    return true;
+}
+
+// A finite number in [minimum, maximum]; inf, nan and junk are rejected.
+inline bool parseNumber(const std::string& text, double minimum, double maximum, double& outValue) {
+    if (text.empty() || !(text[0] == '-' || text[0] == '.' || (text[0] >= '0' && text[0] <= '9'))) {
+        return false;
+    }
+    char* end = nullptr;
+    const double value = std::strtod(text.c_str(), &end);
+    if (*end != '\0' || !std::isfinite(value) || value < minimum || value > maximum) {
+        return false;
+    }
+    outValue = value;
+    return true;
+}
+
+// Bounded variants of envDouble: an unset variable leaves outValue alone
+// and returns true; false means it is set but invalid or out of range, and
+// the caller logs and keeps its default.
+inline bool envInteger(const char* name, long minimum, long maximum, long& outValue) {
+    const char* value = std::getenv(name);
+    return value == nullptr || *value == '\0' || parseInteger(value, minimum, maximum, outValue);
+}
+
+inline bool envNumber(const char* name, double minimum, double maximum, double& outValue) {
+    const char* value = std::getenv(name);
+    return value == nullptr || *value == '\0' || parseNumber(value, minimum, maximum, outValue);
+}
+
+inline bool envBool(const char* name, bool defaultValue) {
+    const char* value = std::getenv(name);
+    if (value == nullptr || *value == '\0') {
+        return defaultValue;
+    }
+    return *value == '1' || *value == 'y' || *value == 'Y' || *value == 't' || *value == 'T';
+}
+
+} // namespace xmonitor
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <sys/resource.h>
+
+namespace xmonitor {
+
+// Collectors that keep one fd per cgroup/process can outgrow the usual 1024
+// soft limit; this lifts it to the hard limit. Returns false if that failed.
+inline bool raiseFileLimit() {
+    struct rlimit limit {};
+    if (::getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        return false;
+    }
+    if (limit.rlim_cur >= limit.rlim_max) {
+        return true;
+    }
+    limit.rlim_cur = limit.rlim_max;
+    return ::setrlimit(RLIMIT_NOFILE, &limit) == 0;
+}
+
+} // namespace xmonitor
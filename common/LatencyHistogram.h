@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace xmonitor {
+
+// Log-linear histogram in the style of HdrHistogram: every power of two is
+// split into 2^kSubBucketBits linear buckets, which bounds the relative error
+// of a reported percentile to ~3% while keeping a fixed, allocation-free
+// footprint. Values are nanoseconds and saturate at kMaxValue.
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBucketBits = 5;
+    static constexpr unsigned kMaxValueBits = 40;
+    static constexpr std::uint64_t kMaxValue = (1ull << kMaxValueBits) - 1;
+    static constexpr std::size_t kLinearBuckets = std::size_t{1} << (kSubBucketBits + 1);
+    static constexpr std::size_t kBucketCount =
+        kLinearBuckets + (kMaxValueBits - kSubBucketBits - 1) * (std::size_t{1} << kSubBucketBits);
+
+    void record(std::uint64_t value) {
+        if (value > kMaxValue) {
+            value = kMaxValue;
+        }
+        ++mCounts[indexOf(value)];
+        ++mTotal;
+        if (value > mMax) {
+            mMax = value;
+        }
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (std::size_t i = 0; i < kBucketCount; ++i) {
+            mCounts[i] += other.mCounts[i];
+        }
+        mTotal += other.mTotal;
+        if (other.mMax > mMax) {
+            mMax = other.mMax;
+        }
+    }
+
+    void reset() {
+        mCounts.fill(0);
+        mTotal = 0;
+        mMax = 0;
+    }
+
+    std::uint64_t count() const {
+        return mTotal;
+    }
+
+    std::uint64_t max() const {
+        return mMax;
+    }
+
+    // Returns the highest value equivalent to the requested percentile (0..100).
+    std::uint64_t valueAtPercentile(double percentile) const {
+        if (mTotal == 0) {
+            return 0;
+        }
+
+        if (percentile < 0.0) {
+            percentile = 0.0;
+        } else if (percentile > 100.0) {
+            percentile = 100.0;
+        }
+
+        std::uint64_t target = static_cast<std::uint64_t>(percentile / 100.0 * static_cast<double>(mTotal) + 0.5);
+        if (target == 0) {
+            target = 1;
+        }
+
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBucketCount; ++i) {
+            seen += mCounts[i];
+            if (seen >= target) {
+                const std::uint64_t value = highestEquivalentValue(i);
+                return value < mMax ? value : mMax;
+            }
+        }
+
+        return mMax;
+    }
+
+private:
+    static std::size_t indexOf(std::uint64_t value) {
+        if (value < kLinearBuckets) {
+            return static_cast<std::size_t>(value);
+        }
+
+        const unsigned exponent = 63u - static_cast<unsigned>(__builtin_clzll(value));
+        const unsigned shift = exponent - kSubBucketBits;
+        const std::size_t mantissa = static_cast<std::size_t>(value >> shift) & ((std::size_t{1} << kSubBucketBits) - 1);
+        return kLinearBuckets + (exponent - kSubBucketBits - 1) * (std::size_t{1} << kSubBucketBits) + mantissa;
+    }
+
+    static std::uint64_t highestEquivalentValue(std::size_t index) {
+        if (index < kLinearBuckets) {
+            return index;
+        }
+
+        const std::size_t offset = index - kLinearBuckets;
+        const unsigned exponent = static_cast<unsigned>(offset >> kSubBucketBits) + kSubBucketBits + 1;
+        const unsigned shift = exponent - kSubBucketBits;
+        const std::uint64_t mantissa = offset & ((std::size_t{1} << kSubBucketBits) - 1);
+        const std::uint64_t lower = ((std::uint64_t{1} << kSubBucketBits) | mantissa) << shift;
+        return lower + (std::uint64_t{1} << shift) - 1;
+    }
+
+    std::array<std::uint64_t, kBucketCount> mCounts{};
+    std::uint64_t mTotal{0};
+    std::uint64_t mMax{0};
+};
+
+} // namespace xmonitor
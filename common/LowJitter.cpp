@@ -0,0 +1,205 @@
+#include "common/LowJitter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#include <malloc.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include "Logger.h"
+#include "common/Config.h"
+
+namespace xmonitor {
+namespace {
+
+constexpr long kDefaultRealtimePriority = 10;
+constexpr long kMinRealtimePriority = 1;
+constexpr long kMaxRealtimePriority = 99;
+constexpr long kDefaultNice = -10;
+constexpr long kMinNice = -20;
+constexpr long kMaxNice = 19;
+
+// Comfortably more stack than a sampling tick uses; the largest payloads
+// built on it (topology, interrupts) are tens of KiB.
+constexpr std::size_t kPrefaultStackBytes = 256 * 1024;
+constexpr std::size_t kPageBytes = 4096;
+
+const char* policyName(int policy) {
+    switch (policy) {
+        case SCHED_FIFO:
+            return "fifo";
+        case SCHED_RR:
+            return "rr";
+        default:
+            return "other";
+    }
+}
+
+__attribute__((noinline)) void prefaultStack() {
+    volatile unsigned char stack[kPrefaultStackBytes];
+    for (std::size_t offset = 0; offset < sizeof(stack); offset += kPageBytes) {
+        stack[offset] = 0;
+    }
+}
+
+} // namespace
+
+bool parseCpuList(const std::string& text, std::vector<int>& outCpus) {
+    outCpus.clear();
+    const char* cursor = text.c_str();
+    while (*cursor != '\0') {
+        char* end = nullptr;
+        const long first = std::strtol(cursor, &end, 10);
+        if (end == cursor || first < 0 || first >= CPU_SETSIZE) {
+            return false;
+        }
+        long last = first;
+        cursor = end;
+        if (*cursor == '-') {
+            ++cursor;
+            last = std::strtol(cursor, &end, 10);
+            if (end == cursor || last < first || last >= CPU_SETSIZE) {
+                return false;
+            }
+            cursor = end;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            outCpus.push_back(static_cast<int>(cpu));
+        }
+
+        if (*cursor == ',') {
+            ++cursor;
+        } else if (*cursor != '\0') {
+            return false;
+        }
+    }
+    return true;
+}
+
+LowJitterOptions lowJitterOptionsFromEnv() {
+    LowJitterOptions options;
+    options.enabled = envBool("XMONITOR_LOW_JITTER", false);
+    if (!options.enabled) {
+        return options;
+    }
+
+    const std::string cpus = envString("XMONITOR_LOW_JITTER_CPUS", "");
+    if (!parseCpuList(cpus, options.cpus)) {
+        LOG_W("Low-jitter: XMONITOR_LOW_JITTER_CPUS '%s' is not a CPU list, affinity unchanged", cpus.c_str());
+        options.cpus.clear();
+    }
+
+    const std::string policy = envString("XMONITOR_LOW_JITTER_SCHED", "fifo");
+    if (policy == "fifo") {
+        options.policy = SCHED_FIFO;
+    } else if (policy == "rr") {
+        options.policy = SCHED_RR;
+    } else if (policy == "other") {
+        options.policy = SCHED_OTHER;
+    } else {
+        LOG_W("Low-jitter: unknown XMONITOR_LOW_JITTER_SCHED '%s', using fifo", policy.c_str());
+        options.policy = SCHED_FIFO;
+    }
+
+    // Range-checked as integers first; the priority is then clamped to what
+    // the chosen policy accepts (1..99 on Linux).
+    long priority = kDefaultRealtimePriority;
+    if (!envInteger("XMONITOR_LOW_JITTER_PRIORITY", kMinRealtimePriority, kMaxRealtimePriority, priority)) {
+        LOG_W("Low-jitter: XMONITOR_LOW_JITTER_PRIORITY must be %ld..%ld, using %ld",
+              kMinRealtimePriority,
+              kMaxRealtimePriority,
+              priority);
+    }
+    options.priority = static_cast<int>(priority);
+    if (options.policy != SCHED_OTHER) {
+        const int minimum = sched_get_priority_min(options.policy);
+        const int maximum = sched_get_priority_max(options.policy);
+        options.priority = std::max(minimum, std::min(options.priority, maximum));
+    }
+
+    long nice = kDefaultNice;
+    if (!envInteger("XMONITOR_LOW_JITTER_NICE", kMinNice, kMaxNice, nice)) {
+        LOG_W("Low-jitter: XMONITOR_LOW_JITTER_NICE must be %ld..%ld, using %ld", kMinNice, kMaxNice, nice);
+    }
+    options.nice = static_cast<int>(nice);
+    options.lockMemory = envBool("XMONITOR_LOW_JITTER_MLOCK", true);
+    return options;
+}
+
+bool applyLowJitterScheduling(const LowJitterOptions& options) {
+    bool applied = true;
+
+    if (!options.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : options.cpus) {
+            CPU_SET(cpu, &set);
+        }
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            LOG_W("Low-jitter: sched_setaffinity failed: %s", std::strerror(errno));
+            applied = false;
+        }
+    }
+
+    bool realtime = false;
+    if (options.policy != SCHED_OTHER) {
+        sched_param param{};
+        param.sched_priority = options.priority;
+        if (sched_setscheduler(0, options.policy, &param) == 0) {
+            realtime = true;
+        } else {
+            LOG_W("Low-jitter: SCHED_%s priority %d refused (%s), falling back to nice %d",
+                  options.policy == SCHED_FIFO ? "FIFO" : "RR",
+                  options.priority,
+                  std::strerror(errno),
+                  options.nice);
+            applied = false;
+        }
+    }
+    if (!realtime && setpriority(PRIO_PROCESS, 0, options.nice) != 0) {
+        LOG_W("Low-jitter: nice %d refused: %s", options.nice, std::strerror(errno));
+        applied = false;
+    }
+
+    LOG_I("Low-jitter: %zu pinned CPUs, policy %s, priority %d, nice %d",
+          options.cpus.size(),
+          realtime ? policyName(options.policy) : "other",
+          realtime ? options.priority : 0,
+          realtime ? 0 : options.nice);
+    return applied;
+}
+
+bool lockLowJitterMemory(const LowJitterOptions& options) {
+    if (!options.lockMemory) {
+        return true;
+    }
+
+    // Freed heap stays mapped (and locked) for the next tick to reuse.
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    int result = -1;
+#ifdef MCL_ONFAULT
+    result = mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT);
+    if (result != 0 && errno == EINVAL) {
+        // Before Linux 4.4 every mapping is populated up front.
+        result = mlockall(MCL_CURRENT | MCL_FUTURE);
+    }
+#else
+    result = mlockall(MCL_CURRENT | MCL_FUTURE);
+#endif
+    if (result != 0) {
+        LOG_W("Low-jitter: mlockall failed: %s", std::strerror(errno));
+        return false;
+    }
+
+    prefaultStack();
+    return true;
+}
+
+} // namespace xmonitor
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace xmonitor {
+
+// Opt-in low-jitter mode for the sampling processes, read from
+// XMONITOR_LOW_JITTER* (see README). Real-time scheduling and memory
+// locking need CAP_SYS_NICE / CAP_IPC_LOCK or matching rlimits; what the
+// process is not allowed to do is logged and skipped, never fatal.
+struct LowJitterOptions {
+    bool enabled{false};
+    // Empty keeps the inherited affinity.
+    std::vector<int> cpus;
+    // SCHED_FIFO, SCHED_RR or SCHED_OTHER.
+    int policy{0};
+    int priority{0};
+    // Used with SCHED_OTHER, and when a real-time class is refused.
+    int nice{0};
+    bool lockMemory{true};
+};
+
+LowJitterOptions lowJitterOptionsFromEnv();
+
+// "0,2-3" -> {0, 2, 3}.
+bool parseCpuList(const std::string& text, std::vector<int>& outCpus);
+
+// Pins the calling thread and changes its scheduling class; threads it
+// starts afterwards inherit both. Returns true when everything applied.
+bool applyLowJitterScheduling(const LowJitterOptions& options);
+
+// mlockall, keeps freed heap mapped and prefaults the stack, so the sampling
+// loop takes no page faults once it has run a tick. Call after the process'
+// threads exist: only what is touched is locked, so idle thread stacks do
+// not count against RLIMIT_MEMLOCK.
+bool lockLowJitterMemory(const LowJitterOptions& options);
+
+} // namespace xmonitor
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+
+namespace xmonitor {
+
+// CLOCK_MONOTONIC is shared by every process on the host, so timestamps taken
+// in services, lifecycle and app can be subtracted from each other directly.
+inline std::uint64_t monotonicNowNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(ts.tv_nsec);
+}
+
+} // namespace xmonitor
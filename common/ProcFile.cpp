@@ -0,0 +1,135 @@
+#include "common/ProcFile.h"
+
+#include <cerrno>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace xmonitor {
+namespace {
+constexpr std::size_t kInitialCapacity = 4096;
+} // namespace
+
+ProcFile::ProcFile()
+    : mFd(-1),
+      mInitialCapacity(kInitialCapacity),
+      mSize(0) {}
+
+ProcFile::ProcFile(const std::string& path)
+    : ProcFile() {
+    open(path);
+}
+
+ProcFile::ProcFile(const std::string& path, std::size_t initialCapacity)
+    : ProcFile() {
+    mInitialCapacity = initialCapacity > 1 ? initialCapacity : kInitialCapacity;
+    open(path);
+}
+
+ProcFile::~ProcFile() {
+    close();
+}
+
+ProcFile::ProcFile(ProcFile&& other) noexcept
+    : mPath(std::move(other.mPath)),
+      mFd(other.mFd),
+      mBuffer(std::move(other.mBuffer)),
+      mInitialCapacity(other.mInitialCapacity),
+      mSize(other.mSize) {
+    other.mFd = -1;
+    other.mSize = 0;
+}
+
+ProcFile& ProcFile::operator=(ProcFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        mPath = std::move(other.mPath);
+        mFd = other.mFd;
+        mBuffer = std::move(other.mBuffer);
+        mInitialCapacity = other.mInitialCapacity;
+        mSize = other.mSize;
+        other.mFd = -1;
+        other.mSize = 0;
+    }
+    return *this;
+}
+
+bool ProcFile::open(const std::string& path) {
+    close();
+    mPath = path;
+    mFd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    return mFd >= 0;
+}
+
+void ProcFile::close() {
+    if (mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+    mSize = 0;
+}
+
+bool ProcFile::isOpen() const {
+    return mFd >= 0;
+}
+
+int ProcFile::fd() const {
+    return mFd;
+}
+
+bool ProcFile::read() {
+    if (mFd < 0) {
+        return false;
+    }
+
+    if (mBuffer.size() < mInitialCapacity) {
+        mBuffer.resize(mInitialCapacity);
+    }
+
+    // A partial read of a seq_file would splice two generations together, so
+    // when the file outgrows the buffer it is grown and re-read from scratch.
+    for (;;) {
+        std::size_t used = 0;
+        for (;;) {
+            const std::size_t room = mBuffer.size() - 1 - used;
+            if (room == 0) {
+                break;
+            }
+            const ssize_t bytes = ::pread(mFd, mBuffer.data() + used, room, static_cast<off_t>(used));
+            if (bytes < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                mSize = 0;
+                return false;
+            }
+            if (bytes == 0) {
+                mSize = used;
+                mBuffer[used] = '\0';
+                return true;
+            }
+            used += static_cast<std::size_t>(bytes);
+        }
+
+        mBuffer.resize(mBuffer.size() * 2);
+    }
+}
+
+const char* ProcFile::data() const {
+    return mBuffer.data();
+}
+
+const char* ProcFile::end() const {
+    return mBuffer.data() + mSize;
+}
+
+std::size_t ProcFile::size() const {
+    return mSize;
+}
+
+const std::string& ProcFile::path() const {
+    return mPath;
+}
+
+} // namespace xmonitor
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace xmonitor {
+
+// Keeps a procfs/sysfs file open and re-reads it with pread() from offset 0,
+// so a sample costs one or two syscalls and no allocation once the buffer has
+// grown to fit the file. The buffer is allocated on the first read and is
+// always NUL-terminated.
+class ProcFile {
+public:
+    ProcFile();
+    explicit ProcFile(const std::string& path);
+    // For files known to be small (e.g. per-cgroup stats, thousands of them
+    // open at once); the buffer still grows on demand.
+    ProcFile(const std::string& path, std::size_t initialCapacity);
+    ~ProcFile();
+
+    ProcFile(ProcFile&& other) noexcept;
+    ProcFile& operator=(ProcFile&& other) noexcept;
+    ProcFile(const ProcFile&) = delete;
+    ProcFile& operator=(const ProcFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+    // For poll(): e.g. mountinfo signals POLLPRI when the mount table changes.
+    int fd() const;
+
+    bool read();
+
+    const char* data() const;
+    const char* end() const;
+    std::size_t size() const;
+    const std::string& path() const;
+
+private:
+    std::string mPath;
+    int mFd;
+    std::vector<char> mBuffer;
+    std::size_t mInitialCapacity;
+    std::size_t mSize;
+};
+
+} // namespace xmonitor
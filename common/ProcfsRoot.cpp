@@ -0,0 +1,53 @@
+#include "common/ProcfsRoot.h"
+
+#include "common/Config.h"
+
+namespace xmonitor {
+namespace {
+
+std::string& procRootStorage() {
+    static std::string root = envString("XMONITOR_PROC_ROOT", "/proc");
+    return root;
+}
+
+std::string& sysRootStorage() {
+    static std::string root = envString("XMONITOR_SYS_ROOT", "/sys");
+    return root;
+}
+
+std::string joinPath(const std::string& root, const char* relativePath) {
+    std::string path = root;
+    if (!path.empty() && path.back() != '/') {
+        path.push_back('/');
+    }
+    path.append(relativePath);
+    return path;
+}
+
+} // namespace
+
+const std::string& procRoot() {
+    return procRootStorage();
+}
+
+const std::string& sysRoot() {
+    return sysRootStorage();
+}
+
+void setProcRoot(const std::string& root) {
+    procRootStorage() = root;
+}
+
+void setSysRoot(const std::string& root) {
+    sysRootStorage() = root;
+}
+
+std::string procPath(const char* relativePath) {
+    return joinPath(procRootStorage(), relativePath);
+}
+
+std::string sysPath(const char* relativePath) {
+    return joinPath(sysRootStorage(), relativePath);
+}
+
+} // namespace xmonitor
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+namespace xmonitor {
+
+// Root directories every collector resolves its procfs/sysfs paths against.
+// They default to /proc and /sys and can be redirected to a recorded fixture
+// tree with XMONITOR_PROC_ROOT / XMONITOR_SYS_ROOT (or setProcRoot/setSysRoot
+// before constructing collectors), so parsers can be replayed deterministically.
+const std::string& procRoot();
+const std::string& sysRoot();
+
+void setProcRoot(const std::string& root);
+void setSysRoot(const std::string& root);
+
+// procPath("stat") -> "<procRoot>/stat"
+std::string procPath(const char* relativePath);
+std::string sysPath(const char* relativePath);
+
+} // namespace xmonitor
@@ -0,0 +1,236 @@
+#include "common/SamplingPolicy.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "ipc/MetricSchema.h"
+
+namespace xmonitor {
+namespace {
+
+struct ServiceName {
+    const char* name;
+    ProcessRole role;
+    bool hasDeadband;
+};
+
+constexpr ServiceName kServices[] = {
+    {"cpu", ProcessRole::CpuService, true},
+    {"ram", ProcessRole::RamService, true},
+    {"memory", ProcessRole::MemoryService, true},
+    {"disk", ProcessRole::DiskService, false},
+    {"net", ProcessRole::NetService, false},
+    {"cgroup", ProcessRole::CgroupService, false},
+    {"thread", ProcessRole::ThreadService, false},
+    {"process", ProcessRole::ProcessService, false},
+};
+
+struct SectionName {
+    const char* name;
+    BinderTransactionCode code;
+};
+
+// Self usage is how overhead is observed, so it cannot be switched off.
+constexpr SectionName kSections[] = {
+    {"cpu", BinderTransactionCode::CpuUpdated},
+    {"ram", BinderTransactionCode::RamUpdated},
+    {"memory", BinderTransactionCode::MemoryUpdated},
+    {"pressure", BinderTransactionCode::PressureUpdated},
+    {"disk", BinderTransactionCode::DiskUpdated},
+    {"net", BinderTransactionCode::NetUpdated},
+    {"cgroup", BinderTransactionCode::CgroupUpdated},
+    {"memory_detail", BinderTransactionCode::MemoryDetailUpdated},
+    {"thread", BinderTransactionCode::ThreadUpdated},
+    {"process", BinderTransactionCode::ProcessUpdated},
+    {"interrupts", BinderTransactionCode::InterruptUpdated},
+    {"topology", BinderTransactionCode::TopologyUpdated},
+    {"filesystems", BinderTransactionCode::FilesystemUpdated},
+};
+
+struct Preset {
+    const char* name;
+    const char* spec;
+};
+
+// lean: roughly a tenth of the default sampling work, for loaded hosts.
+// fine: 50ms resolution on the fast paths, for chasing short spikes.
+constexpr Preset kPresets[kPolicyPresetCount] = {
+    {"default", ""},
+    {"lean",
+     "cpu.period=1000,cpu.deadband=0.5,ram.period=1000,ram.deadband=1048576,memory.period=1000,"
+     "memory.deadband=65536,thread.period=1000,cgroup.period=5000,process.period=5000"},
+    {"fine",
+     "cpu.period=50,cpu.deadband=0,ram.period=50,memory.period=50,thread.period=50,disk.period=250,"
+     "net.period=250"},
+};
+
+std::uint32_t allSectionBits() {
+    std::uint32_t bits = 0;
+    for (const SectionName& section : kSections) {
+        bits |= policySectionBit(section.code);
+    }
+    return bits;
+}
+
+const ServiceName* findService(const std::string& name) {
+    for (const ServiceName& service : kServices) {
+        if (name == service.name) {
+            return &service;
+        }
+    }
+    return nullptr;
+}
+
+const SectionName* findSection(const std::string& name) {
+    for (const SectionName& section : kSections) {
+        if (name == section.name) {
+            return &section;
+        }
+    }
+    return nullptr;
+}
+
+bool parseNumber(const std::string& text, double& outValue) {
+    char* end = nullptr;
+    outValue = std::strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0' && std::isfinite(outValue);
+}
+
+bool applyItem(const std::string& item, SamplingPolicy& policy, std::string& outError) {
+    for (const Preset& preset : kPresets) {
+        if (item == preset.name) {
+            const std::uint64_t version = policy.version;
+            policy = SamplingPolicy{};
+            policy.version = version;
+            return applyPolicySpec(preset.spec, policy, outError);
+        }
+    }
+
+    const std::size_t equals = item.find('=');
+    if (equals == std::string::npos) {
+        outError = "expected key=value or a preset, got '" + item + "'";
+        return false;
+    }
+    const std::string key = item.substr(0, equals);
+    const std::string value = item.substr(equals + 1);
+
+    const std::size_t dot = key.find('.');
+    if (dot == std::string::npos) {
+        const SectionName* section = findSection(key);
+        if (section == nullptr) {
+            outError = "unknown section '" + key + "'";
+            return false;
+        }
+        if (value == "on") {
+            policy.disabledSections &= ~policySectionBit(section->code);
+        } else if (value == "off") {
+            policy.disabledSections |= policySectionBit(section->code);
+        } else {
+            outError = "'" + key + "' takes on or off";
+            return false;
+        }
+        return true;
+    }
+
+    const ServiceName* service = findService(key.substr(0, dot));
+    const std::string field = key.substr(dot + 1);
+    double number = 0.0;
+    if (service == nullptr) {
+        outError = "unknown service '" + key.substr(0, dot) + "'";
+        return false;
+    }
+    if (!parseNumber(value, number)) {
+        outError = "'" + key + "' needs a number, got '" + value + "'";
+        return false;
+    }
+
+    ServicePolicy& entry = policy.services[static_cast<std::size_t>(service->role)];
+    if (field == "period") {
+        if (number != 0.0 && (number < kMinSamplePeriodMs || number > kMaxSamplePeriodMs)) {
+            outError = "'" + key + "' must be 0 or " + std::to_string(kMinSamplePeriodMs) + ".." +
+                       std::to_string(kMaxSamplePeriodMs) + " ms";
+            return false;
+        }
+        entry.periodMs = static_cast<std::uint32_t>(number);
+    } else if (field == "deadband" && service->hasDeadband) {
+        entry.deadband = number < 0.0 ? -1.0 : number;
+    } else {
+        outError = "unknown setting '" + key + "'";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool applyPolicySpec(const std::string& spec, SamplingPolicy& policy, std::string& outError) {
+    std::size_t begin = 0;
+    while (begin <= spec.size()) {
+        std::size_t end = spec.find(',', begin);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+        const std::string item = spec.substr(begin, end - begin);
+        if (!item.empty() && !applyItem(item, policy, outError)) {
+            return false;
+        }
+        begin = end + 1;
+    }
+    return true;
+}
+
+bool validatePolicy(const SamplingPolicy& policy, std::string& outError) {
+    if ((policy.disabledSections & ~allSectionBits()) != 0) {
+        outError = "disabled sections name no collector";
+        return false;
+    }
+    for (std::size_t role = 0; role < kProcessRoleCount; ++role) {
+        const ServicePolicy& entry = policy.services[role];
+        if (entry.periodMs != 0 && (entry.periodMs < kMinSamplePeriodMs || entry.periodMs > kMaxSamplePeriodMs)) {
+            outError = "period out of range for role " + std::to_string(role);
+            return false;
+        }
+        if (!std::isfinite(entry.deadband)) {
+            outError = "deadband is not finite for role " + std::to_string(role);
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string formatPolicy(const SamplingPolicy& policy) {
+    std::string text;
+    char item[96];
+    auto append = [&text](const char* value) {
+        if (!text.empty()) {
+            text.push_back(',');
+        }
+        text.append(value);
+    };
+
+    for (const ServiceName& service : kServices) {
+        const ServicePolicy& entry = policy.services[static_cast<std::size_t>(service.role)];
+        if (entry.periodMs != 0) {
+            std::snprintf(item, sizeof(item), "%s.period=%u", service.name, entry.periodMs);
+            append(item);
+        }
+        if (entry.deadband >= 0.0) {
+            std::snprintf(item, sizeof(item), "%s.deadband=%.15g", service.name, entry.deadband);
+            append(item);
+        }
+    }
+    for (const SectionName& section : kSections) {
+        if ((policy.disabledSections & policySectionBit(section.code)) != 0) {
+            std::snprintf(item, sizeof(item), "%s=off", section.name);
+            append(item);
+        }
+    }
+    return text.empty() ? std::string("default") : text;
+}
+
+const char* policyPresetName(std::size_t index) {
+    return index < kPolicyPresetCount ? kPresets[index].name : "";
+}
+
+} // namespace xmonitor
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "ipc/BinderProtocol.h"
+#include "ipc/MetricSchema.h"
+
+namespace xmonitor {
+
+// Text form of SamplingPolicy, shared by XMONITOR_POLICY, `xMonitor --policy`
+// and the app's presets: comma-separated items applied left to right.
+//
+//   <service>.period=<ms>       cpu ram memory disk net cgroup thread process;
+//                               0 restores the compiled-in period
+//   <service>.deadband=<value>  cpu (percentage points), ram and memory
+//                               (bytes); -1 restores the compiled-in one
+//   <section>=on|off            cpu ram memory pressure disk net cgroup
+//                               memory_detail thread process interrupts
+//                               topology filesystems
+//   default | lean | fine       reset everything to a preset
+bool applyPolicySpec(const std::string& spec, SamplingPolicy& policy, std::string& outError);
+
+// Periods must be 0 or within [kMinSamplePeriodMs, kMaxSamplePeriodMs],
+// deadbands finite, and disabled bits must name a section that can be off.
+bool validatePolicy(const SamplingPolicy& policy, std::string& outError);
+
+// The non-default entries in spec form, or "default".
+std::string formatPolicy(const SamplingPolicy& policy);
+
+constexpr std::size_t kPolicyPresetCount = 3;
+const char* policyPresetName(std::size_t index);
+
+// One bit of SamplingPolicy::disabledSections per update code.
+constexpr std::uint32_t kPolicySectionBits = sizeof(SamplingPolicy::disabledSections) * 8;
+static_assert(MetricSchema::kCodeTableSize <= kPolicySectionBits,
+              "an update code does not fit SamplingPolicy::disabledSections; widen the mask");
+
+// 0 for codes outside the mask (control codes), which can never be disabled.
+inline std::uint32_t policySectionBit(BinderTransactionCode code) {
+    const std::uint32_t value = static_cast<std::uint32_t>(code);
+    return value < kPolicySectionBits ? 1u << value : 0u;
+}
+
+} // namespace xmonitor
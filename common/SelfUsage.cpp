@@ -0,0 +1,111 @@
+#include "common/SelfUsage.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+
+namespace xmonitor {
+namespace {
+
+bool readSmallFile(const char* path, char* buffer, std::size_t capacity) {
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    const ssize_t bytes = ::read(fd, buffer, capacity - 1);
+    ::close(fd);
+    if (bytes <= 0) {
+        return false;
+    }
+
+    buffer[bytes] = '\0';
+    return true;
+}
+
+std::uint64_t readFieldValue(const char* text, const char* key) {
+    const char* found = std::strstr(text, key);
+    if (found == nullptr) {
+        return 0;
+    }
+    return std::strtoull(found + std::strlen(key), nullptr, 10);
+}
+
+std::uint64_t timevalToNs(const timeval& value) {
+    return static_cast<std::uint64_t>(value.tv_sec) * 1000000000ull +
+           static_cast<std::uint64_t>(value.tv_usec) * 1000ull;
+}
+
+double perSecond(std::uint64_t delta, std::uint64_t windowNs) {
+    return windowNs > 0 ? static_cast<double>(delta) * 1e9 / static_cast<double>(windowNs) : 0.0;
+}
+
+} // namespace
+
+SelfUsageSampler::SelfUsageSampler(ProcessRole role)
+    : mRole(role) {}
+
+bool SelfUsageSampler::sample(std::uint64_t samplesTaken, std::uint64_t binderTransactions, SelfUsageData& outData) {
+    rusage usage{};
+    if (::getrusage(RUSAGE_SELF, &usage) != 0) {
+        LOG_E("Self usage read failed: getrusage");
+        return false;
+    }
+
+    const std::uint64_t nowNs = monotonicNowNs();
+    const std::uint64_t cpuNs = timevalToNs(usage.ru_utime) + timevalToNs(usage.ru_stime);
+    const std::uint64_t voluntarySwitches = static_cast<std::uint64_t>(usage.ru_nvcsw);
+    const std::uint64_t involuntarySwitches = static_cast<std::uint64_t>(usage.ru_nivcsw);
+
+    char buffer[512];
+    std::uint64_t residentPages = 0;
+    if (readSmallFile("/proc/self/statm", buffer, sizeof(buffer))) {
+        char* cursor = nullptr;
+        std::strtoull(buffer, &cursor, 10);
+        residentPages = std::strtoull(cursor, nullptr, 10);
+    }
+
+    // syscr/syscw only count read- and write-class syscalls, which is what a
+    // procfs collector spends nearly all of its syscalls on.
+    std::uint64_t syscalls = 0;
+    if (readSmallFile("/proc/self/io", buffer, sizeof(buffer))) {
+        syscalls = readFieldValue(buffer, "syscr:") + readFieldValue(buffer, "syscw:");
+    }
+
+    outData.role = static_cast<std::uint32_t>(mRole);
+    outData.pid = static_cast<std::uint32_t>(::getpid());
+    outData.cpuTimeNs = cpuNs;
+    outData.rssBytes = residentPages * static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+    outData.peakRssBytes = static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+    outData.trace.sampleNs = nowNs;
+
+    if (mHasPrevious && nowNs > mPreviousWallNs) {
+        const std::uint64_t windowNs = nowNs - mPreviousWallNs;
+        const std::uint64_t samples = samplesTaken - mPreviousSamples;
+        outData.cpuPercent = static_cast<double>(cpuNs - mPreviousCpuNs) * 100.0 / static_cast<double>(windowNs);
+        outData.voluntarySwitchesPerSec = perSecond(voluntarySwitches - mPreviousVoluntarySwitches, windowNs);
+        outData.involuntarySwitchesPerSec = perSecond(involuntarySwitches - mPreviousInvoluntarySwitches, windowNs);
+        outData.syscallsPerSample = samples > 0
+            ? static_cast<double>(syscalls - mPreviousSyscalls) / static_cast<double>(samples)
+            : 0.0;
+        outData.binderTransactionsPerSec = perSecond(binderTransactions - mPreviousBinderTransactions, windowNs);
+    }
+
+    mHasPrevious = true;
+    mPreviousWallNs = nowNs;
+    mPreviousCpuNs = cpuNs;
+    mPreviousVoluntarySwitches = voluntarySwitches;
+    mPreviousInvoluntarySwitches = involuntarySwitches;
+    mPreviousSyscalls = syscalls;
+    mPreviousSamples = samplesTaken;
+    mPreviousBinderTransactions = binderTransactions;
+    return true;
+}
+
+} // namespace xmonitor
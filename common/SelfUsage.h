@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// Measures what the calling process itself costs: CPU time and context
+// switches from getrusage, RSS from /proc/self/statm and read/write-class
+// syscalls from /proc/self/io. Rates cover the window since the last sample.
+class SelfUsageSampler {
+public:
+    explicit SelfUsageSampler(ProcessRole role);
+
+    // samplesTaken and binderTransactions are cumulative counters owned by
+    // the caller; the sampler turns them into per-sample / per-second values.
+    bool sample(std::uint64_t samplesTaken, std::uint64_t binderTransactions, SelfUsageData& outData);
+
+private:
+    ProcessRole mRole;
+    bool mHasPrevious{false};
+    std::uint64_t mPreviousWallNs{0};
+    std::uint64_t mPreviousCpuNs{0};
+    std::uint64_t mPreviousVoluntarySwitches{0};
+    std::uint64_t mPreviousInvoluntarySwitches{0};
+    std::uint64_t mPreviousSyscalls{0};
+    std::uint64_t mPreviousSamples{0};
+    std::uint64_t mPreviousBinderTransactions{0};
+};
+
+} // namespace xmonitor
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace xmonitor {
+
+// Allocation-free helpers for scanning procfs text in place. Every function
+// takes the cursor by reference and never reads past `end`.
+
+inline void skipBlanks(const char*& cursor, const char* end) {
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t')) {
+        ++cursor;
+    }
+}
+
+inline void skipLine(const char*& cursor, const char* end) {
+    while (cursor < end && *cursor != '\n') {
+        ++cursor;
+    }
+    if (cursor < end) {
+        ++cursor;
+    }
+}
+
+inline void skipToken(const char*& cursor, const char* end) {
+    skipBlanks(cursor, end);
+    while (cursor < end && *cursor != ' ' && *cursor != '\t' && *cursor != '\n') {
+        ++cursor;
+    }
+}
+
+// Returns the next whitespace-delimited token without copying it.
+inline std::size_t readToken(const char*& cursor, const char* end, const char*& outToken) {
+    skipBlanks(cursor, end);
+    outToken = cursor;
+    while (cursor < end && *cursor != ' ' && *cursor != '\t' && *cursor != '\n') {
+        ++cursor;
+    }
+    return static_cast<std::size_t>(cursor - outToken);
+}
+
+inline bool parseU64(const char*& cursor, const char* end, std::uint64_t& outValue) {
+    skipBlanks(cursor, end);
+    if (cursor >= end || *cursor < '0' || *cursor > '9') {
+        return false;
+    }
+
+    std::uint64_t value = 0;
+    while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+        value = value * 10 + static_cast<std::uint64_t>(*cursor - '0');
+        ++cursor;
+    }
+    outValue = value;
+    return true;
+}
+
+inline bool parseI64(const char*& cursor, const char* end, std::int64_t& outValue) {
+    skipBlanks(cursor, end);
+    const bool negative = cursor < end && *cursor == '-';
+    if (negative) {
+        ++cursor;
+    }
+    std::uint64_t magnitude = 0;
+    if (!parseU64(cursor, end, magnitude)) {
+        return false;
+    }
+    outValue = negative ? -static_cast<std::int64_t>(magnitude) : static_cast<std::int64_t>(magnitude);
+    return true;
+}
+
+// Plain decimal ("12.34"), as printed by the kernel; no exponent or locale.
+inline bool parseDecimal(const char*& cursor, const char* end, double& outValue) {
+    std::uint64_t integral = 0;
+    if (!parseU64(cursor, end, integral)) {
+        return false;
+    }
+
+    double value = static_cast<double>(integral);
+    if (cursor < end && *cursor == '.') {
+        ++cursor;
+        double scale = 0.1;
+        while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+            value += static_cast<double>(*cursor - '0') * scale;
+            scale *= 0.1;
+            ++cursor;
+        }
+    }
+    outValue = value;
+    return true;
+}
+
+inline bool startsWith(const char* cursor, const char* end, const char* literal) {
+    const std::size_t length = std::strlen(literal);
+    return static_cast<std::size_t>(end - cursor) >= length && std::memcmp(cursor, literal, length) == 0;
+}
+
+// Advances past `literal` if the cursor is positioned on it.
+inline bool consume(const char*& cursor, const char* end, const char* literal) {
+    if (!startsWith(cursor, end, literal)) {
+        return false;
+    }
+    cursor += std::strlen(literal);
+    return true;
+}
+
+} // namespace xmonitor
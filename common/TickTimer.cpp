@@ -0,0 +1,57 @@
+#include "common/TickTimer.h"
+
+#include <cerrno>
+#include <cmath>
+#include <ctime>
+
+#include "common/MonotonicClock.h"
+
+namespace xmonitor {
+
+bool TickTimer::wait(std::chrono::nanoseconds period) {
+    const std::uint64_t periodNs = static_cast<std::uint64_t>(period.count());
+    const std::uint64_t nowNs = monotonicNowNs();
+    if (mDeadlineNs == 0) {
+        mDeadlineNs = nowNs;
+    }
+    mDeadlineNs += periodNs;
+    if (mDeadlineNs <= nowNs) {
+        ++mOverruns;
+        mDeadlineNs = nowNs + periodNs;
+    }
+
+    timespec deadline{};
+    deadline.tv_sec = static_cast<time_t>(mDeadlineNs / 1000000000ull);
+    deadline.tv_nsec = static_cast<long>(mDeadlineNs % 1000000000ull);
+    // clock_nanosleep returns the error instead of setting errno.
+    if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+        return false;
+    }
+
+    const std::uint64_t wokeNs = monotonicNowNs();
+    const std::uint64_t lateNs = wokeNs > mDeadlineNs ? wokeNs - mDeadlineNs : 0;
+    mLatency.record(lateNs);
+    mSumNs += static_cast<double>(lateNs);
+    mSumSquaresNs += static_cast<double>(lateNs) * static_cast<double>(lateNs);
+    return true;
+}
+
+void TickTimer::report(SelfUsageData& usage) {
+    const std::uint64_t count = mLatency.count();
+    if (count != 0) {
+        const double mean = mSumNs / static_cast<double>(count);
+        const double variance = mSumSquaresNs / static_cast<double>(count) - mean * mean;
+        usage.wakeupP50Us = static_cast<double>(mLatency.valueAtPercentile(50.0)) / 1000.0;
+        usage.wakeupP99Us = static_cast<double>(mLatency.valueAtPercentile(99.0)) / 1000.0;
+        usage.wakeupMaxUs = static_cast<double>(mLatency.max()) / 1000.0;
+        usage.wakeupJitterUs = variance > 0.0 ? std::sqrt(variance) / 1000.0 : 0.0;
+    }
+    usage.tickOverruns = mOverruns;
+
+    mLatency.reset();
+    mSumNs = 0.0;
+    mSumSquaresNs = 0.0;
+    mOverruns = 0;
+}
+
+} // namespace xmonitor
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "common/LatencyHistogram.h"
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// Fixed-cadence sampling ticks: sleeps with clock_nanosleep(TIMER_ABSTIME)
+// on CLOCK_MONOTONIC until one period after the previous deadline, so the
+// cadence does not drift by the time a sample takes, and records how late
+// each wakeup was.
+class TickTimer {
+public:
+    // The first call starts the schedule one period from now. A deadline
+    // that has already passed counts as an overrun and restarts the
+    // schedule from now instead of firing catch-up ticks back to back.
+    // Returns early (false) when a signal interrupts the sleep.
+    bool wait(std::chrono::nanoseconds period);
+
+    // Wakeup latency and jitter since the previous call; starts a new window.
+    void report(SelfUsageData& usage);
+
+    const LatencyHistogram& latency() const {
+        return mLatency;
+    }
+
+private:
+    std::uint64_t mDeadlineNs{0};
+    LatencyHistogram mLatency;
+    double mSumNs{0.0};
+    double mSumSquaresNs{0.0};
+    std::uint32_t mOverruns{0};
+};
+
+} // namespace xmonitor
@@ -1,87 +1,217 @@
 #include "ipc/BinderClientAdapter.h"
 
-#include <cerrno>
-#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <utility>
 
 #include "Logger.h"
-
-extern "C" {
-#include "binder.h"
-}
+#include "common/MonotonicClock.h"
 
 namespace xmonitor {
 
+namespace {
+// Safety net against a missed wake-up; the sender is normally notified.
+constexpr std::chrono::milliseconds kSenderIdleWait{100};
+}
+
 BinderClientAdapter::BinderClientAdapter()
-    : mBinderState(nullptr) {}
+    : mTransactionCount(0),
+      mSenderSleeping(false),
+      mSenderFailed(false),
+      mSenderStopping(false),
+      mSenderTaskIntervalNs(0),
+      mCoalesced(0),
+      mDropped(0) {}
 
 BinderClientAdapter::~BinderClientAdapter() {
     shutdown();
 }
 
 bool BinderClientAdapter::initialize() {
-    if (mBinderState != nullptr) {
+    if (mTransport != nullptr) {
         return true;
     }
 
-    static const char* kCandidates[] = {
-        "/dev/binderfs/binder",
-    };
+    mConfig = transportConfigFromEnv();
+    std::unique_ptr<ClientTransport> transport = createClientTransport(mConfig);
+    if (!transport->open()) {
+        LOG_E("ipc client init failed: transport=%s", xmonitor::transportName(mConfig.kind));
+        return false;
+    }
 
-    for (const char* candidate : kCandidates) {
-        binder_state* state = binder_open(candidate);
-        if (state == nullptr) {
-            LOG_E("binder_open failed on %s", candidate);
-            continue;
-        }
+    mTransport = std::move(transport);
+    return true;
+}
+
+void BinderClientAdapter::shutdown() {
+    stopAsyncSender();
+    if (mTransport != nullptr) {
+        mTransport->close();
+        mTransport.reset();
+    }
+}
+
+bool BinderClientAdapter::isEnabled() const {
+    return mTransport != nullptr;
+}
 
-        mBinderState = state;
-        LOG_I("binder client init success: path=%s", candidate);
+const char* BinderClientAdapter::transportName() const {
+    return xmonitor::transportName(mConfig.kind);
+}
+
+std::uint64_t BinderClientAdapter::transactionCount() const {
+    return mTransactionCount.load(std::memory_order_relaxed);
+}
+
+bool BinderClientAdapter::startAsyncSender() {
+    if (mTransport == nullptr) {
+        LOG_E("ipc async sender rejected: not initialized");
+        return false;
+    }
+    if (mQueue != nullptr) {
         return true;
     }
 
-    LOG_E("binder client init failed");
-    return false;
+    mQueue = std::make_unique<CoalescingSendQueue>();
+    mSenderStopping = false;
+    mSenderFailed.store(false);
+    mSenderThread = std::thread(&BinderClientAdapter::senderLoop, this);
+    LOG_I("ipc async sender started: transport=%s", transportName());
+    return true;
 }
 
-void BinderClientAdapter::shutdown() {
-    if (mBinderState != nullptr) {
-        binder_close(mBinderState);
-        mBinderState = nullptr;
+bool BinderClientAdapter::isAsync() const {
+    return mQueue != nullptr;
+}
+
+void BinderClientAdapter::setSenderTask(std::uint64_t intervalNs, std::function<void()> task) {
+    mSenderTaskIntervalNs = intervalNs;
+    mSenderTask = std::move(task);
+}
+
+BinderClientAdapter::AsyncSendStats BinderClientAdapter::asyncSendStats() const {
+    AsyncSendStats stats;
+    stats.coalesced = mCoalesced.load(std::memory_order_relaxed);
+    stats.dropped = mDropped.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void BinderClientAdapter::stopAsyncSender() {
+    if (!mSenderThread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mWakeMutex);
+        mSenderStopping = true;
     }
+    mWake.notify_one();
+    mSenderThread.join();
+    mQueue.reset();
 }
 
-bool BinderClientAdapter::isEnabled() const {
-    return mBinderState != nullptr;
+void BinderClientAdapter::senderLoop() {
+    OutgoingMessage batch[CoalescingSendQueue::kMaxKeys];
+    std::uint64_t nextTaskNs = monotonicNowNs() + mSenderTaskIntervalNs;
+    for (;;) {
+        if (mSenderTask && monotonicNowNs() >= nextTaskNs) {
+            mSenderTask();
+            nextTaskNs = monotonicNowNs() + mSenderTaskIntervalNs;
+        }
+
+        const std::size_t count = mQueue->pop(batch, CoalescingSendQueue::kMaxKeys);
+        if (count != 0) {
+            std::size_t sent = 0;
+            {
+                std::lock_guard<std::mutex> lock(mTransportMutex);
+                sent = mTransport->sendBatch(batch, count);
+            }
+            mTransactionCount.fetch_add(sent, std::memory_order_relaxed);
+            if (sent < count) {
+                mDropped.fetch_add(count - sent, std::memory_order_relaxed);
+                mSenderFailed.store(true);
+            }
+            continue;
+        }
+
+        // Announce the sleep before the final emptiness check. The flag and
+        // the queue's tail are different atomics, so both sides need a
+        // seq_cst fence between their store and load (see send()): then a
+        // producer either sees the flag and notifies, or its push is seen
+        // here, and no wake-up waits for kSenderIdleWait.
+        std::unique_lock<std::mutex> lock(mWakeMutex);
+        mSenderSleeping.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mQueue->empty()) {
+            if (mSenderStopping) {
+                mSenderSleeping.store(false);
+                return;
+            }
+            mWake.wait_for(lock, kSenderIdleWait);
+        }
+        mSenderSleeping.store(false);
+    }
 }
 
 bool BinderClientAdapter::send(std::uint32_t code, const void* payload, std::size_t payloadSize) {
-    if (mBinderState == nullptr || payload == nullptr || payloadSize == 0) {
-        LOG_E("binder send rejected: state=%p payload=%p size=%zu",
-              static_cast<void*>(mBinderState),
-              payload,
-              payloadSize);
+    if (mTransport == nullptr) {
+        LOG_E("ipc send rejected: not initialized");
         return false;
     }
 
-    const int rc = binder_call(
-        mBinderState,
-        0,
-        code,
-        const_cast<void*>(payload),
-        payloadSize);
-
-    if (rc != 0) {
-        LOG_E("binder_call failed: code=%u size=%zu errno=%d msg=%s",
-              code,
-              payloadSize,
-              errno,
-              std::strerror(errno));
+    if (mQueue != nullptr) {
+        if (payload == nullptr || payloadSize == 0 || mSenderFailed.load(std::memory_order_relaxed)) {
+            LOG_E("ipc async send rejected: payload=%p size=%zu sender_failed=%d",
+                  payload,
+                  payloadSize,
+                  mSenderFailed.load() ? 1 : 0);
+            return false;
+        }
+
+        switch (mQueue->push(code, payload, payloadSize)) {
+            case CoalescingSendQueue::PushResult::Queued:
+                // Pairs with the fence in senderLoop().
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (mSenderSleeping.load()) {
+                    std::lock_guard<std::mutex> lock(mWakeMutex);
+                    mWake.notify_one();
+                }
+                return true;
+            case CoalescingSendQueue::PushResult::Coalesced:
+                mCoalesced.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            case CoalescingSendQueue::PushResult::Dropped:
+            default:
+                if (mDropped.fetch_add(1, std::memory_order_relaxed) == 0) {
+                    LOG_E("ipc async send dropped code=%u: more than %zu codes",
+                          code,
+                          CoalescingSendQueue::kMaxKeys);
+                }
+                return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mTransportMutex);
+    if (!mTransport->send(code, payload, payloadSize)) {
         return false;
     }
 
+    mTransactionCount.fetch_add(1, std::memory_order_relaxed);
     return true;
 }
 
+std::size_t BinderClientAdapter::sendBatch(const OutgoingMessage* messages, std::size_t count) {
+    if (mTransport == nullptr) {
+        LOG_E("ipc sendBatch rejected: not initialized");
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mTransportMutex);
+    const std::size_t sent = mTransport->sendBatch(messages, count);
+    mTransactionCount.fetch_add(sent, std::memory_order_relaxed);
+    return sent;
+}
+
 bool BinderClientAdapter::transact(std::uint32_t code,
                                    const void* payload,
                                    std::size_t payloadSize,
@@ -89,39 +219,16 @@ bool BinderClientAdapter::transact(std::uint32_t code,
                                    std::size_t replyCapacity,
                                    std::size_t& replySize) {
     replySize = 0;
-
-    if (mBinderState == nullptr || payload == nullptr || payloadSize == 0 ||
-        replyBuffer == nullptr || replyCapacity == 0) {
-        LOG_E("binder transact rejected: state=%p payload=%p size=%zu reply=%p cap=%zu",
-              static_cast<void*>(mBinderState),
-              payload,
-              payloadSize,
-              replyBuffer,
-              replyCapacity);
+    if (mTransport == nullptr) {
+        LOG_E("ipc transact rejected: not initialized");
         return false;
     }
-
-    size_t nativeReplySize = 0;
-    const int rc = binder_transact(
-        mBinderState,
-        0,
-        code,
-        const_cast<void*>(payload),
-        payloadSize,
-        replyBuffer,
-        replyCapacity,
-        &nativeReplySize);
-
-    if (rc != 0) {
-        LOG_E("binder_transact failed: code=%u size=%zu errno=%d msg=%s",
-              code,
-              payloadSize,
-              errno,
-              std::strerror(errno));
+    std::lock_guard<std::mutex> lock(mTransportMutex);
+    if (!mTransport->transact(code, payload, payloadSize, replyBuffer, replyCapacity, replySize)) {
         return false;
     }
 
-    replySize = nativeReplySize;
+    mTransactionCount.fetch_add(1, std::memory_order_relaxed);
     return true;
 }
 
@@ -1,12 +1,21 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
 
-struct binder_state;
+#include "ipc/CoalescingSendQueue.h"
+#include "ipc/Transport.h"
 
 namespace xmonitor {
 
+// Client side of the lifecycle IPC. The backend (binder or seqpacket) is
+// chosen from the environment at initialize(); see ipc/Transport.h.
 class BinderClientAdapter {
 public:
     BinderClientAdapter();
@@ -16,10 +25,36 @@ public:
     BinderClientAdapter& operator=(const BinderClientAdapter&) = delete;
 
     bool initialize();
+    // Flushes pending async updates before closing.
     void shutdown();
     bool isEnabled() const;
+    const char* transportName() const;
+
+    // Moves send() off the calling thread: updates are copied into a
+    // CoalescingSendQueue and a sender thread delivers them with
+    // sendBatch(). While lifecycle lags, only the latest update per code is
+    // kept. send() must then be called from a single thread, and returns
+    // false once the sender thread has failed to deliver.
+    bool startAsyncSender();
+    bool isAsync() const;
+
+    // Runs `task` on the sender thread about every `intervalNs`, between
+    // batches, so a periodic two-way transact() never blocks the thread
+    // calling send(). Set before startAsyncSender(); unused without it.
+    void setSenderTask(std::uint64_t intervalNs, std::function<void()> task);
+
+    struct AsyncSendStats {
+        // Updates replaced by a newer one before they were sent.
+        std::uint64_t coalesced{0};
+        // Updates lost: queue out of keys, or the transport failed.
+        std::uint64_t dropped{0};
+    };
+    AsyncSendStats asyncSendStats() const;
 
     bool send(std::uint32_t code, const void* payload, std::size_t payloadSize);
+    // Sends in order and returns how many messages went out; seqpacket
+    // batches them into a few sendmmsg() calls.
+    std::size_t sendBatch(const OutgoingMessage* messages, std::size_t count);
     bool transact(std::uint32_t code,
                   const void* payload,
                   std::size_t payloadSize,
@@ -27,8 +62,31 @@ public:
                   std::size_t replyCapacity,
                   std::size_t& replySize);
 
+    // Successful send/transact calls (one per batched message) since
+    // construction.
+    std::uint64_t transactionCount() const;
+
 private:
-    binder_state* mBinderState;
+    void senderLoop();
+    void stopAsyncSender();
+
+    TransportConfig mConfig;
+    std::unique_ptr<ClientTransport> mTransport;
+    // The sender thread and the caller's transact() share the transport.
+    std::mutex mTransportMutex;
+    std::atomic<std::uint64_t> mTransactionCount;
+
+    std::unique_ptr<CoalescingSendQueue> mQueue;
+    std::thread mSenderThread;
+    std::mutex mWakeMutex;
+    std::condition_variable mWake;
+    std::atomic<bool> mSenderSleeping;
+    std::atomic<bool> mSenderFailed;
+    bool mSenderStopping;
+    std::function<void()> mSenderTask;
+    std::uint64_t mSenderTaskIntervalNs;
+    std::atomic<std::uint64_t> mCoalesced;
+    std::atomic<std::uint64_t> mDropped;
 };
 
 } // namespace xmonitor
@@ -1,37 +1,666 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 
 namespace xmonitor {
 
+// Monotonic timestamps (CLOCK_MONOTONIC, ns) stamped as a sample travels
+// service -> lifecycle -> app. Zero means the hop has not happened yet.
+struct SampleTrace {
+    std::uint64_t sampleNs{0};
+    std::uint64_t ingestNs{0};
+    std::uint64_t receiveNs{0};
+};
+
+// Per-state shares of CPU time since the previous sample; they add up to
+// 100. guest/guestNice are split out of user/nice, which the kernel folds
+// them into.
 struct CpuData {
     std::uint64_t totalJiffies{0};
     std::uint64_t idleJiffies{0};
     double usagePercent{0.0};
+    double userPercent{0.0};
+    double nicePercent{0.0};
+    double systemPercent{0.0};
+    double idlePercent{0.0};
+    double iowaitPercent{0.0};
+    double irqPercent{0.0};
+    double softirqPercent{0.0};
+    double stealPercent{0.0};
+    double guestPercent{0.0};
+    double guestNicePercent{0.0};
+    SampleTrace trace{};
+};
+
+struct PressureStall {
+    double avg10{0.0};
+    double avg60{0.0};
+    double avg300{0.0};
+    std::uint64_t totalUs{0};
+};
+
+struct PressureResource {
+    std::uint32_t available{0};
+    PressureStall some{};
+    PressureStall full{};
+};
+
+// /proc/pressure/{cpu,memory,io}; a resource is unavailable on kernels
+// without CONFIG_PSI or when booted with psi=0.
+struct PressureData {
+    PressureResource cpu{};
+    PressureResource memory{};
+    PressureResource io{};
+    SampleTrace trace{};
 };
 
+constexpr std::size_t kMaxInterruptCpus = 256;
+constexpr std::size_t kMaxHotInterrupts = 16;
+constexpr std::size_t kMaxSoftirqTypes = 12;
+constexpr std::size_t kInterruptNameLength = 12;
+constexpr std::size_t kInterruptLabelLength = 36;
+
+// One row of /proc/interrupts or /proc/softirqs, summed over CPUs.
+struct InterruptLineStats {
+    char name[kInterruptNameLength]{};
+    char label[kInterruptLabelLength]{};
+    std::uint32_t busiestCpu{0};
+    std::uint32_t reserved{0};
+    double perSec{0.0};
+    double busiestCpuPercent{0.0};
+};
+
+// Scheduler saturation and IRQ balance: /proc/loadavg, procs_running and
+// procs_blocked from /proc/stat, and per-CPU rates from /proc/interrupts and
+// /proc/softirqs. Per-CPU arrays cover the first kMaxInterruptCpus online
+// CPUs; cpuCount is the real number.
+struct InterruptData {
+    double load1{0.0};
+    double load5{0.0};
+    double load15{0.0};
+    std::uint32_t runnableTasks{0};
+    std::uint32_t totalTasks{0};
+    std::uint32_t procsRunning{0};
+    std::uint32_t procsBlocked{0};
+    std::uint32_t cpuCount{0};
+    std::uint32_t interruptLines{0};
+    std::uint32_t hotCount{0};
+    std::uint32_t softirqCount{0};
+    double interruptsPerSec{0.0};
+    double softirqsPerSec{0.0};
+    InterruptLineStats hot[kMaxHotInterrupts]{};
+    InterruptLineStats softirqs[kMaxSoftirqTypes]{};
+    double cpuInterruptsPerSec[kMaxInterruptCpus]{};
+    double cpuSoftirqsPerSec[kMaxInterruptCpus]{};
+    SampleTrace trace{};
+};
+
+constexpr std::size_t kMaxTopologyCpus = 256;
+constexpr std::size_t kMaxNumaNodes = 8;
+
+struct CoreStats {
+    std::uint32_t cpu{0};
+    std::uint32_t node{0};
+    std::uint32_t package{0};
+    std::uint32_t core{0};
+    double usagePercent{0.0};
+    std::uint32_t frequencyMhz{0};
+    std::uint32_t reserved{0};
+};
+
+// numastat rates are page allocations per second: local/remote from the
+// node's CPUs' point of view, miss/foreign when the preferred node was full.
+struct NumaNodeStats {
+    std::uint32_t node{0};
+    std::uint32_t cpuCount{0};
+    std::uint64_t memTotalBytes{0};
+    std::uint64_t memFreeBytes{0};
+    std::uint64_t filePagesBytes{0};
+    std::uint64_t anonPagesBytes{0};
+    double usagePercent{0.0};
+    double averageFrequencyMhz{0.0};
+    double localAllocsPerSec{0.0};
+    double remoteAllocsPerSec{0.0};
+    double missesPerSec{0.0};
+    double foreignPerSec{0.0};
+};
+
+// Per-CPU usage and frequency with their socket/node/core placement,
+// discovered once from sysfs; cores are in CPU order.
+struct TopologyData {
+    std::uint32_t cpuCount{0};
+    std::uint32_t coreCount{0};
+    std::uint32_t nodeCount{0};
+    std::uint32_t packageCount{0};
+    CoreStats cores[kMaxTopologyCpus]{};
+    NumaNodeStats nodes[kMaxNumaNodes]{};
+    SampleTrace trace{};
+};
+
+// /proc/meminfo sizes plus per-second /proc/vmstat reclaim and swap rates.
 struct RamData {
     std::uint64_t totalBytes{0};
     std::uint64_t usedBytes{0};
     std::uint64_t availableBytes{0};
     double usagePercent{0.0};
+    std::uint64_t freeBytes{0};
+    std::uint64_t buffersBytes{0};
+    std::uint64_t cachedBytes{0};
+    std::uint64_t swapCachedBytes{0};
+    std::uint64_t activeBytes{0};
+    std::uint64_t inactiveBytes{0};
+    std::uint64_t anonBytes{0};
+    std::uint64_t mappedBytes{0};
+    std::uint64_t shmemBytes{0};
+    std::uint64_t dirtyBytes{0};
+    std::uint64_t writebackBytes{0};
+    std::uint64_t slabBytes{0};
+    std::uint64_t slabReclaimableBytes{0};
+    std::uint64_t slabUnreclaimableBytes{0};
+    std::uint64_t swapTotalBytes{0};
+    std::uint64_t swapFreeBytes{0};
+    std::uint64_t committedBytes{0};
+    std::uint64_t commitLimitBytes{0};
+    double pageFaultsPerSec{0.0};
+    double majorFaultsPerSec{0.0};
+    double pagesScannedPerSec{0.0};
+    double pagesStolenPerSec{0.0};
+    double swapInPagesPerSec{0.0};
+    double swapOutPagesPerSec{0.0};
+    std::uint64_t oomKills{0};
+    SampleTrace trace{};
 };
 
 struct MemoryData {
     std::uint64_t virtualBytes{0};
     std::uint64_t residentBytes{0};
+    SampleTrace trace{};
+};
+
+constexpr std::size_t kMaxMemoryDetailProcesses = 16;
+constexpr std::size_t kProcessNameLength = 16;
+
+// /proc/<pid>/smaps_rollup for one configured process. USS is
+// Private_Clean + Private_Dirty; the Pss_* split needs Linux 5.9+ and stays
+// zero on older kernels. sampleNs says how fresh this entry is, since
+// processes are re-read in rotation.
+struct ProcessMemoryDetail {
+    std::uint32_t pid{0};
+    std::uint32_t available{0};
+    char name[kProcessNameLength]{};
+    std::uint64_t rssBytes{0};
+    std::uint64_t pssBytes{0};
+    std::uint64_t ussBytes{0};
+    std::uint64_t pssAnonBytes{0};
+    std::uint64_t pssFileBytes{0};
+    std::uint64_t pssShmemBytes{0};
+    std::uint64_t anonymousBytes{0};
+    std::uint64_t swapBytes{0};
+    std::uint64_t swapPssBytes{0};
+    std::uint64_t sampleNs{0};
+};
+
+struct MemoryDetailData {
+    std::uint32_t processCount{0};
+    std::uint32_t reserved{0};
+    ProcessMemoryDetail processes[kMaxMemoryDetailProcesses]{};
+    SampleTrace trace{};
+};
+
+constexpr std::size_t kMaxWatchedThreads = 64;
+
+// One thread of the watched process. cpuPercent and runQueueWaitPercent come
+// from schedstat (ns resolution) and are shares of one CPU over the window;
+// the user/system split is apportioned from the coarser stat tick counters.
+struct ThreadStats {
+    std::uint32_t tid{0};
+    std::int32_t lastCpu{-1};
+    char name[kProcessNameLength]{};
+    double cpuPercent{0.0};
+    double userPercent{0.0};
+    double systemPercent{0.0};
+    double runQueueWaitPercent{0.0};
+    double voluntarySwitchesPerSec{0.0};
+    double involuntarySwitchesPerSec{0.0};
+};
+
+// The busiest kMaxWatchedThreads threads of the `xMonitor --watch` target.
+// available is 0 once the process has exited.
+struct ThreadData {
+    std::uint32_t pid{0};
+    std::uint32_t available{0};
+    std::uint32_t threadCount{0};
+    std::uint32_t totalThreads{0};
+    char processName[kProcessNameLength]{};
+    ThreadStats threads[kMaxWatchedThreads]{};
+    SampleTrace trace{};
+};
+
+constexpr std::size_t kMaxProcesses = 32;
+
+struct ProcessStats {
+    std::uint32_t pid{0};
+    std::uint32_t ppid{0};
+    std::uint32_t threadCount{0};
+    std::uint32_t state{0};
+    char name[kProcessNameLength]{};
+    double cpuPercent{0.0};
+    std::uint64_t rssBytes{0};
+};
+
+enum ProcessEventSourceKind : std::uint32_t {
+    PROCESS_SOURCE_POLLING = 0,
+    PROCESS_SOURCE_NETLINK = 1
+};
+
+// Busiest kMaxProcesses processes plus process churn. With the netlink proc
+// connector, shortLivedProcesses counts processes that exited before they
+// were ever sampled, which /proc polling cannot see at all.
+struct ProcessData {
+    std::uint32_t processCount{0};
+    std::uint32_t totalProcesses{0};
+    std::uint32_t eventSource{PROCESS_SOURCE_POLLING};
+    std::uint32_t reserved{0};
+    double forksPerSec{0.0};
+    double execsPerSec{0.0};
+    double exitsPerSec{0.0};
+    std::uint64_t shortLivedProcesses{0};
+    std::uint64_t eventOverflows{0};
+    std::uint64_t fullRescans{0};
+    ProcessStats processes[kMaxProcesses]{};
+    SampleTrace trace{};
+};
+
+// Set by the app, polled by the thread service; pid 0 means nothing is watched.
+struct WatchTarget {
+    std::uint32_t pid{0};
+    std::uint32_t reserved{0};
+};
+
+constexpr std::size_t kMaxDiskDevices = 32;
+constexpr std::size_t kDeviceNameLength = 32;
+
+// Per-device rates over the last sampling window, derived from /proc/diskstats.
+struct DiskDeviceStats {
+    char name[kDeviceNameLength]{};
+    std::uint32_t major{0};
+    std::uint32_t minor{0};
+    double readsPerSec{0.0};
+    double writesPerSec{0.0};
+    double readBytesPerSec{0.0};
+    double writeBytesPerSec{0.0};
+    double readAwaitMs{0.0};
+    double writeAwaitMs{0.0};
+    double queueDepth{0.0};
+    double utilizationPercent{0.0};
+    std::uint64_t inFlight{0};
+};
+
+// One batched record per tick: the busiest kMaxDiskDevices devices that
+// pass the partition/virtual filters, busiest first.
+struct DiskData {
+    std::uint32_t deviceCount{0};
+    std::uint32_t matchedDevices{0};
+    DiskDeviceStats devices[kMaxDiskDevices]{};
+    SampleTrace trace{};
+};
+
+constexpr std::size_t kMaxFilesystems = 32;
+constexpr std::size_t kMountPathLength = 64;
+constexpr std::size_t kFsTypeLength = 16;
+constexpr std::size_t kMountSourceLength = 48;
+
+enum FilesystemState : std::uint32_t {
+    FS_STATE_PENDING = 0,
+    FS_STATE_OK = 1,
+    FS_STATE_HUNG = 2,
+    FS_STATE_ERROR = 3
+};
+
+// statvfs() of one mount. usedPercent is df's Use%: used / (used + space
+// available to unprivileged users), so it reaches 100 before the root
+// reserve is gone.
+struct FilesystemStats {
+    char mountPoint[kMountPathLength]{};
+    char fsType[kFsTypeLength]{};
+    char source[kMountSourceLength]{};
+    std::uint32_t state{FS_STATE_PENDING};
+    std::uint32_t reserved{0};
+    std::uint64_t totalBytes{0};
+    std::uint64_t usedBytes{0};
+    std::uint64_t availableBytes{0};
+    std::uint64_t totalInodes{0};
+    std::uint64_t usedInodes{0};
+    double usedPercent{0.0};
+    double inodeUsedPercent{0.0};
+};
+
+// The fullest kMaxFilesystems real filesystems (hung ones first), from
+// mountinfo plus statvfs at the configured cadence.
+struct FilesystemData {
+    std::uint32_t filesystemCount{0};
+    std::uint32_t matchedFilesystems{0};
+    std::uint32_t hungFilesystems{0};
+    std::uint32_t reserved{0};
+    std::uint64_t mountTableChanges{0};
+    FilesystemStats filesystems[kMaxFilesystems]{};
+    SampleTrace trace{};
+};
+
+constexpr std::size_t kMaxNetInterfaces = 32;
+constexpr std::size_t kInterfaceNameLength = 16;
+
+struct NetInterfaceStats {
+    char name[kInterfaceNameLength]{};
+    double rxBytesPerSec{0.0};
+    double txBytesPerSec{0.0};
+    double rxPacketsPerSec{0.0};
+    double txPacketsPerSec{0.0};
+    double rxErrorsPerSec{0.0};
+    double txErrorsPerSec{0.0};
+    double rxDropsPerSec{0.0};
+    double txDropsPerSec{0.0};
+};
+
+// TCP counters from /proc/net/snmp (Tcp:) and /proc/net/netstat (TcpExt:).
+struct TcpHealth {
+    std::uint64_t currentEstablished{0};
+    double outSegmentsPerSec{0.0};
+    double retransSegmentsPerSec{0.0};
+    double retransPercent{0.0};
+    double outResetsPerSec{0.0};
+    double establishedResetsPerSec{0.0};
+    double attemptFailsPerSec{0.0};
+    double inErrorsPerSec{0.0};
+    double listenOverflowsPerSec{0.0};
+    double listenDropsPerSec{0.0};
+    double timeoutsPerSec{0.0};
+};
+
+// Busiest kMaxNetInterfaces interfaces by throughput, plus host-wide TCP health.
+struct NetData {
+    std::uint32_t interfaceCount{0};
+    std::uint32_t matchedInterfaces{0};
+    NetInterfaceStats interfaces[kMaxNetInterfaces]{};
+    TcpHealth tcp{};
+    SampleTrace trace{};
+};
+
+constexpr std::size_t kMaxCgroups = 32;
+constexpr std::size_t kCgroupPathLength = 96;
+
+// One cgroup v2 directory; path is relative to the cgroup root and keeps its
+// tail (the container/scope name) when it has to be shortened.
+struct CgroupStats {
+    char path[kCgroupPathLength]{};
+    std::uint32_t depth{0};
+    std::uint32_t reserved{0};  // explicit padding; services memcmp these records
+    double cpuPercent{0.0};
+    double cpuThrottledPercent{0.0};
+    std::uint64_t memoryCurrentBytes{0};
+    std::uint64_t memoryAnonBytes{0};
+    std::uint64_t memoryFileBytes{0};
+    double ioReadBytesPerSec{0.0};
+    double ioWriteBytesPerSec{0.0};
+    double ioOpsPerSec{0.0};
+    double cpuPressureSome{0.0};
+    double memoryPressureSome{0.0};
+    double ioPressureSome{0.0};
+};
+
+// Up to kMaxCgroups cgroups chosen so that the top entries by CPU, memory,
+// I/O and pressure are all present; the app re-sorts by any of them.
+struct CgroupData {
+    std::uint32_t cgroupCount{0};
+    std::uint32_t matchedCgroups{0};
+    CgroupStats cgroups[kMaxCgroups]{};
+    SampleTrace trace{};
+};
+
+enum CgroupSortKey : int {
+    CGROUP_SORT_CPU = 0,
+    CGROUP_SORT_MEMORY,
+    CGROUP_SORT_IO,
+    CGROUP_SORT_PRESSURE,
+    CGROUP_SORT_COUNT
+};
+
+inline double cgroupSortValue(const CgroupStats& stats, int sortKey) {
+    switch (sortKey) {
+        case CGROUP_SORT_MEMORY:
+            return static_cast<double>(stats.memoryCurrentBytes);
+        case CGROUP_SORT_IO:
+            return stats.ioReadBytesPerSec + stats.ioWriteBytesPerSec;
+        case CGROUP_SORT_PRESSURE:
+            return std::max(stats.cpuPressureSome, std::max(stats.memoryPressureSome, stats.ioPressureSome));
+        case CGROUP_SORT_CPU:
+        default:
+            return stats.cpuPercent;
+    }
+}
+
+// Descending by the sort key; ties fall back to the path so the order of idle
+// cgroups is stable between samples.
+inline bool cgroupRanksBefore(const CgroupStats& left, const CgroupStats& right, int sortKey) {
+    const double leftValue = cgroupSortValue(left, sortKey);
+    const double rightValue = cgroupSortValue(right, sortKey);
+    if (leftValue != rightValue) {
+        return leftValue > rightValue;
+    }
+    return std::strcmp(left.path, right.path) < 0;
+}
+
+enum class ProcessRole : std::uint32_t {
+    App = 0,
+    Lifecycle = 1,
+    CpuService = 2,
+    RamService = 3,
+    MemoryService = 4,
+    DiskService = 5,
+    NetService = 6,
+    CgroupService = 7,
+    ThreadService = 8,
+    ProcessService = 9
+};
+
+constexpr std::size_t kProcessRoleCount = 10;
+
+// Cost of one xMonitor process, averaged over the last report window.
+struct SelfUsageData {
+    std::uint32_t role{0};
+    std::uint32_t pid{0};
+    std::uint64_t cpuTimeNs{0};
+    double cpuPercent{0.0};
+    std::uint64_t rssBytes{0};
+    std::uint64_t peakRssBytes{0};
+    double voluntarySwitchesPerSec{0.0};
+    double involuntarySwitchesPerSec{0.0};
+    double syscallsPerSample{0.0};
+    double binderTransactionsPerSec{0.0};
+    // Async sender totals (services only): updates replaced by a newer one
+    // before delivery, and updates lost.
+    std::uint64_t sendsCoalesced{0};
+    std::uint64_t sendsDropped{0};
+    // Sampling-loop wakeups (services only): how long after its tick
+    // deadline the thread got to run, and the standard deviation of that.
+    double wakeupP50Us{0.0};
+    double wakeupP99Us{0.0};
+    double wakeupMaxUs{0.0};
+    double wakeupJitterUs{0.0};
+    // Ticks whose deadline had already passed when the loop went to sleep.
+    std::uint32_t tickOverruns{0};
+    // Non-zero when the process runs in low-jitter mode (XMONITOR_LOW_JITTER).
+    std::uint32_t lowJitter{0};
+    SampleTrace trace{};
+};
+
+constexpr std::size_t kMaxAlerts = 16;
+constexpr std::size_t kAlertNameLength = 32;
+constexpr std::size_t kAlertMetricLength = 40;
+
+enum AlertState : std::uint32_t {
+    ALERT_INACTIVE = 0,
+    ALERT_PENDING = 1,
+    ALERT_FIRING = 2
+};
+
+// One rule that is pending (breached, waiting out its `for:` duration) or
+// firing. sinceNs is CLOCK_MONOTONIC of the last state change.
+struct AlertStatus {
+    char name[kAlertNameLength]{};
+    char metric[kAlertMetricLength]{};
+    char op[4]{};
+    std::uint32_t state{ALERT_INACTIVE};
+    double value{0.0};
+    double threshold{0.0};
+    std::uint64_t sinceNs{0};
+};
+
+// Evaluated inside lifecycle from the rules in XMONITOR_ALERT_RULES; firing
+// alerts come first, then pending ones.
+struct AlertData {
+    std::uint32_t ruleCount{0};
+    std::uint32_t firingCount{0};
+    std::uint32_t pendingCount{0};
+    std::uint32_t alertCount{0};
+    std::uint64_t firedTotal{0};
+    std::uint64_t evaluations{0};
+    AlertStatus alerts[kMaxAlerts]{};
+    SampleTrace trace{};
+};
+
+constexpr std::size_t kMaxPercentileMetrics = 8;
+constexpr std::size_t kPercentileWindowCount = 3;
+
+struct PercentileSummary {
+    std::uint64_t count{0};
+    double min{0.0};
+    double p50{0.0};
+    double p95{0.0};
+    double p99{0.0};
+    double max{0.0};
+};
+
+// Reply to QueryPercentiles: per tracked metric and window (1 min, 5 min,
+// 1 h, see windowSeconds), quantiles from lifecycle's streaming sketches.
+// Values are within relativeAccuracy of the true quantile.
+struct PercentileData {
+    std::uint32_t metricCount{0};
+    std::uint32_t windowSeconds[kPercentileWindowCount]{};
+    double relativeAccuracy{0.0};
+    char metrics[kMaxPercentileMetrics][kAlertMetricLength]{};
+    PercentileSummary summaries[kMaxPercentileMetrics][kPercentileWindowCount]{};
+};
+
+constexpr std::size_t kFleetMetricCount = 8;
+constexpr std::size_t kFleetPageHosts = 32;
+constexpr std::size_t kFleetHostNameLength = 64;
+
+struct FleetHost {
+    // Pass to QueryHostSnapshot; stable for the aggregator's lifetime.
+    std::uint32_t id{0};
+    std::uint32_t connected{0};
+    std::uint32_t firingAlerts{0};
+    // Bit i set when values[i] has been reported.
+    std::uint32_t valueMask{0};
+    std::uint64_t lastFrameAgeMs{0};
+    std::uint64_t frames{0};
+    std::uint64_t bytes{0};
+    double values[kFleetMetricCount]{};
+    char name[kFleetHostNameLength]{};
+};
+
+struct FleetRollup {
+    std::uint32_t hostCount{0};
+    std::uint32_t reserved{0};
+    double min{0.0};
+    double mean{0.0};
+    double max{0.0};
+};
+
+// Reply to QueryFleet (request: uint32 index of the first host): one page of
+// hosts known to an aggregator lifecycle plus fleet-wide rollups of the
+// same metrics over every connected host.
+struct FleetData {
+    std::uint32_t hostCount{0};
+    std::uint32_t connectedCount{0};
+    std::uint32_t firstHost{0};
+    std::uint32_t rowCount{0};
+    char metrics[kFleetMetricCount][kAlertMetricLength]{};
+    FleetRollup rollups[kFleetMetricCount]{};
+    FleetHost hosts[kFleetPageHosts]{};
+};
+
+constexpr std::uint32_t kMinSamplePeriodMs = 10;
+constexpr std::uint32_t kMaxSamplePeriodMs = 10000;
+
+// One service's sampling settings. periodMs 0 and a negative deadband keep
+// the service's compiled-in value. The deadband is the smallest change that
+// is published: percentage points for the CPU service, bytes for the RAM
+// and memory services; other services publish every change.
+struct ServicePolicy {
+    std::uint32_t periodMs{0};
+    std::uint32_t reserved{0};
+    double deadband{-1.0};
+};
+
+// Runtime sampling policy held by lifecycle. SetPolicy replaces it whole
+// (and only if `version` still matches, so concurrent editors cannot lose
+// each other's changes); services poll it with QueryPolicy and apply their
+// entry between two samples.
+struct SamplingPolicy {
+    // Bumped by lifecycle on every accepted SetPolicy.
+    std::uint64_t version{0};
+    // Bit n set: the section with update code n is neither sampled by its
+    // service nor kept by lifecycle.
+    std::uint32_t disabledSections{0};
+    std::uint32_t reserved{0};
+    // Indexed by ProcessRole.
+    ServicePolicy services[kProcessRoleCount]{};
 };
 
 enum class BinderTransactionCode : std::uint32_t {
+    // Snapshot sections with no update of their own.
+    None = 0,
     CpuUpdated = 1,
     RamUpdated = 2,
     MemoryUpdated = 3,
+    SelfUsageUpdated = 4,
+    PressureUpdated = 5,
+    DiskUpdated = 6,
+    NetUpdated = 7,
+    CgroupUpdated = 8,
+    MemoryDetailUpdated = 9,
+    ThreadUpdated = 10,
+    ProcessUpdated = 11,
+    InterruptUpdated = 12,
+    TopologyUpdated = 13,
+    FilesystemUpdated = 14,
     RegisterApp = 100,
     RegisterCpuService = 101,
     RegisterRamService = 102,
     RegisterMemoryService = 103,
     WaitStart = 104,
-    QuerySnapshot = 105
+    QuerySnapshot = 105,
+    RegisterDiskService = 106,
+    RegisterNetService = 107,
+    RegisterCgroupService = 108,
+    RegisterThreadService = 109,
+    SetWatchTarget = 110,
+    QueryWatchTarget = 111,
+    RegisterProcessService = 112,
+    QueryPercentiles = 113,
+    QueryFleet = 114,
+    // Request: uint32 FleetHost::id. Reply: that host's BinderSnapshot, or
+    // a BinderAck with ok=0 if the id is unknown.
+    QueryHostSnapshot = 115,
+    // Request: SamplingPolicy carrying the version it was edited from.
+    // Reply: BinderAck, ok=0 if the version is stale or the policy invalid.
+    SetPolicy = 116,
+    QueryPolicy = 117
 };
 
 struct BinderAck {
@@ -43,38 +672,29 @@ struct BinderSnapshot {
     CpuData cpu;
     RamData ram;
     MemoryData memory;
+    SelfUsageData self[kProcessRoleCount];
+    PressureData pressure;
+    DiskData disk;
+    NetData net;
+    CgroupData cgroup;
+    MemoryDetailData memoryDetail;
+    ThreadData thread;
+    ProcessData process;
+    InterruptData interrupts;
+    TopologyData topology;
+    FilesystemData filesystems;
+    AlertData alerts;
 };
 
+// App message ids. A snapshot section is posted under its update code (see
+// ipc/MetricSchema.h); these are the messages that have no update code.
 enum MonitorMessageId : int {
-    CPU_UPDATE = 1,
-    RAM_UPDATE = 2,
-    MEMORY_UPDATE = 3
-};
-
-inline int binderCodeToMessageId(std::uint32_t code) {
-    switch (static_cast<BinderTransactionCode>(code)) {
-        case BinderTransactionCode::CpuUpdated:
-            return CPU_UPDATE;
-        case BinderTransactionCode::RamUpdated:
-            return RAM_UPDATE;
-        case BinderTransactionCode::MemoryUpdated:
-            return MEMORY_UPDATE;
-        default:
-            return -1;
-    }
-}
-
-inline std::uint32_t messageIdToBinderCode(int messageId) {
-    switch (messageId) {
-        case CPU_UPDATE:
-            return static_cast<std::uint32_t>(BinderTransactionCode::CpuUpdated);
-        case RAM_UPDATE:
-            return static_cast<std::uint32_t>(BinderTransactionCode::RamUpdated);
-        case MEMORY_UPDATE:
-            return static_cast<std::uint32_t>(BinderTransactionCode::MemoryUpdated);
-        default:
-            return 0;
-    }
-}
+    // Snapshot section produced by lifecycle itself.
+    ALERT_UPDATE = 200,
+    // Reply to the app's own QueryPercentiles, not part of the snapshot.
+    PERCENTILE_UPDATE = 201,
+    FLEET_UPDATE = 202,
+    POLICY_UPDATE = 203
+};
 
 } // namespace xmonitor
@@ -1,101 +1,57 @@
 #include "ipc/BinderServerAdapter.h"
 
-#include <cerrno>
-#include <cstring>
 #include <utility>
-#include <vector>
 
 #include "Logger.h"
 
-extern "C" {
-#include "binder.h"
-}
-
 namespace xmonitor {
 
-BinderServerAdapter* BinderServerAdapter::sLoopOwner = nullptr;
-
 BinderServerAdapter::BinderServerAdapter()
-    : mBinderState(nullptr) {}
+    : mEnabled(false),
+      mTransactionCount(0) {}
 
 BinderServerAdapter::~BinderServerAdapter() {
     shutdown();
 }
 
 bool BinderServerAdapter::initializeContextManager() {
-    if (mBinderState != nullptr) {
+    if (mEnabled) {
         return true;
     }
 
-    static const char* kCandidates[] = {
-        "/dev/binderfs/binder",
-    };
-
-    for (const char* candidate : kCandidates) {
-        binder_state* state = binder_open(candidate);
-        if (state == nullptr) {
-            LOG_E("binder_open failed on %s", candidate);
-            continue;
-        }
-
-        if (binder_become_context_manager(state) != 0) {
-            LOG_E("binder_become_context_manager failed on %s errno=%d msg=%s",
-                  candidate,
-                  errno,
-                  std::strerror(errno));
-            binder_close(state);
-            continue;
-        }
-
-        mBinderState = state;
-        LOG_I("binder server init success: path=%s", candidate);
-        return true;
+    mConfig = transportConfigFromEnv();
+    mTransport = createServerTransport(mConfig);
+    if (!mTransport->open()) {
+        LOG_E("ipc server init failed: transport=%s", xmonitor::transportName(mConfig.kind));
+        mTransport.reset();
+        return false;
     }
 
-    LOG_E("binder server init failed");
-    return false;
+    mEnabled = true;
+    return true;
 }
 
 void BinderServerAdapter::shutdown() {
-    if (mBinderState != nullptr) {
-        binder_close(mBinderState);
-        mBinderState = nullptr;
-    }
-
-    if (sLoopOwner == this) {
-        sLoopOwner = nullptr;
+    if (mEnabled) {
+        mTransport->close();
+        mEnabled = false;
     }
 }
 
 bool BinderServerAdapter::isEnabled() const {
-    return mBinderState != nullptr;
+    return mEnabled;
 }
 
-bool BinderServerAdapter::reply(std::uint32_t code, const void* payload, std::size_t payloadSize) {
-    if (mBinderState == nullptr || payload == nullptr || payloadSize == 0) {
-        LOG_E("binder reply rejected: state=%p payload=%p size=%zu",
-              static_cast<void*>(mBinderState),
-              payload,
-              payloadSize);
-        return false;
-    }
+const char* BinderServerAdapter::transportName() const {
+    return xmonitor::transportName(mConfig.kind);
+}
 
-    const int rc = binder_send_reply(
-        mBinderState,
-        code,
-        const_cast<void*>(payload),
-        payloadSize);
-
-    if (rc != 0) {
-        LOG_E("binder_send_reply failed: code=%u size=%zu errno=%d msg=%s",
-              code,
-              payloadSize,
-              errno,
-              std::strerror(errno));
+bool BinderServerAdapter::reply(std::uint32_t code, const void* payload, std::size_t payloadSize) {
+    if (!mEnabled) {
+        LOG_E("ipc reply rejected: not initialized");
         return false;
     }
-
-    return true;
+    return mTransport->reply(code, payload, payloadSize);
 }
 
 void BinderServerAdapter::setTransactionCallback(TransactionCallback callback) {
@@ -103,32 +59,20 @@ void BinderServerAdapter::setTransactionCallback(TransactionCallback callback) {
 }
 
 void BinderServerAdapter::loop() {
-    if (mBinderState == nullptr) {
+    if (!mEnabled) {
         return;
     }
 
-    sLoopOwner = this;
-    binder_loop(mBinderState, &BinderServerAdapter::transactionHandlerThunk);
-}
-
-void BinderServerAdapter::transactionHandlerThunk(struct binder_state*, struct binder_transaction_data* txn) {
-    if (sLoopOwner != nullptr) {
-        sLoopOwner->onTransaction(txn);
-    }
+    mTransport->loop([this](std::uint32_t code, const void* payload, std::size_t payloadSize) {
+        ++mTransactionCount;
+        if (mTransactionCallback) {
+            mTransactionCallback(code, payload, payloadSize);
+        }
+    });
 }
 
-void BinderServerAdapter::onTransaction(struct binder_transaction_data* txn) {
-    if (txn == nullptr || txn->data_size == 0 || txn->data.ptr.buffer == 0) {
-        return;
-    }
-
-    if (!mTransactionCallback) {
-        return;
-    }
-
-    std::vector<std::uint8_t> payload(txn->data_size);
-    std::memcpy(payload.data(), reinterpret_cast<void*>(txn->data.ptr.buffer), txn->data_size);
-    mTransactionCallback(txn->code, payload.data(), payload.size());
+std::uint64_t BinderServerAdapter::transactionCount() const {
+    return mTransactionCount;
 }
 
 } // namespace xmonitor
@@ -3,12 +3,15 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
 
-struct binder_state;
-struct binder_transaction_data;
+#include "ipc/Transport.h"
 
 namespace xmonitor {
 
+// Server side of the lifecycle IPC: the binder context manager, or the
+// seqpacket listener, depending on the transport chosen at
+// initializeContextManager(); see ipc/Transport.h.
 class BinderServerAdapter {
 public:
     using TransactionCallback = std::function<void(std::uint32_t, const void*, std::size_t)>;
@@ -20,21 +23,26 @@ public:
     BinderServerAdapter& operator=(const BinderServerAdapter&) = delete;
 
     bool initializeContextManager();
+    // Safe to call from another thread while loop() runs; loop() returns.
     void shutdown();
     bool isEnabled() const;
+    const char* transportName() const;
 
     bool reply(std::uint32_t code, const void* payload, std::size_t payloadSize);
     void setTransactionCallback(TransactionCallback callback);
     void loop();
 
-private:
-    static void transactionHandlerThunk(struct binder_state* bs, struct binder_transaction_data* txn);
-    void onTransaction(struct binder_transaction_data* txn);
+    // Transactions received by loop() since construction.
+    std::uint64_t transactionCount() const;
 
-    binder_state* mBinderState;
+private:
+    TransportConfig mConfig;
+    // Kept until destruction: shutdown() may race a loop() still unwinding
+    // on another thread.
+    std::unique_ptr<ServerTransport> mTransport;
+    bool mEnabled;
     TransactionCallback mTransactionCallback;
-
-    static BinderServerAdapter* sLoopOwner;
+    std::uint64_t mTransactionCount;
 };
 
 } // namespace xmonitor
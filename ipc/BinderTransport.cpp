@@ -0,0 +1,214 @@
+#include "ipc/BinderTransport.h"
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include "Logger.h"
+
+extern "C" {
+#include "binder.h"
+}
+
+namespace xmonitor {
+
+BinderServerTransport* BinderServerTransport::sLoopOwner = nullptr;
+
+BinderClientTransport::BinderClientTransport()
+    : mBinderState(nullptr) {}
+
+BinderClientTransport::~BinderClientTransport() {
+    close();
+}
+
+bool BinderClientTransport::open() {
+    if (mBinderState != nullptr) {
+        return true;
+    }
+
+    binder_state* state = binder_open(kBinderDevicePath);
+    if (state == nullptr) {
+        LOG_E("binder_open failed on %s", kBinderDevicePath);
+        return false;
+    }
+
+    mBinderState = state;
+    LOG_I("binder client init success: path=%s", kBinderDevicePath);
+    return true;
+}
+
+void BinderClientTransport::close() {
+    if (mBinderState != nullptr) {
+        binder_close(mBinderState);
+        mBinderState = nullptr;
+    }
+}
+
+bool BinderClientTransport::send(std::uint32_t code, const void* payload, std::size_t payloadSize) {
+    if (mBinderState == nullptr || payload == nullptr || payloadSize == 0) {
+        LOG_E("binder send rejected: state=%p payload=%p size=%zu",
+              static_cast<void*>(mBinderState),
+              payload,
+              payloadSize);
+        return false;
+    }
+
+    const int rc = binder_call(
+        mBinderState,
+        0,
+        code,
+        const_cast<void*>(payload),
+        payloadSize);
+
+    if (rc != 0) {
+        LOG_E("binder_call failed: code=%u size=%zu errno=%d msg=%s",
+              code,
+              payloadSize,
+              errno,
+              std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool BinderClientTransport::transact(std::uint32_t code,
+                                     const void* payload,
+                                     std::size_t payloadSize,
+                                     void* replyBuffer,
+                                     std::size_t replyCapacity,
+                                     std::size_t& replySize) {
+    replySize = 0;
+
+    if (mBinderState == nullptr || payload == nullptr || payloadSize == 0 ||
+        replyBuffer == nullptr || replyCapacity == 0) {
+        LOG_E("binder transact rejected: state=%p payload=%p size=%zu reply=%p cap=%zu",
+              static_cast<void*>(mBinderState),
+              payload,
+              payloadSize,
+              replyBuffer,
+              replyCapacity);
+        return false;
+    }
+
+    size_t nativeReplySize = 0;
+    const int rc = binder_transact(
+        mBinderState,
+        0,
+        code,
+        const_cast<void*>(payload),
+        payloadSize,
+        replyBuffer,
+        replyCapacity,
+        &nativeReplySize);
+
+    if (rc != 0) {
+        LOG_E("binder_transact failed: code=%u size=%zu errno=%d msg=%s",
+              code,
+              payloadSize,
+              errno,
+              std::strerror(errno));
+        return false;
+    }
+
+    replySize = nativeReplySize;
+    return true;
+}
+
+BinderServerTransport::BinderServerTransport()
+    : mBinderState(nullptr),
+      mHandler(nullptr) {}
+
+BinderServerTransport::~BinderServerTransport() {
+    close();
+}
+
+bool BinderServerTransport::open() {
+    if (mBinderState != nullptr) {
+        return true;
+    }
+
+    binder_state* state = binder_open(kBinderDevicePath);
+    if (state == nullptr) {
+        LOG_E("binder_open failed on %s", kBinderDevicePath);
+        return false;
+    }
+
+    if (binder_become_context_manager(state) != 0) {
+        LOG_E("binder_become_context_manager failed on %s errno=%d msg=%s",
+              kBinderDevicePath,
+              errno,
+              std::strerror(errno));
+        binder_close(state);
+        return false;
+    }
+
+    mBinderState = state;
+    LOG_I("binder server init success: path=%s", kBinderDevicePath);
+    return true;
+}
+
+void BinderServerTransport::close() {
+    if (mBinderState != nullptr) {
+        binder_close(mBinderState);
+        mBinderState = nullptr;
+    }
+
+    if (sLoopOwner == this) {
+        sLoopOwner = nullptr;
+    }
+}
+
+bool BinderServerTransport::reply(std::uint32_t code, const void* payload, std::size_t payloadSize) {
+    if (mBinderState == nullptr || payload == nullptr || payloadSize == 0) {
+        LOG_E("binder reply rejected: state=%p payload=%p size=%zu",
+              static_cast<void*>(mBinderState),
+              payload,
+              payloadSize);
+        return false;
+    }
+
+    const int rc = binder_send_reply(
+        mBinderState,
+        code,
+        const_cast<void*>(payload),
+        payloadSize);
+
+    if (rc != 0) {
+        LOG_E("binder_send_reply failed: code=%u size=%zu errno=%d msg=%s",
+              code,
+              payloadSize,
+              errno,
+              std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void BinderServerTransport::loop(const Handler& handler) {
+    if (mBinderState == nullptr) {
+        return;
+    }
+
+    mHandler = &handler;
+    sLoopOwner = this;
+    binder_loop(mBinderState, &BinderServerTransport::transactionHandlerThunk);
+    mHandler = nullptr;
+}
+
+void BinderServerTransport::transactionHandlerThunk(struct binder_state*, struct binder_transaction_data* txn) {
+    if (sLoopOwner != nullptr) {
+        sLoopOwner->onTransaction(txn);
+    }
+}
+
+void BinderServerTransport::onTransaction(struct binder_transaction_data* txn) {
+    if (txn == nullptr || txn->data_size == 0 || txn->data.ptr.buffer == 0 || mHandler == nullptr) {
+        return;
+    }
+
+    std::vector<std::uint8_t> payload(txn->data_size);
+    std::memcpy(payload.data(), reinterpret_cast<void*>(txn->data.ptr.buffer), txn->data_size);
+    (*mHandler)(txn->code, payload.data(), payload.size());
+}
+
+} // namespace xmonitor
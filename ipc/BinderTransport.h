@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ipc/Transport.h"
+
+struct binder_state;
+struct binder_transaction_data;
+
+namespace xmonitor {
+
+constexpr const char* kBinderDevicePath = "/dev/binderfs/binder";
+
+// linux_binder backend: lifecycle is the context manager (handle 0) and
+// send() is a synchronous binder_call.
+class BinderClientTransport : public ClientTransport {
+public:
+    BinderClientTransport();
+    ~BinderClientTransport() override;
+
+    bool open() override;
+    void close() override;
+
+    bool send(std::uint32_t code, const void* payload, std::size_t payloadSize) override;
+    bool transact(std::uint32_t code,
+                  const void* payload,
+                  std::size_t payloadSize,
+                  void* replyBuffer,
+                  std::size_t replyCapacity,
+                  std::size_t& replySize) override;
+
+private:
+    binder_state* mBinderState;
+};
+
+class BinderServerTransport : public ServerTransport {
+public:
+    BinderServerTransport();
+    ~BinderServerTransport() override;
+
+    bool open() override;
+    void close() override;
+
+    bool reply(std::uint32_t code, const void* payload, std::size_t payloadSize) override;
+    void loop(const Handler& handler) override;
+
+private:
+    static void transactionHandlerThunk(struct binder_state* bs, struct binder_transaction_data* txn);
+    void onTransaction(struct binder_transaction_data* txn);
+
+    binder_state* mBinderState;
+    const Handler* mHandler;
+
+    // binder_loop takes a plain function pointer.
+    static BinderServerTransport* sLoopOwner;
+};
+
+} // namespace xmonitor
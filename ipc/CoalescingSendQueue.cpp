@@ -0,0 +1,69 @@
+#include "ipc/CoalescingSendQueue.h"
+
+namespace xmonitor {
+
+static_assert((CoalescingSendQueue::kMaxKeys & (CoalescingSendQueue::kMaxKeys - 1)) == 0,
+              "ready ring indexes wrap with a mask");
+
+CoalescingSendQueue::CoalescingSendQueue()
+    : mKeyCount(0),
+      mReady{},
+      mReadyHead(0),
+      mReadyTail(0) {}
+
+CoalescingSendQueue::PushResult CoalescingSendQueue::push(std::uint32_t code,
+                                                          const void* payload,
+                                                          std::size_t payloadSize) {
+    std::size_t index = 0;
+    while (index < mKeyCount && mSlots[index].code != code) {
+        ++index;
+    }
+    if (index == mKeyCount) {
+        if (mKeyCount == kMaxKeys) {
+            return PushResult::Dropped;
+        }
+        mSlots[index].code = code;
+        ++mKeyCount;
+    }
+
+    Slot& slot = mSlots[index];
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(payload);
+    slot.buffers[slot.back].assign(bytes, bytes + payloadSize);
+
+    const std::uint8_t previous = slot.middle.exchange(static_cast<std::uint8_t>(slot.back | kDirty),
+                                                       std::memory_order_acq_rel);
+    slot.back = previous & kIndexMask;
+    if ((previous & kDirty) != 0) {
+        return PushResult::Coalesced;
+    }
+
+    const std::uint32_t tail = mReadyTail.load(std::memory_order_relaxed);
+    mReady[tail & (kMaxKeys - 1)] = static_cast<std::uint32_t>(index);
+    mReadyTail.store(tail + 1, std::memory_order_release);
+    return PushResult::Queued;
+}
+
+std::size_t CoalescingSendQueue::pop(OutgoingMessage* outMessages, std::size_t capacity) {
+    std::uint32_t head = mReadyHead.load(std::memory_order_relaxed);
+    const std::uint32_t tail = mReadyTail.load(std::memory_order_acquire);
+
+    std::size_t count = 0;
+    while (head != tail && count < capacity) {
+        Slot& slot = mSlots[mReady[head & (kMaxKeys - 1)]];
+        ++head;
+
+        const std::uint8_t previous = slot.middle.exchange(slot.front, std::memory_order_acq_rel);
+        slot.front = previous & kIndexMask;
+        const std::vector<std::uint8_t>& buffer = slot.buffers[slot.front];
+        outMessages[count++] = OutgoingMessage{slot.code, buffer.data(), buffer.size()};
+    }
+
+    mReadyHead.store(head, std::memory_order_release);
+    return count;
+}
+
+bool CoalescingSendQueue::empty() const {
+    return mReadyHead.load(std::memory_order_acquire) == mReadyTail.load(std::memory_order_acquire);
+}
+
+} // namespace xmonitor
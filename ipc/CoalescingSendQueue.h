@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ipc/Transport.h"
+
+namespace xmonitor {
+
+// Lock-free hand-off of updates from one producer thread to one sender
+// thread, keeping only the latest payload per transaction code.
+//
+// Each code owns a triple buffer: the producer writes its back buffer and
+// swaps it into the middle with a dirty bit; the sender swaps the middle
+// out into its front buffer. A push that finds the dirty bit still set
+// replaced an update the sender never saw (coalesced). A push that sets it
+// appends the code to a bounded SPSC ring of ready keys, so the ring holds
+// each code at most once and never overflows; only codes beyond kMaxKeys
+// are dropped.
+class CoalescingSendQueue {
+public:
+    static constexpr std::size_t kMaxKeys = 32;
+
+    enum class PushResult {
+        Queued,
+        Coalesced,
+        Dropped
+    };
+
+    CoalescingSendQueue();
+
+    CoalescingSendQueue(const CoalescingSendQueue&) = delete;
+    CoalescingSendQueue& operator=(const CoalescingSendQueue&) = delete;
+
+    // Producer thread only. Copies the payload; allocates only while a
+    // code's buffers grow to its payload size.
+    PushResult push(std::uint32_t code, const void* payload, std::size_t payloadSize);
+
+    // Sender thread only. Fills up to `capacity` ready updates, oldest key
+    // first; their payloads stay valid until the next pop().
+    std::size_t pop(OutgoingMessage* outMessages, std::size_t capacity);
+
+    // Acquire loads only: a caller pairing it with a store to another
+    // atomic (a sleep flag) needs its own seq_cst fence in between.
+    bool empty() const;
+
+private:
+    static constexpr std::uint8_t kDirty = 0x4;
+    static constexpr std::uint8_t kIndexMask = 0x3;
+
+    struct Slot {
+        std::uint32_t code{0};
+        std::array<std::vector<std::uint8_t>, 3> buffers;
+        // Buffer index owned by the producer / the sender.
+        std::uint8_t back{0};
+        std::uint8_t front{2};
+        // Shared buffer index | kDirty.
+        std::atomic<std::uint8_t> middle{1};
+    };
+
+    std::array<Slot, kMaxKeys> mSlots;
+    // Producer only.
+    std::size_t mKeyCount;
+
+    std::array<std::uint32_t, kMaxKeys> mReady;
+    std::atomic<std::uint32_t> mReadyHead;
+    std::atomic<std::uint32_t> mReadyTail;
+};
+
+} // namespace xmonitor
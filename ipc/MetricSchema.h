@@ -0,0 +1,246 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// The one description of every BinderSnapshot section: the update code that
+// carries it on the wire, the app message id it is posted under, its payload
+// type and the snapshot member it is stored in. Code -> section and
+// message id -> section lookups, payload size checks, lifecycle ingestion
+// and the app's storage/dispatch are all generated from MetricSchema below.
+//
+// Adding a metric: a payload struct with a SampleTrace `trace`, a member in
+// BinderSnapshot, a BinderTransactionCode, and one SnapshotSection line.
+//
+// An array member holds one slot per role (SelfUsageData): the payload's
+// `role` picks the slot and out-of-range roles are dropped.
+
+template <typename Member>
+struct SectionSlots {
+    using Payload = Member;
+    static constexpr std::size_t kCount = 1;
+
+    static Payload* slotFor(Member& member, const Payload&) {
+        return &member;
+    }
+    static Payload& at(Member& member, std::size_t) {
+        return member;
+    }
+    static const Payload& at(const Member& member, std::size_t) {
+        return member;
+    }
+};
+
+template <typename T, std::size_t N>
+struct SectionSlots<T[N]> {
+    using Payload = T;
+    static constexpr std::size_t kCount = N;
+
+    static Payload* slotFor(T (&member)[N], const Payload& payload) {
+        return payload.role < N ? &member[payload.role] : nullptr;
+    }
+    static Payload& at(T (&member)[N], std::size_t slot) {
+        return member[slot];
+    }
+    static const Payload& at(const T (&member)[N], std::size_t slot) {
+        return member[slot];
+    }
+};
+
+// MessageId defaults to the wire code; sections lifecycle produces itself
+// (BinderTransactionCode::None) must name one.
+template <BinderTransactionCode Code,
+          typename Member,
+          Member BinderSnapshot::*Field,
+          int MessageId = static_cast<int>(Code)>
+struct SnapshotSection {
+    using Slots = SectionSlots<Member>;
+    using Payload = typename Slots::Payload;
+
+    static constexpr BinderTransactionCode code = Code;
+    static constexpr int messageId = MessageId;
+    static constexpr std::size_t payloadSize = sizeof(Payload);
+    static constexpr std::size_t slotCount = Slots::kCount;
+
+    static_assert(std::is_trivially_copyable<Payload>::value, "sections travel as raw bytes");
+    static_assert(std::is_same<decltype(Payload::trace), SampleTrace>::value, "every section carries a SampleTrace");
+    static_assert(MessageId > 0, "message id 0 is reserved");
+
+    static Member& field(BinderSnapshot& snapshot) {
+        return snapshot.*Field;
+    }
+    static const Member& field(const BinderSnapshot& snapshot) {
+        return snapshot.*Field;
+    }
+
+    // `payload` holds payloadSize bytes. Returns the stored slot's trace, or
+    // nullptr when the payload addresses no slot.
+    static SampleTrace* ingest(BinderSnapshot& snapshot, const void* payload) {
+        Payload* slot = Slots::slotFor(field(snapshot), *static_cast<const Payload*>(payload));
+        if (slot == nullptr) {
+            return nullptr;
+        }
+        std::memcpy(static_cast<void*>(slot), payload, payloadSize);
+        return &slot->trace;
+    }
+
+    static const SampleTrace& trace(const BinderSnapshot& snapshot, std::size_t slot) {
+        return Slots::at(field(snapshot), slot).trace;
+    }
+
+    // Back to the value-initialized state every section starts in.
+    static void clear(BinderSnapshot& snapshot) {
+        std::memset(static_cast<void*>(&field(snapshot)), 0, sizeof(Member));
+    }
+};
+
+// Type-erased view of a SnapshotSection for runtime lookups.
+struct SnapshotSectionInfo {
+    BinderTransactionCode code;
+    int messageId;
+    std::size_t payloadSize;
+    std::size_t slotCount;
+    SampleTrace* (*ingest)(BinderSnapshot&, const void*);
+    const SampleTrace& (*trace)(const BinderSnapshot&, std::size_t);
+    void (*clear)(BinderSnapshot&);
+};
+
+constexpr std::uint16_t kNoSection = 0xFFFF;
+
+namespace schema_detail {
+
+template <std::size_t N>
+constexpr std::uint32_t maxOf(const std::uint32_t (&values)[N]) {
+    std::uint32_t result = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+        result = values[i] > result ? values[i] : result;
+    }
+    return result;
+}
+
+// Zero keys (no wire code) are allowed to repeat.
+template <std::size_t N>
+constexpr bool uniqueKeys(const std::uint32_t (&values)[N]) {
+    for (std::size_t i = 0; i < N; ++i) {
+        for (std::size_t j = i + 1; j < N; ++j) {
+            if (values[i] != 0 && values[i] == values[j]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <std::size_t Size, std::size_t N>
+constexpr std::array<std::uint16_t, Size> indexByKey(const std::uint32_t (&values)[N]) {
+    std::array<std::uint16_t, Size> index{};
+    for (std::size_t i = 0; i < Size; ++i) {
+        index[i] = kNoSection;
+    }
+    for (std::size_t i = 0; i < N; ++i) {
+        if (values[i] != 0) {
+            index[values[i]] = static_cast<std::uint16_t>(i);
+        }
+    }
+    return index;
+}
+
+} // namespace schema_detail
+
+template <typename... Sections>
+struct SnapshotSchema {
+    static constexpr std::size_t kCount = sizeof...(Sections);
+
+    static constexpr SnapshotSectionInfo kInfo[kCount] = {
+        {Sections::code,
+         Sections::messageId,
+         Sections::payloadSize,
+         Sections::slotCount,
+         &Sections::ingest,
+         &Sections::trace,
+         &Sections::clear}...};
+
+    static constexpr std::uint32_t kCodes[kCount] = {static_cast<std::uint32_t>(Sections::code)...};
+    static constexpr std::uint32_t kMessageIds[kCount] = {static_cast<std::uint32_t>(Sections::messageId)...};
+
+    // Lookup tables are indexed directly by code / message id.
+    static constexpr std::size_t kCodeTableSize = schema_detail::maxOf(kCodes) + 1;
+    static constexpr std::size_t kMessageTableSize = schema_detail::maxOf(kMessageIds) + 1;
+
+    static_assert(kCount < kNoSection, "section index must fit the lookup tables");
+    static_assert(schema_detail::uniqueKeys(kCodes), "two sections share an update code");
+    static_assert(schema_detail::uniqueKeys(kMessageIds), "two sections share a message id");
+    static_assert(kCodeTableSize <= static_cast<std::size_t>(BinderTransactionCode::RegisterApp),
+                  "update codes must stay below the control codes");
+
+    static constexpr std::array<std::uint16_t, kCodeTableSize> kByCode =
+        schema_detail::indexByKey<kCodeTableSize>(kCodes);
+    static constexpr std::array<std::uint16_t, kMessageTableSize> kByMessageId =
+        schema_detail::indexByKey<kMessageTableSize>(kMessageIds);
+
+    // Calls visitor(Section{}) for every section, in schema order.
+    template <typename Visitor>
+    static void forEach(Visitor&& visitor) {
+        (visitor(Sections{}), ...);
+    }
+
+    // A message id -> Make<Section>::value table, e.g. typed handlers.
+    template <typename Fn, template <typename> class Make>
+    static constexpr std::array<Fn, kMessageTableSize> byMessageId() {
+        std::array<Fn, kMessageTableSize> table{};
+        ((table[static_cast<std::size_t>(Sections::messageId)] = Make<Sections>::value), ...);
+        return table;
+    }
+};
+
+using MetricSchema = SnapshotSchema<
+    SnapshotSection<BinderTransactionCode::CpuUpdated, CpuData, &BinderSnapshot::cpu>,
+    SnapshotSection<BinderTransactionCode::RamUpdated, RamData, &BinderSnapshot::ram>,
+    SnapshotSection<BinderTransactionCode::MemoryUpdated, MemoryData, &BinderSnapshot::memory>,
+    SnapshotSection<BinderTransactionCode::SelfUsageUpdated, SelfUsageData[kProcessRoleCount], &BinderSnapshot::self>,
+    SnapshotSection<BinderTransactionCode::PressureUpdated, PressureData, &BinderSnapshot::pressure>,
+    SnapshotSection<BinderTransactionCode::DiskUpdated, DiskData, &BinderSnapshot::disk>,
+    SnapshotSection<BinderTransactionCode::NetUpdated, NetData, &BinderSnapshot::net>,
+    SnapshotSection<BinderTransactionCode::CgroupUpdated, CgroupData, &BinderSnapshot::cgroup>,
+    SnapshotSection<BinderTransactionCode::MemoryDetailUpdated, MemoryDetailData, &BinderSnapshot::memoryDetail>,
+    SnapshotSection<BinderTransactionCode::ThreadUpdated, ThreadData, &BinderSnapshot::thread>,
+    SnapshotSection<BinderTransactionCode::ProcessUpdated, ProcessData, &BinderSnapshot::process>,
+    SnapshotSection<BinderTransactionCode::InterruptUpdated, InterruptData, &BinderSnapshot::interrupts>,
+    SnapshotSection<BinderTransactionCode::TopologyUpdated, TopologyData, &BinderSnapshot::topology>,
+    SnapshotSection<BinderTransactionCode::FilesystemUpdated, FilesystemData, &BinderSnapshot::filesystems>,
+    SnapshotSection<BinderTransactionCode::None, AlertData, &BinderSnapshot::alerts, ALERT_UPDATE>>;
+
+// nullptr unless `code` is a section's update code.
+inline const SnapshotSectionInfo* snapshotSectionForCode(std::uint32_t code) {
+    if (code == 0 || code >= MetricSchema::kCodeTableSize || MetricSchema::kByCode[code] == kNoSection) {
+        return nullptr;
+    }
+    return &MetricSchema::kInfo[MetricSchema::kByCode[code]];
+}
+
+inline const SnapshotSectionInfo* snapshotSectionForMessage(int messageId) {
+    if (messageId <= 0 || static_cast<std::size_t>(messageId) >= MetricSchema::kMessageTableSize ||
+        MetricSchema::kByMessageId[static_cast<std::size_t>(messageId)] == kNoSection) {
+        return nullptr;
+    }
+    return &MetricSchema::kInfo[MetricSchema::kByMessageId[static_cast<std::size_t>(messageId)]];
+}
+
+inline int binderCodeToMessageId(std::uint32_t code) {
+    const SnapshotSectionInfo* section = snapshotSectionForCode(code);
+    return section != nullptr ? section->messageId : -1;
+}
+
+inline std::uint32_t messageIdToBinderCode(int messageId) {
+    const SnapshotSectionInfo* section = snapshotSectionForMessage(messageId);
+    return section != nullptr ? static_cast<std::uint32_t>(section->code) : 0;
+}
+
+} // namespace xmonitor
@@ -0,0 +1,565 @@
+#include "ipc/SeqpacketTransport.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <grp.h>
+#include <pwd.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Logger.h"
+
+namespace xmonitor {
+
+namespace {
+constexpr int kListenBacklog = 128;
+constexpr int kMaxEpollEvents = 32;
+// A client that stops reading its replies must not stall every other one.
+constexpr long kReplyTimeoutSec = 1;
+
+// "@name" is an abstract socket, anything else a filesystem path.
+bool makeAddress(const std::string& path, sockaddr_un& outAddress, socklen_t& outLength) {
+    std::memset(&outAddress, 0, sizeof(outAddress));
+    outAddress.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(outAddress.sun_path)) {
+        LOG_E("seqpacket socket path invalid: '%s'", path.c_str());
+        return false;
+    }
+
+    std::memcpy(outAddress.sun_path, path.data(), path.size());
+    if (path[0] == '@') {
+        outAddress.sun_path[0] = '\0';
+        outLength = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size());
+    } else {
+        outLength = static_cast<socklen_t>(sizeof(outAddress));
+    }
+    return true;
+}
+
+// Primary or supplementary membership of `uid`'s account in `group`,
+// resolved through NSS like login does.
+bool userInGroup(uid_t uid, gid_t group) {
+    passwd entry{};
+    passwd* found = nullptr;
+    std::vector<char> buffer(16 * 1024);
+    if (::getpwuid_r(uid, &entry, buffer.data(), buffer.size(), &found) != 0 || found == nullptr) {
+        return false;
+    }
+    if (entry.pw_gid == group) {
+        return true;
+    }
+
+    int count = 64;
+    std::vector<gid_t> groups(static_cast<std::size_t>(count));
+    if (::getgrouplist(entry.pw_name, entry.pw_gid, groups.data(), &count) < 0) {
+        // count now holds the number needed.
+        groups.resize(static_cast<std::size_t>(count));
+        if (::getgrouplist(entry.pw_name, entry.pw_gid, groups.data(), &count) < 0) {
+            return false;
+        }
+    }
+    return std::find(groups.begin(), groups.begin() + count, group) != groups.begin() + count;
+}
+
+int connectTo(const std::string& path) {
+    sockaddr_un address;
+    socklen_t addressLength = 0;
+    if (!makeAddress(path, address, addressLength)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    const int fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), addressLength) != 0) {
+        const int savedErrno = errno;
+        ::close(fd);
+        errno = savedErrno;
+        return -1;
+    }
+    return fd;
+}
+
+void fillMessage(msghdr& message, iovec* iov, SeqpacketHeader& header, const void* payload, std::size_t payloadSize) {
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = const_cast<void*>(payload);
+    iov[1].iov_len = payloadSize;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = iov;
+    message.msg_iovlen = payloadSize != 0 ? 2 : 1;
+}
+
+bool sendMessage(int fd, std::uint32_t code, std::uint32_t flags, const void* payload, std::size_t payloadSize) {
+    SeqpacketHeader header{code, flags};
+    iovec iov[2];
+    msghdr message;
+    fillMessage(message, iov, header, payload, payloadSize);
+
+    ssize_t rc = 0;
+    do {
+        rc = ::sendmsg(fd, &message, MSG_NOSIGNAL);
+    } while (rc < 0 && errno == EINTR);
+    return rc == static_cast<ssize_t>(sizeof(header) + payloadSize);
+}
+}
+
+SeqpacketClientTransport::SeqpacketClientTransport(std::string socketPath)
+    : mSocketPath(std::move(socketPath)),
+      mFd(-1) {}
+
+SeqpacketClientTransport::~SeqpacketClientTransport() {
+    close();
+}
+
+bool SeqpacketClientTransport::open() {
+    if (mFd >= 0) {
+        return true;
+    }
+
+    mFd = connectTo(mSocketPath);
+    if (mFd < 0) {
+        LOG_E("seqpacket connect failed on %s errno=%d msg=%s", mSocketPath.c_str(), errno, std::strerror(errno));
+        return false;
+    }
+
+    LOG_I("seqpacket client init success: path=%s", mSocketPath.c_str());
+    return true;
+}
+
+void SeqpacketClientTransport::close() {
+    if (mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+}
+
+bool SeqpacketClientTransport::send(std::uint32_t code, const void* payload, std::size_t payloadSize) {
+    if (mFd < 0 || payload == nullptr || payloadSize == 0) {
+        LOG_E("seqpacket send rejected: fd=%d payload=%p size=%zu", mFd, payload, payloadSize);
+        return false;
+    }
+
+    if (!sendMessage(mFd, code, SEQPACKET_ONEWAY, payload, payloadSize)) {
+        LOG_E("seqpacket send failed: code=%u size=%zu errno=%d msg=%s",
+              code,
+              payloadSize,
+              errno,
+              std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+std::size_t SeqpacketClientTransport::sendBatch(const OutgoingMessage* messages, std::size_t count) {
+    if (mFd < 0) {
+        LOG_E("seqpacket sendBatch rejected: not connected");
+        return 0;
+    }
+
+    SeqpacketHeader headers[kSendBatch];
+    iovec iov[kSendBatch][2];
+    mmsghdr batch[kSendBatch];
+
+    std::size_t sent = 0;
+    while (sent < count) {
+        std::size_t chunk = 0;
+        while (chunk < kSendBatch && sent + chunk < count) {
+            const OutgoingMessage& message = messages[sent + chunk];
+            if (message.payload == nullptr || message.payloadSize == 0) {
+                break;
+            }
+            headers[chunk] = SeqpacketHeader{message.code, SEQPACKET_ONEWAY};
+            fillMessage(batch[chunk].msg_hdr, iov[chunk], headers[chunk], message.payload, message.payloadSize);
+            batch[chunk].msg_len = 0;
+            ++chunk;
+        }
+        if (chunk == 0) {
+            LOG_E("seqpacket sendBatch rejected message %zu: payload=%p size=%zu",
+                  sent,
+                  messages[sent].payload,
+                  messages[sent].payloadSize);
+            return sent;
+        }
+
+        const int rc = ::sendmmsg(mFd, batch, static_cast<unsigned int>(chunk), MSG_NOSIGNAL);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_E("seqpacket sendmmsg failed: count=%zu errno=%d msg=%s", chunk, errno, std::strerror(errno));
+            return sent;
+        }
+        sent += static_cast<std::size_t>(rc);
+    }
+    return sent;
+}
+
+bool SeqpacketClientTransport::transact(std::uint32_t code,
+                                        const void* payload,
+                                        std::size_t payloadSize,
+                                        void* replyBuffer,
+                                        std::size_t replyCapacity,
+                                        std::size_t& replySize) {
+    replySize = 0;
+
+    if (mFd < 0 || payload == nullptr || payloadSize == 0 || replyBuffer == nullptr || replyCapacity == 0) {
+        LOG_E("seqpacket transact rejected: fd=%d payload=%p size=%zu reply=%p cap=%zu",
+              mFd,
+              payload,
+              payloadSize,
+              replyBuffer,
+              replyCapacity);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mTransactMutex);
+    if (!sendMessage(mFd, code, 0, payload, payloadSize)) {
+        LOG_E("seqpacket transact send failed: code=%u size=%zu errno=%d msg=%s",
+              code,
+              payloadSize,
+              errno,
+              std::strerror(errno));
+        return false;
+    }
+
+    SeqpacketHeader header{};
+    iovec iov[2];
+    msghdr message;
+    fillMessage(message, iov, header, replyBuffer, replyCapacity);
+
+    ssize_t rc = 0;
+    do {
+        rc = ::recvmsg(mFd, &message, 0);
+    } while (rc < 0 && errno == EINTR);
+
+    if (rc < static_cast<ssize_t>(sizeof(header))) {
+        LOG_E("seqpacket transact recv failed: code=%u rc=%zd errno=%d msg=%s",
+              code,
+              rc,
+              errno,
+              rc == 0 ? "server closed" : std::strerror(errno));
+        return false;
+    }
+    if ((message.msg_flags & MSG_TRUNC) != 0 || (header.flags & SEQPACKET_REPLY) == 0) {
+        LOG_E("seqpacket transact bad reply: code=%u flags=0x%x msg_flags=0x%x cap=%zu",
+              code,
+              header.flags,
+              message.msg_flags,
+              replyCapacity);
+        return false;
+    }
+
+    replySize = static_cast<std::size_t>(rc) - sizeof(header);
+    return true;
+}
+
+SeqpacketServerTransport::SeqpacketServerTransport(std::string socketPath, long allowedGid)
+    : mSocketPath(std::move(socketPath)),
+      mAllowedGid(allowedGid),
+      mUid(::geteuid()),
+      mListenFd(-1),
+      mEpollFd(-1),
+      mWakeFd(-1),
+      mCurrentFd(-1),
+      mCurrentOneway(false),
+      mReplied(false),
+      mLooping(false),
+      mStopping(false) {}
+
+SeqpacketServerTransport::~SeqpacketServerTransport() {
+    close();
+}
+
+bool SeqpacketServerTransport::open() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mListenFd >= 0) {
+        return true;
+    }
+
+    sockaddr_un address;
+    socklen_t addressLength = 0;
+    if (!makeAddress(mSocketPath, address, addressLength)) {
+        return false;
+    }
+
+    if (mSocketPath[0] != '@') {
+        // A stale socket file from a crashed server would make bind() fail;
+        // only remove it when nobody is listening behind it.
+        const int probeFd = connectTo(mSocketPath);
+        if (probeFd >= 0) {
+            ::close(probeFd);
+            LOG_E("seqpacket server already running on %s", mSocketPath.c_str());
+            return false;
+        }
+        if (errno == ECONNREFUSED) {
+            ::unlink(mSocketPath.c_str());
+        }
+    }
+
+    mListenFd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    mEpollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    mWakeFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (mListenFd < 0 || mEpollFd < 0 || mWakeFd < 0) {
+        LOG_E("seqpacket server setup failed errno=%d msg=%s", errno, std::strerror(errno));
+        releaseUnlocked();
+        return false;
+    }
+
+    if (::bind(mListenFd, reinterpret_cast<const sockaddr*>(&address), addressLength) != 0 ||
+        ::listen(mListenFd, kListenBacklog) != 0) {
+        LOG_E("seqpacket bind/listen failed on %s errno=%d msg=%s", mSocketPath.c_str(), errno, std::strerror(errno));
+        // Not ours to unlink.
+        ::close(mListenFd);
+        mListenFd = -1;
+        releaseUnlocked();
+        return false;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = mListenFd;
+    ::epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mListenFd, &event);
+    event.data.fd = mWakeFd;
+    ::epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mWakeFd, &event);
+
+    mRecvBuffers.resize(kRecvBatch * kMaxMessageSize);
+    mStopping = false;
+    LOG_I("seqpacket server init success: path=%s", mSocketPath.c_str());
+    return true;
+}
+
+void SeqpacketServerTransport::close() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mLooping) {
+        // loop() releases everything on its way out.
+        mStopping = true;
+        const std::uint64_t one = 1;
+        if (::write(mWakeFd, &one, sizeof(one)) < 0) {
+            LOG_E("seqpacket wake failed errno=%d", errno);
+        }
+        return;
+    }
+    releaseUnlocked();
+}
+
+void SeqpacketServerTransport::releaseUnlocked() {
+    for (int fd : mConnections) {
+        ::close(fd);
+    }
+    mConnections.clear();
+
+    if (mListenFd >= 0) {
+        ::close(mListenFd);
+        mListenFd = -1;
+        if (!mSocketPath.empty() && mSocketPath[0] != '@') {
+            ::unlink(mSocketPath.c_str());
+        }
+    }
+    if (mEpollFd >= 0) {
+        ::close(mEpollFd);
+        mEpollFd = -1;
+    }
+    if (mWakeFd >= 0) {
+        ::close(mWakeFd);
+        mWakeFd = -1;
+    }
+    mRecvBuffers.clear();
+    mRecvBuffers.shrink_to_fit();
+}
+
+bool SeqpacketServerTransport::reply(std::uint32_t code, const void* payload, std::size_t payloadSize) {
+    if (mCurrentFd < 0 || payload == nullptr || payloadSize == 0) {
+        LOG_E("seqpacket reply rejected: fd=%d payload=%p size=%zu", mCurrentFd, payload, payloadSize);
+        return false;
+    }
+    if (mCurrentOneway) {
+        // Nobody is waiting for it.
+        return true;
+    }
+    if (mReplied) {
+        LOG_E("seqpacket reply rejected: code=%u already answered", code);
+        return false;
+    }
+
+    mReplied = true;
+    if (!sendMessage(mCurrentFd, code, SEQPACKET_REPLY, payload, payloadSize)) {
+        LOG_E("seqpacket reply failed: code=%u size=%zu errno=%d msg=%s",
+              code,
+              payloadSize,
+              errno,
+              std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void SeqpacketServerTransport::loop(const Handler& handler) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mListenFd < 0 || mStopping) {
+            return;
+        }
+        mLooping = true;
+    }
+
+    epoll_event events[kMaxEpollEvents];
+    bool stopping = false;
+    while (!stopping) {
+        const int count = ::epoll_wait(mEpollFd, events, kMaxEpollEvents, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_E("seqpacket epoll_wait failed errno=%d msg=%s", errno, std::strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == mWakeFd) {
+                stopping = true;
+            } else if (fd == mListenFd) {
+                acceptConnections();
+            } else if ((events[i].events & EPOLLIN) != 0) {
+                drainConnection(fd, handler);
+            } else {
+                closeConnection(fd);
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLooping = false;
+    releaseUnlocked();
+}
+
+bool SeqpacketServerTransport::acceptConnections() {
+    for (;;) {
+        const int fd = ::accept4(mListenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_E("seqpacket accept failed errno=%d msg=%s", errno, std::strerror(errno));
+                return false;
+            }
+            return true;
+        }
+
+        if (!peerAllowed(fd)) {
+            ::close(fd);
+            continue;
+        }
+
+        const timeval timeout{kReplyTimeoutSec, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (::epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            LOG_E("seqpacket epoll add failed errno=%d msg=%s", errno, std::strerror(errno));
+            ::close(fd);
+            continue;
+        }
+        mConnections.push_back(fd);
+    }
+}
+
+// Updates drive alerts and their hooks, and control codes change the policy
+// and watch target, so only trusted local users may talk to lifecycle.
+bool SeqpacketServerTransport::peerAllowed(int fd) const {
+    ucred credentials{};
+    socklen_t length = sizeof(credentials);
+    if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0) {
+        LOG_E("seqpacket SO_PEERCRED failed errno=%d msg=%s", errno, std::strerror(errno));
+        return false;
+    }
+    if (credentials.uid == mUid || credentials.uid == 0) {
+        return true;
+    }
+    if (mAllowedGid >= 0) {
+        const gid_t allowed = static_cast<gid_t>(mAllowedGid);
+        if (credentials.gid == allowed || userInGroup(credentials.uid, allowed)) {
+            return true;
+        }
+    }
+
+    LOG_W("seqpacket connection rejected: pid=%d uid=%u gid=%u",
+          static_cast<int>(credentials.pid),
+          static_cast<unsigned>(credentials.uid),
+          static_cast<unsigned>(credentials.gid));
+    return false;
+}
+
+// One recvmmsg() per wakeup; epoll is level-triggered, so a connection with
+// more queued messages is picked up again after the others had their turn.
+void SeqpacketServerTransport::drainConnection(int fd, const Handler& handler) {
+    SeqpacketHeader headers[kRecvBatch];
+    iovec iov[kRecvBatch][2];
+    mmsghdr batch[kRecvBatch];
+    for (std::size_t i = 0; i < kRecvBatch; ++i) {
+        fillMessage(batch[i].msg_hdr, iov[i], headers[i], &mRecvBuffers[i * kMaxMessageSize], kMaxMessageSize);
+        batch[i].msg_len = 0;
+    }
+
+    const int count = ::recvmmsg(fd, batch, kRecvBatch, MSG_DONTWAIT, nullptr);
+    if (count < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            closeConnection(fd);
+        }
+        return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const std::size_t length = batch[i].msg_len;
+        if (length < sizeof(SeqpacketHeader)) {
+            // Zero-length datagram: the peer closed.
+            if (length != 0) {
+                LOG_W("seqpacket dropped connection: short message (%zu bytes)", length);
+            }
+            closeConnection(fd);
+            break;
+        }
+
+        mCurrentFd = fd;
+        mCurrentOneway = (headers[i].flags & SEQPACKET_ONEWAY) != 0;
+        mReplied = false;
+
+        const std::size_t payloadSize = length - sizeof(SeqpacketHeader);
+        if ((batch[i].msg_hdr.msg_flags & MSG_TRUNC) != 0) {
+            LOG_W("seqpacket dropped message: code=%u larger than %zu bytes", headers[i].code, kMaxMessageSize);
+        } else if (payloadSize != 0) {
+            handler(headers[i].code, &mRecvBuffers[static_cast<std::size_t>(i) * kMaxMessageSize], payloadSize);
+        }
+
+        // An unanswered transact() gets an empty reply rather than hanging.
+        if (!mCurrentOneway && !mReplied) {
+            sendMessage(fd, headers[i].code, SEQPACKET_REPLY, nullptr, 0);
+        }
+    }
+    mCurrentFd = -1;
+    if (count == 0) {
+        closeConnection(fd);
+    }
+}
+
+void SeqpacketServerTransport::closeConnection(int fd) {
+    ::epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    mConnections.erase(std::remove(mConnections.begin(), mConnections.end(), fd), mConnections.end());
+}
+
+} // namespace xmonitor
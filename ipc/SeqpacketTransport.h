@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "ipc/Transport.h"
+
+namespace xmonitor {
+
+// AF_UNIX SOCK_SEQPACKET backend for hosts without binderfs. Every message
+// is one datagram: SeqpacketHeader followed by the payload. The socket keeps
+// message boundaries and per-connection order, so a client's replies are
+// simply the next datagrams it reads.
+struct SeqpacketHeader {
+    std::uint32_t code;
+    std::uint32_t flags;
+};
+
+enum SeqpacketFlag : std::uint32_t {
+    SEQPACKET_ONEWAY = 1u << 0,
+    SEQPACKET_REPLY = 1u << 1
+};
+
+// send() is one-way: it returns once the datagram is queued, and blocks
+// while the server's receive queue is full. sendBatch() queues up to
+// kSendBatch messages per sendmmsg().
+class SeqpacketClientTransport : public ClientTransport {
+public:
+    static constexpr std::size_t kSendBatch = 32;
+
+    explicit SeqpacketClientTransport(std::string socketPath);
+    ~SeqpacketClientTransport() override;
+
+    bool open() override;
+    void close() override;
+
+    bool send(std::uint32_t code, const void* payload, std::size_t payloadSize) override;
+    std::size_t sendBatch(const OutgoingMessage* messages, std::size_t count) override;
+    bool transact(std::uint32_t code,
+                  const void* payload,
+                  std::size_t payloadSize,
+                  void* replyBuffer,
+                  std::size_t replyCapacity,
+                  std::size_t& replySize) override;
+
+private:
+    std::string mSocketPath;
+    int mFd;
+    // Pairs a transact()'s request with its reply when the adapter is
+    // shared between threads.
+    std::mutex mTransactMutex;
+};
+
+// One epoll thread serves every connection; readable connections are
+// drained with recvmmsg() in batches of kRecvBatch. Connections from other
+// users are closed at accept (see TransportConfig::allowedGid).
+class SeqpacketServerTransport : public ServerTransport {
+public:
+    static constexpr std::size_t kRecvBatch = 8;
+    static constexpr std::size_t kMaxMessageSize = 64 * 1024;
+
+    SeqpacketServerTransport(std::string socketPath, long allowedGid);
+    ~SeqpacketServerTransport() override;
+
+    bool open() override;
+    void close() override;
+
+    bool reply(std::uint32_t code, const void* payload, std::size_t payloadSize) override;
+    void loop(const Handler& handler) override;
+
+private:
+    bool acceptConnections();
+    bool peerAllowed(int fd) const;
+    void drainConnection(int fd, const Handler& handler);
+    void closeConnection(int fd);
+    void releaseUnlocked();
+
+    std::string mSocketPath;
+    long mAllowedGid;
+    uid_t mUid;
+    int mListenFd;
+    int mEpollFd;
+    int mWakeFd;
+    std::vector<int> mConnections;
+    std::vector<std::uint8_t> mRecvBuffers;
+
+    // Message being handled, for reply().
+    int mCurrentFd;
+    bool mCurrentOneway;
+    bool mReplied;
+
+    std::mutex mMutex;
+    bool mLooping;
+    bool mStopping;
+};
+
+} // namespace xmonitor
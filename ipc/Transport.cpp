@@ -0,0 +1,84 @@
+#include "ipc/Transport.h"
+
+#include <cstdlib>
+
+#include <grp.h>
+#include <unistd.h>
+
+#include "Logger.h"
+#include "common/Config.h"
+#include "ipc/BinderTransport.h"
+#include "ipc/SeqpacketTransport.h"
+
+namespace xmonitor {
+
+namespace {
+constexpr const char* kDefaultSocketPath = "@xmonitor-lifecycle";
+
+long groupIdFromName(const std::string& name) {
+    char* end = nullptr;
+    const unsigned long gid = std::strtoul(name.c_str(), &end, 10);
+    if (end != name.c_str() && *end == '\0' && name[0] != '-' &&
+        gid <= static_cast<unsigned long>(static_cast<gid_t>(-1))) {
+        return static_cast<long>(gid);
+    }
+    if (const group* entry = ::getgrnam(name.c_str())) {
+        return static_cast<long>(entry->gr_gid);
+    }
+    return -1;
+}
+}
+
+TransportConfig transportConfigFromEnv() {
+    TransportConfig config;
+    const std::string kind = envString("XMONITOR_IPC", "auto");
+    if (kind == "binder") {
+        config.kind = TransportKind::Binder;
+    } else if (kind == "seqpacket") {
+        config.kind = TransportKind::Seqpacket;
+    } else {
+        if (kind != "auto") {
+            LOG_W("Unknown XMONITOR_IPC '%s', using auto", kind.c_str());
+        }
+        config.kind = ::access(kBinderDevicePath, F_OK) == 0 ? TransportKind::Binder : TransportKind::Seqpacket;
+    }
+    config.socketPath = envString("XMONITOR_IPC_SOCKET", kDefaultSocketPath);
+
+    const std::string group = envString("XMONITOR_IPC_GROUP", "");
+    if (!group.empty()) {
+        config.allowedGid = groupIdFromName(group);
+        if (config.allowedGid < 0) {
+            LOG_W("Unknown XMONITOR_IPC_GROUP '%s', only the same user and root may connect", group.c_str());
+        }
+    }
+    return config;
+}
+
+const char* transportName(TransportKind kind) {
+    return kind == TransportKind::Binder ? "binder" : "seqpacket";
+}
+
+std::size_t ClientTransport::sendBatch(const OutgoingMessage* messages, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!send(messages[i].code, messages[i].payload, messages[i].payloadSize)) {
+            return i;
+        }
+    }
+    return count;
+}
+
+std::unique_ptr<ClientTransport> createClientTransport(const TransportConfig& config) {
+    if (config.kind == TransportKind::Seqpacket) {
+        return std::make_unique<SeqpacketClientTransport>(config.socketPath);
+    }
+    return std::make_unique<BinderClientTransport>();
+}
+
+std::unique_ptr<ServerTransport> createServerTransport(const TransportConfig& config) {
+    if (config.kind == TransportKind::Seqpacket) {
+        return std::make_unique<SeqpacketServerTransport>(config.socketPath, config.allowedGid);
+    }
+    return std::make_unique<BinderServerTransport>();
+}
+
+} // namespace xmonitor
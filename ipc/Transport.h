@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace xmonitor {
+
+// The IPC mechanism behind BinderClientAdapter / BinderServerAdapter.
+//
+// Semantics every backend provides:
+//   - one server (lifecycle) and any number of clients per host;
+//   - send() delivers an update, transact() waits for the server's reply;
+//   - messages from one client are handled in the order they were sent;
+//   - the server handles one message at a time on its loop() thread and
+//     answers a transact() with reply() from inside the handler (an
+//     unanswered transact() gets an empty reply).
+enum class TransportKind {
+    Binder,
+    Seqpacket
+};
+
+struct TransportConfig {
+    TransportKind kind{TransportKind::Binder};
+    // Seqpacket only; a leading '@' selects the abstract namespace.
+    std::string socketPath;
+    // Seqpacket server only. Abstract sockets have no permissions, so the
+    // server checks every peer's SO_PEERCRED: its own uid and root are
+    // accepted, plus, when this is >= 0, peers running with it as effective
+    // gid and peers whose user is a member (primary or supplementary).
+    long allowedGid{-1};
+};
+
+// XMONITOR_IPC=binder|seqpacket|auto, XMONITOR_IPC_SOCKET and
+// XMONITOR_IPC_GROUP (group name or gid). auto (the default) picks binder
+// when binderfs is mounted, so every process on a host resolves to the same
+// backend.
+TransportConfig transportConfigFromEnv();
+const char* transportName(TransportKind kind);
+
+struct OutgoingMessage {
+    std::uint32_t code{0};
+    const void* payload{nullptr};
+    std::size_t payloadSize{0};
+};
+
+class ClientTransport {
+public:
+    virtual ~ClientTransport() = default;
+
+    virtual bool open() = 0;
+    virtual void close() = 0;
+
+    virtual bool send(std::uint32_t code, const void* payload, std::size_t payloadSize) = 0;
+    // Sends in order; returns how many messages went out before the first
+    // failure. The default is one send() per message.
+    virtual std::size_t sendBatch(const OutgoingMessage* messages, std::size_t count);
+    virtual bool transact(std::uint32_t code,
+                          const void* payload,
+                          std::size_t payloadSize,
+                          void* replyBuffer,
+                          std::size_t replyCapacity,
+                          std::size_t& replySize) = 0;
+};
+
+class ServerTransport {
+public:
+    using Handler = std::function<void(std::uint32_t, const void*, std::size_t)>;
+
+    virtual ~ServerTransport() = default;
+
+    // Fails if another server already owns the endpoint.
+    virtual bool open() = 0;
+    // May be called from another thread; loop() returns soon after.
+    virtual void close() = 0;
+
+    virtual bool reply(std::uint32_t code, const void* payload, std::size_t payloadSize) = 0;
+    virtual void loop(const Handler& handler) = 0;
+};
+
+std::unique_ptr<ClientTransport> createClientTransport(const TransportConfig& config);
+std::unique_ptr<ServerTransport> createServerTransport(const TransportConfig& config);
+
+} // namespace xmonitor
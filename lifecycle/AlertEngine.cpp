@@ -0,0 +1,446 @@
+#include "lifecycle/AlertEngine.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include "Logger.h"
+#include "ipc/MetricSchema.h"
+#include "lifecycle/SnapshotMetrics.h"
+
+extern char** environ;
+
+namespace xmonitor {
+
+namespace {
+// Rules are grouped by the update code that carries their metric, so an
+// update indexes straight into its range.
+constexpr std::size_t kSourceCount = MetricSchema::kCodeTableSize;
+constexpr std::size_t kMaxRunningHooks = 8;
+// Longest for= duration: 30 days.
+constexpr double kMaxDurationNs = 30.0 * 24 * 3600e9;
+
+const char* kOpNames[] = {">", ">=", "<", "<="};
+
+// "rate(<metric>)" for rate rules, as written in the rules file.
+void formatMetric(std::uint16_t metric, bool rate, char* out, std::size_t size) {
+    std::snprintf(out, size, rate ? "rate(%s)" : "%s", snapshotMetric(metric).name);
+}
+
+bool parseDuration(const std::string& text, std::uint64_t& outNs) {
+    char* end = nullptr;
+    const double value = std::strtod(text.c_str(), &end);
+    if (end == text.c_str() || !std::isfinite(value) || value < 0.0) {
+        return false;
+    }
+
+    const std::string unit(end);
+    double scale = 1e9;
+    if (unit == "ms") {
+        scale = 1e6;
+    } else if (unit == "m") {
+        scale = 60e9;
+    } else if (unit == "h") {
+        scale = 3600e9;
+    } else if (!unit.empty() && unit != "s") {
+        return false;
+    }
+    const double ns = value * scale;
+    if (ns > kMaxDurationNs) {
+        return false;
+    }
+    outNs = static_cast<std::uint64_t>(ns);
+    return true;
+}
+
+bool parseNumber(const std::string& text, double& outValue) {
+    char* end = nullptr;
+    outValue = std::strtod(text.c_str(), &end);
+    return end != text.c_str() && *end == '\0' && std::isfinite(outValue);
+}
+}
+
+AlertEngine::AlertEngine()
+    : mSources(kSourceCount),
+      mLastValues(snapshotMetricCount(), 0.0),
+      mSeen(snapshotMetricCount(), 0),
+      mPendingCount(0),
+      mFiringCount(0),
+      mFiredTotal(0),
+      mEvaluations(0) {
+}
+
+bool AlertEngine::load(const std::string& rulesPath) {
+    std::ifstream file(rulesPath);
+    if (!file.is_open()) {
+        LOG_E("Alert rules: cannot open %s", rulesPath.c_str());
+        return false;
+    }
+
+    mRules.clear();
+    std::string line;
+    std::size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        const std::size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+
+        Rule rule;
+        if (parseRule(line, lineNumber, rule)) {
+            mRules.push_back(rule);
+        }
+    }
+
+    compile();
+    LOG_I("Alert rules: %zu loaded from %s", mRules.size(), rulesPath.c_str());
+    return true;
+}
+
+void AlertEngine::setHook(const std::string& hookPath) {
+    mHookPath = hookPath;
+}
+
+std::size_t AlertEngine::ruleCount() const {
+    return mRules.size();
+}
+
+bool AlertEngine::parseRule(const std::string& line, std::size_t lineNumber, Rule& outRule) const {
+    std::istringstream tokens(line);
+    std::string name;
+    std::string metric;
+    std::string op;
+    std::string threshold;
+    if (!(tokens >> name >> metric >> op >> threshold)) {
+        LOG_E("Alert rules line %zu: expected <name> <metric> <op> <threshold>", lineNumber);
+        return false;
+    }
+
+    if (name.size() >= kAlertNameLength) {
+        LOG_E("Alert rules line %zu: name longer than %zu characters", lineNumber, kAlertNameLength - 1);
+        return false;
+    }
+    std::memcpy(outRule.name, name.c_str(), name.size() + 1);
+
+    if (metric.compare(0, 5, "rate(") == 0 && metric.back() == ')') {
+        outRule.rate = 1;
+        metric = metric.substr(5, metric.size() - 6);
+    }
+    const std::size_t metricIndex = findSnapshotMetric(metric);
+    if (metricIndex == snapshotMetricCount()) {
+        LOG_E("Alert rules line %zu: unknown metric '%s'", lineNumber, metric.c_str());
+        return false;
+    }
+    outRule.metric = static_cast<std::uint16_t>(metricIndex);
+
+    if (op == ">") {
+        outRule.op = OP_GREATER;
+    } else if (op == ">=") {
+        outRule.op = OP_GREATER_EQUAL;
+    } else if (op == "<") {
+        outRule.op = OP_LESS;
+    } else if (op == "<=") {
+        outRule.op = OP_LESS_EQUAL;
+    } else {
+        LOG_E("Alert rules line %zu: unknown operator '%s'", lineNumber, op.c_str());
+        return false;
+    }
+
+    if (!parseNumber(threshold, outRule.threshold)) {
+        LOG_E("Alert rules line %zu: bad threshold '%s'", lineNumber, threshold.c_str());
+        return false;
+    }
+    outRule.clear = outRule.threshold;
+
+    std::string option;
+    while (tokens >> option) {
+        if (option.compare(0, 4, "for=") == 0) {
+            if (!parseDuration(option.substr(4), outRule.forNs)) {
+                LOG_E("Alert rules line %zu: bad duration '%s'", lineNumber, option.c_str());
+                return false;
+            }
+        } else if (option.compare(0, 6, "clear=") == 0) {
+            if (!parseNumber(option.substr(6), outRule.clear)) {
+                LOG_E("Alert rules line %zu: bad clear value '%s'", lineNumber, option.c_str());
+                return false;
+            }
+        } else {
+            LOG_E("Alert rules line %zu: unknown option '%s'", lineNumber, option.c_str());
+            return false;
+        }
+    }
+
+    // Hysteresis only makes sense on the resolving side of the threshold.
+    const bool above = outRule.op == OP_GREATER || outRule.op == OP_GREATER_EQUAL;
+    if ((above && outRule.clear > outRule.threshold) || (!above && outRule.clear < outRule.threshold)) {
+        LOG_E("Alert rules line %zu: clear=%g is on the firing side of %g", lineNumber, outRule.clear, outRule.threshold);
+        return false;
+    }
+    return true;
+}
+
+// Groups rules by source update, then by metric, so evaluate() reads each
+// metric once and walks a contiguous slice of the table.
+void AlertEngine::compile() {
+    std::stable_sort(mRules.begin(), mRules.end(), [](const Rule& left, const Rule& right) {
+        const auto leftSource = static_cast<std::uint32_t>(snapshotMetric(left.metric).source);
+        const auto rightSource = static_cast<std::uint32_t>(snapshotMetric(right.metric).source);
+        if (leftSource != rightSource) {
+            return leftSource < rightSource;
+        }
+        return left.metric < right.metric;
+    });
+
+    std::fill(mSources.begin(), mSources.end(), SourceRange{});
+    for (std::uint32_t i = 0; i < mRules.size(); ++i) {
+        SourceRange& range = mSources[static_cast<std::size_t>(snapshotMetric(mRules[i].metric).source)];
+        if (range.begin == range.end) {
+            range.begin = i;
+        }
+        range.end = i + 1;
+    }
+}
+
+bool AlertEngine::onUpdate(std::uint32_t code, const BinderSnapshot& snapshot, std::uint64_t nowNs) {
+    if (code >= mSources.size() || mSources[code].begin == mSources[code].end) {
+        return false;
+    }
+
+    ++mEvaluations;
+    bool changed = false;
+    const SourceRange range = mSources[code];
+    std::uint32_t index = range.begin;
+    while (index < range.end) {
+        const std::uint16_t metric = mRules[index].metric;
+        const double value = snapshotMetric(metric).read(snapshot);
+        const bool metricChanged = mSeen[metric] == 0 || value != mLastValues[metric];
+        mSeen[metric] = 1;
+        mLastValues[metric] = value;
+
+        for (; index < range.end && mRules[index].metric == metric; ++index) {
+            Rule& rule = mRules[index];
+            if (rule.rate != 0) {
+                // A rate is due on every update of its source, even when
+                // the counter stood still.
+                const std::uint64_t elapsedNs = nowNs - rule.previousNs;
+                const double previous = rule.previousRaw;
+                const bool primed = rule.previousNs != 0;
+                rule.previousRaw = value;
+                rule.previousNs = nowNs;
+                if (primed && elapsedNs != 0) {
+                    const double perSecond = std::max(0.0, value - previous) * 1e9 / static_cast<double>(elapsedNs);
+                    changed = evaluateRule(rule, perSecond, nowNs) || changed;
+                }
+            } else if (metricChanged) {
+                changed = evaluateRule(rule, value, nowNs) || changed;
+            }
+        }
+    }
+    return changed;
+}
+
+bool AlertEngine::evaluateRule(Rule& rule, double value, std::uint64_t nowNs) {
+    const bool wasActive = rule.state != ALERT_INACTIVE;
+    rule.value = value;
+
+    bool breached = false;
+    bool resolved = false;
+    switch (rule.op) {
+        case OP_GREATER:
+            breached = value > rule.threshold;
+            resolved = value <= rule.clear;
+            break;
+        case OP_GREATER_EQUAL:
+            breached = value >= rule.threshold;
+            resolved = value < rule.clear;
+            break;
+        case OP_LESS:
+            breached = value < rule.threshold;
+            resolved = value >= rule.clear;
+            break;
+        case OP_LESS_EQUAL:
+        default:
+            breached = value <= rule.threshold;
+            resolved = value > rule.clear;
+            break;
+    }
+
+    switch (rule.state) {
+        case ALERT_INACTIVE:
+            if (breached) {
+                transition(rule, rule.forNs == 0 ? ALERT_FIRING : ALERT_PENDING, nowNs);
+            }
+            break;
+        case ALERT_PENDING:
+            if (!breached) {
+                transition(rule, ALERT_INACTIVE, nowNs);
+            } else if (nowNs - rule.sinceNs >= rule.forNs) {
+                transition(rule, ALERT_FIRING, nowNs);
+            }
+            break;
+        case ALERT_FIRING:
+        default:
+            if (resolved) {
+                transition(rule, ALERT_INACTIVE, nowNs);
+            }
+            break;
+    }
+
+    // Active alerts show their current value, so any update to one changes
+    // the exported data.
+    return wasActive || rule.state != ALERT_INACTIVE;
+}
+
+bool AlertEngine::tick(std::uint64_t nowNs) {
+    if (!mHookPids.empty()) {
+        reapHooks();
+    }
+    if (mPendingCount == 0) {
+        return false;
+    }
+
+    bool changed = false;
+    for (Rule& rule : mRules) {
+        if (rule.state == ALERT_PENDING && nowNs - rule.sinceNs >= rule.forNs) {
+            transition(rule, ALERT_FIRING, nowNs);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void AlertEngine::transition(Rule& rule, std::uint32_t state, std::uint64_t nowNs) {
+    const std::uint32_t previous = rule.state;
+    if (previous == ALERT_PENDING) {
+        --mPendingCount;
+    } else if (previous == ALERT_FIRING) {
+        --mFiringCount;
+    }
+    if (state == ALERT_PENDING) {
+        ++mPendingCount;
+    } else if (state == ALERT_FIRING) {
+        ++mFiringCount;
+    }
+
+    rule.state = state;
+    rule.sinceNs = nowNs;
+
+    char metric[kAlertMetricLength];
+    formatMetric(rule.metric, rule.rate != 0, metric, sizeof(metric));
+    if (state == ALERT_FIRING) {
+        ++mFiredTotal;
+        LOG_W("Alert firing: %s %s = %g %s %g", rule.name, metric, rule.value, kOpNames[rule.op], rule.threshold);
+        runHook(rule, "firing");
+    } else if (previous == ALERT_FIRING) {
+        LOG_I("Alert resolved: %s %s = %g", rule.name, metric, rule.value);
+        runHook(rule, "resolved");
+    }
+}
+
+// posix_spawn keeps the fork cost off the binder thread's hot path; the
+// script's exit status is only reaped, never waited for.
+void AlertEngine::runHook(const Rule& rule, const char* event) {
+    if (mHookPath.empty()) {
+        return;
+    }
+    if (mHookPids.size() >= kMaxRunningHooks) {
+        LOG_W("Alert hook skipped for %s: %zu hooks still running", rule.name, mHookPids.size());
+        return;
+    }
+
+    char name[64];
+    char metric[80];
+    char value[64];
+    char threshold[64];
+    char state[32];
+    std::snprintf(name, sizeof(name), "XMONITOR_ALERT_NAME=%s", rule.name);
+    char metricName[kAlertMetricLength];
+    formatMetric(rule.metric, rule.rate != 0, metricName, sizeof(metricName));
+    std::snprintf(metric, sizeof(metric), "XMONITOR_ALERT_METRIC=%s", metricName);
+    std::snprintf(value, sizeof(value), "XMONITOR_ALERT_VALUE=%g", rule.value);
+    std::snprintf(threshold, sizeof(threshold), "XMONITOR_ALERT_THRESHOLD=%s%g", kOpNames[rule.op], rule.threshold);
+    std::snprintf(state, sizeof(state), "XMONITOR_ALERT_STATE=%s", event);
+
+    std::vector<char*> environment;
+    for (char** entry = environ; entry != nullptr && *entry != nullptr; ++entry) {
+        environment.push_back(*entry);
+    }
+    environment.push_back(name);
+    environment.push_back(metric);
+    environment.push_back(value);
+    environment.push_back(threshold);
+    environment.push_back(state);
+    environment.push_back(nullptr);
+
+    char* arguments[] = {
+        const_cast<char*>(mHookPath.c_str()),
+        const_cast<char*>(event),
+        const_cast<char*>(rule.name),
+        nullptr,
+    };
+
+    pid_t pid = 0;
+    const int error = ::posix_spawn(&pid, mHookPath.c_str(), nullptr, nullptr, arguments, environment.data());
+    if (error != 0) {
+        LOG_E("Alert hook %s failed to start errno=%d", mHookPath.c_str(), error);
+        return;
+    }
+    mHookPids.push_back(pid);
+}
+
+// Only the hooks' own pids: lifecycle may have other children.
+void AlertEngine::reapHooks() {
+    std::size_t kept = 0;
+    for (pid_t pid : mHookPids) {
+        int status = 0;
+        const pid_t result = ::waitpid(pid, &status, WNOHANG);
+        if (result == 0 || (result < 0 && errno == EINTR)) {
+            mHookPids[kept++] = pid;
+        }
+    }
+    mHookPids.resize(kept);
+}
+
+void AlertEngine::exportTo(AlertData& outData) const {
+    outData.ruleCount = static_cast<std::uint32_t>(mRules.size());
+    outData.firingCount = mFiringCount;
+    outData.pendingCount = mPendingCount;
+    outData.firedTotal = mFiredTotal;
+    outData.evaluations = mEvaluations;
+
+    std::uint32_t count = 0;
+    for (const std::uint32_t state : {static_cast<std::uint32_t>(ALERT_FIRING), static_cast<std::uint32_t>(ALERT_PENDING)}) {
+        for (const Rule& rule : mRules) {
+            if (rule.state != state || count >= kMaxAlerts) {
+                continue;
+            }
+            AlertStatus& status = outData.alerts[count++];
+            status = AlertStatus{};
+            std::memcpy(status.name, rule.name, sizeof(status.name));
+            formatMetric(rule.metric, rule.rate != 0, status.metric, sizeof(status.metric));
+            std::snprintf(status.op, sizeof(status.op), "%s", kOpNames[rule.op]);
+            status.state = rule.state;
+            status.value = rule.value;
+            status.threshold = rule.threshold;
+            status.sinceNs = rule.sinceNs;
+        }
+    }
+    outData.alertCount = count;
+    for (std::uint32_t i = count; i < kMaxAlerts; ++i) {
+        outData.alerts[i] = AlertStatus{};
+    }
+}
+
+} // namespace xmonitor
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// Threshold and rate alerts evaluated on the lifecycle binder thread.
+//
+// Rules file, one rule per line ('#' starts a comment):
+//
+//   <name> <metric> <op> <threshold> [for=<duration>] [clear=<value>]
+//
+//   cpu_hot      cpu.usage                > 95   for=30s clear=90
+//   swapping     ram.swap_in_per_sec      > 500  for=10s
+//   oom          rate(ram.oom_kills)      > 0
+//
+// op is one of > >= < <=. A rule fires once the condition has held for the
+// `for` duration and resolves when the value crosses back past `clear`
+// (default: the threshold itself). rate(<metric>) is the per-second change
+// of the metric between updates. Durations take ms, s, m or h, up to 720h.
+//
+// Rules are compiled into one flat table grouped by the update that carries
+// their metric, so an update only touches the rules reading it, and a rule
+// whose metric did not change is skipped.
+class AlertEngine {
+public:
+    AlertEngine();
+
+    // Returns false if the file cannot be read; invalid lines are logged and
+    // skipped.
+    bool load(const std::string& rulesPath);
+
+    // Optional script run as `<hook> <firing|resolved> <name>` with the
+    // details in XMONITOR_ALERT_* environment variables.
+    void setHook(const std::string& hookPath);
+
+    std::size_t ruleCount() const;
+
+    // Evaluates the rules fed by update `code`, if any. Returns true when
+    // the exported AlertData changed.
+    bool onUpdate(std::uint32_t code, const BinderSnapshot& snapshot, std::uint64_t nowNs);
+
+    // Promotes pending rules whose `for` duration elapsed and reaps finished
+    // hooks. Services only publish on change, so a breached value may never
+    // be re-sent; this runs on every transaction instead.
+    bool tick(std::uint64_t nowNs);
+
+    void exportTo(AlertData& outData) const;
+
+private:
+    enum Op : std::uint8_t {
+        OP_GREATER,
+        OP_GREATER_EQUAL,
+        OP_LESS,
+        OP_LESS_EQUAL
+    };
+
+    struct Rule {
+        std::uint16_t metric{0};
+        std::uint8_t op{OP_GREATER};
+        std::uint8_t rate{0};
+        std::uint32_t state{ALERT_INACTIVE};
+        double threshold{0.0};
+        double clear{0.0};
+        std::uint64_t forNs{0};
+        std::uint64_t sinceNs{0};
+        double value{0.0};
+        // rate() rules: previous raw reading and its time.
+        double previousRaw{0.0};
+        std::uint64_t previousNs{0};
+        char name[kAlertNameLength]{};
+    };
+
+    struct SourceRange {
+        std::uint32_t begin{0};
+        std::uint32_t end{0};
+    };
+
+    bool parseRule(const std::string& line, std::size_t lineNumber, Rule& outRule) const;
+    void compile();
+    bool evaluateRule(Rule& rule, double value, std::uint64_t nowNs);
+    void transition(Rule& rule, std::uint32_t state, std::uint64_t nowNs);
+    void runHook(const Rule& rule, const char* event);
+    void reapHooks();
+
+    std::vector<Rule> mRules;
+    std::vector<SourceRange> mSources;
+    std::vector<double> mLastValues;
+    std::vector<std::uint8_t> mSeen;
+    std::string mHookPath;
+    std::uint32_t mPendingCount;
+    std::uint32_t mFiringCount;
+    // Hooks spawned and not reaped yet.
+    std::vector<pid_t> mHookPids;
+    std::uint64_t mFiredTotal;
+    std::uint64_t mEvaluations;
+};
+
+} // namespace xmonitor
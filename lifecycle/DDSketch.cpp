@@ -0,0 +1,187 @@
+#include "lifecycle/DDSketch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace xmonitor {
+
+namespace {
+constexpr double kGamma = (1.0 + DDSketch::kRelativeAccuracy) / (1.0 - DDSketch::kRelativeAccuracy);
+// Smaller values (and negatives) are counted as zero.
+constexpr double kMinIndexable = 1e-9;
+
+const double kLogGamma = std::log(kGamma);
+
+std::int32_t keyOf(double value) {
+    return static_cast<std::int32_t>(std::ceil(std::log(value) / kLogGamma));
+}
+
+// The point of (gamma^(k-1), gamma^k] whose relative error to both ends is
+// kRelativeAccuracy.
+double valueOf(std::int32_t key) {
+    return 2.0 * std::pow(kGamma, key) / (kGamma + 1.0);
+}
+
+void addSaturated(std::uint32_t& bin, std::uint64_t count) {
+    bin = static_cast<std::uint32_t>(std::min<std::uint64_t>(bin + count, std::numeric_limits<std::uint32_t>::max()));
+}
+}
+
+DDSketch::DDSketch() {
+    clear();
+}
+
+void DDSketch::clear() {
+    mBins.fill(0);
+    mOffset = 0;
+    mLowestKey = std::numeric_limits<std::int32_t>::max();
+    mHighestKey = std::numeric_limits<std::int32_t>::min();
+    mZeroCount = 0;
+    mCount = 0;
+    mMin = 0.0;
+    mMax = 0.0;
+}
+
+void DDSketch::add(double value) {
+    if (!std::isfinite(value)) {
+        return;
+    }
+
+    mMin = mCount == 0 ? value : std::min(mMin, value);
+    mMax = mCount == 0 ? value : std::max(mMax, value);
+    ++mCount;
+
+    if (value < kMinIndexable) {
+        ++mZeroCount;
+        return;
+    }
+    addKey(keyOf(value), 1);
+}
+
+std::int32_t DDSketch::fittingOffset(std::int32_t lowestKey, std::int32_t highestKey) const {
+    const std::int32_t bins = static_cast<std::int32_t>(kBins);
+    if (highestKey - lowestKey >= bins) {
+        // Wider than the store: keep the highest keys, the rest collapse
+        // into the first bucket.
+        return highestKey - bins + 1;
+    }
+    if (lowestKey < mOffset) {
+        return lowestKey;
+    }
+    if (highestKey >= mOffset + bins) {
+        return highestKey - bins + 1;
+    }
+    return mOffset;
+}
+
+void DDSketch::rebase(std::int32_t offset) {
+    std::array<std::uint32_t, kBins> rebased{};
+    for (std::int32_t k = mLowestKey; k <= mHighestKey; ++k) {
+        const std::uint32_t binCount = mBins[static_cast<std::size_t>(k - mOffset)];
+        if (binCount != 0) {
+            addSaturated(rebased[static_cast<std::size_t>(std::max(k, offset) - offset)], binCount);
+        }
+    }
+    mBins = rebased;
+    mOffset = offset;
+    mLowestKey = std::max(mLowestKey, offset);
+}
+
+void DDSketch::addKey(std::int32_t key, std::uint64_t count) {
+    if (mLowestKey > mHighestKey) {
+        // First keyed value: centre the window on it.
+        mOffset = key - static_cast<std::int32_t>(kBins) / 2;
+    } else {
+        // A key below an already collapsed window keeps the offset and goes
+        // straight into the first bucket.
+        const std::int32_t offset = fittingOffset(std::min(key, mLowestKey), std::max(key, mHighestKey));
+        if (offset != mOffset) {
+            rebase(offset);
+        }
+        key = std::max(key, mOffset);
+    }
+
+    addSaturated(mBins[static_cast<std::size_t>(key - mOffset)], count);
+    mLowestKey = std::min(mLowestKey, key);
+    mHighestKey = std::max(mHighestKey, key);
+}
+
+void DDSketch::merge(const DDSketch& other) {
+    if (other.mCount == 0) {
+        return;
+    }
+    if (mCount == 0) {
+        *this = other;
+        return;
+    }
+
+    mMin = std::min(mMin, other.mMin);
+    mMax = std::max(mMax, other.mMax);
+    mCount += other.mCount;
+    mZeroCount += other.mZeroCount;
+    if (other.mLowestKey > other.mHighestKey) {
+        return;
+    }
+    if (mLowestKey > mHighestKey) {
+        mBins = other.mBins;
+        mOffset = other.mOffset;
+        mLowestKey = other.mLowestKey;
+        mHighestKey = other.mHighestKey;
+        return;
+    }
+
+    // Re-base at most once for both key ranges, then add bucket by bucket.
+    const std::int32_t offset =
+        fittingOffset(std::min(mLowestKey, other.mLowestKey), std::max(mHighestKey, other.mHighestKey));
+    if (offset != mOffset) {
+        rebase(offset);
+    }
+    for (std::int32_t k = other.mLowestKey; k <= other.mHighestKey; ++k) {
+        const std::uint32_t binCount = other.mBins[static_cast<std::size_t>(k - other.mOffset)];
+        if (binCount != 0) {
+            addSaturated(mBins[static_cast<std::size_t>(std::max(k, mOffset) - mOffset)], binCount);
+        }
+    }
+    mLowestKey = std::min(mLowestKey, std::max(other.mLowestKey, mOffset));
+    mHighestKey = std::max(mHighestKey, other.mHighestKey);
+}
+
+double DDSketch::quantile(double q) const {
+    if (mCount == 0) {
+        return 0.0;
+    }
+    if (q <= 0.0) {
+        return mMin;
+    }
+    if (q >= 1.0) {
+        return mMax;
+    }
+
+    const double rank = q * static_cast<double>(mCount - 1);
+    double seen = static_cast<double>(mZeroCount);
+    if (rank < seen) {
+        return std::max(mMin, 0.0);
+    }
+    for (std::int32_t k = mLowestKey; k <= mHighestKey; ++k) {
+        seen += mBins[static_cast<std::size_t>(k - mOffset)];
+        if (rank < seen) {
+            return std::min(std::max(valueOf(k), mMin), mMax);
+        }
+    }
+    return mMax;
+}
+
+std::uint64_t DDSketch::count() const {
+    return mCount;
+}
+
+double DDSketch::min() const {
+    return mMin;
+}
+
+double DDSketch::max() const {
+    return mMax;
+}
+
+} // namespace xmonitor
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace xmonitor {
+
+// DDSketch (Masson et al., VLDB 2019) for non-negative values: quantiles
+// with kRelativeAccuracy relative error in a fixed kBins-bucket store.
+// Bucket i covers (gamma^(k-1), gamma^k] for key k = offset + i. 512
+// buckets cover a ~2.8*10^4x spread (0.004..100 for a percentage); beyond
+// that the lowest buckets are collapsed into the first one, so only the
+// quantiles that fall into the collapsed range lose accuracy.
+//
+// Fixed size (~2 KiB) and no allocation: merge() re-bases at most once and
+// then makes a single pass over the other sketch's buckets.
+class DDSketch {
+public:
+    static constexpr double kRelativeAccuracy = 0.01;
+    static constexpr std::size_t kBins = 512;
+
+    DDSketch();
+
+    void clear();
+    void add(double value);
+    void merge(const DDSketch& other);
+
+    // q in [0, 1]; 0 for an empty sketch.
+    double quantile(double q) const;
+
+    std::uint64_t count() const;
+    double min() const;
+    double max() const;
+
+private:
+    // Window start that holds [lowestKey, highestKey], moving as little as
+    // possible; mOffset when the range already fits.
+    std::int32_t fittingOffset(std::int32_t lowestKey, std::int32_t highestKey) const;
+    // Moves the window to `offset`; keys below it collapse into bucket 0.
+    void rebase(std::int32_t offset);
+    void addKey(std::int32_t key, std::uint64_t count);
+
+    std::array<std::uint32_t, kBins> mBins;
+    std::int32_t mOffset;
+    std::int32_t mLowestKey;
+    std::int32_t mHighestKey;
+    std::uint64_t mZeroCount;
+    std::uint64_t mCount;
+    double mMin;
+    double mMax;
+};
+
+} // namespace xmonitor
@@ -0,0 +1,203 @@
+#include "lifecycle/FederationCodec.h"
+
+#include <cstring>
+
+namespace xmonitor {
+
+namespace {
+constexpr std::size_t kWordCount = sizeof(BinderSnapshot) / 8;
+static_assert(sizeof(BinderSnapshot) % 8 == 0, "BinderSnapshot must be a whole number of words");
+
+// A run absorbs a single unchanged word (one tag byte) rather than paying
+// for a new run header.
+constexpr std::size_t kMaxRunGap = 1;
+constexpr std::size_t kBlockWords = 8;
+
+std::uint64_t loadWord(const unsigned char* bytes, std::size_t index) {
+    std::uint64_t word = 0;
+    std::memcpy(&word, bytes + index * 8, sizeof(word));
+    return word;
+}
+
+void storeWord(unsigned char* bytes, std::size_t index, std::uint64_t word) {
+    std::memcpy(bytes + index * 8, &word, sizeof(word));
+}
+
+template <std::size_t N>
+void terminate(char (&text)[N]) {
+    text[N - 1] = '\0';
+}
+
+void putVarint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+bool getVarint(const std::uint8_t*& cursor, const std::uint8_t* end, std::uint64_t& outValue) {
+    outValue = 0;
+    for (unsigned shift = 0; shift < 64 && cursor < end; shift += 7) {
+        const std::uint8_t byte = *cursor++;
+        outValue |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void putWord(std::vector<std::uint8_t>& out, std::uint64_t xorWord) {
+    if (xorWord == 0) {
+        out.push_back(0x80);
+        return;
+    }
+    const unsigned leading = static_cast<unsigned>(__builtin_clzll(xorWord)) / 8;
+    const unsigned trailing = static_cast<unsigned>(__builtin_ctzll(xorWord)) / 8;
+    out.push_back(static_cast<std::uint8_t>(leading << 4 | trailing));
+    for (unsigned byte = trailing; byte < 8 - leading; ++byte) {
+        out.push_back(static_cast<std::uint8_t>(xorWord >> (byte * 8)));
+    }
+}
+
+bool getWord(const std::uint8_t*& cursor, const std::uint8_t* end, std::uint64_t& outXor) {
+    if (cursor >= end) {
+        return false;
+    }
+    const unsigned leading = *cursor >> 4;
+    const unsigned trailing = *cursor & 0x0f;
+    ++cursor;
+    outXor = 0;
+    if (leading == 8) {
+        return trailing == 0;
+    }
+    if (leading + trailing >= 8 || static_cast<std::size_t>(end - cursor) < 8 - leading - trailing) {
+        return false;
+    }
+    for (unsigned byte = trailing; byte < 8 - leading; ++byte) {
+        outXor |= static_cast<std::uint64_t>(*cursor++) << (byte * 8);
+    }
+    return true;
+}
+}
+
+SnapshotDeltaEncoder::SnapshotDeltaEncoder()
+    : mReference(std::make_unique<BinderSnapshot>()) {
+}
+
+void SnapshotDeltaEncoder::reset() {
+    std::memset(static_cast<void*>(mReference.get()), 0, sizeof(BinderSnapshot));
+}
+
+void SnapshotDeltaEncoder::encode(const BinderSnapshot& snapshot, std::vector<std::uint8_t>& outPayload) {
+    outPayload.clear();
+
+    const auto* current = reinterpret_cast<const unsigned char*>(&snapshot);
+    auto* reference = reinterpret_cast<unsigned char*>(mReference.get());
+
+    std::size_t runEnd = 0;
+    std::size_t word = 0;
+    while (word < kWordCount) {
+        // Most of the snapshot is unchanged tables; skip them a cache line
+        // at a time.
+        if (word + kBlockWords <= kWordCount &&
+            std::memcmp(current + word * 8, reference + word * 8, kBlockWords * 8) == 0) {
+            word += kBlockWords;
+            continue;
+        }
+        if (loadWord(current, word) == loadWord(reference, word)) {
+            ++word;
+            continue;
+        }
+
+        // Extend the run while changed words are at most kMaxRunGap apart.
+        std::size_t end = word + 1;
+        std::size_t gap = 0;
+        for (std::size_t next = end; next < kWordCount && gap <= kMaxRunGap; ++next) {
+            if (loadWord(current, next) != loadWord(reference, next)) {
+                end = next + 1;
+                gap = 0;
+            } else {
+                ++gap;
+            }
+        }
+
+        putVarint(outPayload, word - runEnd);
+        putVarint(outPayload, end - word);
+        for (std::size_t i = word; i < end; ++i) {
+            putWord(outPayload, loadWord(current, i) ^ loadWord(reference, i));
+        }
+        runEnd = end;
+        word = end;
+    }
+
+    std::memcpy(reference, current, sizeof(BinderSnapshot));
+}
+
+bool applySnapshotDelta(const std::uint8_t* payload, std::size_t length, BinderSnapshot& inOutSnapshot) {
+    auto* bytes = reinterpret_cast<unsigned char*>(&inOutSnapshot);
+    const std::uint8_t* cursor = payload;
+    const std::uint8_t* end = payload + length;
+
+    std::size_t word = 0;
+    while (cursor < end) {
+        std::uint64_t skip = 0;
+        std::uint64_t run = 0;
+        if (!getVarint(cursor, end, skip) || !getVarint(cursor, end, run) || run == 0 ||
+            skip > kWordCount - word || run > kWordCount - word - skip) {
+            return false;
+        }
+        word += static_cast<std::size_t>(skip);
+        for (std::uint64_t i = 0; i < run; ++i, ++word) {
+            std::uint64_t xorWord = 0;
+            if (!getWord(cursor, end, xorWord)) {
+                return false;
+            }
+            storeWord(bytes, word, loadWord(bytes, word) ^ xorWord);
+        }
+    }
+    return true;
+}
+
+void terminateSnapshotStrings(BinderSnapshot& snapshot) {
+    for (InterruptLineStats& line : snapshot.interrupts.hot) {
+        terminate(line.name);
+        terminate(line.label);
+    }
+    for (InterruptLineStats& line : snapshot.interrupts.softirqs) {
+        terminate(line.name);
+        terminate(line.label);
+    }
+    for (ProcessMemoryDetail& process : snapshot.memoryDetail.processes) {
+        terminate(process.name);
+    }
+    terminate(snapshot.thread.processName);
+    for (ThreadStats& thread : snapshot.thread.threads) {
+        terminate(thread.name);
+    }
+    for (ProcessStats& process : snapshot.process.processes) {
+        terminate(process.name);
+    }
+    for (DiskDeviceStats& device : snapshot.disk.devices) {
+        terminate(device.name);
+    }
+    for (FilesystemStats& filesystem : snapshot.filesystems.filesystems) {
+        terminate(filesystem.mountPoint);
+        terminate(filesystem.fsType);
+        terminate(filesystem.source);
+    }
+    for (NetInterfaceStats& interface : snapshot.net.interfaces) {
+        terminate(interface.name);
+    }
+    for (CgroupStats& cgroup : snapshot.cgroup.cgroups) {
+        terminate(cgroup.path);
+    }
+    for (AlertStatus& alert : snapshot.alerts.alerts) {
+        terminate(alert.name);
+        terminate(alert.metric);
+        terminate(alert.op);
+    }
+}
+
+} // namespace xmonitor
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// Wire format between a leaf lifecycle (FederationUplink) and an aggregator
+// (FederationServer). Every frame is a FederationFrameHeader followed by
+// payloadLength bytes:
+//
+//   FRAME_HELLO   FederationHello, once per connection
+//   FRAME_KEY     snapshot delta against an all-zero snapshot
+//   FRAME_DELTA   snapshot delta against the previous frame's snapshot
+//
+// Frames use host byte order and the raw BinderSnapshot layout, so leaves
+// and aggregator must run the same build; the hello carries the protocol
+// version and sizeof(BinderSnapshot) to catch mismatches.
+constexpr std::uint32_t kFederationMagic = 0x31464d58u; // "XMF1"
+constexpr std::uint32_t kFederationVersion = 1;
+constexpr std::size_t kFederationNameLength = 64;
+
+enum FederationFrameType : std::uint16_t {
+    FRAME_HELLO = 1,
+    FRAME_KEY = 2,
+    FRAME_DELTA = 3
+};
+
+struct FederationFrameHeader {
+    std::uint32_t magic{kFederationMagic};
+    std::uint16_t type{0};
+    std::uint16_t reserved{0};
+    std::uint32_t payloadLength{0};
+    std::uint32_t reserved2{0};
+    // Counts KEY and DELTA frames on this connection, starting at 1.
+    std::uint64_t sequence{0};
+};
+
+struct FederationHello {
+    std::uint32_t version{kFederationVersion};
+    std::uint32_t snapshotSize{static_cast<std::uint32_t>(sizeof(BinderSnapshot))};
+    char name[kFederationNameLength]{};
+};
+
+// Upper bound of an encoded snapshot: one 9-byte word per 8 bytes plus run
+// headers. Anything larger is a corrupt frame.
+constexpr std::size_t kFederationMaxPayload = sizeof(BinderSnapshot) / 8 * 9 + 4096;
+
+// The snapshot is compared as 64-bit words against the last encoded one.
+// Changed words are grouped into runs (varint skip, varint length) and each
+// word is sent as the XOR with its old value, minus its leading and trailing
+// zero bytes, behind a one-byte tag (leading << 4 | trailing). Counters and
+// timestamps usually cost 2-4 bytes, unchanged tables nothing, so a delta
+// frame stays in the low KiB even with full process and thread tables.
+class SnapshotDeltaEncoder {
+public:
+    SnapshotDeltaEncoder();
+
+    // The next encode() is a keyframe.
+    void reset();
+
+    // Replaces outPayload with the delta from the previous snapshot (or from
+    // zero after reset()) and remembers `snapshot` as the new reference.
+    // An empty payload means nothing changed.
+    void encode(const BinderSnapshot& snapshot, std::vector<std::uint8_t>& outPayload);
+
+private:
+    std::unique_ptr<BinderSnapshot> mReference;
+};
+
+// Applies an encoded delta in place. For a keyframe, zero the snapshot
+// first. Returns false, possibly leaving the snapshot partly updated, if
+// the payload is malformed.
+bool applySnapshotDelta(const std::uint8_t* payload, std::size_t length, BinderSnapshot& inOutSnapshot);
+
+// Forces the last byte of every char array in the snapshot to NUL. A peer
+// controls every byte it sends, and the app prints these fields with %s.
+// The delta XORs each byte independently, so this does not disturb later
+// frames. Update this list with every new string field.
+void terminateSnapshotStrings(BinderSnapshot& snapshot);
+
+} // namespace xmonitor
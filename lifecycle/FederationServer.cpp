@@ -0,0 +1,473 @@
+#include "lifecycle/FederationServer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+#include "lifecycle/SnapshotMetrics.h"
+
+namespace xmonitor {
+
+namespace {
+constexpr int kMaxEvents = 64;
+constexpr int kEpollTimeoutMs = 1000;
+constexpr std::size_t kReadChunk = 64 * 1024;
+// Leaves send at least a heartbeat per interval; a peer silent this long is
+// treated as gone even if TCP has not noticed yet.
+constexpr std::uint64_t kPeerTimeoutNs = 30000000000ull;
+
+// Fleet columns, in display order; names must exist in SnapshotMetrics.
+const char* kFleetMetricNames[kFleetMetricCount] = {
+    "cpu.usage",
+    "cpu.max_core_usage",
+    "ram.used_percent",
+    "load.1",
+    "psi.cpu.some10",
+    "psi.memory.some10",
+    "psi.io.some10",
+    "disk.max_util_percent",
+};
+}
+
+FederationServer::FederationServer(const Options& options)
+    : mOptions(options),
+      mListenFd(-1),
+      mEpollFd(-1),
+      mWakeFd(-1),
+      mBoundPort(0),
+      mRunning(false),
+      mFramesReceived(0),
+      mBytesReceived(0),
+      mDecodeNs(0) {
+    for (std::size_t i = 0; i < kFleetMetricCount; ++i) {
+        mFleetMetrics[i] = findSnapshotMetric(kFleetMetricNames[i]);
+    }
+}
+
+FederationServer::~FederationServer() {
+    stop();
+}
+
+bool FederationServer::start() {
+    if (!openListener()) {
+        return false;
+    }
+
+    mEpollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    mWakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mEpollFd < 0 || mWakeFd < 0) {
+        LOG_E("Federation server: epoll/eventfd failed errno=%d", errno);
+        stop();
+        return false;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = &mListenFd;
+    ::epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mListenFd, &event);
+    event.data.ptr = &mWakeFd;
+    ::epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mWakeFd, &event);
+
+    mRunning.store(true);
+    mThread = std::thread([this]() {
+        run();
+    });
+    return true;
+}
+
+void FederationServer::stop() {
+    if (mRunning.exchange(false)) {
+        const std::uint64_t one = 1;
+        if (::write(mWakeFd, &one, sizeof(one)) < 0) {
+            LOG_W("Federation server: wake failed errno=%d", errno);
+        }
+    }
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+
+    for (const std::unique_ptr<Peer>& peer : mPeers) {
+        closePeer(*peer);
+    }
+    mPeers.clear();
+
+    for (int* fd : {&mListenFd, &mEpollFd, &mWakeFd}) {
+        if (*fd >= 0) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+std::uint16_t FederationServer::port() const {
+    return mBoundPort;
+}
+
+bool FederationServer::openListener() {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST;
+    addrinfo* address = nullptr;
+    const std::string host = mOptions.address.empty() ? "127.0.0.1" : mOptions.address;
+    const std::string port = std::to_string(mOptions.port);
+    const int status = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &address);
+    if (status != 0) {
+        LOG_E("Federation server: bad listen address %s: %s", host.c_str(), ::gai_strerror(status));
+        return false;
+    }
+
+    mListenFd = ::socket(address->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (mListenFd < 0) {
+        LOG_E("Federation server: socket failed errno=%d", errno);
+        ::freeaddrinfo(address);
+        return false;
+    }
+    const int reuse = 1;
+    ::setsockopt(mListenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    const bool bound = ::bind(mListenFd, address->ai_addr, address->ai_addrlen) == 0;
+    ::freeaddrinfo(address);
+    if (!bound || ::listen(mListenFd, SOMAXCONN) != 0) {
+        LOG_E("Federation server: listen on %s:%u failed errno=%d", host.c_str(), mOptions.port, errno);
+        ::close(mListenFd);
+        mListenFd = -1;
+        return false;
+    }
+
+    sockaddr_storage local{};
+    socklen_t localLength = sizeof(local);
+    if (::getsockname(mListenFd, reinterpret_cast<sockaddr*>(&local), &localLength) == 0) {
+        mBoundPort = ntohs(local.ss_family == AF_INET6 ? reinterpret_cast<sockaddr_in6*>(&local)->sin6_port
+                                                       : reinterpret_cast<sockaddr_in*>(&local)->sin_port);
+    }
+    LOG_I("Federation server: accepting leaves on %s:%u", host.c_str(), mBoundPort);
+    return true;
+}
+
+void FederationServer::run() {
+    epoll_event events[kMaxEvents];
+
+    while (mRunning.load()) {
+        const int ready = ::epoll_wait(mEpollFd, events, kMaxEvents, kEpollTimeoutMs);
+        if (ready < 0 && errno != EINTR) {
+            LOG_E("Federation server: epoll_wait failed errno=%d", errno);
+            break;
+        }
+
+        const std::uint64_t nowNs = monotonicNowNs();
+        bool accept = false;
+        for (int i = 0; i < ready; ++i) {
+            if (events[i].data.ptr == &mListenFd) {
+                accept = true;
+                continue;
+            }
+            if (events[i].data.ptr == &mWakeFd) {
+                std::uint64_t drained = 0;
+                (void)!::read(mWakeFd, &drained, sizeof(drained));
+                continue;
+            }
+
+            // A peer closed earlier in this batch (host takeover) stays
+            // allocated until the sweep below.
+            Peer& peer = *static_cast<Peer*>(events[i].data.ptr);
+            if (peer.fd >= 0 && !readPeer(peer, nowNs)) {
+                closePeer(peer);
+            }
+        }
+
+        for (const std::unique_ptr<Peer>& peer : mPeers) {
+            if (peer->fd >= 0 && nowNs - peer->lastFrameNs > kPeerTimeoutNs) {
+                LOG_W("Federation server: peer fd=%d timed out", peer->fd);
+                closePeer(*peer);
+            }
+        }
+        mPeers.erase(std::remove_if(mPeers.begin(),
+                                    mPeers.end(),
+                                    [](const std::unique_ptr<Peer>& peer) { return peer->fd < 0; }),
+                     mPeers.end());
+
+        if (accept) {
+            acceptPeers(nowNs);
+        }
+    }
+}
+
+void FederationServer::acceptPeers(std::uint64_t nowNs) {
+    while (true) {
+        const int fd = ::accept4(mListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                LOG_W("Federation server: accept failed errno=%d", errno);
+            }
+            return;
+        }
+        if (mPeers.size() >= kMaxHosts) {
+            LOG_W("Federation server: more than %zu peers, rejecting", kMaxHosts);
+            ::close(fd);
+            continue;
+        }
+
+        auto peer = std::make_unique<Peer>();
+        peer->fd = fd;
+        peer->lastFrameNs = nowNs;
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.ptr = peer.get();
+        if (::epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            LOG_W("Federation server: epoll_ctl failed errno=%d", errno);
+            ::close(fd);
+            continue;
+        }
+        mPeers.push_back(std::move(peer));
+    }
+}
+
+bool FederationServer::readPeer(Peer& peer, std::uint64_t nowNs) {
+    if (peer.buffer.size() < peer.length + kReadChunk) {
+        peer.buffer.resize(peer.length + kReadChunk);
+    }
+    const ssize_t received = ::read(peer.fd, peer.buffer.data() + peer.length, peer.buffer.size() - peer.length);
+    if (received == 0) {
+        return false;
+    }
+    if (received < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    peer.length += static_cast<std::size_t>(received);
+    mBytesReceived.fetch_add(static_cast<std::uint64_t>(received), std::memory_order_relaxed);
+
+    // Handle every complete frame; a read usually carries exactly one.
+    std::size_t offset = 0;
+    while (peer.length - offset >= sizeof(FederationFrameHeader)) {
+        FederationFrameHeader header{};
+        std::memcpy(&header, peer.buffer.data() + offset, sizeof(header));
+        if (header.magic != kFederationMagic || header.payloadLength > kFederationMaxPayload) {
+            LOG_W("Federation server: bad frame from fd=%d", peer.fd);
+            return false;
+        }
+        const std::size_t frameLength = sizeof(header) + header.payloadLength;
+        if (peer.length - offset < frameLength) {
+            break;
+        }
+        if (!handleFrame(peer, header, peer.buffer.data() + offset + sizeof(header), nowNs)) {
+            return false;
+        }
+        offset += frameLength;
+    }
+
+    if (offset != 0) {
+        std::memmove(peer.buffer.data(), peer.buffer.data() + offset, peer.length - offset);
+        peer.length -= offset;
+    }
+    return true;
+}
+
+bool FederationServer::handleFrame(Peer& peer,
+                                   const FederationFrameHeader& header,
+                                   const std::uint8_t* payload,
+                                   std::uint64_t nowNs) {
+    peer.lastFrameNs = nowNs;
+
+    if (header.type == FRAME_HELLO) {
+        if (peer.host != kNoHost || header.payloadLength != sizeof(FederationHello)) {
+            LOG_W("Federation server: unexpected hello from fd=%d", peer.fd);
+            return false;
+        }
+        FederationHello hello{};
+        std::memcpy(&hello, payload, sizeof(hello));
+        hello.name[kFederationNameLength - 1] = '\0';
+        if (hello.version != kFederationVersion || hello.snapshotSize != sizeof(BinderSnapshot)) {
+            LOG_W("Federation server: '%s' speaks version %u with %u-byte snapshots, expected %u/%zu",
+                  hello.name, hello.version, hello.snapshotSize, kFederationVersion, sizeof(BinderSnapshot));
+            return false;
+        }
+        return bindHost(peer, hello);
+    }
+
+    if ((header.type != FRAME_KEY && header.type != FRAME_DELTA) || peer.host == kNoHost) {
+        LOG_W("Federation server: unexpected frame type %u from fd=%d", header.type, peer.fd);
+        return false;
+    }
+    // A delta only applies on top of its predecessor; the leaf reconnects
+    // and starts over with a keyframe.
+    if (header.sequence != peer.sequence + 1 || (header.type == FRAME_DELTA && peer.sequence == 0)) {
+        LOG_W("Federation server: frame %llu out of sequence from fd=%d",
+              static_cast<unsigned long long>(header.sequence), peer.fd);
+        return false;
+    }
+    peer.sequence = header.sequence;
+
+    const std::uint64_t decodeStartNs = monotonicNowNs();
+    std::lock_guard<std::mutex> lock(mHostsMutex);
+    Host& host = mHosts[peer.host];
+    if (header.type == FRAME_KEY) {
+        std::memset(static_cast<void*>(host.snapshot.get()), 0, sizeof(BinderSnapshot));
+    }
+    const bool applied = applySnapshotDelta(payload, header.payloadLength, *host.snapshot);
+    // Even a rejected frame may have been partly applied.
+    terminateSnapshotStrings(*host.snapshot);
+    if (!applied) {
+        LOG_W("Federation server: corrupt delta from '%s'", host.name.c_str());
+        return false;
+    }
+    host.lastFrameNs = nowNs;
+    ++host.frames;
+    host.bytes += sizeof(header) + header.payloadLength;
+    mFramesReceived.fetch_add(1, std::memory_order_relaxed);
+    mDecodeNs.fetch_add(monotonicNowNs() - decodeStartNs, std::memory_order_relaxed);
+    return true;
+}
+
+bool FederationServer::bindHost(Peer& peer, const FederationHello& hello) {
+    std::lock_guard<std::mutex> lock(mHostsMutex);
+
+    std::size_t index = 0;
+    while (index < mHosts.size() && mHosts[index].name != hello.name) {
+        ++index;
+    }
+    if (index == mHosts.size()) {
+        if (mHosts.size() >= kMaxHosts) {
+            LOG_W("Federation server: more than %zu hosts, rejecting '%s'", kMaxHosts, hello.name);
+            return false;
+        }
+        Host host;
+        host.name = hello.name;
+        host.snapshot = std::make_unique<BinderSnapshot>();
+        mHosts.push_back(std::move(host));
+        LOG_I("Federation server: new host '%s'", hello.name);
+    } else if (mHosts[index].connected) {
+        // The newest connection wins: the old one is most likely a
+        // half-open socket from before a network blip.
+        for (const std::unique_ptr<Peer>& other : mPeers) {
+            if (other.get() != &peer && other->host == index) {
+                LOG_W("Federation server: '%s' reconnected, dropping old connection", hello.name);
+                other->host = kNoHost;
+                ::epoll_ctl(mEpollFd, EPOLL_CTL_DEL, other->fd, nullptr);
+                ::close(other->fd);
+                other->fd = -1;
+            }
+        }
+    }
+
+    mHosts[index].connected = true;
+    peer.host = index;
+    peer.sequence = 0;
+    return true;
+}
+
+void FederationServer::closePeer(Peer& peer) {
+    if (peer.fd < 0) {
+        return;
+    }
+    if (peer.host != kNoHost) {
+        std::lock_guard<std::mutex> lock(mHostsMutex);
+        mHosts[peer.host].connected = false;
+        peer.host = kNoHost;
+    }
+    if (mEpollFd >= 0) {
+        ::epoll_ctl(mEpollFd, EPOLL_CTL_DEL, peer.fd, nullptr);
+    }
+    ::close(peer.fd);
+    peer.fd = -1;
+}
+
+void FederationServer::fleet(std::uint32_t firstHost, std::uint64_t nowNs, FleetData& outData) const {
+    outData = FleetData{};
+    for (std::size_t m = 0; m < kFleetMetricCount; ++m) {
+        std::strncpy(outData.metrics[m], kFleetMetricNames[m], kAlertMetricLength - 1);
+    }
+
+    std::lock_guard<std::mutex> lock(mHostsMutex);
+
+    std::vector<std::uint32_t> order(mHosts.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        order[i] = static_cast<std::uint32_t>(i);
+    }
+    std::sort(order.begin(), order.end(), [this](std::uint32_t left, std::uint32_t right) {
+        return mHosts[left].name < mHosts[right].name;
+    });
+
+    outData.hostCount = static_cast<std::uint32_t>(mHosts.size());
+    outData.firstHost = std::min<std::uint32_t>(firstHost, outData.hostCount);
+
+    for (std::size_t position = 0; position < order.size(); ++position) {
+        const Host& host = mHosts[order[position]];
+        const bool listed = position >= outData.firstHost && outData.rowCount < kFleetPageHosts;
+        FleetHost* row = listed ? &outData.hosts[outData.rowCount++] : nullptr;
+        if (row != nullptr) {
+            row->id = order[position] + 1;
+            row->connected = host.connected ? 1 : 0;
+            row->firingAlerts = host.snapshot->alerts.firingCount;
+            row->lastFrameAgeMs = host.lastFrameNs == 0 ? 0 : (nowNs - host.lastFrameNs) / 1000000ull;
+            row->frames = host.frames;
+            row->bytes = host.bytes;
+            std::strncpy(row->name, host.name.c_str(), kFleetHostNameLength - 1);
+        }
+        if (host.connected) {
+            ++outData.connectedCount;
+        }
+
+        for (std::size_t m = 0; m < kFleetMetricCount; ++m) {
+            const SnapshotMetric& metric = snapshotMetric(mFleetMetrics[m]);
+            if (!snapshotHasSource(*host.snapshot, metric.source)) {
+                continue;
+            }
+            const double value = metric.read(*host.snapshot);
+            if (row != nullptr) {
+                row->values[m] = value;
+                row->valueMask |= 1u << m;
+            }
+            if (!host.connected) {
+                continue;
+            }
+            FleetRollup& rollup = outData.rollups[m];
+            rollup.min = rollup.hostCount == 0 ? value : std::min(rollup.min, value);
+            rollup.max = rollup.hostCount == 0 ? value : std::max(rollup.max, value);
+            rollup.mean += value;
+            ++rollup.hostCount;
+        }
+    }
+
+    for (FleetRollup& rollup : outData.rollups) {
+        if (rollup.hostCount != 0) {
+            rollup.mean /= rollup.hostCount;
+        }
+    }
+}
+
+bool FederationServer::hostSnapshot(std::uint32_t hostId, BinderSnapshot& outSnapshot) const {
+    std::lock_guard<std::mutex> lock(mHostsMutex);
+    if (hostId == 0 || hostId > mHosts.size()) {
+        return false;
+    }
+    outSnapshot = *mHosts[hostId - 1].snapshot;
+    return true;
+}
+
+std::size_t FederationServer::hostCount() const {
+    std::lock_guard<std::mutex> lock(mHostsMutex);
+    return mHosts.size();
+}
+
+std::uint64_t FederationServer::framesReceived() const {
+    return mFramesReceived.load(std::memory_order_relaxed);
+}
+
+std::uint64_t FederationServer::bytesReceived() const {
+    return mBytesReceived.load(std::memory_order_relaxed);
+}
+
+std::uint64_t FederationServer::decodeNs() const {
+    return mDecodeNs.load(std::memory_order_relaxed);
+}
+
+} // namespace xmonitor
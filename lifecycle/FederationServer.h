@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ipc/BinderProtocol.h"
+#include "lifecycle/FederationCodec.h"
+
+namespace xmonitor {
+
+// Aggregator side of federation: accepts FederationUplink connections,
+// keeps the latest decoded snapshot of every host that ever connected, and
+// answers the app's QueryFleet / QueryHostSnapshot from the binder thread.
+// Frames are decoded on the server's own epoll thread; the binder thread
+// only takes mHostsMutex for the copy-out.
+class FederationServer {
+public:
+    static constexpr std::size_t kMaxHosts = 1024;
+
+    struct Options {
+        // Empty listens on loopback only. Leaves are not authenticated, so
+        // a routable address should be firewalled to the leaf hosts.
+        std::string address;
+        // 0 picks a free port, see port().
+        std::uint16_t port{9478};
+    };
+
+    explicit FederationServer(const Options& options);
+    ~FederationServer();
+
+    FederationServer(const FederationServer&) = delete;
+    FederationServer& operator=(const FederationServer&) = delete;
+
+    bool start();
+    void stop();
+
+    std::uint16_t port() const;
+
+    // Hosts sorted by name; rollups cover every connected host.
+    void fleet(std::uint32_t firstHost, std::uint64_t nowNs, FleetData& outData) const;
+    bool hostSnapshot(std::uint32_t hostId, BinderSnapshot& outSnapshot) const;
+
+    std::size_t hostCount() const;
+    std::uint64_t framesReceived() const;
+    std::uint64_t bytesReceived() const;
+    std::uint64_t decodeNs() const;
+
+private:
+    static constexpr std::size_t kNoHost = static_cast<std::size_t>(-1);
+
+    struct Host {
+        std::string name;
+        std::unique_ptr<BinderSnapshot> snapshot;
+        bool connected{false};
+        std::uint64_t lastFrameNs{0};
+        std::uint64_t frames{0};
+        std::uint64_t bytes{0};
+    };
+
+    struct Peer {
+        int fd{-1};
+        std::size_t host{kNoHost};
+        std::uint64_t sequence{0};
+        std::uint64_t lastFrameNs{0};
+        std::vector<std::uint8_t> buffer;
+        std::size_t length{0};
+    };
+
+    bool openListener();
+    void run();
+    void acceptPeers(std::uint64_t nowNs);
+    bool readPeer(Peer& peer, std::uint64_t nowNs);
+    bool handleFrame(Peer& peer, const FederationFrameHeader& header, const std::uint8_t* payload, std::uint64_t nowNs);
+    bool bindHost(Peer& peer, const FederationHello& hello);
+    void closePeer(Peer& peer);
+
+    Options mOptions;
+    int mListenFd;
+    int mEpollFd;
+    int mWakeFd;
+    std::uint16_t mBoundPort;
+    std::thread mThread;
+    std::atomic<bool> mRunning;
+
+    // Server-thread state.
+    std::vector<std::unique_ptr<Peer>> mPeers;
+    std::size_t mFleetMetrics[kFleetMetricCount];
+
+    mutable std::mutex mHostsMutex;
+    std::vector<Host> mHosts;
+
+    std::atomic<std::uint64_t> mFramesReceived;
+    std::atomic<std::uint64_t> mBytesReceived;
+    std::atomic<std::uint64_t> mDecodeNs;
+};
+
+} // namespace xmonitor
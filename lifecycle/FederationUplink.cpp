@@ -0,0 +1,284 @@
+#include "lifecycle/FederationUplink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+
+namespace xmonitor {
+
+namespace {
+constexpr int kConnectTimeoutMs = 2000;
+constexpr std::uint32_t kMaxBackoffMs = 30000;
+constexpr std::uint64_t kNsPerMs = 1000000ull;
+// A stalled aggregator must not hold the uplink thread for long; the frame
+// is dropped and the connection rebuilt with a keyframe.
+constexpr int kSendTimeoutSec = 5;
+
+bool waitWritable(int fd, int timeoutMs) {
+    pollfd pfd{fd, POLLOUT, 0};
+    const int ready = ::poll(&pfd, 1, timeoutMs);
+    if (ready <= 0) {
+        return false;
+    }
+    int error = 0;
+    socklen_t length = sizeof(error);
+    return ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0;
+}
+}
+
+FederationUplink::FederationUplink(const Options& options)
+    : mOptions(options),
+      mRunning(false),
+      mPublishedGeneration(0),
+      mStaging(std::make_unique<BinderSnapshot>()),
+      mStagingGeneration(0),
+      mFd(-1),
+      mSending(std::make_unique<BinderSnapshot>()),
+      mSentGeneration(0),
+      mSequence(0),
+      mBackoffMs(0),
+      mNextConnectNs(0),
+      mFramesSent(0),
+      mKeyframesSent(0),
+      mBytesSent(0) {
+    mOptions.intervalMs = std::max<std::uint32_t>(mOptions.intervalMs, 10);
+    mBackoffMs = mOptions.intervalMs;
+    if (mOptions.name.empty()) {
+        char hostname[kFederationNameLength] = {};
+        if (::gethostname(hostname, sizeof(hostname) - 1) == 0) {
+            mOptions.name = hostname;
+        }
+    }
+    mPayload.reserve(64 * 1024);
+}
+
+FederationUplink::~FederationUplink() {
+    stop();
+}
+
+bool FederationUplink::start() {
+    if (mOptions.host.empty() || mOptions.port == 0) {
+        LOG_E("Federation uplink: no upstream address");
+        return false;
+    }
+    if (mOptions.name.empty() || mOptions.name.size() >= kFederationNameLength) {
+        LOG_E("Federation uplink: host name must be 1-%zu characters", kFederationNameLength - 1);
+        return false;
+    }
+
+    LOG_I("Federation uplink: pushing '%s' to %s:%u every %u ms",
+          mOptions.name.c_str(), mOptions.host.c_str(), mOptions.port, mOptions.intervalMs);
+    mRunning.store(true);
+    mThread = std::thread([this]() {
+        run();
+    });
+    return true;
+}
+
+void FederationUplink::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mWaitMutex);
+        mRunning.store(false);
+    }
+    mWait.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+    disconnect();
+}
+
+void FederationUplink::publish(const BinderSnapshot& snapshot, std::uint64_t generation, std::uint64_t) {
+    if (generation == mPublishedGeneration) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mStagingMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+    *mStaging = snapshot;
+    mStagingGeneration = generation;
+    mPublishedGeneration = generation;
+}
+
+std::uint64_t FederationUplink::framesSent() const {
+    return mFramesSent.load(std::memory_order_relaxed);
+}
+
+std::uint64_t FederationUplink::keyframesSent() const {
+    return mKeyframesSent.load(std::memory_order_relaxed);
+}
+
+std::uint64_t FederationUplink::bytesSent() const {
+    return mBytesSent.load(std::memory_order_relaxed);
+}
+
+bool FederationUplink::connectUpstream() {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    const std::string port = std::to_string(mOptions.port);
+    const int status = ::getaddrinfo(mOptions.host.c_str(), port.c_str(), &hints, &addresses);
+    if (status != 0) {
+        LOG_W("Federation uplink: cannot resolve %s: %s", mOptions.host.c_str(), ::gai_strerror(status));
+        return false;
+    }
+
+    for (addrinfo* address = addresses; address != nullptr && mFd < 0; address = address->ai_next) {
+        const int fd = ::socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, address->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (::connect(fd, address->ai_addr, address->ai_addrlen) != 0 &&
+            (errno != EINPROGRESS || !waitWritable(fd, kConnectTimeoutMs))) {
+            ::close(fd);
+            continue;
+        }
+        mFd = fd;
+    }
+    ::freeaddrinfo(addresses);
+
+    if (mFd < 0) {
+        LOG_W("Federation uplink: connect %s:%u failed errno=%d", mOptions.host.c_str(), mOptions.port, errno);
+        return false;
+    }
+
+    // Frames are written whole with a send timeout instead of polling.
+    ::fcntl(mFd, F_SETFL, ::fcntl(mFd, F_GETFL) & ~O_NONBLOCK);
+    const timeval timeout{kSendTimeoutSec, 0};
+    ::setsockopt(mFd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    const int noDelay = 1;
+    ::setsockopt(mFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    FederationHello hello{};
+    std::memcpy(hello.name, mOptions.name.c_str(), mOptions.name.size());
+    if (!sendFrame(FRAME_HELLO, 0, &hello, sizeof(hello))) {
+        disconnect();
+        return false;
+    }
+
+    LOG_I("Federation uplink: connected to %s:%u", mOptions.host.c_str(), mOptions.port);
+    mEncoder.reset();
+    mSequence = 0;
+    return true;
+}
+
+void FederationUplink::disconnect() {
+    if (mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+}
+
+bool FederationUplink::sendFrame(std::uint16_t type, std::uint64_t sequence, const void* payload, std::size_t length) {
+    FederationFrameHeader header{};
+    header.type = type;
+    header.payloadLength = static_cast<std::uint32_t>(length);
+    header.sequence = sequence;
+
+    iovec parts[2] = {
+        {&header, sizeof(header)},
+        {const_cast<void*>(payload), length},
+    };
+    msghdr message{};
+    message.msg_iov = parts;
+    message.msg_iovlen = length == 0 ? 1 : 2;
+
+    std::size_t remaining = sizeof(header) + length;
+    while (remaining != 0) {
+        const ssize_t sent = ::sendmsg(mFd, &message, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_W("Federation uplink: send failed errno=%d", errno);
+            return false;
+        }
+
+        remaining -= static_cast<std::size_t>(sent);
+        std::size_t skip = static_cast<std::size_t>(sent);
+        while (message.msg_iovlen != 0 && skip >= message.msg_iov[0].iov_len) {
+            skip -= message.msg_iov[0].iov_len;
+            ++message.msg_iov;
+            --message.msg_iovlen;
+        }
+        if (message.msg_iovlen != 0) {
+            message.msg_iov[0].iov_base = static_cast<char*>(message.msg_iov[0].iov_base) + skip;
+            message.msg_iov[0].iov_len -= skip;
+        }
+    }
+
+    mBytesSent.fetch_add(sizeof(header) + length, std::memory_order_relaxed);
+    return true;
+}
+
+void FederationUplink::run() {
+    const auto interval = std::chrono::milliseconds(mOptions.intervalMs);
+
+    while (mRunning.load()) {
+        {
+            std::unique_lock<std::mutex> lock(mWaitMutex);
+            mWait.wait_for(lock, interval, [this]() { return !mRunning.load(); });
+        }
+        if (!mRunning.load()) {
+            break;
+        }
+
+        const std::uint64_t nowNs = monotonicNowNs();
+        bool keyframe = false;
+        if (mFd < 0) {
+            if (nowNs < mNextConnectNs) {
+                continue;
+            }
+            if (!connectUpstream()) {
+                mBackoffMs = std::min(mBackoffMs * 2, kMaxBackoffMs);
+                mNextConnectNs = nowNs + mBackoffMs * kNsPerMs;
+                continue;
+            }
+            mBackoffMs = mOptions.intervalMs;
+            keyframe = true;
+        }
+
+        bool changed = false;
+        {
+            std::lock_guard<std::mutex> lock(mStagingMutex);
+            if (mStagingGeneration != mSentGeneration) {
+                *mSending = *mStaging;
+                mSentGeneration = mStagingGeneration;
+                changed = true;
+            }
+        }
+        // Nothing new: an empty delta doubles as the heartbeat.
+        if (changed || keyframe) {
+            mEncoder.encode(*mSending, mPayload);
+        } else {
+            mPayload.clear();
+        }
+
+        if (!sendFrame(keyframe ? FRAME_KEY : FRAME_DELTA, ++mSequence, mPayload.data(), mPayload.size())) {
+            disconnect();
+            mNextConnectNs = nowNs + mBackoffMs * kNsPerMs;
+            continue;
+        }
+        mFramesSent.fetch_add(1, std::memory_order_relaxed);
+        if (keyframe) {
+            mKeyframesSent.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace xmonitor
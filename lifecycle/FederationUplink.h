@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ipc/BinderProtocol.h"
+#include "lifecycle/FederationCodec.h"
+
+namespace xmonitor {
+
+// Leaf side of federation: pushes this lifecycle's snapshot to an
+// aggregator over TCP. The binder thread hands over snapshot copies with
+// publish() (try_lock only, as for the metrics exporter); the uplink thread
+// wakes every intervalMs and sends one frame with everything that changed
+// since the previous one, so any number of updates cost one frame per
+// interval. A lost connection is retried with backoff and restarts with a
+// keyframe.
+class FederationUplink {
+public:
+    struct Options {
+        std::string host;
+        std::uint16_t port{0};
+        // Shown by the aggregator; defaults to gethostname().
+        std::string name;
+        std::uint32_t intervalMs{1000};
+    };
+
+    explicit FederationUplink(const Options& options);
+    ~FederationUplink();
+
+    FederationUplink(const FederationUplink&) = delete;
+    FederationUplink& operator=(const FederationUplink&) = delete;
+
+    bool start();
+    void stop();
+
+    // Binder thread only.
+    void publish(const BinderSnapshot& snapshot, std::uint64_t generation, std::uint64_t nowNs);
+
+    std::uint64_t framesSent() const;
+    std::uint64_t keyframesSent() const;
+    std::uint64_t bytesSent() const;
+
+private:
+    bool connectUpstream();
+    void disconnect();
+    bool sendFrame(std::uint16_t type, std::uint64_t sequence, const void* payload, std::size_t length);
+    void run();
+
+    Options mOptions;
+    std::thread mThread;
+    std::atomic<bool> mRunning;
+    std::mutex mWaitMutex;
+    std::condition_variable mWait;
+
+    // Binder-thread side of the hand-over.
+    std::uint64_t mPublishedGeneration;
+
+    std::mutex mStagingMutex;
+    std::unique_ptr<BinderSnapshot> mStaging;
+    std::uint64_t mStagingGeneration;
+
+    // Uplink-thread state.
+    int mFd;
+    std::unique_ptr<BinderSnapshot> mSending;
+    std::uint64_t mSentGeneration;
+    std::uint64_t mSequence;
+    SnapshotDeltaEncoder mEncoder;
+    std::vector<std::uint8_t> mPayload;
+    std::uint32_t mBackoffMs;
+    std::uint64_t mNextConnectNs;
+    std::atomic<std::uint64_t> mFramesSent;
+    std::atomic<std::uint64_t> mKeyframesSent;
+    std::atomic<std::uint64_t> mBytesSent;
+};
+
+} // namespace xmonitor
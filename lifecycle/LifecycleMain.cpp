@@ -1,18 +1,47 @@
 #include <csignal>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <string>
 #include <thread>
 
 #include "Logger.h"
+#include "common/Config.h"
+#include "common/MonotonicClock.h"
+#include "common/SamplingPolicy.h"
+#include "common/SelfUsage.h"
 #include "ipc/BinderProtocol.h"
 #include "ipc/BinderServerAdapter.h"
+#include "ipc/MetricSchema.h"
+#include "lifecycle/AlertEngine.h"
+#include "lifecycle/FederationServer.h"
+#include "lifecycle/FederationUplink.h"
+#include "lifecycle/MetricsExporter.h"
+#include "lifecycle/PercentileTracker.h"
 
 namespace {
 volatile std::sig_atomic_t gRunning = 1;
 
+constexpr std::uint64_t kSelfUsageIntervalNs = 1000000000ull;
+// An hour; the uplink raises anything below its 10 ms floor.
+constexpr long kMaxFederationIntervalMs = 3600000;
+
 void signalHandler(int) {
     gRunning = 0;
 }
+
+// "host:port", or "port" alone when host is optional.
+bool splitHostPort(const std::string& text, std::string& outHost, std::uint16_t& outPort) {
+    const std::size_t colon = text.rfind(':');
+    outHost = colon == std::string::npos ? "" : text.substr(0, colon);
+    long value = 0;
+    if (!xmonitor::parseInteger(colon == std::string::npos ? text : text.substr(colon + 1), 0, 65535, value)) {
+        return false;
+    }
+    outPort = static_cast<std::uint16_t>(value);
+    return true;
+}
 }
 
 int main() {
@@ -24,9 +53,10 @@ int main() {
 
     xmonitor::BinderServerAdapter binder;
     if (!binder.initializeContextManager()) {
-        LOG_E("Lifecycle binder initialize(context manager) failed");
+        LOG_E("Lifecycle %s initialize(context manager) failed", binder.transportName());
         return 1;
     }
+    LOG_I("Lifecycle IPC transport: %s", binder.transportName());
 
     struct State {
         xmonitor::BinderSnapshot snapshot{};
@@ -34,17 +64,157 @@ int main() {
         bool hasCpuService{false};
         bool hasRamService{false};
         bool hasMemoryService{false};
+        bool hasDiskService{false};
+        bool hasNetService{false};
+        bool hasCgroupService{false};
+        bool hasThreadService{false};
+        bool hasProcessService{false};
+        xmonitor::WatchTarget watch{};
+        xmonitor::SamplingPolicy policy{};
         bool startGranted{false};
+        std::uint64_t updatesIngested{0};
+        // Bumped on every snapshot change; the metrics exporter re-renders
+        // only when it moves.
+        std::uint64_t generation{0};
+        std::uint64_t lastSelfUsageNs{0};
+        xmonitor::SelfUsageSampler selfUsage{xmonitor::ProcessRole::Lifecycle};
+        // Reply buffer for QueryHostSnapshot on an aggregator.
+        xmonitor::BinderSnapshot hostView{};
     } state;
 
+    // Starting policy; SetPolicy replaces it at runtime.
+    const std::string policySpec = xmonitor::envString("XMONITOR_POLICY", "");
+    if (!policySpec.empty()) {
+        std::string error;
+        xmonitor::SamplingPolicy policy{};
+        if (xmonitor::applyPolicySpec(policySpec, policy, error)) {
+            state.policy = policy;
+            state.policy.version = 1;
+            LOG_I("Lifecycle: sampling policy %s", xmonitor::formatPolicy(state.policy).c_str());
+        } else {
+            LOG_E("Lifecycle: XMONITOR_POLICY ignored: %s", error.c_str());
+        }
+    }
+
+    // Alerting is off unless a rules file is given.
+    std::unique_ptr<xmonitor::AlertEngine> alerts;
+    const std::string alertRules = xmonitor::envString("XMONITOR_ALERT_RULES", "");
+    if (!alertRules.empty()) {
+        alerts = std::make_unique<xmonitor::AlertEngine>();
+        if (alerts->load(alertRules) && alerts->ruleCount() != 0) {
+            alerts->setHook(xmonitor::envString("XMONITOR_ALERT_HOOK", ""));
+            alerts->exportTo(state.snapshot.alerts);
+        } else {
+            alerts.reset();
+        }
+    }
+
+    // Sliding-window quantiles served to the app via QueryPercentiles;
+    // XMONITOR_SKETCH_METRICS="" turns sampling off.
+    xmonitor::PercentileTracker percentiles;
+    percentiles.configure(xmonitor::envString(
+        "XMONITOR_SKETCH_METRICS",
+        "cpu.usage,cpu.max_core_usage,ram.used_percent,load.1,psi.cpu.some10,psi.memory.some10,"
+        "psi.io.some10,disk.max_util_percent"));
+
+    // Loopback TCP by default; XMONITOR_METRICS_SOCKET switches to a Unix
+    // socket and XMONITOR_METRICS_PORT=0 turns the endpoint off.
+    std::unique_ptr<xmonitor::MetricsExporter> exporter;
+    xmonitor::MetricsExporter::Options exporterOptions;
+    const std::string metricsPort = xmonitor::envString("XMONITOR_METRICS_PORT", "9477");
+    long port = 0;
+    if (xmonitor::parseInteger(metricsPort, 0, 65535, port)) {
+        exporterOptions.port = static_cast<std::uint16_t>(port);
+    } else {
+        LOG_E("Lifecycle: XMONITOR_METRICS_PORT must be 0..65535, got '%s'; TCP metrics endpoint disabled",
+              metricsPort.c_str());
+        exporterOptions.port = 0;
+    }
+    exporterOptions.socketPath = xmonitor::envString("XMONITOR_METRICS_SOCKET", "");
+    if (exporterOptions.port != 0 || !exporterOptions.socketPath.empty()) {
+        exporter = std::make_unique<xmonitor::MetricsExporter>(exporterOptions);
+        if (!exporter->start()) {
+            LOG_W("Lifecycle: metrics endpoint disabled");
+            exporter.reset();
+        }
+    }
+
+    // Federation: a leaf pushes its snapshot to XMONITOR_FEDERATION_UPSTREAM,
+    // an aggregator accepts leaves on XMONITOR_FEDERATION_LISTEN. A rack
+    // aggregator can do both; it only forwards its own snapshot.
+    std::unique_ptr<xmonitor::FederationUplink> uplink;
+    const std::string upstream = xmonitor::envString("XMONITOR_FEDERATION_UPSTREAM", "");
+    if (!upstream.empty()) {
+        xmonitor::FederationUplink::Options uplinkOptions;
+        uplinkOptions.name = xmonitor::envString("XMONITOR_FEDERATION_NAME", "");
+        const std::string interval = xmonitor::envString("XMONITOR_FEDERATION_INTERVAL_MS", "1000");
+        long intervalMs = 0;
+        if (xmonitor::parseInteger(interval, 0, kMaxFederationIntervalMs, intervalMs)) {
+            uplinkOptions.intervalMs = static_cast<std::uint32_t>(intervalMs);
+        } else {
+            LOG_W("Lifecycle: XMONITOR_FEDERATION_INTERVAL_MS must be 0..%ld, got '%s'; using %u",
+                  kMaxFederationIntervalMs,
+                  interval.c_str(),
+                  uplinkOptions.intervalMs);
+        }
+        if (!splitHostPort(upstream, uplinkOptions.host, uplinkOptions.port) || uplinkOptions.host.empty()) {
+            LOG_E("Lifecycle: XMONITOR_FEDERATION_UPSTREAM must be host:port, got '%s'", upstream.c_str());
+        } else {
+            uplink = std::make_unique<xmonitor::FederationUplink>(uplinkOptions);
+            if (!uplink->start()) {
+                uplink.reset();
+            }
+        }
+    }
+
+    std::unique_ptr<xmonitor::FederationServer> federation;
+    const std::string federationListen = xmonitor::envString("XMONITOR_FEDERATION_LISTEN", "");
+    if (!federationListen.empty()) {
+        xmonitor::FederationServer::Options serverOptions;
+        if (!splitHostPort(federationListen, serverOptions.address, serverOptions.port)) {
+            LOG_E("Lifecycle: XMONITOR_FEDERATION_LISTEN must be [address:]port, got '%s'", federationListen.c_str());
+        } else {
+            federation = std::make_unique<xmonitor::FederationServer>(serverOptions);
+            if (!federation->start()) {
+                LOG_W("Lifecycle: federation server disabled");
+                federation.reset();
+            }
+        }
+    }
+
     binder.setTransactionCallback([&](std::uint32_t code, const void* payload, std::size_t payloadSize) {
         const auto txnCode = static_cast<xmonitor::BinderTransactionCode>(code);
+        const std::uint64_t generationBefore = state.generation;
+
+        // Service updates: one table lookup, then a copy into the section's
+        // snapshot slot (see ipc/MetricSchema.h).
+        if (const xmonitor::SnapshotSectionInfo* section = xmonitor::snapshotSectionForCode(code)) {
+            // Samples of a previous watch target still in flight are dropped,
+            // as are samples a service sent before it saw its section disabled.
+            const bool staleThreads = txnCode == xmonitor::BinderTransactionCode::ThreadUpdated &&
+                                      payloadSize == section->payloadSize &&
+                                      reinterpret_cast<const xmonitor::ThreadData*>(payload)->pid != state.watch.pid;
+            const bool disabled = (state.policy.disabledSections & xmonitor::policySectionBit(txnCode)) != 0;
+            if (state.startGranted && payload != nullptr && payloadSize == section->payloadSize && !staleThreads &&
+                !disabled) {
+                if (xmonitor::SampleTrace* trace = section->ingest(state.snapshot, payload)) {
+                    trace->ingestNs = xmonitor::monotonicNowNs();
+                    ++state.updatesIngested;
+                    ++state.generation;
+                }
+            }
+        }
 
         switch (txnCode) {
             case xmonitor::BinderTransactionCode::RegisterApp:
             case xmonitor::BinderTransactionCode::RegisterCpuService:
             case xmonitor::BinderTransactionCode::RegisterRamService:
             case xmonitor::BinderTransactionCode::RegisterMemoryService:
+            case xmonitor::BinderTransactionCode::RegisterDiskService:
+            case xmonitor::BinderTransactionCode::RegisterNetService:
+            case xmonitor::BinderTransactionCode::RegisterCgroupService:
+            case xmonitor::BinderTransactionCode::RegisterThreadService:
+            case xmonitor::BinderTransactionCode::RegisterProcessService:
             case xmonitor::BinderTransactionCode::WaitStart: {
                 xmonitor::BinderAck ack{};
                 ack.ok = 1;
@@ -61,8 +231,26 @@ int main() {
                 } else if (txnCode == xmonitor::BinderTransactionCode::RegisterMemoryService) {
                     state.hasMemoryService = true;
                     LOG_I("Lifecycle: Memory service registered");
+                } else if (txnCode == xmonitor::BinderTransactionCode::RegisterDiskService) {
+                    state.hasDiskService = true;
+                    LOG_I("Lifecycle: Disk service registered");
+                } else if (txnCode == xmonitor::BinderTransactionCode::RegisterNetService) {
+                    state.hasNetService = true;
+                    LOG_I("Lifecycle: Net service registered");
+                } else if (txnCode == xmonitor::BinderTransactionCode::RegisterCgroupService) {
+                    state.hasCgroupService = true;
+                    LOG_I("Lifecycle: Cgroup service registered");
+                } else if (txnCode == xmonitor::BinderTransactionCode::RegisterThreadService) {
+                    state.hasThreadService = true;
+                    LOG_I("Lifecycle: Thread service registered");
+                } else if (txnCode == xmonitor::BinderTransactionCode::RegisterProcessService) {
+                    state.hasProcessService = true;
+                    LOG_I("Lifecycle: Process service registered");
                 }
 
+                // Only the core services gate the start; newer collectors are
+                // optional and begin streaming once the core set is up.
+
                 state.startGranted = state.hasApp && state.hasCpuService && state.hasRamService && state.hasMemoryService;
                 ack.startGranted = state.startGranted ? 1u : 0u;
 
@@ -71,33 +259,145 @@ int main() {
                 }
                 break;
             }
+            case xmonitor::BinderTransactionCode::SetWatchTarget: {
+                xmonitor::BinderAck ack{};
+                if (payload != nullptr && payloadSize == sizeof(xmonitor::WatchTarget)) {
+                    state.watch = *reinterpret_cast<const xmonitor::WatchTarget*>(payload);
+                    state.snapshot.thread = xmonitor::ThreadData{};
+                    ack.ok = 1;
+                    LOG_I("Lifecycle: watch target pid=%u", state.watch.pid);
+                }
+                ack.startGranted = state.startGranted ? 1u : 0u;
+                if (!binder.reply(code, &ack, sizeof(ack))) {
+                    LOG_E("Lifecycle: reply failed for code=%u", code);
+                }
+                break;
+            }
+            case xmonitor::BinderTransactionCode::QueryWatchTarget: {
+                if (!binder.reply(code, &state.watch, sizeof(state.watch))) {
+                    LOG_E("Lifecycle: watch target reply failed");
+                }
+                break;
+            }
+            case xmonitor::BinderTransactionCode::SetPolicy: {
+                xmonitor::BinderAck ack{};
+                std::string error = "malformed request";
+                if (payload != nullptr && payloadSize == sizeof(xmonitor::SamplingPolicy)) {
+                    const auto& policy = *reinterpret_cast<const xmonitor::SamplingPolicy*>(payload);
+                    if (policy.version != state.policy.version) {
+                        error = "stale version " + std::to_string(policy.version);
+                    } else if (xmonitor::validatePolicy(policy, error)) {
+                        // Sections switched off stop showing their last sample.
+                        const std::uint32_t newlyDisabled = policy.disabledSections & ~state.policy.disabledSections;
+                        xmonitor::MetricSchema::forEach([&](auto section) {
+                            using Section = decltype(section);
+                            if ((newlyDisabled & xmonitor::policySectionBit(Section::code)) != 0) {
+                                Section::clear(state.snapshot);
+                                ++state.generation;
+                            }
+                        });
+                        state.policy = policy;
+                        state.policy.version = policy.version + 1;
+                        ack.ok = 1;
+                        LOG_I("Lifecycle: sampling policy v%llu %s",
+                              static_cast<unsigned long long>(state.policy.version),
+                              xmonitor::formatPolicy(state.policy).c_str());
+                    }
+                }
+                if (ack.ok == 0) {
+                    LOG_W("Lifecycle: SetPolicy rejected: %s", error.c_str());
+                }
+                ack.startGranted = state.startGranted ? 1u : 0u;
+                if (!binder.reply(code, &ack, sizeof(ack))) {
+                    LOG_E("Lifecycle: reply failed for code=%u", code);
+                }
+                break;
+            }
+            case xmonitor::BinderTransactionCode::QueryPolicy: {
+                if (!binder.reply(code, &state.policy, sizeof(state.policy))) {
+                    LOG_E("Lifecycle: policy reply failed");
+                }
+                break;
+            }
             case xmonitor::BinderTransactionCode::QuerySnapshot: {
+                const std::uint64_t nowNs = xmonitor::monotonicNowNs();
+                if (nowNs - state.lastSelfUsageNs >= kSelfUsageIntervalNs) {
+                    state.lastSelfUsageNs = nowNs;
+                    xmonitor::SelfUsageData& usage =
+                        state.snapshot.self[static_cast<std::size_t>(xmonitor::ProcessRole::Lifecycle)];
+                    if (state.selfUsage.sample(state.updatesIngested, binder.transactionCount(), usage)) {
+                        usage.trace.ingestNs = nowNs;
+                        ++state.generation;
+                    }
+                }
+
                 if (!binder.reply(code, &state.snapshot, sizeof(state.snapshot))) {
                     LOG_E("Lifecycle: snapshot reply failed");
                 }
                 break;
             }
-            case xmonitor::BinderTransactionCode::CpuUpdated: {
-                if (state.startGranted && payload != nullptr && payloadSize == sizeof(xmonitor::CpuData)) {
-                    state.snapshot.cpu = *reinterpret_cast<const xmonitor::CpuData*>(payload);
+            case xmonitor::BinderTransactionCode::QueryPercentiles: {
+                xmonitor::PercentileData data{};
+                percentiles.report(xmonitor::monotonicNowNs(), data);
+                if (!binder.reply(code, &data, sizeof(data))) {
+                    LOG_E("Lifecycle: percentile reply failed");
                 }
                 break;
             }
-            case xmonitor::BinderTransactionCode::RamUpdated: {
-                if (state.startGranted && payload != nullptr && payloadSize == sizeof(xmonitor::RamData)) {
-                    state.snapshot.ram = *reinterpret_cast<const xmonitor::RamData*>(payload);
+            case xmonitor::BinderTransactionCode::QueryFleet: {
+                xmonitor::FleetData fleet{};
+                if (federation != nullptr) {
+                    const std::uint32_t firstHost = payload != nullptr && payloadSize == sizeof(std::uint32_t)
+                                                        ? *reinterpret_cast<const std::uint32_t*>(payload)
+                                                        : 0;
+                    federation->fleet(firstHost, xmonitor::monotonicNowNs(), fleet);
+                }
+                if (!binder.reply(code, &fleet, sizeof(fleet))) {
+                    LOG_E("Lifecycle: fleet reply failed");
                 }
                 break;
             }
-            case xmonitor::BinderTransactionCode::MemoryUpdated: {
-                if (state.startGranted && payload != nullptr && payloadSize == sizeof(xmonitor::MemoryData)) {
-                    state.snapshot.memory = *reinterpret_cast<const xmonitor::MemoryData*>(payload);
+            case xmonitor::BinderTransactionCode::QueryHostSnapshot: {
+                const std::uint32_t hostId = payload != nullptr && payloadSize == sizeof(std::uint32_t)
+                                                 ? *reinterpret_cast<const std::uint32_t*>(payload)
+                                                 : 0;
+                bool replied = false;
+                if (federation != nullptr && federation->hostSnapshot(hostId, state.hostView)) {
+                    replied = binder.reply(code, &state.hostView, sizeof(state.hostView));
+                } else {
+                    xmonitor::BinderAck ack{};
+                    replied = binder.reply(code, &ack, sizeof(ack));
+                }
+                if (!replied) {
+                    LOG_E("Lifecycle: host snapshot reply failed");
                 }
                 break;
             }
             default:
                 break;
         }
+
+        const std::uint64_t nowNs = xmonitor::monotonicNowNs();
+        percentiles.sample(state.snapshot, nowNs);
+
+        if (alerts != nullptr) {
+            const bool ingested = state.generation != generationBefore;
+            bool alertsChanged = ingested && alerts->onUpdate(code, state.snapshot, nowNs);
+            alertsChanged = alerts->tick(nowNs) || alertsChanged;
+            if (alertsChanged) {
+                alerts->exportTo(state.snapshot.alerts);
+                state.snapshot.alerts.trace.sampleNs = nowNs;
+                state.snapshot.alerts.trace.ingestNs = nowNs;
+                ++state.generation;
+            }
+        }
+
+        if (exporter != nullptr) {
+            exporter->publish(state.snapshot, state.generation, nowNs);
+        }
+        if (uplink != nullptr) {
+            uplink->publish(state.snapshot, state.generation, nowNs);
+        }
     });
 
     std::thread loopThread([&]() {
@@ -113,6 +413,16 @@ int main() {
         loopThread.join();
     }
 
+    if (exporter != nullptr) {
+        exporter->stop();
+    }
+    if (uplink != nullptr) {
+        uplink->stop();
+    }
+    if (federation != nullptr) {
+        federation->stop();
+    }
+
     LOG_I("Lifecycle stop");
     return 0;
 }
@@ -0,0 +1,801 @@
+#include "lifecycle/MetricsExporter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+
+namespace xmonitor {
+
+namespace {
+// A full snapshot renders to roughly 60-100 KiB; start above that so the
+// buffer is allocated once.
+constexpr std::size_t kInitialBodyCapacity = 256 * 1024;
+constexpr std::size_t kTrailerCapacity = 2048;
+constexpr std::size_t kMaxConnections = 16;
+constexpr std::uint64_t kPublishIntervalNs = 100000000ull;
+constexpr std::uint64_t kConnectionTimeoutNs = 5000000000ull;
+constexpr int kPollTimeoutMs = 1000;
+
+constexpr const char* kContentType = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+constexpr const char kNotFoundBody[] = "only /metrics is served\n";
+constexpr const char kBadMethodBody[] = "only GET and HEAD are supported\n";
+
+const char* kRoleLabels[] = {
+    "app",
+    "lifecycle",
+    "cpu",
+    "ram",
+    "memory",
+    "disk",
+    "net",
+    "cgroup",
+    "thread",
+    "process",
+};
+static_assert(sizeof(kRoleLabels) / sizeof(kRoleLabels[0]) == kProcessRoleCount,
+              "kRoleLabels must name every ProcessRole");
+
+bool hasSample(const SampleTrace& trace) {
+    return trace.sampleNs != 0;
+}
+
+void renderCpu(const CpuData& cpu, OpenMetricsWriter& out) {
+    out.family("xmonitor_cpu_usage_percent", "gauge", "Share of CPU time per state over the last sample.");
+    out.gauge("xmonitor_cpu_usage_percent", {{"mode", "user"}}, cpu.userPercent);
+    out.gauge("xmonitor_cpu_usage_percent", {{"mode", "nice"}}, cpu.nicePercent);
+    out.gauge("xmonitor_cpu_usage_percent", {{"mode", "system"}}, cpu.systemPercent);
+    out.gauge("xmonitor_cpu_usage_percent", {{"mode", "idle"}}, cpu.idlePercent);
+    out.gauge("xmonitor_cpu_usage_percent", {{"mode", "iowait"}}, cpu.iowaitPercent);
+    out.gauge("xmonitor_cpu_usage_percent", {{"mode", "irq"}}, cpu.irqPercent);
+    out.gauge("xmonitor_cpu_usage_percent", {{"mode", "softirq"}}, cpu.softirqPercent);
+    out.gauge("xmonitor_cpu_usage_percent", {{"mode", "steal"}}, cpu.stealPercent);
+    out.gauge("xmonitor_cpu_usage_percent", {{"mode", "guest"}}, cpu.guestPercent);
+    out.gauge("xmonitor_cpu_usage_percent", {{"mode", "guest_nice"}}, cpu.guestNicePercent);
+    out.family("xmonitor_cpu_busy_percent", "gauge", "Non-idle CPU time over the last sample.");
+    out.gauge("xmonitor_cpu_busy_percent", cpu.usagePercent);
+}
+
+void renderRam(const RamData& ram, OpenMetricsWriter& out) {
+    out.family("xmonitor_memory_bytes", "gauge", "System memory from /proc/meminfo.");
+    out.gauge("xmonitor_memory_bytes", {{"kind", "total"}}, ram.totalBytes);
+    out.gauge("xmonitor_memory_bytes", {{"kind", "used"}}, ram.usedBytes);
+    out.gauge("xmonitor_memory_bytes", {{"kind", "available"}}, ram.availableBytes);
+    out.gauge("xmonitor_memory_bytes", {{"kind", "free"}}, ram.freeBytes);
+    out.gauge("xmonitor_memory_bytes", {{"kind", "buffers"}}, ram.buffersBytes);
+    out.gauge("xmonitor_memory_bytes", {{"kind", "cached"}}, ram.cachedBytes);
+    out.gauge("xmonitor_memory_bytes", {{"kind", "anon"}}, ram.anonBytes);
+    out.gauge("xmonitor_memory_bytes", {{"kind", "shmem"}}, ram.shmemBytes);
+    out.gauge("xmonitor_memory_bytes", {{"kind", "dirty"}}, ram.dirtyBytes);
+    out.gauge("xmonitor_memory_bytes", {{"kind", "writeback"}}, ram.writebackBytes);
+    out.gauge("xmonitor_memory_bytes", {{"kind", "slab"}}, ram.slabBytes);
+    out.gauge("xmonitor_memory_bytes", {{"kind", "committed"}}, ram.committedBytes);
+    out.gauge("xmonitor_memory_bytes", {{"kind", "commit_limit"}}, ram.commitLimitBytes);
+    out.family("xmonitor_swap_bytes", "gauge", "Swap space from /proc/meminfo.");
+    out.gauge("xmonitor_swap_bytes", {{"kind", "total"}}, ram.swapTotalBytes);
+    out.gauge("xmonitor_swap_bytes", {{"kind", "free"}}, ram.swapFreeBytes);
+    out.gauge("xmonitor_swap_bytes", {{"kind", "cached"}}, ram.swapCachedBytes);
+    out.family("xmonitor_vm_events_per_second", "gauge", "Paging rates from /proc/vmstat.");
+    out.gauge("xmonitor_vm_events_per_second", {{"event", "page_fault"}}, ram.pageFaultsPerSec);
+    out.gauge("xmonitor_vm_events_per_second", {{"event", "major_fault"}}, ram.majorFaultsPerSec);
+    out.gauge("xmonitor_vm_events_per_second", {{"event", "page_scanned"}}, ram.pagesScannedPerSec);
+    out.gauge("xmonitor_vm_events_per_second", {{"event", "page_stolen"}}, ram.pagesStolenPerSec);
+    out.gauge("xmonitor_vm_events_per_second", {{"event", "swap_in"}}, ram.swapInPagesPerSec);
+    out.gauge("xmonitor_vm_events_per_second", {{"event", "swap_out"}}, ram.swapOutPagesPerSec);
+    out.family("xmonitor_oom_kills", "counter", "OOM killer invocations since boot.");
+    out.counter("xmonitor_oom_kills", ram.oomKills);
+}
+
+void renderPressureResource(const char* resource, const PressureResource& pressure, OpenMetricsWriter& out) {
+    if (pressure.available == 0) {
+        return;
+    }
+    out.gauge("xmonitor_pressure_percent", {{"resource", resource}, {"kind", "some"}, {"window", "10s"}}, pressure.some.avg10);
+    out.gauge("xmonitor_pressure_percent", {{"resource", resource}, {"kind", "some"}, {"window", "60s"}}, pressure.some.avg60);
+    out.gauge("xmonitor_pressure_percent", {{"resource", resource}, {"kind", "some"}, {"window", "300s"}}, pressure.some.avg300);
+    out.gauge("xmonitor_pressure_percent", {{"resource", resource}, {"kind", "full"}, {"window", "10s"}}, pressure.full.avg10);
+    out.gauge("xmonitor_pressure_percent", {{"resource", resource}, {"kind", "full"}, {"window", "60s"}}, pressure.full.avg60);
+    out.gauge("xmonitor_pressure_percent", {{"resource", resource}, {"kind", "full"}, {"window", "300s"}}, pressure.full.avg300);
+}
+
+void renderPressureTotals(const char* resource, const PressureResource& pressure, OpenMetricsWriter& out) {
+    if (pressure.available == 0) {
+        return;
+    }
+    out.counter("xmonitor_pressure_stall_microseconds", {{"resource", resource}, {"kind", "some"}}, pressure.some.totalUs);
+    out.counter("xmonitor_pressure_stall_microseconds", {{"resource", resource}, {"kind", "full"}}, pressure.full.totalUs);
+}
+
+void renderPressure(const PressureData& pressure, OpenMetricsWriter& out) {
+    out.family("xmonitor_pressure_percent", "gauge", "PSI stall averages from /proc/pressure.");
+    renderPressureResource("cpu", pressure.cpu, out);
+    renderPressureResource("memory", pressure.memory, out);
+    renderPressureResource("io", pressure.io, out);
+    out.family("xmonitor_pressure_stall_microseconds", "counter", "Total PSI stall time.");
+    renderPressureTotals("cpu", pressure.cpu, out);
+    renderPressureTotals("memory", pressure.memory, out);
+    renderPressureTotals("io", pressure.io, out);
+}
+
+void renderInterrupts(const InterruptData& interrupts, OpenMetricsWriter& out) {
+    out.family("xmonitor_load_average", "gauge", "Run-queue load average from /proc/loadavg.");
+    out.gauge("xmonitor_load_average", {{"window", "1m"}}, interrupts.load1);
+    out.gauge("xmonitor_load_average", {{"window", "5m"}}, interrupts.load5);
+    out.gauge("xmonitor_load_average", {{"window", "15m"}}, interrupts.load15);
+    out.family("xmonitor_procs", "gauge", "Tasks running and blocked on I/O from /proc/stat.");
+    out.gauge("xmonitor_procs", {{"state", "running"}}, static_cast<std::uint64_t>(interrupts.procsRunning));
+    out.gauge("xmonitor_procs", {{"state", "blocked"}}, static_cast<std::uint64_t>(interrupts.procsBlocked));
+    out.family("xmonitor_interrupts_per_second", "gauge", "Hardware interrupts per second, all CPUs.");
+    out.gauge("xmonitor_interrupts_per_second", interrupts.interruptsPerSec);
+    out.family("xmonitor_softirqs_per_second", "gauge", "Softirqs per second by type.");
+    for (std::uint32_t i = 0; i < interrupts.softirqCount && i < kMaxSoftirqTypes; ++i) {
+        out.gauge("xmonitor_softirqs_per_second", {{"type", interrupts.softirqs[i].name}}, interrupts.softirqs[i].perSec);
+    }
+}
+
+void renderTopology(const TopologyData& topology, OpenMetricsWriter& out) {
+    char cpu[16];
+    char node[16];
+    out.family("xmonitor_core_usage_percent", "gauge", "Per-CPU busy time over the last second.");
+    for (std::uint32_t i = 0; i < topology.cpuCount && i < kMaxTopologyCpus; ++i) {
+        const CoreStats& core = topology.cores[i];
+        std::snprintf(cpu, sizeof(cpu), "%u", core.cpu);
+        std::snprintf(node, sizeof(node), "%u", core.node);
+        out.gauge("xmonitor_core_usage_percent", {{"cpu", cpu}, {"node", node}}, core.usagePercent);
+    }
+    out.family("xmonitor_core_frequency_mhz", "gauge", "Current per-CPU frequency from cpufreq.");
+    for (std::uint32_t i = 0; i < topology.cpuCount && i < kMaxTopologyCpus; ++i) {
+        const CoreStats& core = topology.cores[i];
+        if (core.frequencyMhz == 0) {
+            continue;
+        }
+        std::snprintf(cpu, sizeof(cpu), "%u", core.cpu);
+        std::snprintf(node, sizeof(node), "%u", core.node);
+        out.gauge("xmonitor_core_frequency_mhz", {{"cpu", cpu}, {"node", node}}, static_cast<std::uint64_t>(core.frequencyMhz));
+    }
+    out.family("xmonitor_numa_memory_free_bytes", "gauge", "Free memory per NUMA node.");
+    for (std::uint32_t i = 0; i < topology.nodeCount && i < kMaxNumaNodes; ++i) {
+        std::snprintf(node, sizeof(node), "%u", topology.nodes[i].node);
+        out.gauge("xmonitor_numa_memory_free_bytes", {{"node", node}}, topology.nodes[i].memFreeBytes);
+    }
+    out.family("xmonitor_numa_allocations_per_second", "gauge", "Page allocations per second per NUMA node.");
+    for (std::uint32_t i = 0; i < topology.nodeCount && i < kMaxNumaNodes; ++i) {
+        const NumaNodeStats& stats = topology.nodes[i];
+        std::snprintf(node, sizeof(node), "%u", stats.node);
+        out.gauge("xmonitor_numa_allocations_per_second", {{"node", node}, {"kind", "local"}}, stats.localAllocsPerSec);
+        out.gauge("xmonitor_numa_allocations_per_second", {{"node", node}, {"kind", "remote"}}, stats.remoteAllocsPerSec);
+    }
+}
+
+void renderDisk(const DiskData& disk, OpenMetricsWriter& out) {
+    out.family("xmonitor_disk_ops_per_second", "gauge", "Completed I/O requests per second.");
+    for (std::uint32_t i = 0; i < disk.deviceCount && i < kMaxDiskDevices; ++i) {
+        const DiskDeviceStats& device = disk.devices[i];
+        out.gauge("xmonitor_disk_ops_per_second", {{"device", device.name}, {"op", "read"}}, device.readsPerSec);
+        out.gauge("xmonitor_disk_ops_per_second", {{"device", device.name}, {"op", "write"}}, device.writesPerSec);
+    }
+    out.family("xmonitor_disk_bytes_per_second", "gauge", "Bytes transferred per second.");
+    for (std::uint32_t i = 0; i < disk.deviceCount && i < kMaxDiskDevices; ++i) {
+        const DiskDeviceStats& device = disk.devices[i];
+        out.gauge("xmonitor_disk_bytes_per_second", {{"device", device.name}, {"op", "read"}}, device.readBytesPerSec);
+        out.gauge("xmonitor_disk_bytes_per_second", {{"device", device.name}, {"op", "write"}}, device.writeBytesPerSec);
+    }
+    out.family("xmonitor_disk_await_milliseconds", "gauge", "Average time per completed request.");
+    for (std::uint32_t i = 0; i < disk.deviceCount && i < kMaxDiskDevices; ++i) {
+        const DiskDeviceStats& device = disk.devices[i];
+        out.gauge("xmonitor_disk_await_milliseconds", {{"device", device.name}, {"op", "read"}}, device.readAwaitMs);
+        out.gauge("xmonitor_disk_await_milliseconds", {{"device", device.name}, {"op", "write"}}, device.writeAwaitMs);
+    }
+    out.family("xmonitor_disk_utilization_percent", "gauge", "Time the device had I/O in flight.");
+    for (std::uint32_t i = 0; i < disk.deviceCount && i < kMaxDiskDevices; ++i) {
+        out.gauge("xmonitor_disk_utilization_percent", {{"device", disk.devices[i].name}}, disk.devices[i].utilizationPercent);
+    }
+}
+
+void renderFilesystems(const FilesystemData& filesystems, OpenMetricsWriter& out) {
+    out.family("xmonitor_filesystem_size_bytes", "gauge", "Filesystem size from statvfs.");
+    for (std::uint32_t i = 0; i < filesystems.filesystemCount && i < kMaxFilesystems; ++i) {
+        const FilesystemStats& fs = filesystems.filesystems[i];
+        if (fs.state == FS_STATE_OK) {
+            out.gauge("xmonitor_filesystem_size_bytes",
+                      {{"mountpoint", fs.mountPoint}, {"fstype", fs.fsType}, {"device", fs.source}},
+                      fs.totalBytes);
+        }
+    }
+    out.family("xmonitor_filesystem_avail_bytes", "gauge", "Space available to unprivileged users.");
+    for (std::uint32_t i = 0; i < filesystems.filesystemCount && i < kMaxFilesystems; ++i) {
+        const FilesystemStats& fs = filesystems.filesystems[i];
+        if (fs.state == FS_STATE_OK) {
+            out.gauge("xmonitor_filesystem_avail_bytes",
+                      {{"mountpoint", fs.mountPoint}, {"fstype", fs.fsType}, {"device", fs.source}},
+                      fs.availableBytes);
+        }
+    }
+    out.family("xmonitor_filesystem_inodes_used_percent", "gauge", "Share of inodes in use.");
+    for (std::uint32_t i = 0; i < filesystems.filesystemCount && i < kMaxFilesystems; ++i) {
+        const FilesystemStats& fs = filesystems.filesystems[i];
+        if (fs.state == FS_STATE_OK) {
+            out.gauge("xmonitor_filesystem_inodes_used_percent",
+                      {{"mountpoint", fs.mountPoint}, {"fstype", fs.fsType}, {"device", fs.source}},
+                      fs.inodeUsedPercent);
+        }
+    }
+    out.family("xmonitor_filesystem_hung", "gauge", "1 while statvfs on the mount is timing out.");
+    for (std::uint32_t i = 0; i < filesystems.filesystemCount && i < kMaxFilesystems; ++i) {
+        const FilesystemStats& fs = filesystems.filesystems[i];
+        out.gauge("xmonitor_filesystem_hung",
+                  {{"mountpoint", fs.mountPoint}, {"fstype", fs.fsType}, {"device", fs.source}},
+                  static_cast<std::uint64_t>(fs.state == FS_STATE_HUNG ? 1 : 0));
+    }
+}
+
+void renderNet(const NetData& net, OpenMetricsWriter& out) {
+    out.family("xmonitor_net_bytes_per_second", "gauge", "Interface throughput.");
+    for (std::uint32_t i = 0; i < net.interfaceCount && i < kMaxNetInterfaces; ++i) {
+        const NetInterfaceStats& nic = net.interfaces[i];
+        out.gauge("xmonitor_net_bytes_per_second", {{"interface", nic.name}, {"direction", "rx"}}, nic.rxBytesPerSec);
+        out.gauge("xmonitor_net_bytes_per_second", {{"interface", nic.name}, {"direction", "tx"}}, nic.txBytesPerSec);
+    }
+    out.family("xmonitor_net_packets_per_second", "gauge", "Interface packet rate.");
+    for (std::uint32_t i = 0; i < net.interfaceCount && i < kMaxNetInterfaces; ++i) {
+        const NetInterfaceStats& nic = net.interfaces[i];
+        out.gauge("xmonitor_net_packets_per_second", {{"interface", nic.name}, {"direction", "rx"}}, nic.rxPacketsPerSec);
+        out.gauge("xmonitor_net_packets_per_second", {{"interface", nic.name}, {"direction", "tx"}}, nic.txPacketsPerSec);
+    }
+    out.family("xmonitor_net_drops_per_second", "gauge", "Interface drops plus errors.");
+    for (std::uint32_t i = 0; i < net.interfaceCount && i < kMaxNetInterfaces; ++i) {
+        const NetInterfaceStats& nic = net.interfaces[i];
+        out.gauge("xmonitor_net_drops_per_second", {{"interface", nic.name}, {"direction", "rx"}},
+                  nic.rxDropsPerSec + nic.rxErrorsPerSec);
+        out.gauge("xmonitor_net_drops_per_second", {{"interface", nic.name}, {"direction", "tx"}},
+                  nic.txDropsPerSec + nic.txErrorsPerSec);
+    }
+    out.family("xmonitor_tcp_established", "gauge", "Currently established TCP connections.");
+    out.gauge("xmonitor_tcp_established", {}, net.tcp.currentEstablished);
+    out.family("xmonitor_tcp_retransmit_percent", "gauge", "Retransmitted share of sent TCP segments.");
+    out.gauge("xmonitor_tcp_retransmit_percent", net.tcp.retransPercent);
+    out.family("xmonitor_tcp_events_per_second", "gauge", "TCP error and overflow rates.");
+    out.gauge("xmonitor_tcp_events_per_second", {{"event", "out_reset"}}, net.tcp.outResetsPerSec);
+    out.gauge("xmonitor_tcp_events_per_second", {{"event", "established_reset"}}, net.tcp.establishedResetsPerSec);
+    out.gauge("xmonitor_tcp_events_per_second", {{"event", "attempt_fail"}}, net.tcp.attemptFailsPerSec);
+    out.gauge("xmonitor_tcp_events_per_second", {{"event", "listen_overflow"}}, net.tcp.listenOverflowsPerSec);
+    out.gauge("xmonitor_tcp_events_per_second", {{"event", "listen_drop"}}, net.tcp.listenDropsPerSec);
+    out.gauge("xmonitor_tcp_events_per_second", {{"event", "timeout"}}, net.tcp.timeoutsPerSec);
+}
+
+void renderCgroups(const CgroupData& cgroups, OpenMetricsWriter& out) {
+    out.family("xmonitor_cgroup_cpu_percent", "gauge", "Cgroup CPU usage, 100 per fully used CPU.");
+    for (std::uint32_t i = 0; i < cgroups.cgroupCount && i < kMaxCgroups; ++i) {
+        out.gauge("xmonitor_cgroup_cpu_percent", {{"cgroup", cgroups.cgroups[i].path}}, cgroups.cgroups[i].cpuPercent);
+    }
+    out.family("xmonitor_cgroup_memory_bytes", "gauge", "Cgroup memory.current.");
+    for (std::uint32_t i = 0; i < cgroups.cgroupCount && i < kMaxCgroups; ++i) {
+        out.gauge("xmonitor_cgroup_memory_bytes", {{"cgroup", cgroups.cgroups[i].path}}, cgroups.cgroups[i].memoryCurrentBytes);
+    }
+    out.family("xmonitor_cgroup_io_bytes_per_second", "gauge", "Cgroup block I/O throughput.");
+    for (std::uint32_t i = 0; i < cgroups.cgroupCount && i < kMaxCgroups; ++i) {
+        const CgroupStats& cgroup = cgroups.cgroups[i];
+        out.gauge("xmonitor_cgroup_io_bytes_per_second", {{"cgroup", cgroup.path}, {"op", "read"}}, cgroup.ioReadBytesPerSec);
+        out.gauge("xmonitor_cgroup_io_bytes_per_second", {{"cgroup", cgroup.path}, {"op", "write"}}, cgroup.ioWriteBytesPerSec);
+    }
+}
+
+void renderProcesses(const ProcessData& processes, OpenMetricsWriter& out) {
+    out.family("xmonitor_process_count", "gauge", "Processes in the system-wide table.");
+    out.gauge("xmonitor_process_count", {}, static_cast<std::uint64_t>(processes.totalProcesses));
+    out.family("xmonitor_process_events_per_second", "gauge", "Process fork/exec/exit rates.");
+    out.gauge("xmonitor_process_events_per_second", {{"event", "fork"}}, processes.forksPerSec);
+    out.gauge("xmonitor_process_events_per_second", {{"event", "exec"}}, processes.execsPerSec);
+    out.gauge("xmonitor_process_events_per_second", {{"event", "exit"}}, processes.exitsPerSec);
+    out.family("xmonitor_process_short_lived", "counter", "Processes that exited before they were sampled.");
+    out.counter("xmonitor_process_short_lived", processes.shortLivedProcesses);
+}
+
+void renderAlerts(const AlertData& alerts, OpenMetricsWriter& out) {
+    out.family("xmonitor_alerts_firing", "gauge", "Alert rules currently firing.");
+    out.gauge("xmonitor_alerts_firing", {}, static_cast<std::uint64_t>(alerts.firingCount));
+    out.family("xmonitor_alert_state", "gauge", "1 pending, 2 firing, per active alert rule.");
+    for (std::uint32_t i = 0; i < alerts.alertCount && i < kMaxAlerts; ++i) {
+        out.gauge("xmonitor_alert_state",
+                  {{"alert", alerts.alerts[i].name}, {"metric", alerts.alerts[i].metric}},
+                  static_cast<std::uint64_t>(alerts.alerts[i].state));
+    }
+}
+
+void renderSelfUsage(const SelfUsageData* self, OpenMetricsWriter& out) {
+    out.family("xmonitor_self_cpu_percent", "gauge", "CPU used by each xMonitor process.");
+    for (std::size_t role = 0; role < kProcessRoleCount; ++role) {
+        if (self[role].pid != 0) {
+            out.gauge("xmonitor_self_cpu_percent", {{"process", kRoleLabels[role]}}, self[role].cpuPercent);
+        }
+    }
+    out.family("xmonitor_self_rss_bytes", "gauge", "Resident memory of each xMonitor process.");
+    for (std::size_t role = 0; role < kProcessRoleCount; ++role) {
+        if (self[role].pid != 0) {
+            out.gauge("xmonitor_self_rss_bytes", {{"process", kRoleLabels[role]}}, self[role].rssBytes);
+        }
+    }
+    out.family("xmonitor_self_sends_coalesced", "counter", "Updates replaced by a newer one before the async sender delivered them.");
+    for (std::size_t role = 0; role < kProcessRoleCount; ++role) {
+        if (self[role].pid != 0) {
+            out.counter("xmonitor_self_sends_coalesced", {{"process", kRoleLabels[role]}}, self[role].sendsCoalesced);
+        }
+    }
+    out.family("xmonitor_self_sends_dropped", "counter", "Updates the async sender could not deliver.");
+    for (std::size_t role = 0; role < kProcessRoleCount; ++role) {
+        if (self[role].pid != 0) {
+            out.counter("xmonitor_self_sends_dropped", {{"process", kRoleLabels[role]}}, self[role].sendsDropped);
+        }
+    }
+    out.family("xmonitor_self_wakeup_latency_us", "gauge", "How late each service's sampling tick woke up, over the last report window.");
+    for (std::size_t role = 0; role < kProcessRoleCount; ++role) {
+        if (self[role].pid != 0 && self[role].wakeupMaxUs != 0.0) {
+            out.gauge("xmonitor_self_wakeup_latency_us", {{"process", kRoleLabels[role]}, {"quantile", "0.5"}}, self[role].wakeupP50Us);
+            out.gauge("xmonitor_self_wakeup_latency_us", {{"process", kRoleLabels[role]}, {"quantile", "0.99"}}, self[role].wakeupP99Us);
+            out.gauge("xmonitor_self_wakeup_latency_us", {{"process", kRoleLabels[role]}, {"quantile", "1"}}, self[role].wakeupMaxUs);
+        }
+    }
+    out.family("xmonitor_self_wakeup_jitter_us", "gauge", "Standard deviation of the sampling tick wakeup latency.");
+    for (std::size_t role = 0; role < kProcessRoleCount; ++role) {
+        if (self[role].pid != 0 && self[role].wakeupMaxUs != 0.0) {
+            out.gauge("xmonitor_self_wakeup_jitter_us", {{"process", kRoleLabels[role]}}, self[role].wakeupJitterUs);
+        }
+    }
+}
+}
+
+MetricsExporter::MetricsExporter(const Options& options)
+    : mOptions(options),
+      mListenFd(-1),
+      mWakeFd(-1),
+      mRunning(false),
+      mPublishedGeneration(0),
+      mLastPublishNs(0),
+      mStagingGeneration(0),
+      mPublishContended(0),
+      mRenderedGeneration(0),
+      mBody(kInitialBodyCapacity),
+      mTrailer(kTrailerCapacity),
+      mScrapes(0),
+      mRenders(0),
+      mRejectedConnections(0) {
+    mConnections.reserve(kMaxConnections);
+}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+bool MetricsExporter::start() {
+    if (!openListener()) {
+        return false;
+    }
+
+    mWakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mWakeFd < 0) {
+        LOG_E("Metrics exporter: eventfd failed errno=%d", errno);
+        ::close(mListenFd);
+        mListenFd = -1;
+        return false;
+    }
+
+    mRunning.store(true);
+    mThread = std::thread([this]() {
+        run();
+    });
+    return true;
+}
+
+void MetricsExporter::stop() {
+    if (mRunning.exchange(false)) {
+        const std::uint64_t one = 1;
+        if (::write(mWakeFd, &one, sizeof(one)) < 0) {
+            LOG_W("Metrics exporter: wake failed errno=%d", errno);
+        }
+    }
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+
+    for (Connection& connection : mConnections) {
+        closeConnection(connection);
+    }
+    mConnections.clear();
+
+    if (mListenFd >= 0) {
+        ::close(mListenFd);
+        mListenFd = -1;
+        if (!mOptions.socketPath.empty()) {
+            ::unlink(mOptions.socketPath.c_str());
+        }
+    }
+    if (mWakeFd >= 0) {
+        ::close(mWakeFd);
+        mWakeFd = -1;
+    }
+}
+
+void MetricsExporter::publish(const BinderSnapshot& snapshot, std::uint64_t generation, std::uint64_t nowNs) {
+    if (generation == mPublishedGeneration) {
+        return;
+    }
+    // Scrapes come every few seconds; copying 40+ KiB on every ingest would
+    // cost the binder thread far more than any scraper can observe.
+    if (mLastPublishNs != 0 && nowNs - mLastPublishNs < kPublishIntervalNs) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mStagingMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        mPublishContended.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    mStaging = snapshot;
+    mStagingGeneration = generation;
+    mPublishedGeneration = generation;
+    mLastPublishNs = nowNs;
+}
+
+bool MetricsExporter::openListener() {
+    if (!mOptions.socketPath.empty()) {
+        sockaddr_un address{};
+        if (mOptions.socketPath.size() >= sizeof(address.sun_path)) {
+            LOG_E("Metrics exporter: socket path too long: %s", mOptions.socketPath.c_str());
+            return false;
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, mOptions.socketPath.c_str(), mOptions.socketPath.size() + 1);
+
+        mListenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (mListenFd < 0) {
+            LOG_E("Metrics exporter: socket failed errno=%d", errno);
+            return false;
+        }
+        // A previous lifecycle that was killed leaves its socket file behind.
+        ::unlink(mOptions.socketPath.c_str());
+        if (::bind(mListenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            LOG_E("Metrics exporter: bind %s failed errno=%d", mOptions.socketPath.c_str(), errno);
+            ::close(mListenFd);
+            mListenFd = -1;
+            return false;
+        }
+    } else {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(mOptions.port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        mListenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (mListenFd < 0) {
+            LOG_E("Metrics exporter: socket failed errno=%d", errno);
+            return false;
+        }
+        const int reuse = 1;
+        ::setsockopt(mListenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (::bind(mListenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            LOG_E("Metrics exporter: bind 127.0.0.1:%u failed errno=%d", mOptions.port, errno);
+            ::close(mListenFd);
+            mListenFd = -1;
+            return false;
+        }
+    }
+
+    if (::listen(mListenFd, static_cast<int>(kMaxConnections)) != 0) {
+        LOG_E("Metrics exporter: listen failed errno=%d", errno);
+        ::close(mListenFd);
+        mListenFd = -1;
+        return false;
+    }
+
+    if (mOptions.socketPath.empty()) {
+        LOG_I("Metrics exporter: serving http://127.0.0.1:%u/metrics", mOptions.port);
+    } else {
+        LOG_I("Metrics exporter: serving /metrics on %s", mOptions.socketPath.c_str());
+    }
+    return true;
+}
+
+void MetricsExporter::run() {
+    std::vector<pollfd> fds;
+    fds.reserve(kMaxConnections + 2);
+
+    while (mRunning.load()) {
+        fds.clear();
+        fds.push_back(pollfd{mWakeFd, POLLIN, 0});
+        fds.push_back(pollfd{mListenFd, POLLIN, 0});
+        for (const Connection& connection : mConnections) {
+            fds.push_back(pollfd{connection.fd, static_cast<short>(connection.responding ? POLLOUT : POLLIN), 0});
+        }
+
+        const int ready = ::poll(fds.data(), fds.size(), kPollTimeoutMs);
+        if (ready < 0 && errno != EINTR) {
+            LOG_E("Metrics exporter: poll failed errno=%d", errno);
+            break;
+        }
+
+        // Connections accepted below are polled from the next round on.
+        const std::size_t polledConnections = fds.size() - 2;
+        const std::uint64_t nowNs = monotonicNowNs();
+        for (std::size_t i = 0; i < polledConnections; ++i) {
+            Connection& connection = mConnections[i];
+            const short revents = fds[i + 2].revents;
+
+            bool keep = true;
+            if ((revents & POLLNVAL) != 0) {
+                keep = false;
+            } else if (!connection.responding && (revents & (POLLIN | POLLHUP | POLLERR)) != 0) {
+                keep = readRequest(connection);
+                if (keep && connection.responding) {
+                    keep = writeResponse(connection);
+                }
+            } else if (connection.responding && (revents & (POLLOUT | POLLHUP | POLLERR)) != 0) {
+                keep = writeResponse(connection);
+            }
+
+            if (keep && nowNs - connection.acceptedNs > kConnectionTimeoutNs) {
+                keep = false;
+            }
+            if (!keep) {
+                closeConnection(connection);
+            }
+        }
+
+        mConnections.erase(std::remove_if(mConnections.begin(),
+                                          mConnections.end(),
+                                          [](const Connection& connection) { return connection.fd < 0; }),
+                           mConnections.end());
+
+        if ((fds[1].revents & POLLIN) != 0) {
+            acceptConnections();
+        }
+        if ((fds[0].revents & POLLIN) != 0) {
+            std::uint64_t drained = 0;
+            (void)!::read(mWakeFd, &drained, sizeof(drained));
+        }
+    }
+}
+
+void MetricsExporter::acceptConnections() {
+    while (true) {
+        const int fd = ::accept4(mListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                LOG_W("Metrics exporter: accept failed errno=%d", errno);
+            }
+            return;
+        }
+        if (mConnections.size() >= kMaxConnections) {
+            ++mRejectedConnections;
+            ::close(fd);
+            continue;
+        }
+
+        mConnections.emplace_back();
+        Connection& connection = mConnections.back();
+        connection.fd = fd;
+        connection.acceptedNs = monotonicNowNs();
+    }
+}
+
+// Returns false when the connection should be closed.
+bool MetricsExporter::readRequest(Connection& connection) {
+    const std::size_t room = sizeof(connection.request) - 1 - connection.requestLength;
+    if (room == 0) {
+        return false;
+    }
+
+    const ssize_t received = ::recv(connection.fd, connection.request + connection.requestLength, room, 0);
+    if (received == 0) {
+        return false;
+    }
+    if (received < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+
+    connection.requestLength += static_cast<std::size_t>(received);
+    connection.request[connection.requestLength] = '\0';
+    if (std::strstr(connection.request, "\r\n\r\n") == nullptr &&
+        std::strstr(connection.request, "\n\n") == nullptr) {
+        return true;
+    }
+
+    prepareResponse(connection);
+    return true;
+}
+
+void MetricsExporter::prepareResponse(Connection& connection) {
+    const char* request = connection.request;
+    bool head = false;
+    const char* path = nullptr;
+    if (std::strncmp(request, "GET ", 4) == 0) {
+        path = request + 4;
+    } else if (std::strncmp(request, "HEAD ", 5) == 0) {
+        path = request + 5;
+        head = true;
+    }
+
+    const char* status = "200 OK";
+    const char* contentType = kContentType;
+    connection.trailer.clear();
+    if (path == nullptr) {
+        status = "405 Method Not Allowed";
+        contentType = "text/plain";
+        connection.body = kBadMethodBody;
+        connection.bodyLength = sizeof(kBadMethodBody) - 1;
+    } else if (std::strcspn(path, " ?\r\n") != 8 || std::strncmp(path, "/metrics", 8) != 0) {
+        status = "404 Not Found";
+        contentType = "text/plain";
+        connection.body = kNotFoundBody;
+        connection.bodyLength = sizeof(kNotFoundBody) - 1;
+    } else {
+        ++mScrapes;
+        // The body is shared by every connection still sending, so it is
+        // only re-rendered when none is mid-response.
+        const bool bodyInUse = std::any_of(mConnections.begin(), mConnections.end(), [](const Connection& other) {
+            return other.responding;
+        });
+        if (!bodyInUse) {
+            refreshBody();
+        }
+        connection.body = mBody.data();
+        connection.bodyLength = mBody.size();
+        renderTrailer(connection.trailer);
+    }
+
+    char header[256];
+    const int headerLength = std::snprintf(header,
+                                           sizeof(header),
+                                           "HTTP/1.1 %s\r\n"
+                                           "Content-Type: %s\r\n"
+                                           "Content-Length: %zu\r\n"
+                                           "Connection: close\r\n"
+                                           "\r\n",
+                                           status,
+                                           contentType,
+                                           connection.bodyLength + connection.trailer.size());
+    connection.header.assign(header, static_cast<std::size_t>(headerLength));
+    if (head) {
+        connection.bodyLength = 0;
+        connection.trailer.clear();
+    }
+    connection.responding = true;
+    connection.sent = 0;
+}
+
+// Sends header, body and trailer as one gathered write. Returns false once
+// the response is complete or the peer went away.
+bool MetricsExporter::writeResponse(Connection& connection) {
+    const iovec parts[3] = {
+        {const_cast<char*>(connection.header.data()), connection.header.size()},
+        {const_cast<char*>(connection.body), connection.bodyLength},
+        {const_cast<char*>(connection.trailer.data()), connection.trailer.size()},
+    };
+    const std::size_t total = connection.header.size() + connection.bodyLength + connection.trailer.size();
+
+    iovec pending[3];
+    std::size_t pendingCount = 0;
+    std::size_t skip = connection.sent;
+    for (const iovec& part : parts) {
+        if (skip >= part.iov_len) {
+            skip -= part.iov_len;
+            continue;
+        }
+        pending[pendingCount].iov_base = static_cast<char*>(part.iov_base) + skip;
+        pending[pendingCount].iov_len = part.iov_len - skip;
+        ++pendingCount;
+        skip = 0;
+    }
+
+    msghdr message{};
+    message.msg_iov = pending;
+    message.msg_iovlen = pendingCount;
+    const ssize_t written = ::sendmsg(connection.fd, &message, MSG_NOSIGNAL);
+    if (written < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+
+    connection.sent += static_cast<std::size_t>(written);
+    return connection.sent < total;
+}
+
+void MetricsExporter::closeConnection(Connection& connection) {
+    if (connection.fd >= 0) {
+        ::close(connection.fd);
+        connection.fd = -1;
+    }
+    connection.responding = false;
+}
+
+void MetricsExporter::refreshBody() {
+    std::uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(mStagingMutex);
+        generation = mStagingGeneration;
+        if (generation == mRenderedGeneration && mRenders != 0) {
+            return;
+        }
+        mRendered = mStaging;
+    }
+    render(generation);
+}
+
+void MetricsExporter::render(std::uint64_t generation) {
+    mBody.clear();
+    mBody.family("xmonitor_snapshot_generation", "gauge", "Lifecycle snapshot generation this body was rendered from.");
+    mBody.gauge("xmonitor_snapshot_generation", {}, generation);
+
+    const BinderSnapshot& snapshot = mRendered;
+    if (hasSample(snapshot.cpu.trace)) {
+        renderCpu(snapshot.cpu, mBody);
+    }
+    if (hasSample(snapshot.ram.trace)) {
+        renderRam(snapshot.ram, mBody);
+    }
+    if (hasSample(snapshot.pressure.trace)) {
+        renderPressure(snapshot.pressure, mBody);
+    }
+    if (hasSample(snapshot.interrupts.trace)) {
+        renderInterrupts(snapshot.interrupts, mBody);
+    }
+    if (hasSample(snapshot.topology.trace)) {
+        renderTopology(snapshot.topology, mBody);
+    }
+    if (hasSample(snapshot.disk.trace)) {
+        renderDisk(snapshot.disk, mBody);
+    }
+    if (hasSample(snapshot.filesystems.trace)) {
+        renderFilesystems(snapshot.filesystems, mBody);
+    }
+    if (hasSample(snapshot.net.trace)) {
+        renderNet(snapshot.net, mBody);
+    }
+    if (hasSample(snapshot.cgroup.trace)) {
+        renderCgroups(snapshot.cgroup, mBody);
+    }
+    if (hasSample(snapshot.process.trace)) {
+        renderProcesses(snapshot.process, mBody);
+    }
+    if (hasSample(snapshot.alerts.trace)) {
+        renderAlerts(snapshot.alerts, mBody);
+    }
+    renderSelfUsage(snapshot.self, mBody);
+
+    mRenderedGeneration = generation;
+    ++mRenders;
+}
+
+// Exporter counters change on every scrape, so they go into a small
+// per-response trailer instead of invalidating the cached body.
+void MetricsExporter::renderTrailer(std::string& outTrailer) {
+    mTrailer.clear();
+    mTrailer.family("xmonitor_exporter_scrapes", "counter", "Requests for /metrics.");
+    mTrailer.counter("xmonitor_exporter_scrapes", mScrapes);
+    mTrailer.family("xmonitor_exporter_renders", "counter", "Times the body was re-rendered.");
+    mTrailer.counter("xmonitor_exporter_renders", mRenders);
+    mTrailer.family("xmonitor_exporter_publish_contended",
+                    "counter",
+                    "Snapshot hand-overs the binder thread skipped because a scrape held the lock.");
+    mTrailer.counter("xmonitor_exporter_publish_contended", mPublishContended.load(std::memory_order_relaxed));
+    mTrailer.family("xmonitor_exporter_rejected_connections",
+                    "counter",
+                    "Connections closed because the connection limit was reached.");
+    mTrailer.counter("xmonitor_exporter_rejected_connections", mRejectedConnections);
+    mTrailer.family("xmonitor_exporter_buffer_bytes", "gauge", "Capacity of the reused body buffer.");
+    mTrailer.gauge("xmonitor_exporter_buffer_bytes", {}, static_cast<std::uint64_t>(mBody.capacity()));
+    mTrailer.finish();
+    outTrailer.assign(mTrailer.data(), mTrailer.size());
+}
+
+} // namespace xmonitor
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ipc/BinderProtocol.h"
+#include "lifecycle/OpenMetricsWriter.h"
+
+namespace xmonitor {
+
+// Serves the lifecycle snapshot as OpenMetrics text on GET /metrics, over
+// TCP on 127.0.0.1:<port> or on a Unix socket. The binder loop hands over
+// snapshot copies with publish(), which only try_locks, so a scrape in
+// progress never stalls the binder thread; the exporter thread then renders
+// into a reused buffer, and only when the snapshot generation has changed.
+class MetricsExporter {
+public:
+    struct Options {
+        std::uint16_t port{9477};
+        // When set, listen on this Unix socket path instead of TCP.
+        std::string socketPath;
+    };
+
+    explicit MetricsExporter(const Options& options);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    bool start();
+    void stop();
+
+    // Binder thread only. Copies the snapshot into the staging slot at most
+    // every kPublishIntervalNs; a contended or skipped hand-over stays
+    // pending and is retried on the next call.
+    void publish(const BinderSnapshot& snapshot, std::uint64_t generation, std::uint64_t nowNs);
+
+private:
+    struct Connection {
+        int fd{-1};
+        std::size_t requestLength{0};
+        char request[2048]{};
+        // Response: header, then the shared body (mBody or a static error
+        // text), then a per-response trailer.
+        std::string header;
+        const char* body{nullptr};
+        std::size_t bodyLength{0};
+        std::string trailer;
+        std::size_t sent{0};
+        bool responding{false};
+        std::uint64_t acceptedNs{0};
+    };
+
+    bool openListener();
+    void run();
+    void acceptConnections();
+    bool readRequest(Connection& connection);
+    void prepareResponse(Connection& connection);
+    bool writeResponse(Connection& connection);
+    void closeConnection(Connection& connection);
+    void refreshBody();
+    void render(std::uint64_t generation);
+    void renderTrailer(std::string& outTrailer);
+
+    Options mOptions;
+    int mListenFd;
+    int mWakeFd;
+    std::thread mThread;
+    std::atomic<bool> mRunning;
+
+    // Binder-thread side of the hand-over.
+    std::uint64_t mPublishedGeneration;
+    std::uint64_t mLastPublishNs;
+
+    std::mutex mStagingMutex;
+    BinderSnapshot mStaging{};
+    std::uint64_t mStagingGeneration;
+    std::atomic<std::uint64_t> mPublishContended;
+
+    // Exporter-thread state.
+    BinderSnapshot mRendered{};
+    std::uint64_t mRenderedGeneration;
+    OpenMetricsWriter mBody;
+    OpenMetricsWriter mTrailer;
+    std::vector<Connection> mConnections;
+    std::uint64_t mScrapes;
+    std::uint64_t mRenders;
+    std::uint64_t mRejectedConnections;
+};
+
+} // namespace xmonitor
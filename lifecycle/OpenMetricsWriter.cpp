@@ -0,0 +1,170 @@
+#include "lifecycle/OpenMetricsWriter.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace xmonitor {
+
+namespace {
+// Longest formatted number: "%.17g" of a double or a 20-digit uint64.
+constexpr std::size_t kNumberLength = 32;
+}
+
+OpenMetricsWriter::OpenMetricsWriter(std::size_t initialCapacity)
+    : mBuffer(initialCapacity), mSize(0) {
+}
+
+void OpenMetricsWriter::clear() {
+    mSize = 0;
+}
+
+void OpenMetricsWriter::family(const char* name, const char* type, const char* help) {
+    append("# TYPE ");
+    append(name);
+    append(" ");
+    append(type);
+    append("\n# HELP ");
+    append(name);
+    append(" ");
+    append(help);
+    append("\n");
+}
+
+void OpenMetricsWriter::gauge(const char* name, double value) {
+    gauge(name, {}, value);
+}
+
+void OpenMetricsWriter::gauge(const char* name, std::initializer_list<Label> labels, double value) {
+    appendName(name, "", labels);
+    appendDouble(value);
+    append("\n");
+}
+
+void OpenMetricsWriter::gauge(const char* name, std::initializer_list<Label> labels, std::uint64_t value) {
+    appendName(name, "", labels);
+    appendUnsigned(value);
+    append("\n");
+}
+
+void OpenMetricsWriter::counter(const char* name, std::uint64_t value) {
+    counter(name, {}, value);
+}
+
+void OpenMetricsWriter::counter(const char* name, std::initializer_list<Label> labels, std::uint64_t value) {
+    appendName(name, "_total", labels);
+    appendUnsigned(value);
+    append("\n");
+}
+
+void OpenMetricsWriter::finish() {
+    append("# EOF\n");
+}
+
+const char* OpenMetricsWriter::data() const {
+    return mBuffer.data();
+}
+
+std::size_t OpenMetricsWriter::size() const {
+    return mSize;
+}
+
+std::size_t OpenMetricsWriter::capacity() const {
+    return mBuffer.size();
+}
+
+void OpenMetricsWriter::ensure(std::size_t extra) {
+    if (mSize + extra <= mBuffer.size()) {
+        return;
+    }
+    std::size_t capacity = mBuffer.empty() ? 4096 : mBuffer.size();
+    while (capacity < mSize + extra) {
+        capacity *= 2;
+    }
+    mBuffer.resize(capacity);
+}
+
+void OpenMetricsWriter::append(const char* text) {
+    append(text, std::strlen(text));
+}
+
+void OpenMetricsWriter::append(const char* text, std::size_t length) {
+    ensure(length);
+    std::memcpy(mBuffer.data() + mSize, text, length);
+    mSize += length;
+}
+
+// Label values may be mount points or cgroup paths, so \, " and newlines
+// are escaped as the format requires.
+void OpenMetricsWriter::appendEscaped(const char* value) {
+    for (const char* cursor = value; *cursor != '\0'; ++cursor) {
+        switch (*cursor) {
+            case '\\':
+                append("\\\\", 2);
+                break;
+            case '"':
+                append("\\\"", 2);
+                break;
+            case '\n':
+                append("\\n", 2);
+                break;
+            default:
+                append(cursor, 1);
+                break;
+        }
+    }
+}
+
+void OpenMetricsWriter::appendName(const char* name, const char* suffix, std::initializer_list<Label> labels) {
+    append(name);
+    append(suffix);
+    if (labels.size() != 0) {
+        append("{");
+        bool first = true;
+        for (const Label& label : labels) {
+            if (!first) {
+                append(",");
+            }
+            first = false;
+            append(label.name);
+            append("=\"");
+            appendEscaped(label.value);
+            append("\"");
+        }
+        append("}");
+    }
+    append(" ");
+}
+
+void OpenMetricsWriter::appendDouble(double value) {
+    if (std::isnan(value)) {
+        append("NaN");
+        return;
+    }
+    if (std::isinf(value)) {
+        append(value > 0 ? "+Inf" : "-Inf");
+        return;
+    }
+    ensure(kNumberLength);
+    const int written = std::snprintf(mBuffer.data() + mSize, kNumberLength, "%.9g", value);
+    if (written > 0) {
+        mSize += static_cast<std::size_t>(written);
+    }
+}
+
+void OpenMetricsWriter::appendUnsigned(std::uint64_t value) {
+    char digits[kNumberLength];
+    std::size_t length = 0;
+    do {
+        digits[length++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    ensure(length);
+    for (std::size_t i = 0; i < length; ++i) {
+        mBuffer[mSize + i] = digits[length - 1 - i];
+    }
+    mSize += length;
+}
+
+} // namespace xmonitor
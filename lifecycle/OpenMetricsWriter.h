@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+namespace xmonitor {
+
+// Appends OpenMetrics text exposition into one reusable buffer. The buffer
+// keeps its capacity across clear(), so steady-state renders do not
+// allocate; it only grows when a body outgrows every previous one.
+class OpenMetricsWriter {
+public:
+    struct Label {
+        const char* name;
+        const char* value;
+    };
+
+    explicit OpenMetricsWriter(std::size_t initialCapacity);
+
+    void clear();
+
+    // `# TYPE` / `# HELP` header; type is "gauge" or "counter". Counter
+    // samples are written with the `_total` suffix by counter().
+    void family(const char* name, const char* type, const char* help);
+
+    void gauge(const char* name, double value);
+    void gauge(const char* name, std::initializer_list<Label> labels, double value);
+    void gauge(const char* name, std::initializer_list<Label> labels, std::uint64_t value);
+    void counter(const char* name, std::uint64_t value);
+    void counter(const char* name, std::initializer_list<Label> labels, std::uint64_t value);
+
+    // Terminates the exposition with `# EOF`.
+    void finish();
+
+    const char* data() const;
+    std::size_t size() const;
+    std::size_t capacity() const;
+
+private:
+    void ensure(std::size_t extra);
+    void append(const char* text);
+    void append(const char* text, std::size_t length);
+    void appendEscaped(const char* value);
+    void appendName(const char* name, const char* suffix, std::initializer_list<Label> labels);
+    void appendDouble(double value);
+    void appendUnsigned(std::uint64_t value);
+
+    std::vector<char> mBuffer;
+    std::size_t mSize;
+};
+
+} // namespace xmonitor
@@ -0,0 +1,134 @@
+#include "lifecycle/PercentileTracker.h"
+
+#include <cstring>
+#include <sstream>
+
+#include "Logger.h"
+#include "lifecycle/SnapshotMetrics.h"
+
+namespace xmonitor {
+
+namespace {
+constexpr std::uint64_t kNsPerSecond = 1000000000ull;
+
+struct WindowSpec {
+    std::uint32_t seconds;
+    std::uint32_t slotSeconds;
+};
+
+constexpr WindowSpec kWindowSpecs[kPercentileWindowCount] = {
+    {60, 10},
+    {300, 30},
+    {3600, 300},
+};
+}
+
+PercentileTracker::PercentileTracker()
+    : mSlotsPerMetric(0),
+      mLastSampleNs(0) {
+    for (std::size_t i = 0; i < kPercentileWindowCount; ++i) {
+        Window& window = mWindows[i];
+        window.seconds = kWindowSpecs[i].seconds;
+        window.slotNs = static_cast<std::uint64_t>(kWindowSpecs[i].slotSeconds) * kNsPerSecond;
+        window.slotCount = kWindowSpecs[i].seconds / kWindowSpecs[i].slotSeconds;
+        window.firstSlot = mSlotsPerMetric;
+        mSlotsPerMetric += window.slotCount;
+    }
+}
+
+void PercentileTracker::configure(const std::string& metricList) {
+    mMetrics.clear();
+
+    std::istringstream stream(metricList);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        if (name.empty()) {
+            continue;
+        }
+        const std::size_t index = findSnapshotMetric(name);
+        if (index == snapshotMetricCount()) {
+            LOG_W("Percentiles: unknown metric '%s'", name.c_str());
+            continue;
+        }
+        if (mMetrics.size() == kMaxPercentileMetrics) {
+            LOG_W("Percentiles: more than %zu metrics, ignoring '%s'", kMaxPercentileMetrics, name.c_str());
+            continue;
+        }
+        mMetrics.push_back(index);
+    }
+
+    mSlots.assign(mMetrics.size() * mSlotsPerMetric, Slot{});
+    LOG_I("Percentiles: tracking %zu metrics (%zu KiB of sketches)",
+          mMetrics.size(), mSlots.size() * sizeof(Slot) / 1024);
+}
+
+std::size_t PercentileTracker::metricCount() const {
+    return mMetrics.size();
+}
+
+PercentileTracker::Slot& PercentileTracker::currentSlot(std::size_t metric, std::size_t window, std::uint64_t nowNs) {
+    const Window& spec = mWindows[window];
+    // Epoch 0 marks an unused slot, so count epochs from 1.
+    const std::uint64_t epoch = nowNs / spec.slotNs + 1;
+    Slot& slot = mSlots[metric * mSlotsPerMetric + spec.firstSlot + epoch % spec.slotCount];
+    if (slot.epoch != epoch) {
+        slot.epoch = epoch;
+        slot.sketch.clear();
+    }
+    return slot;
+}
+
+void PercentileTracker::sample(const BinderSnapshot& snapshot, std::uint64_t nowNs) {
+    if (mMetrics.empty() || nowNs - mLastSampleNs < kSampleIntervalNs) {
+        return;
+    }
+    mLastSampleNs = nowNs;
+
+    for (std::size_t m = 0; m < mMetrics.size(); ++m) {
+        const SnapshotMetric& metric = snapshotMetric(mMetrics[m]);
+        if (!snapshotHasSource(snapshot, metric.source)) {
+            continue;
+        }
+        const double value = metric.read(snapshot);
+        for (std::size_t w = 0; w < kPercentileWindowCount; ++w) {
+            currentSlot(m, w, nowNs).sketch.add(value);
+        }
+    }
+}
+
+void PercentileTracker::report(std::uint64_t nowNs, PercentileData& outData) const {
+    outData = PercentileData{};
+    outData.metricCount = static_cast<std::uint32_t>(mMetrics.size());
+    outData.relativeAccuracy = DDSketch::kRelativeAccuracy;
+
+    DDSketch merged;
+    for (std::size_t w = 0; w < kPercentileWindowCount; ++w) {
+        const Window& spec = mWindows[w];
+        outData.windowSeconds[w] = spec.seconds;
+        const std::uint64_t currentEpoch = nowNs / spec.slotNs + 1;
+
+        for (std::size_t m = 0; m < mMetrics.size(); ++m) {
+            merged.clear();
+            const Slot* slots = &mSlots[m * mSlotsPerMetric + spec.firstSlot];
+            for (std::size_t s = 0; s < spec.slotCount; ++s) {
+                if (slots[s].epoch != 0 && slots[s].epoch + spec.slotCount > currentEpoch) {
+                    merged.merge(slots[s].sketch);
+                }
+            }
+
+            PercentileSummary& summary = outData.summaries[m][w];
+            summary.count = merged.count();
+            summary.min = merged.min();
+            summary.p50 = merged.quantile(0.50);
+            summary.p95 = merged.quantile(0.95);
+            summary.p99 = merged.quantile(0.99);
+            summary.max = merged.max();
+        }
+    }
+
+    for (std::size_t m = 0; m < mMetrics.size(); ++m) {
+        std::strncpy(outData.metrics[m], snapshotMetric(mMetrics[m]).name, kAlertMetricLength - 1);
+    }
+}
+
+} // namespace xmonitor
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ipc/BinderProtocol.h"
+#include "lifecycle/DDSketch.h"
+
+namespace xmonitor {
+
+// Sliding-window percentiles for a handful of snapshot metrics.
+//
+// Every kSampleIntervalNs the tracked metrics are read from the snapshot and
+// added to one DDSketch per window. A window is a ring of time slots (1 min =
+// 6 x 10 s, 5 min = 10 x 30 s, 1 h = 12 x 5 min); the current slot is cleared
+// when its epoch comes round again, and report() merges the slots still
+// inside the window. The window therefore slides in slot-sized steps, and
+// memory is fixed at metrics x 28 sketches.
+class PercentileTracker {
+public:
+    static constexpr std::uint64_t kSampleIntervalNs = 100000000ull;
+
+    PercentileTracker();
+
+    // Comma-separated metric names from SnapshotMetrics; unknown names are
+    // logged and skipped, at most kMaxPercentileMetrics are kept.
+    void configure(const std::string& metricList);
+
+    std::size_t metricCount() const;
+
+    // Cheap when called more often than kSampleIntervalNs. Metrics whose
+    // service has not reported yet are not sampled.
+    void sample(const BinderSnapshot& snapshot, std::uint64_t nowNs);
+
+    void report(std::uint64_t nowNs, PercentileData& outData) const;
+
+private:
+    struct Slot {
+        std::uint64_t epoch{0};
+        DDSketch sketch;
+    };
+
+    struct Window {
+        std::uint32_t seconds{0};
+        std::uint64_t slotNs{0};
+        std::size_t slotCount{0};
+        std::size_t firstSlot{0};
+    };
+
+    Slot& currentSlot(std::size_t metric, std::size_t window, std::uint64_t nowNs);
+
+    std::vector<std::size_t> mMetrics;
+    Window mWindows[kPercentileWindowCount];
+    std::size_t mSlotsPerMetric;
+    // mMetrics.size() x mSlotsPerMetric, windows laid out back to back.
+    std::vector<Slot> mSlots;
+    std::uint64_t mLastSampleNs;
+};
+
+} // namespace xmonitor
@@ -0,0 +1,134 @@
+#include "lifecycle/SnapshotMetrics.h"
+
+#include <algorithm>
+
+#include "ipc/MetricSchema.h"
+
+namespace xmonitor {
+
+namespace {
+using Code = BinderTransactionCode;
+
+double maxDiskUtilization(const BinderSnapshot& snapshot) {
+    double value = 0.0;
+    for (std::uint32_t i = 0; i < snapshot.disk.deviceCount && i < kMaxDiskDevices; ++i) {
+        value = std::max(value, snapshot.disk.devices[i].utilizationPercent);
+    }
+    return value;
+}
+
+double maxDiskAwait(const BinderSnapshot& snapshot) {
+    double value = 0.0;
+    for (std::uint32_t i = 0; i < snapshot.disk.deviceCount && i < kMaxDiskDevices; ++i) {
+        const DiskDeviceStats& device = snapshot.disk.devices[i];
+        value = std::max(value, std::max(device.readAwaitMs, device.writeAwaitMs));
+    }
+    return value;
+}
+
+double maxFilesystemUsed(const BinderSnapshot& snapshot) {
+    double value = 0.0;
+    for (std::uint32_t i = 0; i < snapshot.filesystems.filesystemCount && i < kMaxFilesystems; ++i) {
+        const FilesystemStats& fs = snapshot.filesystems.filesystems[i];
+        if (fs.state == FS_STATE_OK) {
+            value = std::max(value, fs.usedPercent);
+        }
+    }
+    return value;
+}
+
+double maxFilesystemInodes(const BinderSnapshot& snapshot) {
+    double value = 0.0;
+    for (std::uint32_t i = 0; i < snapshot.filesystems.filesystemCount && i < kMaxFilesystems; ++i) {
+        const FilesystemStats& fs = snapshot.filesystems.filesystems[i];
+        if (fs.state == FS_STATE_OK) {
+            value = std::max(value, fs.inodeUsedPercent);
+        }
+    }
+    return value;
+}
+
+double maxCgroupThrottled(const BinderSnapshot& snapshot) {
+    double value = 0.0;
+    for (std::uint32_t i = 0; i < snapshot.cgroup.cgroupCount && i < kMaxCgroups; ++i) {
+        value = std::max(value, snapshot.cgroup.cgroups[i].cpuThrottledPercent);
+    }
+    return value;
+}
+
+double maxCoreUsage(const BinderSnapshot& snapshot) {
+    double value = 0.0;
+    for (std::uint32_t i = 0; i < snapshot.topology.cpuCount && i < kMaxTopologyCpus; ++i) {
+        value = std::max(value, snapshot.topology.cores[i].usagePercent);
+    }
+    return value;
+}
+
+// Per-device tables are reduced to their worst entry: "is any disk
+// saturated" is the host-level question.
+const SnapshotMetric kMetrics[] = {
+    {"cpu.usage", Code::CpuUpdated, [](const BinderSnapshot& s) { return s.cpu.usagePercent; }},
+    {"cpu.system", Code::CpuUpdated, [](const BinderSnapshot& s) { return s.cpu.systemPercent; }},
+    {"cpu.iowait", Code::CpuUpdated, [](const BinderSnapshot& s) { return s.cpu.iowaitPercent; }},
+    {"cpu.steal", Code::CpuUpdated, [](const BinderSnapshot& s) { return s.cpu.stealPercent; }},
+    {"cpu.max_core_usage", Code::TopologyUpdated, maxCoreUsage},
+    {"ram.used_percent", Code::RamUpdated, [](const BinderSnapshot& s) { return s.ram.usagePercent; }},
+    {"ram.available_bytes", Code::RamUpdated, [](const BinderSnapshot& s) { return static_cast<double>(s.ram.availableBytes); }},
+    {"ram.dirty_bytes", Code::RamUpdated, [](const BinderSnapshot& s) { return static_cast<double>(s.ram.dirtyBytes); }},
+    {"ram.swap_used_bytes", Code::RamUpdated,
+     [](const BinderSnapshot& s) { return static_cast<double>(s.ram.swapTotalBytes - std::min(s.ram.swapTotalBytes, s.ram.swapFreeBytes)); }},
+    {"ram.swap_in_per_sec", Code::RamUpdated, [](const BinderSnapshot& s) { return s.ram.swapInPagesPerSec; }},
+    {"ram.swap_out_per_sec", Code::RamUpdated, [](const BinderSnapshot& s) { return s.ram.swapOutPagesPerSec; }},
+    {"ram.major_faults_per_sec", Code::RamUpdated, [](const BinderSnapshot& s) { return s.ram.majorFaultsPerSec; }},
+    {"ram.oom_kills", Code::RamUpdated, [](const BinderSnapshot& s) { return static_cast<double>(s.ram.oomKills); }},
+    {"psi.cpu.some10", Code::PressureUpdated, [](const BinderSnapshot& s) { return s.pressure.cpu.some.avg10; }},
+    {"psi.memory.some10", Code::PressureUpdated, [](const BinderSnapshot& s) { return s.pressure.memory.some.avg10; }},
+    {"psi.memory.full10", Code::PressureUpdated, [](const BinderSnapshot& s) { return s.pressure.memory.full.avg10; }},
+    {"psi.io.some10", Code::PressureUpdated, [](const BinderSnapshot& s) { return s.pressure.io.some.avg10; }},
+    {"psi.io.full10", Code::PressureUpdated, [](const BinderSnapshot& s) { return s.pressure.io.full.avg10; }},
+    {"load.1", Code::InterruptUpdated, [](const BinderSnapshot& s) { return s.interrupts.load1; }},
+    {"load.5", Code::InterruptUpdated, [](const BinderSnapshot& s) { return s.interrupts.load5; }},
+    {"load.15", Code::InterruptUpdated, [](const BinderSnapshot& s) { return s.interrupts.load15; }},
+    {"procs.running", Code::InterruptUpdated, [](const BinderSnapshot& s) { return static_cast<double>(s.interrupts.procsRunning); }},
+    {"procs.blocked", Code::InterruptUpdated, [](const BinderSnapshot& s) { return static_cast<double>(s.interrupts.procsBlocked); }},
+    {"irq.per_sec", Code::InterruptUpdated, [](const BinderSnapshot& s) { return s.interrupts.interruptsPerSec; }},
+    {"disk.max_util_percent", Code::DiskUpdated, maxDiskUtilization},
+    {"disk.max_await_ms", Code::DiskUpdated, maxDiskAwait},
+    {"fs.max_used_percent", Code::FilesystemUpdated, maxFilesystemUsed},
+    {"fs.max_inode_percent", Code::FilesystemUpdated, maxFilesystemInodes},
+    {"fs.hung", Code::FilesystemUpdated, [](const BinderSnapshot& s) { return static_cast<double>(s.filesystems.hungFilesystems); }},
+    {"net.tcp.established", Code::NetUpdated, [](const BinderSnapshot& s) { return static_cast<double>(s.net.tcp.currentEstablished); }},
+    {"net.tcp.retrans_percent", Code::NetUpdated, [](const BinderSnapshot& s) { return s.net.tcp.retransPercent; }},
+    {"net.tcp.resets_per_sec", Code::NetUpdated, [](const BinderSnapshot& s) { return s.net.tcp.outResetsPerSec; }},
+    {"net.tcp.listen_overflows_per_sec", Code::NetUpdated, [](const BinderSnapshot& s) { return s.net.tcp.listenOverflowsPerSec; }},
+    {"cgroup.max_throttled_percent", Code::CgroupUpdated, maxCgroupThrottled},
+    {"process.count", Code::ProcessUpdated, [](const BinderSnapshot& s) { return static_cast<double>(s.process.totalProcesses); }},
+    {"process.forks_per_sec", Code::ProcessUpdated, [](const BinderSnapshot& s) { return s.process.forksPerSec; }},
+    {"process.short_lived", Code::ProcessUpdated, [](const BinderSnapshot& s) { return static_cast<double>(s.process.shortLivedProcesses); }},
+};
+
+constexpr std::size_t kMetricCount = sizeof(kMetrics) / sizeof(kMetrics[0]);
+}
+
+std::size_t snapshotMetricCount() {
+    return kMetricCount;
+}
+
+const SnapshotMetric& snapshotMetric(std::size_t index) {
+    return kMetrics[index];
+}
+
+std::size_t findSnapshotMetric(const std::string& name) {
+    std::size_t index = 0;
+    while (index < kMetricCount && name != kMetrics[index].name) {
+        ++index;
+    }
+    return index;
+}
+
+bool snapshotHasSource(const BinderSnapshot& snapshot, BinderTransactionCode source) {
+    const SnapshotSectionInfo* section = snapshotSectionForCode(static_cast<std::uint32_t>(source));
+    return section != nullptr && section->trace(snapshot, 0).sampleNs != 0;
+}
+
+} // namespace xmonitor
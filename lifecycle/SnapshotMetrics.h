@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// Host-level scalars that lifecycle derives from its snapshot, shared by the
+// alert rules and the percentile sketches. source is the update that
+// refreshes the value.
+struct SnapshotMetric {
+    const char* name;
+    BinderTransactionCode source;
+    double (*read)(const BinderSnapshot&);
+};
+
+std::size_t snapshotMetricCount();
+const SnapshotMetric& snapshotMetric(std::size_t index);
+
+// Returns snapshotMetricCount() for an unknown name.
+std::size_t findSnapshotMetric(const std::string& name);
+
+// False until the service behind `source` has delivered its first update.
+bool snapshotHasSource(const BinderSnapshot& snapshot, BinderTransactionCode source);
+
+} // namespace xmonitor
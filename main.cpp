@@ -1,7 +1,37 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
 #include "app/MonitorApp.h"
 
-int main() {
+namespace {
+void printUsage() {
+    std::fprintf(stderr, "usage: xMonitor [--watch <pid>]\n");
+    std::fprintf(stderr, "       xMonitor --policy <spec|show>\n");
+}
+}
+
+int main(int argc, char** argv) {
     xmonitor::MonitorApp app;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--watch") == 0 && i + 1 < argc) {
+            char* end = nullptr;
+            const unsigned long pid = std::strtoul(argv[++i], &end, 10);
+            if (end == argv[i] || *end != '\0' || pid == 0 || pid > UINT32_MAX) {
+                printUsage();
+                return 2;
+            }
+            app.setWatchTarget(static_cast<std::uint32_t>(pid));
+        } else if (std::strcmp(argv[i], "--policy") == 0 && i + 1 < argc && argc == 3) {
+            return app.runPolicyCommand(argv[++i]) ? 0 : 1;
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+
     app.run();
     return 0;
 }
@@ -0,0 +1,376 @@
+#include "service/CgroupCollector.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <utility>
+
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+#include "common/ProcfsRoot.h"
+#include "common/TextScan.h"
+#include "service/PressureCollector.h"
+
+namespace xmonitor {
+namespace {
+
+// Without inotify (e.g. a read-only fixture on an odd filesystem) the tree is
+// re-walked this often instead.
+constexpr std::size_t kRescanFallbackSamples = 30;
+
+// Per-cgroup files are a few hundred bytes; memory.stat grows its buffer once.
+constexpr std::size_t kCgroupFileCapacity = 512;
+
+constexpr std::uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+const char* kFileNames[] = {
+    "cpu.stat",
+    "memory.current",
+    "memory.stat",
+    "io.stat",
+    "cpu.pressure",
+    "memory.pressure",
+    "io.pressure",
+};
+
+double perSecond(std::uint64_t delta, double windowSec) {
+    return windowSec > 0.0 ? static_cast<double>(delta) / windowSec : 0.0;
+}
+
+std::uint64_t counterDelta(std::uint64_t current, std::uint64_t previous) {
+    return current >= previous ? current - previous : 0;
+}
+
+// Long paths keep their tail, which names the container or scope.
+void copyPath(const std::string& path, char (&outPath)[kCgroupPathLength]) {
+    if (path.size() < kCgroupPathLength) {
+        std::memcpy(outPath, path.c_str(), path.size() + 1);
+        return;
+    }
+
+    const std::size_t tailLength = kCgroupPathLength - 3;
+    std::memcpy(outPath, "..", 2);
+    std::memcpy(outPath + 2, path.c_str() + path.size() - tailLength, tailLength);
+    outPath[kCgroupPathLength - 1] = '\0';
+}
+
+// Reads "key value" lines (cpu.stat, memory.stat); `key` includes the
+// trailing space so "anon " does not match "anon_thp".
+void parseFlatKeyed(const ProcFile& file,
+                    const char* const* keys,
+                    std::uint64_t* const* outValues,
+                    std::size_t keyCount) {
+    const char* cursor = file.data();
+    const char* end = file.end();
+    while (cursor < end) {
+        for (std::size_t i = 0; i < keyCount; ++i) {
+            if (consume(cursor, end, keys[i])) {
+                parseU64(cursor, end, *outValues[i]);
+                break;
+            }
+        }
+        skipLine(cursor, end);
+    }
+}
+
+// "8:0 rbytes=1 wbytes=2 rios=3 wios=4 dbytes=0 dios=0", one line per device.
+void parseIoStat(const ProcFile& file, std::uint64_t& outReadBytes, std::uint64_t& outWriteBytes, std::uint64_t& outOps) {
+    const char* cursor = file.data();
+    const char* end = file.end();
+    while (cursor < end) {
+        skipToken(cursor, end);
+        for (;;) {
+            skipBlanks(cursor, end);
+            if (cursor >= end || *cursor == '\n') {
+                break;
+            }
+
+            std::uint64_t value = 0;
+            if (consume(cursor, end, "rbytes=") && parseU64(cursor, end, value)) {
+                outReadBytes += value;
+            } else if (consume(cursor, end, "wbytes=") && parseU64(cursor, end, value)) {
+                outWriteBytes += value;
+            } else if ((consume(cursor, end, "rios=") || consume(cursor, end, "wios=")) &&
+                       parseU64(cursor, end, value)) {
+                outOps += value;
+            } else {
+                skipToken(cursor, end);
+            }
+        }
+        skipLine(cursor, end);
+    }
+}
+
+bool isUnifiedRoot(const std::string& path) {
+    return ::access((path + "/cgroup.controllers").c_str(), F_OK) == 0;
+}
+
+// Hybrid hosts mount the v2 tree at fs/cgroup/unified next to the v1 controllers.
+std::string unifiedRoot() {
+    const std::string root = sysPath("fs/cgroup");
+    const std::string hybridRoot = root + "/unified";
+    return !isUnifiedRoot(root) && isUnifiedRoot(hybridRoot) ? hybridRoot : root;
+}
+
+double pressureSome(ProcFile& file) {
+    PressureResource resource;
+    return PressureCollector::readResource(file, resource) ? resource.some.avg10 : 0.0;
+}
+
+} // namespace
+
+CgroupCollector::CgroupCollector()
+    : CgroupCollector(Options{}) {}
+
+CgroupCollector::CgroupCollector(const Options& options)
+    : mOptions(options),
+      mRoot(unifiedRoot()),
+      mInotifyFd(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+      mNeedsRescan(true),
+      mSamplesSinceScan(0),
+      mPreviousSampleNs(0) {
+    if (!isUnifiedRoot(mRoot)) {
+        LOG_W("Cgroup v2 not mounted at %s", mRoot.c_str());
+    }
+    if (mInotifyFd < 0) {
+        LOG_W("Cgroup inotify unavailable; re-walking %s every %zu samples", mRoot.c_str(), kRescanFallbackSamples);
+    }
+}
+
+CgroupCollector::~CgroupCollector() {
+    if (mInotifyFd >= 0) {
+        ::close(mInotifyFd);
+    }
+}
+
+bool CgroupCollector::treeChanged() {
+    ++mSamplesSinceScan;
+    if (mInotifyFd < 0) {
+        return mSamplesSinceScan >= kRescanFallbackSamples;
+    }
+
+    // The events themselves don't matter: any create/delete/rename below a
+    // watched level means the cgroup set may differ.
+    alignas(struct inotify_event) char buffer[4096];
+    bool changed = false;
+    while (::read(mInotifyFd, buffer, sizeof(buffer)) > 0) {
+        changed = true;
+    }
+    return changed;
+}
+
+void CgroupCollector::scanDirectory(const std::string& relativePath,
+                                    std::uint32_t depth,
+                                    std::vector<std::string>& outPaths) {
+    if (depth >= mOptions.maxDepth) {
+        return;
+    }
+
+    const std::string absolutePath = relativePath.empty() ? mRoot : mRoot + "/" + relativePath;
+    if (mInotifyFd >= 0) {
+        ::inotify_add_watch(mInotifyFd, absolutePath.c_str(), kWatchMask);
+    }
+
+    DIR* directory = ::opendir(absolutePath.c_str());
+    if (directory == nullptr) {
+        return;
+    }
+
+    while (const dirent* entry = ::readdir(directory)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        if (entry->d_type != DT_DIR) {
+            if (entry->d_type != DT_UNKNOWN) {
+                continue;
+            }
+            struct stat info {};
+            const std::string entryPath = absolutePath + "/" + entry->d_name;
+            if (::stat(entryPath.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+                continue;
+            }
+        }
+
+        std::string childPath = relativePath.empty() ? std::string(entry->d_name) : relativePath + "/" + entry->d_name;
+        outPaths.push_back(childPath);
+        scanDirectory(childPath, depth + 1, outPaths);
+    }
+    ::closedir(directory);
+}
+
+void CgroupCollector::openFiles(CgroupState& state) const {
+    // Files of controllers enabled later appear on a subsequent rescan.
+    for (std::size_t file = 0; file < FILE_COUNT; ++file) {
+        if (!state.files[file].isOpen()) {
+            state.files[file] = ProcFile(mRoot + "/" + state.relativePath + "/" + kFileNames[file], kCgroupFileCapacity);
+        }
+    }
+}
+
+void CgroupCollector::rescan() {
+    std::vector<std::string> paths;
+    scanDirectory(std::string(), 0, paths);
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<CgroupState> cgroups;
+    cgroups.reserve(paths.size());
+    for (std::string& path : paths) {
+        const auto found = mIndexByPath.find(path);
+        if (found != mIndexByPath.end()) {
+            cgroups.push_back(std::move(mCgroups[found->second]));
+        } else {
+            CgroupState state;
+            state.depth = static_cast<std::uint32_t>(std::count(path.begin(), path.end(), '/') + 1);
+            state.relativePath = std::move(path);
+            cgroups.push_back(std::move(state));
+        }
+        openFiles(cgroups.back());
+    }
+
+    mCgroups.swap(cgroups);
+    mIndexByPath.clear();
+    for (std::size_t i = 0; i < mCgroups.size(); ++i) {
+        mIndexByPath.emplace(mCgroups[i].relativePath, i);
+    }
+
+    mNeedsRescan = false;
+    mSamplesSinceScan = 0;
+    LOG_D("Cgroup tree rescanned: %zu cgroups under %s", mCgroups.size(), mRoot.c_str());
+}
+
+bool CgroupCollector::sampleCgroup(CgroupState& state, double windowSec, CgroupStats& outStats) {
+    // cpu.stat exists in every cgroup; failing to read it means the cgroup is gone.
+    ProcFile& cpuStat = state.files[FILE_CPU_STAT];
+    if (!cpuStat.read()) {
+        return false;
+    }
+
+    std::uint64_t usageUs = 0;
+    std::uint64_t throttledUs = 0;
+    static const char* const kCpuKeys[] = {"usage_usec ", "throttled_usec "};
+    std::uint64_t* const cpuValues[] = {&usageUs, &throttledUs};
+    parseFlatKeyed(cpuStat, kCpuKeys, cpuValues, 2);
+
+    copyPath(state.relativePath, outStats.path);
+    outStats.depth = state.depth;
+
+    ProcFile& memoryCurrent = state.files[FILE_MEMORY_CURRENT];
+    if (memoryCurrent.isOpen() && memoryCurrent.read()) {
+        const char* cursor = memoryCurrent.data();
+        parseU64(cursor, memoryCurrent.end(), outStats.memoryCurrentBytes);
+    }
+
+    ProcFile& memoryStat = state.files[FILE_MEMORY_STAT];
+    if (memoryStat.isOpen() && memoryStat.read()) {
+        static const char* const kMemoryKeys[] = {"anon ", "file "};
+        std::uint64_t* const memoryValues[] = {&outStats.memoryAnonBytes, &outStats.memoryFileBytes};
+        parseFlatKeyed(memoryStat, kMemoryKeys, memoryValues, 2);
+    }
+
+    std::uint64_t ioReadBytes = 0;
+    std::uint64_t ioWriteBytes = 0;
+    std::uint64_t ioOps = 0;
+    ProcFile& ioStat = state.files[FILE_IO_STAT];
+    if (ioStat.isOpen() && ioStat.read()) {
+        parseIoStat(ioStat, ioReadBytes, ioWriteBytes, ioOps);
+    }
+
+    outStats.cpuPressureSome = pressureSome(state.files[FILE_CPU_PRESSURE]);
+    outStats.memoryPressureSome = pressureSome(state.files[FILE_MEMORY_PRESSURE]);
+    outStats.ioPressureSome = pressureSome(state.files[FILE_IO_PRESSURE]);
+
+    if (state.hasPrevious && windowSec > 0.0) {
+        const double windowUs = windowSec * 1e6;
+        outStats.cpuPercent = static_cast<double>(counterDelta(usageUs, state.usageUs)) * 100.0 / windowUs;
+        outStats.cpuThrottledPercent =
+            std::min(100.0, static_cast<double>(counterDelta(throttledUs, state.throttledUs)) * 100.0 / windowUs);
+        outStats.ioReadBytesPerSec = perSecond(counterDelta(ioReadBytes, state.ioReadBytes), windowSec);
+        outStats.ioWriteBytesPerSec = perSecond(counterDelta(ioWriteBytes, state.ioWriteBytes), windowSec);
+        outStats.ioOpsPerSec = perSecond(counterDelta(ioOps, state.ioOps), windowSec);
+    }
+
+    state.usageUs = usageUs;
+    state.throttledUs = throttledUs;
+    state.ioReadBytes = ioReadBytes;
+    state.ioWriteBytes = ioWriteBytes;
+    state.ioOps = ioOps;
+    state.hasPrevious = true;
+    return true;
+}
+
+void CgroupCollector::select(std::size_t limit) {
+    // Every sort key gets an equal share of the slots so the app can re-sort
+    // by any column; CPU goes last and takes whatever the others left over.
+    static const int kSelectionOrder[] = {CGROUP_SORT_MEMORY, CGROUP_SORT_IO, CGROUP_SORT_PRESSURE, CGROUP_SORT_CPU};
+    const std::size_t quota = limit / CGROUP_SORT_COUNT;
+
+    mOutput.clear();
+    mSelected.assign(mMatched.size(), 0);
+    mOrder.resize(mMatched.size());
+    for (int sortKey : kSelectionOrder) {
+        std::iota(mOrder.begin(), mOrder.end(), std::size_t{0});
+        std::sort(mOrder.begin(), mOrder.end(), [this, sortKey](std::size_t left, std::size_t right) {
+            return cgroupRanksBefore(mMatched[left], mMatched[right], sortKey);
+        });
+
+        const std::size_t share = sortKey == CGROUP_SORT_CPU ? limit : mOutput.size() + quota;
+        for (std::size_t index : mOrder) {
+            if (mOutput.size() >= share) {
+                break;
+            }
+            if (mSelected[index] == 0) {
+                mSelected[index] = 1;
+                mOutput.push_back(mMatched[index]);
+            }
+        }
+    }
+
+    std::sort(mOutput.begin(), mOutput.end(), [](const CgroupStats& left, const CgroupStats& right) {
+        return cgroupRanksBefore(left, right, CGROUP_SORT_CPU);
+    });
+}
+
+bool CgroupCollector::sample(CgroupData& outData) {
+    if (mNeedsRescan || treeChanged()) {
+        rescan();
+    }
+    if (mCgroups.empty() && !isUnifiedRoot(mRoot)) {
+        LOG_E("Cgroup read failed: cannot open %s", mRoot.c_str());
+        mNeedsRescan = true;
+        return false;
+    }
+
+    const std::uint64_t nowNs = monotonicNowNs();
+    const double windowSec = mPreviousSampleNs != 0 ? static_cast<double>(nowNs - mPreviousSampleNs) / 1e9 : 0.0;
+
+    mMatched.clear();
+    for (CgroupState& state : mCgroups) {
+        // Never opened (e.g. out of fds): skipped rather than forcing a re-walk every tick.
+        if (!state.files[FILE_CPU_STAT].isOpen()) {
+            continue;
+        }
+        CgroupStats stats;
+        if (!sampleCgroup(state, windowSec, stats)) {
+            mNeedsRescan = true;
+            continue;
+        }
+        mMatched.push_back(stats);
+    }
+
+    select(kMaxCgroups);
+
+    outData.matchedCgroups = static_cast<std::uint32_t>(mMatched.size());
+    outData.cgroupCount = static_cast<std::uint32_t>(mOutput.size());
+    std::copy(mOutput.begin(), mOutput.end(), outData.cgroups);
+    std::fill(outData.cgroups + mOutput.size(), outData.cgroups + kMaxCgroups, CgroupStats{});
+    outData.trace.sampleNs = nowNs;
+    mPreviousSampleNs = nowNs;
+    return true;
+}
+
+} // namespace xmonitor
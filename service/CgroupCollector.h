@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/ProcFile.h"
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// Per-cgroup CPU, memory, I/O and pressure from the cgroup v2 tree at
+// <sysRoot>/fs/cgroup, down to Options::maxDepth below the root. Each cgroup
+// keeps its files open between samples; the directory tree is walked again
+// only when inotify reports a cgroup created or removed (or, where inotify is
+// unavailable, every kRescanFallbackSamples samples).
+class CgroupCollector {
+public:
+    struct Options {
+        std::size_t maxDepth{3};
+    };
+
+    CgroupCollector();
+    explicit CgroupCollector(const Options& options);
+    ~CgroupCollector();
+
+    CgroupCollector(const CgroupCollector&) = delete;
+    CgroupCollector& operator=(const CgroupCollector&) = delete;
+
+    bool sample(CgroupData& outData);
+
+private:
+    enum File : std::size_t {
+        FILE_CPU_STAT = 0,
+        FILE_MEMORY_CURRENT,
+        FILE_MEMORY_STAT,
+        FILE_IO_STAT,
+        FILE_CPU_PRESSURE,
+        FILE_MEMORY_PRESSURE,
+        FILE_IO_PRESSURE,
+        FILE_COUNT
+    };
+
+    struct CgroupState {
+        std::string relativePath;
+        std::uint32_t depth{0};
+        ProcFile files[FILE_COUNT];
+        bool hasPrevious{false};
+        std::uint64_t usageUs{0};
+        std::uint64_t throttledUs{0};
+        std::uint64_t ioReadBytes{0};
+        std::uint64_t ioWriteBytes{0};
+        std::uint64_t ioOps{0};
+    };
+
+    bool treeChanged();
+    void rescan();
+    void scanDirectory(const std::string& relativePath, std::uint32_t depth, std::vector<std::string>& outPaths);
+    void openFiles(CgroupState& state) const;
+    bool sampleCgroup(CgroupState& state, double windowSec, CgroupStats& outStats);
+    void select(std::size_t limit);
+
+    Options mOptions;
+    std::string mRoot;
+    int mInotifyFd;
+    bool mNeedsRescan;
+    std::size_t mSamplesSinceScan;
+    std::vector<CgroupState> mCgroups;
+    std::unordered_map<std::string, std::size_t> mIndexByPath;
+    std::vector<CgroupStats> mMatched;
+    std::vector<std::size_t> mOrder;
+    std::vector<unsigned char> mSelected;
+    std::vector<CgroupStats> mOutput;
+    std::uint64_t mPreviousSampleNs;
+};
+
+} // namespace xmonitor
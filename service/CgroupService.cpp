@@ -0,0 +1,99 @@
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "Logger.h"
+#include "common/Config.h"
+#include "common/FileLimit.h"
+#include "ipc/BinderProtocol.h"
+#include "service/CgroupCollector.h"
+#include "service/ServiceSession.h"
+
+namespace {
+volatile std::sig_atomic_t gRunning = 1;
+
+// A cgroup sample reads seven files per cgroup, so it runs at the disk and
+// network cadence rather than the 100ms CPU one.
+constexpr auto kSamplePeriod = std::chrono::milliseconds(1000);
+
+constexpr long kDefaultDepth = 3;
+// Deep enough for systemd slices inside containers; keeps the walk bounded.
+constexpr long kMaxDepth = 8;
+
+void signalHandler(int) {
+    gRunning = 0;
+}
+
+bool cgroupChanged(const xmonitor::CgroupData& current, const xmonitor::CgroupData& previous) {
+    return std::memcmp(&current, &previous, offsetof(xmonitor::CgroupData, trace)) != 0;
+}
+}
+
+int main() {
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+
+    setLogFilePath("logs/xMonitor-cgroup.log");
+    LOG_I("Cgroup service start");
+
+    xmonitor::ServiceSession session("Cgroup",
+                                     xmonitor::BinderTransactionCode::RegisterCgroupService,
+                                     xmonitor::ProcessRole::CgroupService);
+
+    // Every cgroup keeps ~7 files open.
+    if (!xmonitor::raiseFileLimit()) {
+        LOG_W("Cgroup service: cannot raise RLIMIT_NOFILE");
+    }
+
+    xmonitor::CgroupCollector::Options options;
+    long depth = kDefaultDepth;
+    if (!xmonitor::envInteger("XMONITOR_CGROUP_DEPTH", 0, kMaxDepth, depth)) {
+        LOG_W("Cgroup service: XMONITOR_CGROUP_DEPTH must be 0..%ld, using %ld", kMaxDepth, depth);
+    }
+    options.maxDepth = static_cast<std::size_t>(depth);
+    xmonitor::CgroupCollector collector(options);
+
+    xmonitor::CgroupData lastPublished{};
+    bool hasLastPublished = false;
+
+    if (!session.start(gRunning)) {
+        return 1;
+    }
+
+    if (gRunning == 0) {
+        session.stop();
+        LOG_I("Cgroup service stop");
+        return 0;
+    }
+
+    while (gRunning != 0) {
+        if (session.takePolicyChange()) {
+            hasLastPublished = false;
+        }
+
+        xmonitor::CgroupData current{};
+        if (session.sectionEnabled(xmonitor::BinderTransactionCode::CgroupUpdated) && collector.sample(current)) {
+            if (!hasLastPublished || cgroupChanged(current, lastPublished)) {
+                hasLastPublished = true;
+                lastPublished = current;
+                if (!session.publish(xmonitor::BinderTransactionCode::CgroupUpdated, &current, sizeof(current))) {
+                    session.stop();
+                    return 1;
+                }
+            }
+        }
+
+        if (!session.onSampleTick()) {
+            session.stop();
+            return 1;
+        }
+
+        session.sleepUntilNextTick(kSamplePeriod);
+    }
+
+    session.stop();
+    LOG_I("Cgroup service stop");
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "service/CpuCollector.h"
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+#include "common/ProcfsRoot.h"
+#include "common/TextScan.h"
+
+namespace xmonitor {
+namespace {
+
+enum StatColumn : std::size_t {
+    COLUMN_USER = 0,
+    COLUMN_NICE,
+    COLUMN_SYSTEM,
+    COLUMN_IDLE,
+    COLUMN_IOWAIT,
+    COLUMN_IRQ,
+    COLUMN_SOFTIRQ,
+    COLUMN_STEAL,
+    COLUMN_GUEST,
+    COLUMN_GUEST_NICE
+};
+
+std::uint64_t deltaOf(std::uint64_t current, std::uint64_t previous) {
+    return current >= previous ? current - previous : 0;
+}
+
+} // namespace
+
+CpuCollector::CpuCollector()
+    : mStatFile(procPath("stat")),
+      mPrevious{},
+      mHasPrevious(false) {}
+
+bool CpuCollector::sample(CpuData& outData) {
+    if (!mStatFile.isOpen() && !mStatFile.open(procPath("stat"))) {
+        LOG_E("CPU read failed: cannot open %s", mStatFile.path().c_str());
+        return false;
+    }
+
+    if (!mStatFile.read()) {
+        LOG_E("CPU read failed: cannot read %s", mStatFile.path().c_str());
+        return false;
+    }
+
+    const char* cursor = mStatFile.data();
+    const char* end = mStatFile.end();
+    if (!consume(cursor, end, "cpu ")) {
+        LOG_E("CPU read failed: missing aggregate cpu line");
+        return false;
+    }
+
+    // guest/guest_nice are absent on very old kernels and stay zero.
+    std::uint64_t current[kStatColumns] = {};
+    std::size_t columns = 0;
+    while (columns < kStatColumns && parseU64(cursor, end, current[columns])) {
+        ++columns;
+    }
+    if (columns < COLUMN_STEAL + 1) {
+        LOG_E("CPU read failed: only %zu columns in cpu line", columns);
+        return false;
+    }
+
+    const std::uint64_t idleAll = current[COLUMN_IDLE] + current[COLUMN_IOWAIT];
+    std::uint64_t total = 0;
+    for (std::size_t column = COLUMN_USER; column <= COLUMN_STEAL; ++column) {
+        total += current[column];
+    }
+
+    outData.totalJiffies = total;
+    outData.idleJiffies = idleAll;
+
+    if (mHasPrevious) {
+        std::uint64_t delta[kStatColumns];
+        std::uint64_t totalDelta = 0;
+        for (std::size_t column = 0; column < kStatColumns; ++column) {
+            delta[column] = deltaOf(current[column], mPrevious[column]);
+            if (column <= COLUMN_STEAL) {
+                totalDelta += delta[column];
+            }
+        }
+
+        if (totalDelta > 0) {
+            const double scale = 100.0 / static_cast<double>(totalDelta);
+            const std::uint64_t guest = delta[COLUMN_GUEST] <= delta[COLUMN_USER] ? delta[COLUMN_GUEST] : delta[COLUMN_USER];
+            const std::uint64_t guestNice =
+                delta[COLUMN_GUEST_NICE] <= delta[COLUMN_NICE] ? delta[COLUMN_GUEST_NICE] : delta[COLUMN_NICE];
+
+            outData.userPercent = static_cast<double>(delta[COLUMN_USER] - guest) * scale;
+            outData.nicePercent = static_cast<double>(delta[COLUMN_NICE] - guestNice) * scale;
+            outData.systemPercent = static_cast<double>(delta[COLUMN_SYSTEM]) * scale;
+            outData.idlePercent = static_cast<double>(delta[COLUMN_IDLE]) * scale;
+            outData.iowaitPercent = static_cast<double>(delta[COLUMN_IOWAIT]) * scale;
+            outData.irqPercent = static_cast<double>(delta[COLUMN_IRQ]) * scale;
+            outData.softirqPercent = static_cast<double>(delta[COLUMN_SOFTIRQ]) * scale;
+            outData.stealPercent = static_cast<double>(delta[COLUMN_STEAL]) * scale;
+            outData.guestPercent = static_cast<double>(guest) * scale;
+            outData.guestNicePercent = static_cast<double>(guestNice) * scale;
+            outData.usagePercent = 100.0 - outData.idlePercent - outData.iowaitPercent;
+        }
+    }
+
+    for (std::size_t column = 0; column < kStatColumns; ++column) {
+        mPrevious[column] = current[column];
+    }
+    mHasPrevious = true;
+    outData.trace.sampleNs = monotonicNowNs();
+
+    static int sampleCounter = 0;
+    ++sampleCounter;
+    if (sampleCounter % 10 == 0) {
+        LOG_D("CPU read ok: usage=%.2f iowait=%.2f steal=%.2f total=%llu idle=%llu",
+              outData.usagePercent,
+              outData.iowaitPercent,
+              outData.stealPercent,
+              static_cast<unsigned long long>(outData.totalJiffies),
+              static_cast<unsigned long long>(outData.idleJiffies));
+    }
+
+    return true;
+}
+
+} // namespace xmonitor
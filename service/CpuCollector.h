@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "common/ProcFile.h"
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// Aggregate CPU time breakdown from the "cpu" line of <procRoot>/stat, as a
+// delta against the previous sample.
+class CpuCollector {
+public:
+    CpuCollector();
+
+    bool sample(CpuData& outData);
+
+private:
+    // Column order of the "cpu" line in /proc/stat.
+    static constexpr std::size_t kStatColumns = 10;
+
+    ProcFile mStatFile;
+    std::uint64_t mPrevious[kStatColumns];
+    bool mHasPrevious;
+};
+
+} // namespace xmonitor
@@ -2,80 +2,71 @@
 #include <csignal>
 #include <cmath>
 #include <cstdint>
-#include <fstream>
-#include <sstream>
-#include <thread>
 
 #include "Logger.h"
+#include "common/MonotonicClock.h"
 #include "ipc/BinderProtocol.h"
-#include "ipc/BinderClientAdapter.h"
+#include "service/CpuCollector.h"
+#include "service/InterruptCollector.h"
+#include "service/PressureCollector.h"
+#include "service/TopologyCollector.h"
+#include "service/ServiceSession.h"
 
 namespace {
 volatile std::sig_atomic_t gRunning = 1;
 
-void signalHandler(int) {
-    gRunning = 0;
-}
+constexpr auto kSamplePeriod = std::chrono::milliseconds(100);
 
-bool readCpu(xmonitor::CpuData& outData, std::uint64_t& previousTotal, std::uint64_t& previousIdle) {
-    std::ifstream statFile("/proc/stat");
-    if (!statFile.is_open()) {
-        LOG_E("CPU read failed: cannot open /proc/stat");
-        return false;
-    }
+// Usage shares are published once one of them moves by this many
+// percentage points.
+constexpr double kDeadbandPercent = 0.01;
 
-    std::string line;
-    if (!std::getline(statFile, line)) {
-        LOG_E("CPU read failed: cannot read first line /proc/stat");
-        return false;
-    }
+// PSI totals advance on every sample, so an unchanged-averages snapshot is
+// still refreshed at this period to keep the totals current.
+constexpr std::uint64_t kPressureRefreshNs = 1000000000ull;
 
-    std::istringstream lineStream(line);
-    std::string cpuLabel;
-    std::uint64_t user = 0;
-    std::uint64_t nice = 0;
-    std::uint64_t system = 0;
-    std::uint64_t idle = 0;
-    std::uint64_t iowait = 0;
-    std::uint64_t irq = 0;
-    std::uint64_t softirq = 0;
-    std::uint64_t steal = 0;
-
-    lineStream >> cpuLabel >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal;
-    if (cpuLabel != "cpu") {
-        LOG_E("CPU read failed: invalid label '%s'", cpuLabel.c_str());
-        return false;
-    }
+// /proc/interrupts and the per-CPU sysfs files scale with the core count
+// and are costly for the kernel to format on many-core hosts; load, IRQ
+// rates and per-core topology are sampled once a second whatever the
+// sampling period is.
+constexpr std::uint64_t kPerSecondNs = 1000000000ull;
 
-    const std::uint64_t idleAll = idle + iowait;
-    const std::uint64_t total = user + nice + system + idle + iowait + irq + softirq + steal;
+void signalHandler(int) {
+    gRunning = 0;
+}
 
-    double usage = 0.0;
-    if (previousTotal != 0 && total >= previousTotal && idleAll >= previousIdle) {
-        const std::uint64_t totalDelta = total - previousTotal;
-        const std::uint64_t idleDelta = idleAll - previousIdle;
-        if (totalDelta > 0) {
-            usage = (static_cast<double>(totalDelta - idleDelta) * 100.0) / static_cast<double>(totalDelta);
-        }
-    }
+bool percentChanged(double current, double previous, double deadband) {
+    return std::fabs(current - previous) >= deadband;
+}
 
-    previousTotal = total;
-    previousIdle = idleAll;
+bool cpuChanged(const xmonitor::CpuData& current, const xmonitor::CpuData& previous, double deadband) {
+    return percentChanged(current.usagePercent, previous.usagePercent, deadband) ||
+           percentChanged(current.userPercent, previous.userPercent, deadband) ||
+           percentChanged(current.nicePercent, previous.nicePercent, deadband) ||
+           percentChanged(current.systemPercent, previous.systemPercent, deadband) ||
+           percentChanged(current.iowaitPercent, previous.iowaitPercent, deadband) ||
+           percentChanged(current.irqPercent, previous.irqPercent, deadband) ||
+           percentChanged(current.softirqPercent, previous.softirqPercent, deadband) ||
+           percentChanged(current.stealPercent, previous.stealPercent, deadband) ||
+           percentChanged(current.guestPercent, previous.guestPercent, deadband) ||
+           percentChanged(current.guestNicePercent, previous.guestNicePercent, deadband);
+}
 
-    outData.totalJiffies = total;
-    outData.idleJiffies = idleAll;
-    outData.usagePercent = usage;
+bool stallAveragesChanged(const xmonitor::PressureStall& current, const xmonitor::PressureStall& previous) {
+    return current.avg10 != previous.avg10 || current.avg60 != previous.avg60 || current.avg300 != previous.avg300;
+}
 
-    static int sampleCounter = 0;
-    ++sampleCounter;
-    if (sampleCounter % 10 == 0) {
-        LOG_D("CPU read ok: usage=%.2f total=%llu idle=%llu",
-              outData.usagePercent,
-              static_cast<unsigned long long>(outData.totalJiffies),
-              static_cast<unsigned long long>(outData.idleJiffies));
+bool pressureAveragesChanged(const xmonitor::PressureData& current, const xmonitor::PressureData& previous) {
+    const xmonitor::PressureResource* currentResources[] = {&current.cpu, &current.memory, &current.io};
+    const xmonitor::PressureResource* previousResources[] = {&previous.cpu, &previous.memory, &previous.io};
+    for (int i = 0; i < 3; ++i) {
+        if (currentResources[i]->available != previousResources[i]->available ||
+            stallAveragesChanged(currentResources[i]->some, previousResources[i]->some) ||
+            stallAveragesChanged(currentResources[i]->full, previousResources[i]->full)) {
+            return true;
+        }
     }
-
-    return true;
+    return false;
 }
 }
 
@@ -86,83 +77,92 @@ int main() {
     setLogFilePath("logs/xMonitor-cpu.log");
     LOG_I("CPU service start");
 
-    xmonitor::BinderClientAdapter binder;
+    xmonitor::ServiceSession session("CPU",
+                                     xmonitor::BinderTransactionCode::RegisterCpuService,
+                                     xmonitor::ProcessRole::CpuService);
 
+    xmonitor::CpuCollector collector;
     xmonitor::CpuData lastPublished{};
     bool hasLastPublished = false;
-    std::uint64_t previousTotal = 0;
-    std::uint64_t previousIdle = 0;
 
-    if (!binder.initialize()) {
-        LOG_E("CPU service binder initialize failed");
-        return 1;
-    }
+    xmonitor::PressureCollector pressureCollector;
+    xmonitor::PressureData lastPressure{};
+    std::uint64_t lastPressureNs = 0;
 
-    LOG_I("CPU service binder initialize success");
-
-    {
-        xmonitor::BinderAck ack{};
-        const std::uint32_t request = 1;
-        std::size_t replySize = 0;
-        if (!binder.transact(static_cast<std::uint32_t>(xmonitor::BinderTransactionCode::RegisterCpuService),
-                     &request,
-                     sizeof(request),
-                     &ack,
-                     sizeof(ack),
-                     replySize) ||
-            replySize != sizeof(ack) || ack.ok == 0) {
-            LOG_E("CPU service register to lifecycle failed");
-            binder.shutdown();
-            return 1;
-        }
-    }
+    xmonitor::InterruptCollector interruptCollector;
+    xmonitor::TopologyCollector topologyCollector;
+    std::uint64_t lastPerSecondNs = 0;
 
-    while (gRunning != 0) {
-        xmonitor::BinderAck ack{};
-        const std::uint32_t request = 1;
-        std::size_t replySize = 0;
-        if (binder.transact(static_cast<std::uint32_t>(xmonitor::BinderTransactionCode::WaitStart),
-                            &request,
-                            sizeof(request),
-                            &ack,
-                            sizeof(ack),
-                            replySize) &&
-            replySize == sizeof(ack) && ack.ok != 0 && ack.startGranted != 0) {
-            break;
-        }
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (!session.start(gRunning)) {
+        return 1;
     }
 
     if (gRunning == 0) {
-        binder.shutdown();
+        session.stop();
         LOG_I("CPU service stop");
         return 0;
     }
 
-    LOG_I("CPU service start streaming");
-
     while (gRunning != 0) {
+        if (session.takePolicyChange()) {
+            hasLastPublished = false;
+            lastPressureNs = 0;
+        }
+        const std::uint64_t nowNs = xmonitor::monotonicNowNs();
+
         xmonitor::CpuData current{};
-        if (readCpu(current, previousTotal, previousIdle)) {
-            if (!hasLastPublished || std::fabs(current.usagePercent - lastPublished.usagePercent) >= 0.01) {
+        if (session.sectionEnabled(xmonitor::BinderTransactionCode::CpuUpdated) && collector.sample(current)) {
+            if (!hasLastPublished || cpuChanged(current, lastPublished, session.deadband(kDeadbandPercent))) {
                 hasLastPublished = true;
                 lastPublished = current;
-                const bool sent = binder.send(static_cast<std::uint32_t>(xmonitor::BinderTransactionCode::CpuUpdated),
-                                              &current,
-                                              sizeof(current));
-                if (!sent) {
-                    LOG_E("CPU service binder send failed");
-                    binder.shutdown();
+                if (!session.publish(xmonitor::BinderTransactionCode::CpuUpdated, &current, sizeof(current))) {
+                    session.stop();
                     return 1;
                 }
             }
         }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        xmonitor::PressureData pressure{};
+        if (session.sectionEnabled(xmonitor::BinderTransactionCode::PressureUpdated) &&
+            pressureCollector.sample(pressure) &&
+            (nowNs - lastPressureNs >= kPressureRefreshNs || pressureAveragesChanged(pressure, lastPressure))) {
+            lastPressureNs = nowNs;
+            lastPressure = pressure;
+            if (!session.publish(xmonitor::BinderTransactionCode::PressureUpdated, &pressure, sizeof(pressure))) {
+                session.stop();
+                return 1;
+            }
+        }
+
+        // Rates move every second, so each sample is published.
+        if (nowNs - lastPerSecondNs >= kPerSecondNs) {
+            lastPerSecondNs = nowNs;
+            xmonitor::InterruptData interrupts{};
+            if (session.sectionEnabled(xmonitor::BinderTransactionCode::InterruptUpdated) &&
+                interruptCollector.sample(interrupts) &&
+                !session.publish(xmonitor::BinderTransactionCode::InterruptUpdated, &interrupts, sizeof(interrupts))) {
+                session.stop();
+                return 1;
+            }
+
+            xmonitor::TopologyData topology{};
+            if (session.sectionEnabled(xmonitor::BinderTransactionCode::TopologyUpdated) &&
+                topologyCollector.sample(topology) &&
+                !session.publish(xmonitor::BinderTransactionCode::TopologyUpdated, &topology, sizeof(topology))) {
+                session.stop();
+                return 1;
+            }
+        }
+
+        if (!session.onSampleTick()) {
+            session.stop();
+            return 1;
+        }
+
+        session.sleepUntilNextTick(kSamplePeriod);
     }
 
-    binder.shutdown();
+    session.stop();
     LOG_I("CPU service stop");
     return 0;
 }
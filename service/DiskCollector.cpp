@@ -0,0 +1,211 @@
+#include "service/DiskCollector.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/stat.h>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+#include "common/ProcfsRoot.h"
+#include "common/TextScan.h"
+
+namespace xmonitor {
+namespace {
+
+constexpr double kSectorBytes = 512.0;
+
+// Used when sysfs symlinks are unavailable (e.g. replaying a fixture).
+const char* kVirtualPrefixes[] = {"loop", "ram", "zram", "dm-", "md", "nbd"};
+
+std::uint64_t deviceKey(std::uint32_t major, std::uint32_t minor) {
+    return (static_cast<std::uint64_t>(major) << 32) | minor;
+}
+
+bool hasVirtualPrefix(const char* name) {
+    for (const char* prefix : kVirtualPrefixes) {
+        if (std::strncmp(name, prefix, std::strlen(prefix)) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+double perSecond(std::uint64_t delta, double windowSec) {
+    return windowSec > 0.0 ? static_cast<double>(delta) / windowSec : 0.0;
+}
+
+double awaitMs(std::uint64_t msDelta, std::uint64_t ioDelta) {
+    return ioDelta > 0 ? static_cast<double>(msDelta) / static_cast<double>(ioDelta) : 0.0;
+}
+
+} // namespace
+
+DiskCollector::DiskCollector()
+    : DiskCollector(Options{}) {}
+
+DiskCollector::DiskCollector(const Options& options)
+    : mOptions(options),
+      mDiskstatsFile(procPath("diskstats")),
+      mPreviousSampleNs(0) {}
+
+bool DiskCollector::classify(const DeviceState& state) const {
+    // Whole disks (including dm/md/loop) have an entry in /sys/block; partitions don't.
+    const std::string blockPath = sysPath("block/") + state.name;
+    struct stat info {};
+    const bool wholeDisk = ::stat(blockPath.c_str(), &info) == 0;
+    if (!wholeDisk && !mOptions.includePartitions) {
+        return false;
+    }
+
+    if (!mOptions.includeVirtual) {
+        char resolved[PATH_MAX];
+        const bool isVirtual = (::realpath(blockPath.c_str(), resolved) != nullptr &&
+                                std::strstr(resolved, "/devices/virtual/") != nullptr) ||
+                               hasVirtualPrefix(state.name);
+        if (isVirtual) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::size_t DiskCollector::indexFor(std::size_t position,
+                                   std::uint32_t major,
+                                   std::uint32_t minor,
+                                   const char* name,
+                                   std::size_t nameLength) {
+    const std::uint64_t key = deviceKey(major, minor);
+    if (position < mDevices.size() && mDevices[position].key == key) {
+        return position;
+    }
+
+    const auto found = mIndexByKey.find(key);
+    if (found != mIndexByKey.end()) {
+        return found->second;
+    }
+
+    DeviceState state;
+    state.key = key;
+    state.major = major;
+    state.minor = minor;
+    std::memcpy(state.name, name, std::min(nameLength, kDeviceNameLength - 1));
+    state.included = classify(state);
+    mIndexByKey.emplace(key, mDevices.size());
+    mDevices.push_back(state);
+    return mDevices.size() - 1;
+}
+
+void DiskCollector::relayout() {
+    std::vector<DeviceState> ordered;
+    ordered.reserve(mSeenOrder.size());
+    for (std::size_t index : mSeenOrder) {
+        ordered.push_back(mDevices[index]);
+    }
+
+    mDevices.swap(ordered);
+    mIndexByKey.clear();
+    for (std::size_t i = 0; i < mDevices.size(); ++i) {
+        mIndexByKey.emplace(mDevices[i].key, i);
+    }
+}
+
+bool DiskCollector::sample(DiskData& outData) {
+    if (!mDiskstatsFile.isOpen() || !mDiskstatsFile.read()) {
+        LOG_E("Disk read failed: cannot read %s", mDiskstatsFile.path().c_str());
+        return false;
+    }
+
+    const std::uint64_t nowNs = monotonicNowNs();
+    const double windowSec = mPreviousSampleNs != 0 ? static_cast<double>(nowNs - mPreviousSampleNs) / 1e9 : 0.0;
+    const double windowMs = windowSec * 1000.0;
+    mRanked.clear();
+    mSeenOrder.clear();
+
+    const char* cursor = mDiskstatsFile.data();
+    const char* end = mDiskstatsFile.end();
+    std::size_t position = 0;
+    bool layoutChanged = false;
+    while (cursor < end) {
+        std::uint64_t major = 0;
+        std::uint64_t minor = 0;
+        const char* name = nullptr;
+        if (!parseU64(cursor, end, major) || !parseU64(cursor, end, minor)) {
+            skipLine(cursor, end);
+            continue;
+        }
+        const std::size_t nameLength = readToken(cursor, end, name);
+
+        std::uint64_t counters[COUNTER_COUNT] = {};
+        for (std::size_t column = 0; column < COUNTER_COUNT; ++column) {
+            parseU64(cursor, end, counters[column]);
+        }
+        skipLine(cursor, end);
+
+        const std::size_t index =
+            indexFor(position, static_cast<std::uint32_t>(major), static_cast<std::uint32_t>(minor), name, nameLength);
+        layoutChanged = layoutChanged || index != position;
+        mSeenOrder.push_back(index);
+        DeviceState& state = mDevices[index];
+        ++position;
+
+        // Devices that never completed an I/O (unused loop/ram slots) are noise.
+        const bool everUsed = counters[COUNTER_READS] != 0 || counters[COUNTER_WRITES] != 0;
+        if (state.included && everUsed && state.hasPrevious && windowSec > 0.0) {
+            std::uint64_t delta[COUNTER_COUNT];
+            for (std::size_t column = 0; column < COUNTER_COUNT; ++column) {
+                delta[column] = counters[column] >= state.counters[column] ? counters[column] - state.counters[column] : 0;
+            }
+
+            DiskDeviceStats stats;
+            std::memcpy(stats.name, state.name, sizeof(stats.name));
+            stats.major = state.major;
+            stats.minor = state.minor;
+            stats.readsPerSec = perSecond(delta[COUNTER_READS], windowSec);
+            stats.writesPerSec = perSecond(delta[COUNTER_WRITES], windowSec);
+            stats.readBytesPerSec = perSecond(delta[COUNTER_READ_SECTORS], windowSec) * kSectorBytes;
+            stats.writeBytesPerSec = perSecond(delta[COUNTER_WRITE_SECTORS], windowSec) * kSectorBytes;
+            stats.readAwaitMs = awaitMs(delta[COUNTER_READ_MS], delta[COUNTER_READS]);
+            stats.writeAwaitMs = awaitMs(delta[COUNTER_WRITE_MS], delta[COUNTER_WRITES]);
+            stats.queueDepth = static_cast<double>(delta[COUNTER_WEIGHTED_MS]) / windowMs;
+            stats.utilizationPercent = std::min(100.0, static_cast<double>(delta[COUNTER_IO_MS]) * 100.0 / windowMs);
+            stats.inFlight = counters[COUNTER_IN_FLIGHT];
+            mRanked.push_back(stats);
+        }
+
+        std::memcpy(state.counters, counters, sizeof(counters));
+        state.hasPrevious = true;
+    }
+
+    if (layoutChanged || position != mDevices.size()) {
+        relayout();
+    }
+
+    const std::size_t kept = std::min(mRanked.size(), kMaxDiskDevices);
+    std::partial_sort(mRanked.begin(), mRanked.begin() + static_cast<std::ptrdiff_t>(kept), mRanked.end(),
+                      [](const DiskDeviceStats& left, const DiskDeviceStats& right) {
+                          if (left.utilizationPercent != right.utilizationPercent) {
+                              return left.utilizationPercent > right.utilizationPercent;
+                          }
+                          const double leftBytes = left.readBytesPerSec + left.writeBytesPerSec;
+                          const double rightBytes = right.readBytesPerSec + right.writeBytesPerSec;
+                          if (leftBytes != rightBytes) {
+                              return leftBytes > rightBytes;
+                          }
+                          // Stable order for idle devices keeps unchanged ticks byte-identical.
+                          return deviceKey(left.major, left.minor) < deviceKey(right.major, right.minor);
+                      });
+
+    outData.matchedDevices = static_cast<std::uint32_t>(mRanked.size());
+    outData.deviceCount = static_cast<std::uint32_t>(kept);
+    std::copy(mRanked.begin(), mRanked.begin() + static_cast<std::ptrdiff_t>(kept), outData.devices);
+    std::fill(outData.devices + kept, outData.devices + kMaxDiskDevices, DiskDeviceStats{});
+    outData.trace.sampleNs = nowNs;
+    mPreviousSampleNs = nowNs;
+    return true;
+}
+
+} // namespace xmonitor
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/ProcFile.h"
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// Per-device IOPS, throughput, await and utilization from <procRoot>/diskstats.
+// Device state persists across samples in diskstats order: a line is matched
+// to its previous counters by position first and (major, minor) second, and
+// the sysfs partition/virtual classification runs only when a device first
+// appears. The table is re-laid out only when devices come or go.
+class DiskCollector {
+public:
+    struct Options {
+        bool includePartitions{false};
+        bool includeVirtual{true};
+    };
+
+    DiskCollector();
+    explicit DiskCollector(const Options& options);
+
+    bool sample(DiskData& outData);
+
+private:
+    enum Counter : std::size_t {
+        COUNTER_READS = 0,
+        COUNTER_READ_MERGES,
+        COUNTER_READ_SECTORS,
+        COUNTER_READ_MS,
+        COUNTER_WRITES,
+        COUNTER_WRITE_MERGES,
+        COUNTER_WRITE_SECTORS,
+        COUNTER_WRITE_MS,
+        COUNTER_IN_FLIGHT,
+        COUNTER_IO_MS,
+        COUNTER_WEIGHTED_MS,
+        COUNTER_COUNT
+    };
+
+    struct DeviceState {
+        std::uint64_t key{0};
+        char name[kDeviceNameLength]{};
+        std::uint32_t major{0};
+        std::uint32_t minor{0};
+        bool included{false};
+        bool hasPrevious{false};
+        std::uint64_t counters[COUNTER_COUNT]{};
+    };
+
+    std::size_t indexFor(std::size_t position, std::uint32_t major, std::uint32_t minor, const char* name, std::size_t nameLength);
+    bool classify(const DeviceState& state) const;
+    void relayout();
+
+    Options mOptions;
+    ProcFile mDiskstatsFile;
+    std::vector<DeviceState> mDevices;
+    std::unordered_map<std::uint64_t, std::size_t> mIndexByKey;
+    std::vector<std::size_t> mSeenOrder;
+    std::vector<DiskDeviceStats> mRanked;
+    std::uint64_t mPreviousSampleNs;
+};
+
+} // namespace xmonitor
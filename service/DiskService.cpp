@@ -0,0 +1,128 @@
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "Logger.h"
+#include "common/Config.h"
+#include "ipc/BinderProtocol.h"
+#include "service/DiskCollector.h"
+#include "service/FilesystemCollector.h"
+#include "service/ServiceSession.h"
+
+namespace {
+volatile std::sig_atomic_t gRunning = 1;
+
+// diskstats rates over 100ms windows are mostly quantisation noise, so disks
+// are sampled once per second.
+constexpr auto kSamplePeriod = std::chrono::milliseconds(1000);
+
+// statvfs refresh interval and hang timeout. A timeout near 0 would declare
+// every call hung and respawn the worker on each sample.
+constexpr double kDefaultFsIntervalSec = 10.0;
+constexpr double kDefaultFsTimeoutSec = 2.0;
+constexpr double kMinFsSec = 0.1;
+constexpr double kMaxFsSec = 3600.0;
+
+void signalHandler(int) {
+    gRunning = 0;
+}
+
+bool diskChanged(const xmonitor::DiskData& current, const xmonitor::DiskData& previous) {
+    return std::memcmp(&current, &previous, offsetof(xmonitor::DiskData, trace)) != 0;
+}
+
+bool filesystemsChanged(const xmonitor::FilesystemData& current, const xmonitor::FilesystemData& previous) {
+    return std::memcmp(&current, &previous, offsetof(xmonitor::FilesystemData, trace)) != 0;
+}
+}
+
+int main() {
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+
+    setLogFilePath("logs/xMonitor-disk.log");
+    LOG_I("Disk service start");
+
+    xmonitor::ServiceSession session("Disk",
+                                     xmonitor::BinderTransactionCode::RegisterDiskService,
+                                     xmonitor::ProcessRole::DiskService);
+
+    xmonitor::DiskCollector::Options options;
+    options.includePartitions = xmonitor::envBool("XMONITOR_DISK_PARTITIONS", false);
+    options.includeVirtual = xmonitor::envBool("XMONITOR_DISK_VIRTUAL", true);
+    xmonitor::DiskCollector collector(options);
+
+    // statvfs() results change slowly and a hung mount may block the call,
+    // so filesystems are refreshed off-thread every few seconds.
+    xmonitor::FilesystemCollector::Options fsOptions;
+    double fsIntervalSec = kDefaultFsIntervalSec;
+    if (!xmonitor::envNumber("XMONITOR_FS_INTERVAL_SEC", kMinFsSec, kMaxFsSec, fsIntervalSec)) {
+        LOG_W("Disk service: XMONITOR_FS_INTERVAL_SEC must be %g..%g, using %g", kMinFsSec, kMaxFsSec, fsIntervalSec);
+    }
+    double fsTimeoutSec = kDefaultFsTimeoutSec;
+    if (!xmonitor::envNumber("XMONITOR_FS_TIMEOUT_SEC", kMinFsSec, kMaxFsSec, fsTimeoutSec)) {
+        LOG_W("Disk service: XMONITOR_FS_TIMEOUT_SEC must be %g..%g, using %g", kMinFsSec, kMaxFsSec, fsTimeoutSec);
+    }
+    fsOptions.refreshNs = static_cast<std::uint64_t>(fsIntervalSec * 1e9);
+    fsOptions.timeoutNs = static_cast<std::uint64_t>(fsTimeoutSec * 1e9);
+    xmonitor::FilesystemCollector fsCollector(fsOptions);
+
+    xmonitor::DiskData lastPublished{};
+    bool hasLastPublished = false;
+    xmonitor::FilesystemData lastFilesystems{};
+    bool hasLastFilesystems = false;
+
+    if (!session.start(gRunning)) {
+        return 1;
+    }
+
+    if (gRunning == 0) {
+        session.stop();
+        LOG_I("Disk service stop");
+        return 0;
+    }
+
+    while (gRunning != 0) {
+        if (session.takePolicyChange()) {
+            hasLastPublished = false;
+            hasLastFilesystems = false;
+        }
+
+        xmonitor::DiskData current{};
+        if (session.sectionEnabled(xmonitor::BinderTransactionCode::DiskUpdated) && collector.sample(current)) {
+            if (!hasLastPublished || diskChanged(current, lastPublished)) {
+                hasLastPublished = true;
+                lastPublished = current;
+                if (!session.publish(xmonitor::BinderTransactionCode::DiskUpdated, &current, sizeof(current))) {
+                    session.stop();
+                    return 1;
+                }
+            }
+        }
+
+        xmonitor::FilesystemData filesystems{};
+        if (session.sectionEnabled(xmonitor::BinderTransactionCode::FilesystemUpdated) && fsCollector.sample(filesystems)) {
+            if (!hasLastFilesystems || filesystemsChanged(filesystems, lastFilesystems)) {
+                hasLastFilesystems = true;
+                lastFilesystems = filesystems;
+                if (!session.publish(xmonitor::BinderTransactionCode::FilesystemUpdated, &filesystems, sizeof(filesystems))) {
+                    session.stop();
+                    return 1;
+                }
+            }
+        }
+
+        if (!session.onSampleTick()) {
+            session.stop();
+            return 1;
+        }
+
+        session.sleepUntilNextTick(kSamplePeriod);
+    }
+
+    session.stop();
+    LOG_I("Disk service stop");
+    return 0;
+}
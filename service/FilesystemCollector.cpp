@@ -0,0 +1,413 @@
+#include "service/FilesystemCollector.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+
+#include <poll.h>
+#include <sys/statvfs.h>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+#include "common/ProcfsRoot.h"
+#include "common/TextScan.h"
+
+namespace xmonitor {
+namespace {
+
+// Pseudo filesystems, plus read-only images that always read as 100% full.
+const char* kSkippedTypes[] = {
+    "autofs", "binfmt_misc", "bpf", "cgroup", "cgroup2", "configfs", "debugfs", "devpts", "devtmpfs",
+    "efivarfs", "fusectl", "hugetlbfs", "iso9660", "mqueue", "nfsd", "nsfs", "proc", "pstore",
+    "ramfs", "rpc_pipefs", "securityfs", "selinuxfs", "squashfs", "sysfs", "tracefs",
+};
+
+bool isSkippedType(const char* type, std::size_t length) {
+    for (const char* skipped : kSkippedTypes) {
+        if (std::strlen(skipped) == length && std::memcmp(skipped, type, length) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// mountinfo escapes space, tab, newline and backslash as \ooo.
+std::string unescapeField(const char* text, std::size_t length) {
+    std::string value;
+    value.reserve(length);
+    for (std::size_t i = 0; i < length; ++i) {
+        if (text[i] == '\\' && i + 3 < length && text[i + 1] >= '0' && text[i + 1] <= '3') {
+            value += static_cast<char>(((text[i + 1] - '0') << 6) | ((text[i + 2] - '0') << 3) | (text[i + 3] - '0'));
+            i += 3;
+        } else {
+            value += text[i];
+        }
+    }
+    return value;
+}
+
+template <std::size_t N>
+void copyField(const char* text, std::size_t length, char (&outField)[N]) {
+    std::memset(outField, 0, N);
+    std::memcpy(outField, text, std::min(length, N - 1));
+}
+
+double percentOf(std::uint64_t part, std::uint64_t whole) {
+    return whole > 0 ? static_cast<double>(part) * 100.0 / static_cast<double>(whole) : 0.0;
+}
+
+} // namespace
+
+struct FilesystemCollector::Worker {
+    struct Request {
+        std::uint32_t mountId;
+        std::string path;
+    };
+
+    struct Result {
+        std::uint32_t mountId;
+        bool ok;
+        struct statvfs info;
+    };
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<Request> requests;
+    std::vector<Result> results;
+    bool hasRequest{false};
+    bool hasResults{false};
+    bool stop{false};
+    bool busy{false};
+    std::uint32_t callMountId{0};
+    std::uint64_t callStartNs{0};
+};
+
+FilesystemCollector::FilesystemCollector()
+    : FilesystemCollector(Options{}) {}
+
+FilesystemCollector::FilesystemCollector(const Options& options)
+    : mOptions(options),
+      mMountinfo(procPath("self/mountinfo")),
+      mNeedsParse(true),
+      mMountTableChanges(0),
+      mNextRefreshNs(0) {
+    startWorker();
+}
+
+FilesystemCollector::~FilesystemCollector() {
+    bool busy = false;
+    {
+        std::lock_guard<std::mutex> lock(mWorker->mutex);
+        mWorker->stop = true;
+        busy = mWorker->busy;
+    }
+    mWorker->wake.notify_all();
+    // A worker stuck in statvfs() may never return; don't wait for it.
+    if (busy) {
+        mWorkerThread.detach();
+    } else {
+        mWorkerThread.join();
+    }
+}
+
+void FilesystemCollector::startWorker() {
+    mWorker = std::make_shared<Worker>();
+    std::shared_ptr<Worker> worker = mWorker;
+    mWorkerThread = std::thread([worker]() {
+        std::unique_lock<std::mutex> lock(worker->mutex);
+        for (;;) {
+            worker->wake.wait(lock, [&worker]() { return worker->stop || worker->hasRequest; });
+            if (worker->stop) {
+                return;
+            }
+
+            std::vector<Worker::Request> batch;
+            batch.swap(worker->requests);
+            worker->hasRequest = false;
+            worker->busy = true;
+
+            for (const Worker::Request& request : batch) {
+                worker->callMountId = request.mountId;
+                worker->callStartNs = monotonicNowNs();
+                lock.unlock();
+
+                Worker::Result result{};
+                result.mountId = request.mountId;
+                result.ok = ::statvfs(request.path.c_str(), &result.info) == 0;
+
+                lock.lock();
+                if (worker->stop) {
+                    worker->busy = false;
+                    return;
+                }
+                // Published one by one so a later hang doesn't lose them.
+                worker->results.push_back(result);
+                worker->hasResults = true;
+            }
+
+            worker->busy = false;
+            worker->callStartNs = 0;
+        }
+    });
+}
+
+void FilesystemCollector::abandonWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mWorker->mutex);
+        mWorker->stop = true;
+    }
+    mWorker->wake.notify_all();
+    // The thread owns the Worker through its shared_ptr and exits whenever
+    // the stuck call returns; until then it is tracked so the same mount is
+    // not retried into a second stuck thread.
+    mWorkerThread.detach();
+    mAbandoned.push_back(mWorker);
+    startWorker();
+}
+
+bool FilesystemCollector::mountTableChanged() {
+    pollfd entry{};
+    entry.fd = mMountinfo.fd();
+    entry.events = POLLPRI;
+    return ::poll(&entry, 1, 0) > 0 && (entry.revents & (POLLPRI | POLLERR)) != 0;
+}
+
+void FilesystemCollector::parseMountinfo() {
+    if (!mMountinfo.read()) {
+        LOG_E("Filesystem read failed: cannot read %s", mMountinfo.path().c_str());
+        return;
+    }
+
+    // "36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 - ext3 /dev/root rw"
+    std::vector<MountState> mounts;
+    std::vector<std::uint64_t> devices;
+    const char* cursor = mMountinfo.data();
+    const char* end = mMountinfo.end();
+    while (cursor < end) {
+        std::uint64_t id = 0;
+        std::uint64_t major = 0;
+        std::uint64_t minor = 0;
+        const char* mountPoint = nullptr;
+        if (!parseU64(cursor, end, id)) {
+            skipLine(cursor, end);
+            continue;
+        }
+        skipToken(cursor, end);
+        if (!parseU64(cursor, end, major) || !consume(cursor, end, ":") || !parseU64(cursor, end, minor)) {
+            skipLine(cursor, end);
+            continue;
+        }
+        skipToken(cursor, end);
+        const std::size_t mountPointLength = readToken(cursor, end, mountPoint);
+        skipToken(cursor, end);
+
+        // Optional fields run up to a lone "-".
+        const char* token = nullptr;
+        std::size_t tokenLength = 0;
+        do {
+            tokenLength = readToken(cursor, end, token);
+        } while (tokenLength > 0 && !(tokenLength == 1 && *token == '-'));
+
+        const char* type = nullptr;
+        const char* source = nullptr;
+        const std::size_t typeLength = readToken(cursor, end, type);
+        const std::size_t sourceLength = readToken(cursor, end, source);
+        skipLine(cursor, end);
+        if (typeLength == 0 || isSkippedType(type, typeLength)) {
+            continue;
+        }
+
+        // Bind mounts repeat their device; the first mount point wins.
+        const std::uint64_t device = (major << 32) | minor;
+        if (std::find(devices.begin(), devices.end(), device) != devices.end()) {
+            continue;
+        }
+        devices.push_back(device);
+
+        MountState state;
+        state.id = static_cast<std::uint32_t>(id);
+        state.path = unescapeField(mountPoint, mountPointLength);
+        const auto previous = std::find_if(mMounts.begin(), mMounts.end(), [&state](const MountState& mount) {
+            return mount.id == state.id;
+        });
+        if (previous != mMounts.end()) {
+            state.stats = previous->stats;
+        }
+        copyField(state.path.data(), state.path.size(), state.stats.mountPoint);
+        copyField(type, typeLength, state.stats.fsType);
+        copyField(source, sourceLength, state.stats.source);
+        mounts.push_back(std::move(state));
+    }
+
+    if (!mNeedsParse) {
+        ++mMountTableChanges;
+    }
+    mMounts.swap(mounts);
+    // New mounts get their first statvfs on the next tick.
+    mNextRefreshNs = 0;
+    LOG_I("Filesystems: %zu mounts tracked", mMounts.size());
+}
+
+void FilesystemCollector::collectResults() {
+    std::vector<Worker::Result> results;
+    {
+        std::lock_guard<std::mutex> lock(mWorker->mutex);
+        if (!mWorker->hasResults) {
+            return;
+        }
+        results.swap(mWorker->results);
+        mWorker->hasResults = false;
+    }
+
+    for (const Worker::Result& result : results) {
+        const auto mount = std::find_if(mMounts.begin(), mMounts.end(), [&result](const MountState& state) {
+            return state.id == result.mountId;
+        });
+        if (mount == mMounts.end()) {
+            continue;
+        }
+
+        FilesystemStats& stats = mount->stats;
+        if (!result.ok) {
+            stats.state = FS_STATE_ERROR;
+            continue;
+        }
+
+        const struct statvfs& info = result.info;
+        const std::uint64_t blockSize = info.f_frsize != 0 ? info.f_frsize : info.f_bsize;
+        stats.state = FS_STATE_OK;
+        stats.totalBytes = static_cast<std::uint64_t>(info.f_blocks) * blockSize;
+        stats.usedBytes = static_cast<std::uint64_t>(info.f_blocks - info.f_bfree) * blockSize;
+        stats.availableBytes = static_cast<std::uint64_t>(info.f_bavail) * blockSize;
+        stats.totalInodes = info.f_files;
+        stats.usedInodes = info.f_files >= info.f_ffree ? info.f_files - info.f_ffree : 0;
+        stats.usedPercent = percentOf(stats.usedBytes, stats.usedBytes + stats.availableBytes);
+        stats.inodeUsedPercent = percentOf(stats.usedInodes, stats.totalInodes);
+    }
+}
+
+void FilesystemCollector::checkTimeout(std::uint64_t nowNs) {
+    std::uint32_t stuckMountId = 0;
+    {
+        std::lock_guard<std::mutex> lock(mWorker->mutex);
+        if (!mWorker->busy || mWorker->callStartNs == 0 || nowNs - mWorker->callStartNs < mOptions.timeoutNs) {
+            return;
+        }
+        stuckMountId = mWorker->callMountId;
+    }
+
+    for (MountState& mount : mMounts) {
+        if (mount.id == stuckMountId) {
+            mount.stats.state = FS_STATE_HUNG;
+            LOG_W("Filesystem %s: statvfs still blocked after %llu ms, skipping it",
+                  mount.path.c_str(),
+                  static_cast<unsigned long long>(mOptions.timeoutNs / 1000000ull));
+        }
+    }
+
+    // Keep what the worker finished before it got stuck; the rest of the
+    // batch is re-requested right away.
+    collectResults();
+    abandonWorker();
+    mNextRefreshNs = 0;
+}
+
+bool FilesystemCollector::stuckOn(std::uint32_t mountId) const {
+    for (const std::shared_ptr<Worker>& worker : mAbandoned) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        if (worker->busy && worker->callMountId == mountId) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FilesystemCollector::requestRefresh() {
+    mAbandoned.erase(std::remove_if(mAbandoned.begin(), mAbandoned.end(),
+                                    [](const std::shared_ptr<Worker>& worker) {
+                                        std::lock_guard<std::mutex> lock(worker->mutex);
+                                        return !worker->busy;
+                                    }),
+                     mAbandoned.end());
+
+    std::vector<Worker::Request> requests;
+    requests.reserve(mMounts.size());
+    for (const MountState& mount : mMounts) {
+        if (mount.stats.state == FS_STATE_HUNG && stuckOn(mount.id)) {
+            continue;
+        }
+        requests.push_back({mount.id, mount.path});
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mWorker->mutex);
+        mWorker->requests.swap(requests);
+        mWorker->hasRequest = true;
+    }
+    mWorker->wake.notify_one();
+}
+
+bool FilesystemCollector::sample(FilesystemData& outData) {
+    if (!mMountinfo.isOpen()) {
+        LOG_E("Filesystem read failed: cannot open %s", mMountinfo.path().c_str());
+        return false;
+    }
+
+    const std::uint64_t nowNs = monotonicNowNs();
+    if (mNeedsParse || mountTableChanged()) {
+        parseMountinfo();
+        mNeedsParse = false;
+    }
+
+    collectResults();
+    checkTimeout(nowNs);
+
+    bool workerIdle = false;
+    {
+        std::lock_guard<std::mutex> lock(mWorker->mutex);
+        workerIdle = !mWorker->busy && !mWorker->hasRequest;
+    }
+    if (workerIdle && nowNs >= mNextRefreshNs) {
+        requestRefresh();
+        mNextRefreshNs = nowNs + mOptions.refreshNs;
+    }
+
+    mRanked.clear();
+    std::uint32_t hung = 0;
+    for (const MountState& mount : mMounts) {
+        mRanked.push_back(&mount.stats);
+        if (mount.stats.state == FS_STATE_HUNG) {
+            ++hung;
+        }
+    }
+
+    const std::size_t kept = std::min(mRanked.size(), kMaxFilesystems);
+    std::partial_sort(mRanked.begin(), mRanked.begin() + static_cast<std::ptrdiff_t>(kept), mRanked.end(),
+                      [](const FilesystemStats* left, const FilesystemStats* right) {
+                          const bool leftHung = left->state == FS_STATE_HUNG;
+                          const bool rightHung = right->state == FS_STATE_HUNG;
+                          if (leftHung != rightHung) {
+                              return leftHung;
+                          }
+                          const double leftFull = std::max(left->usedPercent, left->inodeUsedPercent);
+                          const double rightFull = std::max(right->usedPercent, right->inodeUsedPercent);
+                          if (leftFull != rightFull) {
+                              return leftFull > rightFull;
+                          }
+                          return std::strcmp(left->mountPoint, right->mountPoint) < 0;
+                      });
+
+    for (std::size_t i = 0; i < kept; ++i) {
+        outData.filesystems[i] = *mRanked[i];
+    }
+    std::fill(outData.filesystems + kept, outData.filesystems + kMaxFilesystems, FilesystemStats{});
+    outData.filesystemCount = static_cast<std::uint32_t>(kept);
+    outData.matchedFilesystems = static_cast<std::uint32_t>(mMounts.size());
+    outData.hungFilesystems = hung;
+    outData.mountTableChanges = mMountTableChanges;
+    outData.trace.sampleNs = nowNs;
+    return true;
+}
+
+} // namespace xmonitor
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/ProcFile.h"
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// Capacity and inode usage of real (non-pseudo) filesystems. The mount list
+// comes from <procRoot>/self/mountinfo and is re-parsed only when poll()
+// reports a mount table change. statvfs() runs on a worker thread at
+// refreshNs, so a hung NFS/FUSE mount never blocks sample(): a call still
+// running after timeoutNs marks that mount hung, and the stuck worker is
+// abandoned and replaced. Hung mounts are retried once the stuck call has
+// returned.
+class FilesystemCollector {
+public:
+    struct Options {
+        std::uint64_t refreshNs{10000000000ull};
+        std::uint64_t timeoutNs{2000000000ull};
+    };
+
+    FilesystemCollector();
+    explicit FilesystemCollector(const Options& options);
+    ~FilesystemCollector();
+
+    FilesystemCollector(const FilesystemCollector&) = delete;
+    FilesystemCollector& operator=(const FilesystemCollector&) = delete;
+
+    bool sample(FilesystemData& outData);
+
+private:
+    struct Worker;
+
+    struct MountState {
+        std::uint32_t id{0};
+        std::string path;
+        FilesystemStats stats{};
+    };
+
+    bool mountTableChanged();
+    void parseMountinfo();
+    void startWorker();
+    void abandonWorker();
+    void collectResults();
+    void checkTimeout(std::uint64_t nowNs);
+    void requestRefresh();
+    bool stuckOn(std::uint32_t mountId) const;
+
+    Options mOptions;
+    ProcFile mMountinfo;
+    bool mNeedsParse;
+    std::uint64_t mMountTableChanges;
+    std::vector<MountState> mMounts;
+    std::vector<const FilesystemStats*> mRanked;
+    std::shared_ptr<Worker> mWorker;
+    std::thread mWorkerThread;
+    std::vector<std::shared_ptr<Worker>> mAbandoned;
+    std::uint64_t mNextRefreshNs;
+};
+
+} // namespace xmonitor
@@ -0,0 +1,316 @@
+#include "service/InterruptCollector.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+#include "common/ProcfsRoot.h"
+#include "common/TextScan.h"
+
+namespace xmonitor {
+namespace {
+
+// "procs_running 3" style lines near the end of /proc/stat, after the long
+// per-CPU and intr lines; the buffer is NUL-terminated.
+bool findStatValue(const ProcFile& file, const char* key, std::uint64_t& outValue) {
+    const char* found = std::strstr(file.data(), key);
+    if (found == nullptr) {
+        return false;
+    }
+    const char* cursor = found + std::strlen(key);
+    return parseU64(cursor, file.end(), outValue);
+}
+
+// Rest of the line with whitespace runs collapsed ("IO-APIC 2-edge timer").
+std::string collapseLabel(const char*& cursor, const char* end) {
+    std::string label;
+    skipBlanks(cursor, end);
+    while (cursor < end && *cursor != '\n') {
+        const char* token = nullptr;
+        const std::size_t length = readToken(cursor, end, token);
+        if (length == 0) {
+            break;
+        }
+        if (!label.empty()) {
+            label += ' ';
+        }
+        label.append(token, length);
+    }
+    return label;
+}
+
+} // namespace
+
+InterruptCollector::InterruptCollector()
+    : mLoadFile(procPath("loadavg")),
+      mStatFile(procPath("stat")),
+      mPreviousSampleNs(0) {
+    mInterrupts.file.open(procPath("interrupts"));
+    mSoftirqs.file.open(procPath("softirqs"));
+}
+
+bool InterruptCollector::readLoad(InterruptData& outData) {
+    if (!mLoadFile.isOpen() || !mLoadFile.read()) {
+        return false;
+    }
+
+    // "0.23 0.20 0.12 1/72 7245"
+    const char* cursor = mLoadFile.data();
+    const char* end = mLoadFile.end();
+    std::uint64_t runnable = 0;
+    std::uint64_t total = 0;
+    if (!parseDecimal(cursor, end, outData.load1) || !parseDecimal(cursor, end, outData.load5) ||
+        !parseDecimal(cursor, end, outData.load15) || !parseU64(cursor, end, runnable) ||
+        !consume(cursor, end, "/") || !parseU64(cursor, end, total)) {
+        return false;
+    }
+    outData.runnableTasks = static_cast<std::uint32_t>(runnable);
+    outData.totalTasks = static_cast<std::uint32_t>(total);
+    return true;
+}
+
+bool InterruptCollector::readRunQueue(InterruptData& outData) {
+    if (!mStatFile.isOpen() || !mStatFile.read()) {
+        return false;
+    }
+
+    std::uint64_t running = 0;
+    std::uint64_t blocked = 0;
+    if (!findStatValue(mStatFile, "procs_running ", running) || !findStatValue(mStatFile, "procs_blocked ", blocked)) {
+        return false;
+    }
+    outData.procsRunning = static_cast<std::uint32_t>(running);
+    outData.procsBlocked = static_cast<std::uint32_t>(blocked);
+    return true;
+}
+
+bool InterruptCollector::readTable(CounterTable& table, bool withLabels) {
+    if (!table.file.isOpen() || !table.file.read()) {
+        return false;
+    }
+
+    const char* cursor = table.file.data();
+    const char* end = table.file.end();
+
+    // Header: one "CPUn" column per online CPU.
+    std::size_t cpuCount = 0;
+    while (cursor < end && *cursor != '\n') {
+        const char* token = nullptr;
+        const std::size_t length = readToken(cursor, end, token);
+        if (length == 0) {
+            break;
+        }
+        if (startsWith(token, token + length, "CPU")) {
+            ++cpuCount;
+        }
+    }
+    skipLine(cursor, end);
+    if (cpuCount == 0) {
+        return false;
+    }
+
+    // Row names are compared in place; they are only copied (and the
+    // previous counters dropped) when an IRQ appears/disappears or a CPU
+    // goes on/offline.
+    bool layoutChanged = cpuCount != table.cpuCount;
+    if (layoutChanged) {
+        table.cpuCount = cpuCount;
+        table.rowNames.clear();
+        table.rowLabels.clear();
+    }
+
+    std::size_t row = 0;
+    while (cursor < end) {
+        const char* name = nullptr;
+        std::size_t nameLength = readToken(cursor, end, name);
+        if (nameLength < 2 || name[nameLength - 1] != ':') {
+            skipLine(cursor, end);
+            continue;
+        }
+        --nameLength;
+
+        const bool knownRow =
+            row < table.rowNames.size() && table.rowNames[row].compare(0, std::string::npos, name, nameLength) == 0;
+        if (!knownRow) {
+            layoutChanged = true;
+            table.rowNames.resize(row);
+            table.rowLabels.resize(row);
+            table.rowNames.emplace_back(name, nameLength);
+        }
+
+        if (table.current.size() < (row + 1) * cpuCount) {
+            table.current.resize((row + 1) * cpuCount);
+        }
+        std::uint32_t* counters = table.current.data() + row * cpuCount;
+        std::size_t cpu = 0;
+        std::uint64_t value = 0;
+        while (cpu < cpuCount && parseU64(cursor, end, value)) {
+            counters[cpu++] = static_cast<std::uint32_t>(value);
+        }
+        // ERR/MIS are single system-wide counters, not a per-CPU column.
+        const std::size_t parsed = cpu;
+        if (parsed == 1 && cpuCount > 1) {
+            counters[0] = 0;
+        }
+        std::fill(counters + parsed, counters + cpuCount, 0u);
+
+        if (!knownRow) {
+            table.rowLabels.push_back(withLabels ? collapseLabel(cursor, end) : std::string());
+        }
+        skipLine(cursor, end);
+        ++row;
+    }
+
+    if (row != table.rowNames.size()) {
+        layoutChanged = true;
+        table.rowNames.resize(row);
+        table.rowLabels.resize(row);
+    }
+
+    const std::size_t counterCount = row * cpuCount;
+    table.rowCount = row;
+    table.current.resize(counterCount);
+    if (layoutChanged) {
+        table.previous.assign(counterCount, 0);
+        table.delta.assign(counterCount, 0);
+        table.rowTotals.assign(row, 0);
+        table.cpuTotals.assign(cpuCount, 0);
+        table.hasPrevious = false;
+    }
+    return true;
+}
+
+void InterruptCollector::computeDeltas(CounterTable& table) {
+    const std::size_t cpuCount = table.cpuCount;
+    const std::size_t counterCount = table.rowCount * cpuCount;
+    std::uint32_t* delta = table.delta.data();
+    std::uint64_t* cpuTotals = table.cpuTotals.data();
+
+    if (table.hasPrevious) {
+        const std::uint32_t* current = table.current.data();
+        const std::uint32_t* previous = table.previous.data();
+        for (std::size_t i = 0; i < counterCount; ++i) {
+            delta[i] = current[i] - previous[i];
+        }
+
+        std::fill(table.cpuTotals.begin(), table.cpuTotals.end(), 0);
+        for (std::size_t row = 0; row < table.rowCount; ++row) {
+            const std::uint32_t* rowDelta = delta + row * cpuCount;
+            std::uint64_t rowTotal = 0;
+            for (std::size_t cpu = 0; cpu < cpuCount; ++cpu) {
+                rowTotal += rowDelta[cpu];
+                cpuTotals[cpu] += rowDelta[cpu];
+            }
+            table.rowTotals[row] = rowTotal;
+        }
+    }
+
+    // The counters just read become the baseline; no copy.
+    table.current.swap(table.previous);
+    table.hasPrevious = true;
+}
+
+void InterruptCollector::fillLine(const CounterTable& table,
+                                  std::size_t row,
+                                  double windowSec,
+                                  InterruptLineStats& outLine) {
+    const std::string& name = table.rowNames[row];
+    std::memcpy(outLine.name, name.data(), std::min(name.size(), kInterruptNameLength - 1));
+
+    // Device names are at the end of the label, so keep its tail.
+    const std::string& label = table.rowLabels[row];
+    std::size_t labelStart = label.size() - std::min(label.size(), kInterruptLabelLength - 1);
+    while (labelStart < label.size() && label[labelStart] == ' ') {
+        ++labelStart;
+    }
+    std::memcpy(outLine.label, label.data() + labelStart, label.size() - labelStart);
+
+    const std::uint64_t total = table.rowTotals[row];
+    outLine.perSec = static_cast<double>(total) / windowSec;
+
+    const std::uint32_t* rowDelta = table.delta.data() + row * table.cpuCount;
+    const std::uint32_t* busiest = std::max_element(rowDelta, rowDelta + table.cpuCount);
+    outLine.busiestCpu = static_cast<std::uint32_t>(busiest - rowDelta);
+    outLine.busiestCpuPercent = total > 0 ? static_cast<double>(*busiest) * 100.0 / static_cast<double>(total) : 0.0;
+}
+
+bool InterruptCollector::sample(InterruptData& outData) {
+    const std::uint64_t nowNs = monotonicNowNs();
+    const double windowSec = mPreviousSampleNs != 0 ? static_cast<double>(nowNs - mPreviousSampleNs) / 1e9 : 0.0;
+
+    const bool hasLoad = readLoad(outData);
+    const bool hasRunQueue = readRunQueue(outData);
+    const bool hasInterrupts = readTable(mInterrupts, true);
+    const bool hasSoftirqs = readTable(mSoftirqs, false);
+    if (!hasLoad && !hasRunQueue && !hasInterrupts && !hasSoftirqs) {
+        LOG_E("Interrupt read failed: cannot read %s", mLoadFile.path().c_str());
+        return false;
+    }
+
+    if (hasInterrupts) {
+        const bool hasWindow = mInterrupts.hasPrevious && windowSec > 0.0;
+        computeDeltas(mInterrupts);
+        outData.cpuCount = static_cast<std::uint32_t>(mInterrupts.cpuCount);
+        outData.interruptLines = static_cast<std::uint32_t>(mInterrupts.rowCount);
+        if (hasWindow) {
+            const std::size_t cpus = std::min(mInterrupts.cpuCount, kMaxInterruptCpus);
+            for (std::size_t cpu = 0; cpu < cpus; ++cpu) {
+                outData.cpuInterruptsPerSec[cpu] = static_cast<double>(mInterrupts.cpuTotals[cpu]) / windowSec;
+            }
+
+            mHotRows.clear();
+            std::uint64_t total = 0;
+            for (std::size_t row = 0; row < mInterrupts.rowCount; ++row) {
+                total += mInterrupts.rowTotals[row];
+                if (mInterrupts.rowTotals[row] > 0) {
+                    mHotRows.push_back(row);
+                }
+            }
+            outData.interruptsPerSec = static_cast<double>(total) / windowSec;
+
+            const std::size_t kept = std::min(mHotRows.size(), kMaxHotInterrupts);
+            const std::vector<std::uint64_t>& rowTotals = mInterrupts.rowTotals;
+            std::partial_sort(mHotRows.begin(), mHotRows.begin() + static_cast<std::ptrdiff_t>(kept), mHotRows.end(),
+                              [&rowTotals](std::size_t left, std::size_t right) {
+                                  if (rowTotals[left] != rowTotals[right]) {
+                                      return rowTotals[left] > rowTotals[right];
+                                  }
+                                  return left < right;
+                              });
+            for (std::size_t i = 0; i < kept; ++i) {
+                fillLine(mInterrupts, mHotRows[i], windowSec, outData.hot[i]);
+            }
+            outData.hotCount = static_cast<std::uint32_t>(kept);
+        }
+    }
+
+    if (hasSoftirqs) {
+        const bool hasWindow = mSoftirqs.hasPrevious && windowSec > 0.0;
+        computeDeltas(mSoftirqs);
+        if (hasWindow) {
+            const std::size_t cpus = std::min(mSoftirqs.cpuCount, kMaxInterruptCpus);
+            for (std::size_t cpu = 0; cpu < cpus; ++cpu) {
+                outData.cpuSoftirqsPerSec[cpu] = static_cast<double>(mSoftirqs.cpuTotals[cpu]) / windowSec;
+            }
+
+            // Few fixed types (HI, TIMER, NET_RX, ...), kept in kernel order.
+            const std::size_t types = std::min(mSoftirqs.rowCount, kMaxSoftirqTypes);
+            std::uint64_t total = 0;
+            for (std::size_t row = 0; row < mSoftirqs.rowCount; ++row) {
+                total += mSoftirqs.rowTotals[row];
+            }
+            for (std::size_t row = 0; row < types; ++row) {
+                fillLine(mSoftirqs, row, windowSec, outData.softirqs[row]);
+            }
+            outData.softirqsPerSec = static_cast<double>(total) / windowSec;
+            outData.softirqCount = static_cast<std::uint32_t>(types);
+        }
+    }
+
+    outData.trace.sampleNs = nowNs;
+    mPreviousSampleNs = nowNs;
+    return true;
+}
+
+} // namespace xmonitor
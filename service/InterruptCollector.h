@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/ProcFile.h"
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// Load average, run-queue counts and per-CPU interrupt/softirq rates from
+// <procRoot>/{loadavg,stat,interrupts,softirqs}. The two IRQ tables are
+// rows x CPUs wide (thousands of counters on many-core hosts), so they are
+// parsed straight into flat row-major arrays and the deltas, row totals and
+// per-CPU totals are plain loops over contiguous memory.
+class InterruptCollector {
+public:
+    InterruptCollector();
+
+    // Returns false only when none of the files could be read.
+    bool sample(InterruptData& outData);
+
+private:
+    // Counter at [row * cpuCount + cpu]. The kernel prints these as 32-bit
+    // values, so deltas are taken in uint32 arithmetic, which is wrap-safe.
+    struct CounterTable {
+        ProcFile file;
+        std::size_t cpuCount{0};
+        std::size_t rowCount{0};
+        std::vector<std::string> rowNames;
+        std::vector<std::string> rowLabels;
+        std::vector<std::uint32_t> current;
+        std::vector<std::uint32_t> previous;
+        std::vector<std::uint32_t> delta;
+        std::vector<std::uint64_t> rowTotals;
+        std::vector<std::uint64_t> cpuTotals;
+        bool hasPrevious{false};
+    };
+
+    bool readLoad(InterruptData& outData);
+    bool readRunQueue(InterruptData& outData);
+    static bool readTable(CounterTable& table, bool withLabels);
+    static void computeDeltas(CounterTable& table);
+    static void fillLine(const CounterTable& table, std::size_t row, double windowSec, InterruptLineStats& outLine);
+
+    ProcFile mLoadFile;
+    ProcFile mStatFile;
+    CounterTable mInterrupts;
+    CounterTable mSoftirqs;
+    std::vector<std::size_t> mHotRows;
+    std::uint64_t mPreviousSampleNs;
+};
+
+} // namespace xmonitor
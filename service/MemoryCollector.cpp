@@ -0,0 +1,54 @@
+#include "service/MemoryCollector.h"
+
+#include <cstdint>
+#include <fstream>
+
+#include <unistd.h>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+#include "common/ProcfsRoot.h"
+
+namespace xmonitor {
+
+MemoryCollector::MemoryCollector()
+    : mStatmPath(procPath("self/statm")),
+      mPageSize(sysconf(_SC_PAGESIZE)) {}
+
+bool MemoryCollector::sample(MemoryData& outData) {
+    std::ifstream statm(mStatmPath);
+    if (!statm.is_open()) {
+        LOG_E("Memory read failed: cannot open %s", mStatmPath.c_str());
+        return false;
+    }
+
+    std::uint64_t sizePages = 0;
+    std::uint64_t residentPages = 0;
+    statm >> sizePages >> residentPages;
+
+    if (sizePages == 0 && residentPages == 0) {
+        LOG_E("Memory read failed: invalid size/resident pages");
+        return false;
+    }
+
+    if (mPageSize <= 0) {
+        LOG_E("Memory read failed: invalid page size");
+        return false;
+    }
+
+    outData.virtualBytes = sizePages * static_cast<std::uint64_t>(mPageSize);
+    outData.residentBytes = residentPages * static_cast<std::uint64_t>(mPageSize);
+    outData.trace.sampleNs = monotonicNowNs();
+
+    static int sampleCounter = 0;
+    ++sampleCounter;
+    if (sampleCounter % 10 == 0) {
+        LOG_D("Memory read ok: rss=%llu virt=%llu",
+              static_cast<unsigned long long>(outData.residentBytes),
+              static_cast<unsigned long long>(outData.virtualBytes));
+    }
+
+    return true;
+}
+
+} // namespace xmonitor
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// Virtual/resident size of the calling process from <procRoot>/self/statm.
+class MemoryCollector {
+public:
+    MemoryCollector();
+
+    bool sample(MemoryData& outData);
+
+private:
+    std::string mStatmPath;
+    long mPageSize;
+};
+
+} // namespace xmonitor
@@ -0,0 +1,190 @@
+#include "service/MemoryDetailCollector.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+#include "common/ProcfsRoot.h"
+#include "common/TextScan.h"
+
+namespace xmonitor {
+namespace {
+
+enum RollupField : std::size_t {
+    ROLLUP_RSS = 0,
+    ROLLUP_PSS,
+    ROLLUP_PSS_ANON,
+    ROLLUP_PSS_FILE,
+    ROLLUP_PSS_SHMEM,
+    ROLLUP_PRIVATE_CLEAN,
+    ROLLUP_PRIVATE_DIRTY,
+    ROLLUP_ANONYMOUS,
+    ROLLUP_SWAP,
+    ROLLUP_SWAP_PSS,
+    ROLLUP_FIELD_COUNT
+};
+
+struct RollupKey {
+    const char* key;
+    RollupField field;
+};
+
+const RollupKey kRollupKeys[] = {
+    {"Rss", ROLLUP_RSS},
+    {"Pss", ROLLUP_PSS},
+    {"Pss_Anon", ROLLUP_PSS_ANON},
+    {"Pss_File", ROLLUP_PSS_FILE},
+    {"Pss_Shmem", ROLLUP_PSS_SHMEM},
+    {"Private_Clean", ROLLUP_PRIVATE_CLEAN},
+    {"Private_Dirty", ROLLUP_PRIVATE_DIRTY},
+    {"Anonymous", ROLLUP_ANONYMOUS},
+    {"Swap", ROLLUP_SWAP},
+    {"SwapPss", ROLLUP_SWAP_PSS},
+};
+
+const RollupKey* lookup(const char* key, std::size_t length) {
+    for (const RollupKey& entry : kRollupKeys) {
+        if (std::strlen(entry.key) == length && std::memcmp(entry.key, key, length) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+std::string pidPath(std::uint32_t pid, const char* file) {
+    return procPath((std::to_string(pid) + "/" + file).c_str());
+}
+
+} // namespace
+
+MemoryDetailCollector::MemoryDetailCollector(const Options& options)
+    : mOptions(options),
+      mCursor(0) {
+    if (mOptions.pids.size() > kMaxMemoryDetailProcesses) {
+        LOG_W("Memory detail: %zu PIDs configured, only the first %zu are tracked",
+              mOptions.pids.size(),
+              kMaxMemoryDetailProcesses);
+        mOptions.pids.resize(kMaxMemoryDetailProcesses);
+    }
+
+    mProcesses.resize(mOptions.pids.size());
+    for (std::size_t i = 0; i < mProcesses.size(); ++i) {
+        mProcesses[i].detail.pid = mOptions.pids[i];
+    }
+}
+
+bool MemoryDetailCollector::enabled() const {
+    return !mProcesses.empty();
+}
+
+std::vector<std::uint32_t> MemoryDetailCollector::parsePidList(const std::string& text) {
+    std::vector<std::uint32_t> pids;
+    const char* cursor = text.c_str();
+    const char* end = cursor + text.size();
+    while (cursor < end) {
+        std::uint64_t pid = 0;
+        if (parseU64(cursor, end, pid) && pid > 0 && pid <= UINT32_MAX &&
+            std::find(pids.begin(), pids.end(), static_cast<std::uint32_t>(pid)) == pids.end()) {
+            pids.push_back(static_cast<std::uint32_t>(pid));
+        }
+        while (cursor < end && (*cursor < '0' || *cursor > '9')) {
+            ++cursor;
+        }
+    }
+    return pids;
+}
+
+bool MemoryDetailCollector::openProcess(ProcessState& state) {
+    if (!state.rollup.open(pidPath(state.detail.pid, "smaps_rollup"))) {
+        return false;
+    }
+
+    ProcFile comm(pidPath(state.detail.pid, "comm"), 64);
+    if (comm.isOpen() && comm.read()) {
+        const char* name = comm.data();
+        const std::size_t length = std::min<std::size_t>(
+            static_cast<std::size_t>(std::find(name, comm.end(), '\n') - name), kProcessNameLength - 1);
+        std::memset(state.detail.name, 0, sizeof(state.detail.name));
+        std::memcpy(state.detail.name, name, length);
+    }
+    return true;
+}
+
+void MemoryDetailCollector::readProcess(ProcessState& state, std::uint64_t nowNs) {
+    ProcessMemoryDetail& detail = state.detail;
+    // A vanished process is retried on its next turn; a reused PID shows up
+    // under its new name.
+    if ((!state.rollup.isOpen() && !openProcess(state)) || !state.rollup.read()) {
+        state.rollup.close();
+        detail.available = 0;
+        return;
+    }
+
+    // Header line, then "Key:   12345 kB" like meminfo.
+    std::uint64_t values[ROLLUP_FIELD_COUNT] = {};
+    const char* cursor = state.rollup.data();
+    const char* end = state.rollup.end();
+    skipLine(cursor, end);
+    while (cursor < end) {
+        const char* key = cursor;
+        while (cursor < end && *cursor != ':' && *cursor != '\n') {
+            ++cursor;
+        }
+
+        const RollupKey* entry = lookup(key, static_cast<std::size_t>(cursor - key));
+        if (entry != nullptr && cursor < end && *cursor == ':') {
+            ++cursor;
+            parseU64(cursor, end, values[entry->field]);
+        }
+        skipLine(cursor, end);
+    }
+
+    detail.available = 1;
+    detail.rssBytes = values[ROLLUP_RSS] * 1024;
+    detail.pssBytes = values[ROLLUP_PSS] * 1024;
+    detail.ussBytes = (values[ROLLUP_PRIVATE_CLEAN] + values[ROLLUP_PRIVATE_DIRTY]) * 1024;
+    detail.pssAnonBytes = values[ROLLUP_PSS_ANON] * 1024;
+    detail.pssFileBytes = values[ROLLUP_PSS_FILE] * 1024;
+    detail.pssShmemBytes = values[ROLLUP_PSS_SHMEM] * 1024;
+    detail.anonymousBytes = values[ROLLUP_ANONYMOUS] * 1024;
+    detail.swapBytes = values[ROLLUP_SWAP] * 1024;
+    detail.swapPssBytes = values[ROLLUP_SWAP_PSS] * 1024;
+    detail.sampleNs = nowNs;
+}
+
+bool MemoryDetailCollector::sample(MemoryDetailData& outData) {
+    const std::uint64_t startNs = monotonicNowNs();
+    bool refreshed = false;
+    for (std::size_t visited = 0; visited < mProcesses.size(); ++visited) {
+        const std::uint64_t nowNs = monotonicNowNs();
+        if (refreshed && nowNs - startNs >= mOptions.budgetNs) {
+            break;
+        }
+
+        ProcessState& state = mProcesses[mCursor];
+        mCursor = (mCursor + 1) % mProcesses.size();
+        if (state.lastAttemptNs != 0 && nowNs - state.lastAttemptNs < mOptions.refreshNs) {
+            continue;
+        }
+
+        state.lastAttemptNs = nowNs;
+        readProcess(state, nowNs);
+        refreshed = true;
+    }
+
+    if (!refreshed) {
+        return false;
+    }
+
+    outData.processCount = static_cast<std::uint32_t>(mProcesses.size());
+    for (std::size_t i = 0; i < mProcesses.size(); ++i) {
+        outData.processes[i] = mProcesses[i].detail;
+    }
+    std::fill(outData.processes + mProcesses.size(), outData.processes + kMaxMemoryDetailProcesses,
+              ProcessMemoryDetail{});
+    outData.trace.sampleNs = startNs;
+    return true;
+}
+
+} // namespace xmonitor
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/ProcFile.h"
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// PSS/USS/swap of a configured PID set from <procRoot>/<pid>/smaps_rollup.
+// Generating smaps_rollup walks every VMA under the target's mmap lock, so the
+// set is read in rotation: each tick re-reads PIDs until Options::budgetNs is
+// spent (at least one when any is due), and no PID more often than
+// Options::refreshNs. Entries not re-read keep their previous values.
+class MemoryDetailCollector {
+public:
+    struct Options {
+        std::vector<std::uint32_t> pids;
+        std::uint64_t budgetNs{1000000};
+        std::uint64_t refreshNs{1000000000};
+    };
+
+    explicit MemoryDetailCollector(const Options& options);
+
+    bool enabled() const;
+
+    // Returns false when no PID was due this tick, so callers can skip publishing.
+    bool sample(MemoryDetailData& outData);
+
+    // "1234,5678" -> {1234, 5678}; anything that is not a PID is ignored.
+    static std::vector<std::uint32_t> parsePidList(const std::string& text);
+
+private:
+    struct ProcessState {
+        ProcessMemoryDetail detail{};
+        ProcFile rollup;
+        std::uint64_t lastAttemptNs{0};
+    };
+
+    bool openProcess(ProcessState& state);
+    void readProcess(ProcessState& state, std::uint64_t nowNs);
+
+    Options mOptions;
+    std::vector<ProcessState> mProcesses;
+    std::size_t mCursor;
+};
+
+} // namespace xmonitor
@@ -1,56 +1,44 @@
 #include <chrono>
 #include <csignal>
+#include <cstddef>
 #include <cstdint>
-#include <fstream>
-#include <thread>
-
-#include <unistd.h>
+#include <cstring>
 
 #include "Logger.h"
+#include "common/Config.h"
 #include "ipc/BinderProtocol.h"
-#include "ipc/BinderClientAdapter.h"
+#include "service/MemoryCollector.h"
+#include "service/MemoryDetailCollector.h"
+#include "service/ServiceSession.h"
 
 namespace {
 volatile std::sig_atomic_t gRunning = 1;
 
-void signalHandler(int) {
-    gRunning = 0;
-}
-
-bool readMemory(xmonitor::MemoryData& outData) {
-    std::ifstream statm("/proc/self/statm");
-    if (!statm.is_open()) {
-        LOG_E("Memory read failed: cannot open /proc/self/statm");
-        return false;
-    }
+constexpr auto kSamplePeriod = std::chrono::milliseconds(100);
 
-    std::uint64_t sizePages = 0;
-    std::uint64_t residentPages = 0;
-    statm >> sizePages >> residentPages;
+// Sizes are published on any change unless a deadband is set by policy.
+constexpr double kDeadbandBytes = 0.0;
 
-    if (sizePages == 0 && residentPages == 0) {
-        LOG_E("Memory read failed: invalid size/resident pages");
-        return false;
-    }
+// smaps_rollup time per tick beyond the first read; at most a whole tick.
+constexpr long kDefaultDetailBudgetUs = 1000;
+constexpr long kMaxDetailBudgetUs = 100000;
 
-    const long pageSize = sysconf(_SC_PAGESIZE);
-    if (pageSize <= 0) {
-        LOG_E("Memory read failed: invalid page size");
-        return false;
-    }
+void signalHandler(int) {
+    gRunning = 0;
+}
 
-    outData.virtualBytes = sizePages * static_cast<std::uint64_t>(pageSize);
-    outData.residentBytes = residentPages * static_cast<std::uint64_t>(pageSize);
+bool bytesChanged(std::uint64_t current, std::uint64_t previous, double deadband) {
+    const std::uint64_t delta = current > previous ? current - previous : previous - current;
+    return delta != 0 && static_cast<double>(delta) >= deadband;
+}
 
-    static int sampleCounter = 0;
-    ++sampleCounter;
-    if (sampleCounter % 10 == 0) {
-        LOG_D("Memory read ok: rss=%llu virt=%llu",
-              static_cast<unsigned long long>(outData.residentBytes),
-              static_cast<unsigned long long>(outData.virtualBytes));
-    }
+bool memoryChanged(const xmonitor::MemoryData& current, const xmonitor::MemoryData& previous, double deadband) {
+    return bytesChanged(current.virtualBytes, previous.virtualBytes, deadband) ||
+           bytesChanged(current.residentBytes, previous.residentBytes, deadband);
+}
 
-    return true;
+bool detailChanged(const xmonitor::MemoryDetailData& current, const xmonitor::MemoryDetailData& previous) {
+    return std::memcmp(&current, &previous, offsetof(xmonitor::MemoryDetailData, trace)) != 0;
 }
 }
 
@@ -61,83 +49,78 @@ int main() {
     setLogFilePath("logs/xMonitor-memory.log");
     LOG_I("Memory service start");
 
-    xmonitor::BinderClientAdapter binder;
+    xmonitor::ServiceSession session("Memory",
+                                     xmonitor::BinderTransactionCode::RegisterMemoryService,
+                                     xmonitor::ProcessRole::MemoryService);
 
+    xmonitor::MemoryCollector collector;
     xmonitor::MemoryData lastPublished{};
     bool hasLastPublished = false;
 
-    if (!binder.initialize()) {
-        LOG_E("Memory service binder initialize failed");
-        return 1;
+    // Opt-in: smaps_rollup detail only for the PIDs listed in XMONITOR_MEMORY_PIDS.
+    xmonitor::MemoryDetailCollector::Options detailOptions;
+    detailOptions.pids = xmonitor::MemoryDetailCollector::parsePidList(xmonitor::envString("XMONITOR_MEMORY_PIDS", ""));
+    long budgetUs = kDefaultDetailBudgetUs;
+    if (!xmonitor::envInteger("XMONITOR_MEMORY_DETAIL_BUDGET_US", 0, kMaxDetailBudgetUs, budgetUs)) {
+        LOG_W("Memory service: XMONITOR_MEMORY_DETAIL_BUDGET_US must be 0..%ld, using %ld",
+              kMaxDetailBudgetUs,
+              budgetUs);
     }
-
-    LOG_I("Memory service binder initialize success");
-
-    {
-        xmonitor::BinderAck ack{};
-        const std::uint32_t request = 1;
-        std::size_t replySize = 0;
-        if (!binder.transact(static_cast<std::uint32_t>(xmonitor::BinderTransactionCode::RegisterMemoryService),
-                     &request,
-                     sizeof(request),
-                     &ack,
-                     sizeof(ack),
-                     replySize) ||
-            replySize != sizeof(ack) || ack.ok == 0) {
-            LOG_E("Memory service register to lifecycle failed");
-            binder.shutdown();
-            return 1;
-        }
+    detailOptions.budgetNs = static_cast<std::uint64_t>(budgetUs) * 1000ull;
+    xmonitor::MemoryDetailCollector detailCollector(detailOptions);
+    xmonitor::MemoryDetailData lastPublishedDetail{};
+    if (detailCollector.enabled()) {
+        LOG_I("Memory detail enabled for %zu PIDs", detailOptions.pids.size());
     }
 
-    while (gRunning != 0) {
-        xmonitor::BinderAck ack{};
-        const std::uint32_t request = 1;
-        std::size_t replySize = 0;
-        if (binder.transact(static_cast<std::uint32_t>(xmonitor::BinderTransactionCode::WaitStart),
-                            &request,
-                            sizeof(request),
-                            &ack,
-                            sizeof(ack),
-                            replySize) &&
-            replySize == sizeof(ack) && ack.ok != 0 && ack.startGranted != 0) {
-            break;
-        }
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (!session.start(gRunning)) {
+        return 1;
     }
 
     if (gRunning == 0) {
-        binder.shutdown();
+        session.stop();
         LOG_I("Memory service stop");
         return 0;
     }
 
-    LOG_I("Memory service start streaming");
-
     while (gRunning != 0) {
+        if (session.takePolicyChange()) {
+            hasLastPublished = false;
+            lastPublishedDetail = xmonitor::MemoryDetailData{};
+        }
+
         xmonitor::MemoryData current{};
-        if (readMemory(current)) {
-            if (!hasLastPublished ||
-                current.virtualBytes != lastPublished.virtualBytes ||
-                current.residentBytes != lastPublished.residentBytes) {
+        if (session.sectionEnabled(xmonitor::BinderTransactionCode::MemoryUpdated) && collector.sample(current)) {
+            if (!hasLastPublished || memoryChanged(current, lastPublished, session.deadband(kDeadbandBytes))) {
                 hasLastPublished = true;
                 lastPublished = current;
-                const bool sent = binder.send(static_cast<std::uint32_t>(xmonitor::BinderTransactionCode::MemoryUpdated),
-                                              &current,
-                                              sizeof(current));
-                if (!sent) {
-                    LOG_E("Memory service binder send failed");
-                    binder.shutdown();
+                if (!session.publish(xmonitor::BinderTransactionCode::MemoryUpdated, &current, sizeof(current))) {
+                    session.stop();
                     return 1;
                 }
             }
         }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // Runs after the statm sample so a slow smaps_rollup never delays it.
+        xmonitor::MemoryDetailData detail{};
+        if (detailCollector.enabled() && session.sectionEnabled(xmonitor::BinderTransactionCode::MemoryDetailUpdated) &&
+            detailCollector.sample(detail) && detailChanged(detail, lastPublishedDetail)) {
+            lastPublishedDetail = detail;
+            if (!session.publish(xmonitor::BinderTransactionCode::MemoryDetailUpdated, &detail, sizeof(detail))) {
+                session.stop();
+                return 1;
+            }
+        }
+
+        if (!session.onSampleTick()) {
+            session.stop();
+            return 1;
+        }
+
+        session.sleepUntilNextTick(kSamplePeriod);
     }
 
-    binder.shutdown();
+    session.stop();
     LOG_I("Memory service stop");
     return 0;
 }
@@ -0,0 +1,298 @@
+#include "service/NetCollector.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+#include "common/ProcfsRoot.h"
+#include "common/TextScan.h"
+
+namespace xmonitor {
+namespace {
+
+struct FieldKey {
+    const char* name;
+    std::size_t slot;
+};
+
+std::uint64_t nameKey(const char* name, std::size_t length) {
+    // FNV-1a; interface names are at most 15 bytes.
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (std::size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(name[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool sameName(const char* stored, const char* name, std::size_t length) {
+    return std::strlen(stored) == length && std::memcmp(stored, name, length) == 0;
+}
+
+double perSecond(std::uint64_t delta, double windowSec) {
+    return windowSec > 0.0 ? static_cast<double>(delta) / windowSec : 0.0;
+}
+
+std::uint64_t counterDelta(std::uint64_t current, std::uint64_t previous) {
+    return current >= previous ? current - previous : 0;
+}
+
+// net/snmp and net/netstat print each protocol as two lines sharing a prefix:
+// column names first, values second. Columns are matched by name because
+// their order differs between kernels.
+bool parseKeyedLines(const char* cursor,
+                     const char* end,
+                     const char* prefix,
+                     const FieldKey* keys,
+                     std::size_t keyCount,
+                     std::uint64_t* outValues) {
+    while (cursor < end && !startsWith(cursor, end, prefix)) {
+        skipLine(cursor, end);
+    }
+    const char* header = cursor;
+    if (!consume(header, end, prefix)) {
+        return false;
+    }
+    skipLine(cursor, end);
+    const char* values = cursor;
+    if (!consume(values, end, prefix)) {
+        return false;
+    }
+
+    std::size_t found = 0;
+    while (found < keyCount) {
+        const char* name = nullptr;
+        const std::size_t nameLength = readToken(header, end, name);
+        std::int64_t value = 0;
+        if (nameLength == 0 || !parseI64(values, end, value)) {
+            break;
+        }
+        for (std::size_t i = 0; i < keyCount; ++i) {
+            if (std::strlen(keys[i].name) == nameLength && std::memcmp(keys[i].name, name, nameLength) == 0) {
+                outValues[keys[i].slot] = value > 0 ? static_cast<std::uint64_t>(value) : 0;
+                ++found;
+                break;
+            }
+        }
+    }
+    return found > 0;
+}
+
+} // namespace
+
+NetCollector::NetCollector()
+    : NetCollector(Options{}) {}
+
+NetCollector::NetCollector(const Options& options)
+    : mOptions(options),
+      mDevFile(procPath("net/dev")),
+      mSnmpFile(procPath("net/snmp")),
+      mNetstatFile(procPath("net/netstat")),
+      mTcpCounters{},
+      mHasTcpPrevious(false),
+      mPreviousSampleNs(0) {}
+
+std::size_t NetCollector::indexFor(std::size_t position, const char* name, std::size_t nameLength) {
+    const std::uint64_t key = nameKey(name, nameLength);
+    if (position < mInterfaces.size() && mInterfaces[position].key == key &&
+        sameName(mInterfaces[position].name, name, nameLength)) {
+        return position;
+    }
+
+    const auto found = mIndexByKey.find(key);
+    if (found != mIndexByKey.end() && sameName(mInterfaces[found->second].name, name, nameLength)) {
+        return found->second;
+    }
+
+    InterfaceState state;
+    state.key = key;
+    std::memcpy(state.name, name, std::min(nameLength, kInterfaceNameLength - 1));
+    state.included = mOptions.includeLoopback || std::strcmp(state.name, "lo") != 0;
+    mIndexByKey[key] = mInterfaces.size();
+    mInterfaces.push_back(state);
+    return mInterfaces.size() - 1;
+}
+
+void NetCollector::relayout() {
+    // Reuses the scratch table and existing map nodes so veth churn doesn't
+    // turn into an allocation per interface.
+    mRelayoutScratch.clear();
+    for (std::size_t index : mSeenOrder) {
+        mRelayoutScratch.push_back(mInterfaces[index]);
+    }
+    mInterfaces.swap(mRelayoutScratch);
+
+    for (std::size_t i = 0; i < mInterfaces.size(); ++i) {
+        mIndexByKey[mInterfaces[i].key] = i;
+    }
+    for (auto entry = mIndexByKey.begin(); entry != mIndexByKey.end();) {
+        if (entry->second >= mInterfaces.size() || mInterfaces[entry->second].key != entry->first) {
+            entry = mIndexByKey.erase(entry);
+        } else {
+            ++entry;
+        }
+    }
+}
+
+bool NetCollector::sampleInterfaces(double windowSec) {
+    if (!mDevFile.isOpen() || !mDevFile.read()) {
+        LOG_E("Net read failed: cannot read %s", mDevFile.path().c_str());
+        return false;
+    }
+
+    mRanked.clear();
+    mSeenOrder.clear();
+
+    const char* cursor = mDevFile.data();
+    const char* end = mDevFile.end();
+    std::size_t position = 0;
+    bool layoutChanged = false;
+    while (cursor < end) {
+        // "  eth0: 1234 ..."; the two header lines have no ':' before the '|'.
+        skipBlanks(cursor, end);
+        const char* name = cursor;
+        while (cursor < end && *cursor != ':' && *cursor != '|' && *cursor != '\n') {
+            ++cursor;
+        }
+        if (cursor >= end || *cursor != ':') {
+            skipLine(cursor, end);
+            continue;
+        }
+        const std::size_t nameLength = static_cast<std::size_t>(cursor - name);
+        ++cursor;
+
+        std::uint64_t counters[COLUMN_COUNT] = {};
+        for (std::size_t column = 0; column < COLUMN_COUNT; ++column) {
+            parseU64(cursor, end, counters[column]);
+        }
+        skipLine(cursor, end);
+
+        const std::size_t index = indexFor(position, name, nameLength);
+        layoutChanged = layoutChanged || index != position;
+        mSeenOrder.push_back(index);
+        InterfaceState& state = mInterfaces[index];
+        ++position;
+
+        // Interfaces that never moved a packet (parked veths, down links) are noise.
+        const bool everUsed = counters[COLUMN_RX_PACKETS] != 0 || counters[COLUMN_TX_PACKETS] != 0;
+        if (state.included && everUsed && state.hasPrevious && windowSec > 0.0) {
+            std::uint64_t delta[COLUMN_COUNT];
+            for (std::size_t column = 0; column < COLUMN_COUNT; ++column) {
+                delta[column] = counterDelta(counters[column], state.counters[column]);
+            }
+
+            NetInterfaceStats stats;
+            std::memcpy(stats.name, state.name, sizeof(stats.name));
+            stats.rxBytesPerSec = perSecond(delta[COLUMN_RX_BYTES], windowSec);
+            stats.txBytesPerSec = perSecond(delta[COLUMN_TX_BYTES], windowSec);
+            stats.rxPacketsPerSec = perSecond(delta[COLUMN_RX_PACKETS], windowSec);
+            stats.txPacketsPerSec = perSecond(delta[COLUMN_TX_PACKETS], windowSec);
+            stats.rxErrorsPerSec = perSecond(delta[COLUMN_RX_ERRORS], windowSec);
+            stats.txErrorsPerSec = perSecond(delta[COLUMN_TX_ERRORS], windowSec);
+            stats.rxDropsPerSec = perSecond(delta[COLUMN_RX_DROPS], windowSec);
+            stats.txDropsPerSec = perSecond(delta[COLUMN_TX_DROPS], windowSec);
+            mRanked.push_back(stats);
+        }
+
+        std::memcpy(state.counters, counters, sizeof(counters));
+        state.hasPrevious = true;
+    }
+
+    if (layoutChanged || position != mInterfaces.size()) {
+        relayout();
+    }
+    return true;
+}
+
+void NetCollector::sampleTcp(double windowSec, TcpHealth& outTcp) {
+    static const FieldKey kTcpKeys[] = {
+        {"CurrEstab", TCP_CURRENT_ESTABLISHED},
+        {"OutSegs", TCP_OUT_SEGMENTS},
+        {"RetransSegs", TCP_RETRANS_SEGMENTS},
+        {"OutRsts", TCP_OUT_RESETS},
+        {"EstabResets", TCP_ESTABLISHED_RESETS},
+        {"AttemptFails", TCP_ATTEMPT_FAILS},
+        {"InErrs", TCP_IN_ERRORS},
+    };
+    static const FieldKey kTcpExtKeys[] = {
+        {"ListenOverflows", TCP_LISTEN_OVERFLOWS},
+        {"ListenDrops", TCP_LISTEN_DROPS},
+        {"TCPTimeouts", TCP_TIMEOUTS},
+    };
+
+    std::uint64_t counters[TCP_COUNTER_COUNT] = {};
+    // Both files are optional: some sandboxes hide them, and TCP health then
+    // stays zero instead of failing the whole sample.
+    bool parsed = false;
+    if (mSnmpFile.isOpen() && mSnmpFile.read()) {
+        parsed = parseKeyedLines(mSnmpFile.data(), mSnmpFile.end(), "Tcp:", kTcpKeys,
+                                 sizeof(kTcpKeys) / sizeof(kTcpKeys[0]), counters);
+    }
+    if (mNetstatFile.isOpen() && mNetstatFile.read()) {
+        parsed = parseKeyedLines(mNetstatFile.data(), mNetstatFile.end(), "TcpExt:", kTcpExtKeys,
+                                 sizeof(kTcpExtKeys) / sizeof(kTcpExtKeys[0]), counters) ||
+                 parsed;
+    }
+    if (!parsed) {
+        mHasTcpPrevious = false;
+        return;
+    }
+
+    outTcp.currentEstablished = counters[TCP_CURRENT_ESTABLISHED];
+    if (mHasTcpPrevious && windowSec > 0.0) {
+        std::uint64_t delta[TCP_COUNTER_COUNT];
+        for (std::size_t i = 0; i < TCP_COUNTER_COUNT; ++i) {
+            delta[i] = counterDelta(counters[i], mTcpCounters[i]);
+        }
+
+        outTcp.outSegmentsPerSec = perSecond(delta[TCP_OUT_SEGMENTS], windowSec);
+        outTcp.retransSegmentsPerSec = perSecond(delta[TCP_RETRANS_SEGMENTS], windowSec);
+        outTcp.retransPercent = delta[TCP_OUT_SEGMENTS] > 0
+                                    ? static_cast<double>(delta[TCP_RETRANS_SEGMENTS]) * 100.0 /
+                                          static_cast<double>(delta[TCP_OUT_SEGMENTS])
+                                    : 0.0;
+        outTcp.outResetsPerSec = perSecond(delta[TCP_OUT_RESETS], windowSec);
+        outTcp.establishedResetsPerSec = perSecond(delta[TCP_ESTABLISHED_RESETS], windowSec);
+        outTcp.attemptFailsPerSec = perSecond(delta[TCP_ATTEMPT_FAILS], windowSec);
+        outTcp.inErrorsPerSec = perSecond(delta[TCP_IN_ERRORS], windowSec);
+        outTcp.listenOverflowsPerSec = perSecond(delta[TCP_LISTEN_OVERFLOWS], windowSec);
+        outTcp.listenDropsPerSec = perSecond(delta[TCP_LISTEN_DROPS], windowSec);
+        outTcp.timeoutsPerSec = perSecond(delta[TCP_TIMEOUTS], windowSec);
+    }
+
+    std::memcpy(mTcpCounters, counters, sizeof(counters));
+    mHasTcpPrevious = true;
+}
+
+bool NetCollector::sample(NetData& outData) {
+    const std::uint64_t nowNs = monotonicNowNs();
+    const double windowSec = mPreviousSampleNs != 0 ? static_cast<double>(nowNs - mPreviousSampleNs) / 1e9 : 0.0;
+
+    if (!sampleInterfaces(windowSec)) {
+        return false;
+    }
+    sampleTcp(windowSec, outData.tcp);
+
+    const std::size_t kept = std::min(mRanked.size(), kMaxNetInterfaces);
+    std::partial_sort(mRanked.begin(), mRanked.begin() + static_cast<std::ptrdiff_t>(kept), mRanked.end(),
+                      [](const NetInterfaceStats& left, const NetInterfaceStats& right) {
+                          const double leftBytes = left.rxBytesPerSec + left.txBytesPerSec;
+                          const double rightBytes = right.rxBytesPerSec + right.txBytesPerSec;
+                          if (leftBytes != rightBytes) {
+                              return leftBytes > rightBytes;
+                          }
+                          // Stable order for idle interfaces keeps unchanged ticks byte-identical.
+                          return std::strcmp(left.name, right.name) < 0;
+                      });
+
+    outData.matchedInterfaces = static_cast<std::uint32_t>(mRanked.size());
+    outData.interfaceCount = static_cast<std::uint32_t>(kept);
+    std::copy(mRanked.begin(), mRanked.begin() + static_cast<std::ptrdiff_t>(kept), outData.interfaces);
+    std::fill(outData.interfaces + kept, outData.interfaces + kMaxNetInterfaces, NetInterfaceStats{});
+    outData.trace.sampleNs = nowNs;
+    mPreviousSampleNs = nowNs;
+    return true;
+}
+
+} // namespace xmonitor
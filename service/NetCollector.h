@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "common/ProcFile.h"
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// Per-interface rates from <procRoot>/net/dev and TCP health counters from
+// <procRoot>/net/snmp and <procRoot>/net/netstat. Interface state persists in
+// net/dev order and is matched by position first and name hash second, so a
+// steady-state sample parses hundreds of veth lines without allocating.
+class NetCollector {
+public:
+    struct Options {
+        bool includeLoopback{true};
+    };
+
+    NetCollector();
+    explicit NetCollector(const Options& options);
+
+    bool sample(NetData& outData);
+
+private:
+    enum Column : std::size_t {
+        COLUMN_RX_BYTES = 0,
+        COLUMN_RX_PACKETS,
+        COLUMN_RX_ERRORS,
+        COLUMN_RX_DROPS,
+        COLUMN_RX_FIFO,
+        COLUMN_RX_FRAME,
+        COLUMN_RX_COMPRESSED,
+        COLUMN_RX_MULTICAST,
+        COLUMN_TX_BYTES,
+        COLUMN_TX_PACKETS,
+        COLUMN_TX_ERRORS,
+        COLUMN_TX_DROPS,
+        COLUMN_TX_FIFO,
+        COLUMN_TX_COLLISIONS,
+        COLUMN_TX_CARRIER,
+        COLUMN_TX_COMPRESSED,
+        COLUMN_COUNT
+    };
+
+    enum TcpCounter : std::size_t {
+        TCP_CURRENT_ESTABLISHED = 0,
+        TCP_OUT_SEGMENTS,
+        TCP_RETRANS_SEGMENTS,
+        TCP_OUT_RESETS,
+        TCP_ESTABLISHED_RESETS,
+        TCP_ATTEMPT_FAILS,
+        TCP_IN_ERRORS,
+        TCP_LISTEN_OVERFLOWS,
+        TCP_LISTEN_DROPS,
+        TCP_TIMEOUTS,
+        TCP_COUNTER_COUNT
+    };
+
+    struct InterfaceState {
+        std::uint64_t key{0};
+        char name[kInterfaceNameLength]{};
+        bool included{false};
+        bool hasPrevious{false};
+        std::uint64_t counters[COLUMN_COUNT]{};
+    };
+
+    std::size_t indexFor(std::size_t position, const char* name, std::size_t nameLength);
+    void relayout();
+    bool sampleInterfaces(double windowSec);
+    void sampleTcp(double windowSec, TcpHealth& outTcp);
+
+    Options mOptions;
+    ProcFile mDevFile;
+    ProcFile mSnmpFile;
+    ProcFile mNetstatFile;
+    std::vector<InterfaceState> mInterfaces;
+    std::vector<InterfaceState> mRelayoutScratch;
+    std::unordered_map<std::uint64_t, std::size_t> mIndexByKey;
+    std::vector<std::size_t> mSeenOrder;
+    std::vector<NetInterfaceStats> mRanked;
+    std::uint64_t mTcpCounters[TCP_COUNTER_COUNT];
+    bool mHasTcpPrevious;
+    std::uint64_t mPreviousSampleNs;
+};
+
+} // namespace xmonitor
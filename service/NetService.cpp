@@ -0,0 +1,85 @@
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "Logger.h"
+#include "common/Config.h"
+#include "ipc/BinderProtocol.h"
+#include "service/NetCollector.h"
+#include "service/ServiceSession.h"
+
+namespace {
+volatile std::sig_atomic_t gRunning = 1;
+
+// Matches the disk service: per-second rates are what operators compare
+// against link speed, and a 1s tick keeps large veth tables cheap.
+constexpr auto kSamplePeriod = std::chrono::milliseconds(1000);
+
+void signalHandler(int) {
+    gRunning = 0;
+}
+
+bool netChanged(const xmonitor::NetData& current, const xmonitor::NetData& previous) {
+    return std::memcmp(&current, &previous, offsetof(xmonitor::NetData, trace)) != 0;
+}
+}
+
+int main() {
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+
+    setLogFilePath("logs/xMonitor-net.log");
+    LOG_I("Net service start");
+
+    xmonitor::ServiceSession session("Net",
+                                     xmonitor::BinderTransactionCode::RegisterNetService,
+                                     xmonitor::ProcessRole::NetService);
+
+    xmonitor::NetCollector::Options options;
+    options.includeLoopback = xmonitor::envBool("XMONITOR_NET_LOOPBACK", true);
+    xmonitor::NetCollector collector(options);
+
+    xmonitor::NetData lastPublished{};
+    bool hasLastPublished = false;
+
+    if (!session.start(gRunning)) {
+        return 1;
+    }
+
+    if (gRunning == 0) {
+        session.stop();
+        LOG_I("Net service stop");
+        return 0;
+    }
+
+    while (gRunning != 0) {
+        if (session.takePolicyChange()) {
+            hasLastPublished = false;
+        }
+
+        xmonitor::NetData current{};
+        if (session.sectionEnabled(xmonitor::BinderTransactionCode::NetUpdated) && collector.sample(current)) {
+            if (!hasLastPublished || netChanged(current, lastPublished)) {
+                hasLastPublished = true;
+                lastPublished = current;
+                if (!session.publish(xmonitor::BinderTransactionCode::NetUpdated, &current, sizeof(current))) {
+                    session.stop();
+                    return 1;
+                }
+            }
+        }
+
+        if (!session.onSampleTick()) {
+            session.stop();
+            return 1;
+        }
+
+        session.sleepUntilNextTick(kSamplePeriod);
+    }
+
+    session.stop();
+    LOG_I("Net service stop");
+    return 0;
+}
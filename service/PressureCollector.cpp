@@ -0,0 +1,73 @@
+#include "service/PressureCollector.h"
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+#include "common/ProcfsRoot.h"
+#include "common/TextScan.h"
+
+namespace xmonitor {
+namespace {
+
+// "avg10=0.00 avg60=0.00 avg300=0.00 total=0"
+bool parseStallLine(const char*& cursor, const char* end, PressureStall& outStall) {
+    skipBlanks(cursor, end);
+    if (!consume(cursor, end, "avg10=") || !parseDecimal(cursor, end, outStall.avg10)) {
+        return false;
+    }
+    skipBlanks(cursor, end);
+    if (!consume(cursor, end, "avg60=") || !parseDecimal(cursor, end, outStall.avg60)) {
+        return false;
+    }
+    skipBlanks(cursor, end);
+    if (!consume(cursor, end, "avg300=") || !parseDecimal(cursor, end, outStall.avg300)) {
+        return false;
+    }
+    skipBlanks(cursor, end);
+    return consume(cursor, end, "total=") && parseU64(cursor, end, outStall.totalUs);
+}
+
+} // namespace
+
+PressureCollector::PressureCollector()
+    : mCpuFile(procPath("pressure/cpu")),
+      mMemoryFile(procPath("pressure/memory")),
+      mIoFile(procPath("pressure/io")) {
+    if (!mCpuFile.isOpen() && !mMemoryFile.isOpen() && !mIoFile.isOpen()) {
+        LOG_W("PSI unavailable: %s/pressure not readable", procRoot().c_str());
+    }
+}
+
+bool PressureCollector::readResource(ProcFile& file, PressureResource& outResource) {
+    outResource = PressureResource{};
+    if (!file.isOpen() || !file.read()) {
+        return false;
+    }
+
+    const char* cursor = file.data();
+    const char* end = file.end();
+    while (cursor < end) {
+        if (consume(cursor, end, "some")) {
+            if (!parseStallLine(cursor, end, outResource.some)) {
+                return false;
+            }
+        } else if (consume(cursor, end, "full")) {
+            if (!parseStallLine(cursor, end, outResource.full)) {
+                return false;
+            }
+        }
+        skipLine(cursor, end);
+    }
+
+    outResource.available = 1;
+    return true;
+}
+
+bool PressureCollector::sample(PressureData& outData) {
+    const bool cpu = readResource(mCpuFile, outData.cpu);
+    const bool memory = readResource(mMemoryFile, outData.memory);
+    const bool io = readResource(mIoFile, outData.io);
+    outData.trace.sampleNs = monotonicNowNs();
+    return cpu || memory || io;
+}
+
+} // namespace xmonitor
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "common/ProcFile.h"
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// Pressure stall information from <procRoot>/pressure/{cpu,memory,io}.
+class PressureCollector {
+public:
+    PressureCollector();
+
+    // Returns false only when no resource could be read at all.
+    bool sample(PressureData& outData);
+
+    // Parses one PSI file ("some ..." / "full ..."); also used for the
+    // per-cgroup *.pressure files, which share the format.
+    static bool readResource(ProcFile& file, PressureResource& outResource);
+
+private:
+    ProcFile mCpuFile;
+    ProcFile mMemoryFile;
+    ProcFile mIoFile;
+};
+
+} // namespace xmonitor
@@ -0,0 +1,283 @@
+#include "service/ProcessCollector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+#include "common/ProcfsRoot.h"
+#include "common/TextScan.h"
+
+namespace xmonitor {
+namespace {
+
+// One line, well under this; thousands of these stay open at once.
+constexpr std::size_t kStatFileCapacity = 512;
+
+double perSecond(std::uint64_t delta, std::uint64_t windowNs) {
+    return windowNs > 0 ? static_cast<double>(delta) * 1e9 / static_cast<double>(windowNs) : 0.0;
+}
+
+bool parsePid(const char* name, std::uint32_t& outPid) {
+    const char* cursor = name;
+    std::uint64_t pid = 0;
+    if (!parseU64(cursor, cursor + std::strlen(name), pid) || *cursor != '\0') {
+        return false;
+    }
+    outPid = static_cast<std::uint32_t>(pid);
+    return true;
+}
+
+} // namespace
+
+ProcessCollector::ProcessCollector()
+    : ProcessCollector(Options{}) {}
+
+ProcessCollector::ProcessCollector(const Options& options)
+    : mOptions(options),
+      mNeedsRescan(true),
+      mForks(0),
+      mExecs(0),
+      mExits(0),
+      mShortLived(0),
+      mOverflows(0),
+      mRescans(0),
+      mNsPerTick(1e9 / static_cast<double>(std::max(1L, ::sysconf(_SC_CLK_TCK)))),
+      mPageSize(static_cast<std::uint64_t>(std::max(1L, ::sysconf(_SC_PAGESIZE)))),
+      mPreviousSampleNs(0) {
+    if (mOptions.useEvents) {
+        if (mEvents.open()) {
+            LOG_I("Process table: using netlink proc connector events");
+        } else {
+            LOG_W("Process table: proc connector unavailable, polling /proc");
+        }
+    }
+}
+
+void ProcessCollector::waitForEvents(int timeoutMs) {
+    if (!mEvents.isOpen()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+        return;
+    }
+
+    const std::uint64_t deadlineNs = monotonicNowNs() + static_cast<std::uint64_t>(timeoutMs) * 1000000ull;
+    for (std::uint64_t nowNs = monotonicNowNs(); nowNs < deadlineNs && mEvents.isOpen(); nowNs = monotonicNowNs()) {
+        if (mEvents.wait(static_cast<int>((deadlineNs - nowNs + 999999ull) / 1000000ull))) {
+            drainEvents();
+        }
+    }
+}
+
+void ProcessCollector::drainEvents() {
+    mPendingEvents.clear();
+    const ProcessEventSource::DrainResult result = mEvents.drain(mPendingEvents);
+    for (const ProcessEventSource::Event& event : mPendingEvents) {
+        applyEvent(event);
+    }
+
+    if (result == ProcessEventSource::DRAIN_OVERFLOW) {
+        ++mOverflows;
+        mNeedsRescan = true;
+    } else if (result == ProcessEventSource::DRAIN_ERROR) {
+        LOG_W("Process table: event socket failed, falling back to /proc polling");
+        mEvents.close();
+        mNeedsRescan = true;
+    }
+}
+
+void ProcessCollector::applyEvent(const ProcessEventSource::Event& event) {
+    switch (event.type) {
+        case ProcessEventSource::EVENT_FORK:
+            ++mForks;
+            // A reused pid whose exit we missed starts over.
+            mProcesses[event.pid] = ProcessState{};
+            break;
+        case ProcessEventSource::EVENT_EXEC:
+            ++mExecs;
+            break;
+        case ProcessEventSource::EVENT_EXIT: {
+            ++mExits;
+            const auto found = mProcesses.find(event.pid);
+            if (found != mProcesses.end()) {
+                if (!found->second.sampled) {
+                    ++mShortLived;
+                }
+                mProcesses.erase(found);
+            }
+            break;
+        }
+    }
+}
+
+void ProcessCollector::rescan() {
+    mListedPids.clear();
+    if (DIR* directory = ::opendir(procPath("").c_str())) {
+        while (const dirent* entry = ::readdir(directory)) {
+            std::uint32_t pid = 0;
+            if (parsePid(entry->d_name, pid)) {
+                mListedPids.push_back(pid);
+            }
+        }
+        ::closedir(directory);
+    }
+    std::sort(mListedPids.begin(), mListedPids.end());
+
+    // Polling sees churn only as the difference between two listings.
+    const bool countChurn = !mEvents.isOpen() && mRescans > 0;
+    mVanishedPids.clear();
+    for (const auto& entry : mProcesses) {
+        if (!std::binary_search(mListedPids.begin(), mListedPids.end(), entry.first)) {
+            mVanishedPids.push_back(entry.first);
+        }
+    }
+    for (std::uint32_t pid : mVanishedPids) {
+        mProcesses.erase(pid);
+    }
+    for (std::uint32_t pid : mListedPids) {
+        if (mProcesses.emplace(pid, ProcessState{}).second && countChurn) {
+            ++mForks;
+        }
+    }
+    if (countChurn) {
+        mExits += mVanishedPids.size();
+    }
+
+    ++mRescans;
+    mNeedsRescan = false;
+}
+
+bool ProcessCollector::readProcess(std::uint32_t pid,
+                                   ProcessState& state,
+                                   std::uint64_t windowNs,
+                                   ProcessStats& outStats) {
+    if (!state.stat.isOpen() &&
+        !state.stat.open(procPath((std::to_string(pid) + "/stat").c_str()))) {
+        return false;
+    }
+    if (!state.stat.read()) {
+        return false;
+    }
+
+    // "pid (comm) S ppid ..." -- fields are counted from the last ')'.
+    const char* begin = state.stat.data();
+    const char* end = state.stat.end();
+    const char* open = static_cast<const char*>(std::memchr(begin, '(', static_cast<std::size_t>(end - begin)));
+    const char* close = end;
+    while (close > begin && *(close - 1) != ')') {
+        --close;
+    }
+    if (open == nullptr || close <= open + 1) {
+        return false;
+    }
+    std::memset(outStats.name, 0, sizeof(outStats.name));
+    std::memcpy(outStats.name, open + 1,
+                std::min(static_cast<std::size_t>(close - 1 - (open + 1)), kProcessNameLength - 1));
+
+    // State is field 3, ppid 4, utime/stime 14/15, num_threads 20, rss 24.
+    const char* cursor = close;
+    skipBlanks(cursor, end);
+    const char processState = cursor < end ? *cursor : '?';
+    skipToken(cursor, end);
+    std::uint64_t ppid = 0;
+    std::uint64_t userTicks = 0;
+    std::uint64_t systemTicks = 0;
+    std::uint64_t threadCount = 0;
+    std::uint64_t rssPages = 0;
+    parseU64(cursor, end, ppid);
+    for (int field = 5; field < 14; ++field) {
+        skipToken(cursor, end);
+    }
+    parseU64(cursor, end, userTicks);
+    parseU64(cursor, end, systemTicks);
+    for (int field = 16; field < 20; ++field) {
+        skipToken(cursor, end);
+    }
+    parseU64(cursor, end, threadCount);
+    for (int field = 21; field < 24; ++field) {
+        skipToken(cursor, end);
+    }
+    parseU64(cursor, end, rssPages);
+
+    const std::uint64_t cpuTicks = userTicks + systemTicks;
+    outStats.pid = pid;
+    outStats.ppid = static_cast<std::uint32_t>(ppid);
+    outStats.threadCount = static_cast<std::uint32_t>(threadCount);
+    outStats.state = static_cast<std::uint32_t>(static_cast<unsigned char>(processState));
+    outStats.rssBytes = rssPages * mPageSize;
+    if (state.hasPrevious && windowNs > 0 && cpuTicks >= state.cpuTicks) {
+        outStats.cpuPercent =
+            static_cast<double>(cpuTicks - state.cpuTicks) * mNsPerTick * 100.0 / static_cast<double>(windowNs);
+    }
+
+    state.cpuTicks = cpuTicks;
+    state.hasPrevious = true;
+    state.sampled = true;
+    return true;
+}
+
+bool ProcessCollector::sample(ProcessData& outData) {
+    if (mEvents.isOpen()) {
+        drainEvents();
+    }
+    if (mNeedsRescan || !mEvents.isOpen()) {
+        rescan();
+    }
+
+    const std::uint64_t nowNs = monotonicNowNs();
+    const std::uint64_t windowNs = mPreviousSampleNs != 0 ? nowNs - mPreviousSampleNs : 0;
+
+    mRanked.clear();
+    mVanishedPids.clear();
+    for (auto& entry : mProcesses) {
+        ProcessStats stats;
+        if (readProcess(entry.first, entry.second, windowNs, stats)) {
+            mRanked.push_back(stats);
+        } else {
+            mVanishedPids.push_back(entry.first);
+        }
+    }
+    // Gone without an exit event (yet): polling counts these as exits, with
+    // events the exit is counted when it is delivered.
+    for (std::uint32_t pid : mVanishedPids) {
+        mProcesses.erase(pid);
+    }
+    if (!mEvents.isOpen()) {
+        mExits += mVanishedPids.size();
+    }
+
+    const std::size_t kept = std::min(mRanked.size(), kMaxProcesses);
+    std::partial_sort(mRanked.begin(), mRanked.begin() + static_cast<std::ptrdiff_t>(kept), mRanked.end(),
+                      [](const ProcessStats& left, const ProcessStats& right) {
+                          if (left.cpuPercent != right.cpuPercent) {
+                              return left.cpuPercent > right.cpuPercent;
+                          }
+                          return left.pid < right.pid;
+                      });
+
+    outData.processCount = static_cast<std::uint32_t>(kept);
+    outData.totalProcesses = static_cast<std::uint32_t>(mRanked.size());
+    outData.eventSource = mEvents.isOpen() ? PROCESS_SOURCE_NETLINK : PROCESS_SOURCE_POLLING;
+    outData.forksPerSec = perSecond(mForks, windowNs);
+    outData.execsPerSec = perSecond(mExecs, windowNs);
+    outData.exitsPerSec = perSecond(mExits, windowNs);
+    outData.shortLivedProcesses = mShortLived;
+    outData.eventOverflows = mOverflows;
+    outData.fullRescans = mRescans;
+    std::copy(mRanked.begin(), mRanked.begin() + static_cast<std::ptrdiff_t>(kept), outData.processes);
+    std::fill(outData.processes + kept, outData.processes + kMaxProcesses, ProcessStats{});
+    outData.trace.sampleNs = nowNs;
+
+    mForks = 0;
+    mExecs = 0;
+    mExits = 0;
+    mPreviousSampleNs = nowNs;
+    return true;
+}
+
+} // namespace xmonitor
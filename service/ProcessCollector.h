@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "common/ProcFile.h"
+#include "ipc/BinderProtocol.h"
+#include "service/ProcessEventSource.h"
+
+namespace xmonitor {
+
+// System-wide process table. With the netlink proc connector the table is
+// maintained from fork/exec/exit events and /proc is only read for the
+// counters of live PIDs (one pread of <pid>/stat each); /proc is listed
+// again only on start-up and after the event socket overflowed. Without
+// the connector (no CAP_NET_ADMIN, or disabled) every sample lists /proc.
+class ProcessCollector {
+public:
+    struct Options {
+        bool useEvents{true};
+    };
+
+    ProcessCollector();
+    explicit ProcessCollector(const Options& options);
+
+    // Applies events as they arrive until timeoutMs has passed, so the
+    // socket never builds a backlog between samples; sleeps when polling.
+    void waitForEvents(int timeoutMs);
+
+    bool sample(ProcessData& outData);
+
+private:
+    struct ProcessState {
+        ProcFile stat;
+        bool sampled{false};
+        bool hasPrevious{false};
+        std::uint64_t cpuTicks{0};
+    };
+
+    void drainEvents();
+    void applyEvent(const ProcessEventSource::Event& event);
+    void rescan();
+    bool readProcess(std::uint32_t pid, ProcessState& state, std::uint64_t windowNs, ProcessStats& outStats);
+
+    Options mOptions;
+    ProcessEventSource mEvents;
+    std::vector<ProcessEventSource::Event> mPendingEvents;
+    std::unordered_map<std::uint32_t, ProcessState> mProcesses;
+    std::vector<std::uint32_t> mListedPids;
+    std::vector<std::uint32_t> mVanishedPids;
+    std::vector<ProcessStats> mRanked;
+    bool mNeedsRescan;
+    std::uint64_t mForks;
+    std::uint64_t mExecs;
+    std::uint64_t mExits;
+    std::uint64_t mShortLived;
+    std::uint64_t mOverflows;
+    std::uint64_t mRescans;
+    double mNsPerTick;
+    std::uint64_t mPageSize;
+    std::uint64_t mPreviousSampleNs;
+};
+
+} // namespace xmonitor
@@ -0,0 +1,219 @@
+#include "service/ProcessEventSource.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+
+namespace xmonitor {
+namespace {
+
+constexpr std::size_t kReceiveBufferBytes = 64 * 1024;
+
+// A fork storm between two drains is absorbed here before ENOBUFS; the
+// forced variant only works with CAP_NET_ADMIN, which we have if we got this far.
+constexpr int kSocketBufferBytes = 4 * 1024 * 1024;
+
+constexpr int kAckTimeoutMs = 1000;
+
+} // namespace
+
+ProcessEventSource::ProcessEventSource()
+    : mFd(-1),
+      mBuffer(kReceiveBufferBytes) {}
+
+ProcessEventSource::~ProcessEventSource() {
+    close();
+}
+
+bool ProcessEventSource::open() {
+    close();
+
+    mFd = ::socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (mFd < 0) {
+        LOG_W("Process events: netlink socket failed: %s", std::strerror(errno));
+        return false;
+    }
+
+    sockaddr_nl address{};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = CN_IDX_PROC;
+    if (::bind(mFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        LOG_W("Process events: netlink bind failed: %s", std::strerror(errno));
+        close();
+        return false;
+    }
+
+    const int bufferBytes = kSocketBufferBytes;
+    if (::setsockopt(mFd, SOL_SOCKET, SO_RCVBUFFORCE, &bufferBytes, sizeof(bufferBytes)) != 0) {
+        ::setsockopt(mFd, SOL_SOCKET, SO_RCVBUF, &bufferBytes, sizeof(bufferBytes));
+    }
+
+    // The subscription is only known to work once the connector acks it with
+    // error 0. Without CAP_NET_ADMIN (or outside the initial network
+    // namespace) the ack carries EPERM instead, which waitForAck() reports
+    // as refused; a kernel without the connector never answers.
+    if (!sendListen(true) || !waitForAck()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ProcessEventSource::close() {
+    if (mFd >= 0) {
+        sendListen(false);
+        ::close(mFd);
+        mFd = -1;
+    }
+}
+
+bool ProcessEventSource::isOpen() const {
+    return mFd >= 0;
+}
+
+bool ProcessEventSource::sendListen(bool listen) {
+    alignas(nlmsghdr) char message[NLMSG_SPACE(sizeof(cn_msg) + sizeof(proc_cn_mcast_op))] = {};
+    auto* header = reinterpret_cast<nlmsghdr*>(message);
+    header->nlmsg_len = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_cn_mcast_op));
+    header->nlmsg_type = NLMSG_DONE;
+    header->nlmsg_pid = static_cast<std::uint32_t>(::getpid());
+
+    auto* connector = static_cast<cn_msg*>(NLMSG_DATA(header));
+    connector->id.idx = CN_IDX_PROC;
+    connector->id.val = CN_VAL_PROC;
+    connector->len = sizeof(proc_cn_mcast_op);
+    const proc_cn_mcast_op op = listen ? PROC_CN_MCAST_LISTEN : PROC_CN_MCAST_IGNORE;
+    std::memcpy(connector->data, &op, sizeof(op));
+
+    if (::send(mFd, message, header->nlmsg_len, 0) < 0) {
+        if (listen) {
+            LOG_W("Process events: subscribe failed: %s", std::strerror(errno));
+        }
+        return false;
+    }
+    return true;
+}
+
+bool ProcessEventSource::waitForAck() {
+    const std::uint64_t deadlineNs = monotonicNowNs() + static_cast<std::uint64_t>(kAckTimeoutMs) * 1000000ull;
+    for (;;) {
+        const std::uint64_t nowNs = monotonicNowNs();
+        if (nowNs >= deadlineNs || !wait(static_cast<int>((deadlineNs - nowNs) / 1000000ull) + 1)) {
+            LOG_W("Process events: no subscription ack from the proc connector");
+            return false;
+        }
+
+        const ssize_t bytes = ::recv(mFd, mBuffer.data(), mBuffer.size(), 0);
+        if (bytes <= 0) {
+            if (bytes < 0 && (errno == EAGAIN || errno == EINTR)) {
+                continue;
+            }
+            return false;
+        }
+
+        // Events racing the ack are dropped; the first sample rescans anyway.
+        int ackError = -1;
+        parse(mBuffer.data(), static_cast<std::size_t>(bytes), nullptr, &ackError);
+        if (ackError == 0) {
+            return true;
+        }
+        if (ackError > 0) {
+            LOG_W("Process events: subscription refused: %s", std::strerror(ackError));
+            return false;
+        }
+    }
+}
+
+bool ProcessEventSource::wait(int timeoutMs) const {
+    if (mFd < 0) {
+        return false;
+    }
+    pollfd entry{};
+    entry.fd = mFd;
+    entry.events = POLLIN;
+    return ::poll(&entry, 1, timeoutMs) > 0 && (entry.revents & POLLIN) != 0;
+}
+
+ProcessEventSource::DrainResult ProcessEventSource::drain(std::vector<Event>& outEvents) {
+    bool overflowed = false;
+    for (;;) {
+        const ssize_t bytes = ::recv(mFd, mBuffer.data(), mBuffer.size(), 0);
+        if (bytes < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return overflowed ? DRAIN_OVERFLOW : DRAIN_OK;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == ENOBUFS) {
+                overflowed = true;
+                continue;
+            }
+            LOG_E("Process events: recv failed: %s", std::strerror(errno));
+            return DRAIN_ERROR;
+        }
+        if (bytes == 0) {
+            return DRAIN_ERROR;
+        }
+        parse(mBuffer.data(), static_cast<std::size_t>(bytes), &outEvents, nullptr);
+    }
+}
+
+void ProcessEventSource::parse(const char* data,
+                               std::size_t size,
+                               std::vector<Event>* outEvents,
+                               int* outAckError) const {
+    int remaining = static_cast<int>(size);
+    for (auto* header = reinterpret_cast<const nlmsghdr*>(data); NLMSG_OK(header, remaining);
+         header = NLMSG_NEXT(header, remaining)) {
+        if (header->nlmsg_type == NLMSG_NOOP || header->nlmsg_type == NLMSG_ERROR ||
+            header->nlmsg_len < NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_event))) {
+            continue;
+        }
+
+        const auto* connector = static_cast<const cn_msg*>(NLMSG_DATA(header));
+        if (connector->id.idx != CN_IDX_PROC || connector->id.val != CN_VAL_PROC) {
+            continue;
+        }
+
+        proc_event event;
+        std::memcpy(&event, connector->data, sizeof(event));
+        switch (event.what) {
+            case proc_event::PROC_EVENT_NONE:
+                if (outAckError != nullptr) {
+                    *outAckError = static_cast<int>(event.event_data.ack.err);
+                }
+                break;
+            case proc_event::PROC_EVENT_FORK:
+                if (outEvents != nullptr && event.event_data.fork.child_pid == event.event_data.fork.child_tgid) {
+                    outEvents->push_back({EVENT_FORK,
+                                          static_cast<std::uint32_t>(event.event_data.fork.child_tgid),
+                                          static_cast<std::uint32_t>(event.event_data.fork.parent_tgid)});
+                }
+                break;
+            case proc_event::PROC_EVENT_EXEC:
+                if (outEvents != nullptr && event.event_data.exec.process_pid == event.event_data.exec.process_tgid) {
+                    outEvents->push_back({EVENT_EXEC, static_cast<std::uint32_t>(event.event_data.exec.process_tgid), 0});
+                }
+                break;
+            case proc_event::PROC_EVENT_EXIT:
+                if (outEvents != nullptr && event.event_data.exit.process_pid == event.event_data.exit.process_tgid) {
+                    outEvents->push_back({EVENT_EXIT, static_cast<std::uint32_t>(event.event_data.exit.process_tgid), 0});
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+} // namespace xmonitor
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace xmonitor {
+
+// Fork/exec/exit notifications from the netlink proc connector. Subscribing
+// needs CAP_NET_ADMIN in the initial namespaces; open() fails without it and
+// callers fall back to /proc polling. Only process-level events are reported
+// (thread creation and exit are filtered out).
+class ProcessEventSource {
+public:
+    enum EventType : std::uint32_t {
+        EVENT_FORK = 0,
+        EVENT_EXEC,
+        EVENT_EXIT
+    };
+
+    struct Event {
+        EventType type;
+        std::uint32_t pid;
+        std::uint32_t parentPid;
+    };
+
+    enum DrainResult {
+        DRAIN_OK = 0,
+        DRAIN_OVERFLOW,
+        DRAIN_ERROR
+    };
+
+    ProcessEventSource();
+    ~ProcessEventSource();
+
+    ProcessEventSource(const ProcessEventSource&) = delete;
+    ProcessEventSource& operator=(const ProcessEventSource&) = delete;
+
+    bool open();
+    void close();
+    bool isOpen() const;
+
+    // Waits up to timeoutMs for the socket to become readable.
+    bool wait(int timeoutMs) const;
+
+    // Appends every queued event without blocking. DRAIN_OVERFLOW means the
+    // kernel dropped events (ENOBUFS) and the caller must rebuild from /proc.
+    DrainResult drain(std::vector<Event>& outEvents);
+
+private:
+    bool sendListen(bool listen);
+    bool waitForAck();
+    void parse(const char* data, std::size_t size, std::vector<Event>* outEvents, int* outAckError) const;
+
+    int mFd;
+    std::vector<char> mBuffer;
+};
+
+} // namespace xmonitor
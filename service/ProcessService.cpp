@@ -0,0 +1,90 @@
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "Logger.h"
+#include "common/Config.h"
+#include "common/FileLimit.h"
+#include "ipc/BinderProtocol.h"
+#include "service/ProcessCollector.h"
+#include "service/ServiceSession.h"
+
+namespace {
+volatile std::sig_atomic_t gRunning = 1;
+
+// Events are applied as they arrive; the table is published once a second.
+constexpr auto kSamplePeriod = std::chrono::milliseconds(1000);
+
+void signalHandler(int) {
+    gRunning = 0;
+}
+
+bool processChanged(const xmonitor::ProcessData& current, const xmonitor::ProcessData& previous) {
+    return std::memcmp(&current, &previous, offsetof(xmonitor::ProcessData, trace)) != 0;
+}
+}
+
+int main() {
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+
+    setLogFilePath("logs/xMonitor-process.log");
+    LOG_I("Process service start");
+
+    xmonitor::ServiceSession session("Process",
+                                     xmonitor::BinderTransactionCode::RegisterProcessService,
+                                     xmonitor::ProcessRole::ProcessService);
+
+    // Every live process keeps its stat file open.
+    if (!xmonitor::raiseFileLimit()) {
+        LOG_W("Process service: cannot raise RLIMIT_NOFILE");
+    }
+
+    xmonitor::ProcessCollector::Options options;
+    options.useEvents = xmonitor::envBool("XMONITOR_PROCESS_EVENTS", true);
+    xmonitor::ProcessCollector collector(options);
+
+    xmonitor::ProcessData lastPublished{};
+    bool hasLastPublished = false;
+
+    if (!session.start(gRunning)) {
+        return 1;
+    }
+
+    if (gRunning == 0) {
+        session.stop();
+        LOG_I("Process service stop");
+        return 0;
+    }
+
+    while (gRunning != 0) {
+        if (session.takePolicyChange()) {
+            hasLastPublished = false;
+        }
+
+        xmonitor::ProcessData current{};
+        if (session.sectionEnabled(xmonitor::BinderTransactionCode::ProcessUpdated) && collector.sample(current)) {
+            if (!hasLastPublished || processChanged(current, lastPublished)) {
+                hasLastPublished = true;
+                lastPublished = current;
+                if (!session.publish(xmonitor::BinderTransactionCode::ProcessUpdated, &current, sizeof(current))) {
+                    session.stop();
+                    return 1;
+                }
+            }
+        }
+
+        if (!session.onSampleTick()) {
+            session.stop();
+            return 1;
+        }
+
+        collector.waitForEvents(static_cast<int>(session.samplePeriod(kSamplePeriod).count()));
+    }
+
+    session.stop();
+    LOG_I("Process service stop");
+    return 0;
+}
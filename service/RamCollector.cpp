@@ -0,0 +1,221 @@
+#include "service/RamCollector.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+#include "common/ProcfsRoot.h"
+#include "common/TextScan.h"
+
+namespace xmonitor {
+namespace {
+
+// Byte fields of RamData are addressed by member pointer so this table is
+// the single place that maps meminfo keys onto the wire struct.
+struct MeminfoKey {
+    const char* key;
+    std::uint64_t RamData::*field;
+};
+
+struct VmstatKey {
+    const char* key;
+    std::size_t slot;
+};
+
+constexpr bool keyLess(const char* left, const char* right) {
+    while (*left != '\0' && *left == *right) {
+        ++left;
+        ++right;
+    }
+    return static_cast<unsigned char>(*left) < static_cast<unsigned char>(*right);
+}
+
+template <typename Entry, std::size_t N>
+constexpr bool isSorted(const Entry (&table)[N]) {
+    for (std::size_t i = 1; i < N; ++i) {
+        if (!keyLess(table[i - 1].key, table[i].key)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Orders a NUL-terminated table key against the unterminated key[0, length).
+int compareKey(const char* entryKey, const char* key, std::size_t length) {
+    const int order = std::strncmp(entryKey, key, length);
+    if (order != 0) {
+        return order;
+    }
+    return entryKey[length] == '\0' ? 0 : 1;
+}
+
+template <typename Entry, std::size_t N>
+const Entry* lookup(const Entry (&table)[N], const char* key, std::size_t length) {
+    const Entry* found = std::lower_bound(table, table + N, key, [length](const Entry& entry, const char* wanted) {
+        return compareKey(entry.key, wanted, length) < 0;
+    });
+    if (found != table + N && compareKey(found->key, key, length) == 0) {
+        return found;
+    }
+    return nullptr;
+}
+
+constexpr MeminfoKey kMeminfoKeys[] = {
+    {"Active", &RamData::activeBytes},
+    {"AnonPages", &RamData::anonBytes},
+    {"Buffers", &RamData::buffersBytes},
+    {"Cached", &RamData::cachedBytes},
+    {"CommitLimit", &RamData::commitLimitBytes},
+    {"Committed_AS", &RamData::committedBytes},
+    {"Dirty", &RamData::dirtyBytes},
+    {"Inactive", &RamData::inactiveBytes},
+    {"Mapped", &RamData::mappedBytes},
+    {"MemAvailable", &RamData::availableBytes},
+    {"MemFree", &RamData::freeBytes},
+    {"MemTotal", &RamData::totalBytes},
+    {"SReclaimable", &RamData::slabReclaimableBytes},
+    {"SUnreclaim", &RamData::slabUnreclaimableBytes},
+    {"Shmem", &RamData::shmemBytes},
+    {"Slab", &RamData::slabBytes},
+    {"SwapCached", &RamData::swapCachedBytes},
+    {"SwapFree", &RamData::swapFreeBytes},
+    {"SwapTotal", &RamData::swapTotalBytes},
+    {"Writeback", &RamData::writebackBytes},
+};
+
+static_assert(isSorted(kMeminfoKeys), "kMeminfoKeys must stay sorted for binary search");
+
+constexpr VmstatKey kVmstatKeys[] = {
+    {"oom_kill", RamCollector::VMSTAT_OOM_KILL},
+    {"pgfault", RamCollector::VMSTAT_PGFAULT},
+    {"pgmajfault", RamCollector::VMSTAT_PGMAJFAULT},
+    {"pgscan_direct", RamCollector::VMSTAT_PGSCAN},
+    {"pgscan_khugepaged", RamCollector::VMSTAT_PGSCAN},
+    {"pgscan_kswapd", RamCollector::VMSTAT_PGSCAN},
+    {"pgsteal_direct", RamCollector::VMSTAT_PGSTEAL},
+    {"pgsteal_khugepaged", RamCollector::VMSTAT_PGSTEAL},
+    {"pgsteal_kswapd", RamCollector::VMSTAT_PGSTEAL},
+    {"pswpin", RamCollector::VMSTAT_PSWPIN},
+    {"pswpout", RamCollector::VMSTAT_PSWPOUT},
+};
+
+static_assert(isSorted(kVmstatKeys), "kVmstatKeys must stay sorted for binary search");
+
+double ratePerSecond(std::uint64_t current, std::uint64_t previous, std::uint64_t windowNs) {
+    if (windowNs == 0 || current < previous) {
+        return 0.0;
+    }
+    return static_cast<double>(current - previous) * 1e9 / static_cast<double>(windowNs);
+}
+
+} // namespace
+
+RamCollector::RamCollector()
+    : mMeminfoFile(procPath("meminfo")),
+      mVmstatFile(procPath("vmstat")),
+      mPreviousCounters{},
+      mPreviousSampleNs(0) {}
+
+bool RamCollector::readMeminfo(RamData& outData) {
+    if (!mMeminfoFile.isOpen() || !mMeminfoFile.read()) {
+        LOG_E("RAM read failed: cannot read %s", mMeminfoFile.path().c_str());
+        return false;
+    }
+
+    // "Key:   12345 kB" -- the key stops at ':' and values are in KiB.
+    const char* cursor = mMeminfoFile.data();
+    const char* end = mMeminfoFile.end();
+    while (cursor < end) {
+        const char* key = cursor;
+        while (cursor < end && *cursor != ':' && *cursor != '\n') {
+            ++cursor;
+        }
+
+        const MeminfoKey* entry = lookup(kMeminfoKeys, key, static_cast<std::size_t>(cursor - key));
+        if (entry != nullptr && cursor < end && *cursor == ':') {
+            ++cursor;
+            std::uint64_t valueKb = 0;
+            if (parseU64(cursor, end, valueKb)) {
+                outData.*(entry->field) = valueKb * 1024;
+            }
+        }
+        skipLine(cursor, end);
+    }
+
+    return true;
+}
+
+bool RamCollector::readVmstat(std::uint64_t (&outCounters)[VMSTAT_SLOT_COUNT]) {
+    if (!mVmstatFile.isOpen() || !mVmstatFile.read()) {
+        return false;
+    }
+
+    // "key value" per line.
+    const char* cursor = mVmstatFile.data();
+    const char* end = mVmstatFile.end();
+    while (cursor < end) {
+        const char* key = nullptr;
+        const std::size_t length = readToken(cursor, end, key);
+        const VmstatKey* entry = lookup(kVmstatKeys, key, length);
+        std::uint64_t value = 0;
+        if (entry != nullptr && parseU64(cursor, end, value)) {
+            outCounters[entry->slot] += value;
+        }
+        skipLine(cursor, end);
+    }
+
+    return true;
+}
+
+bool RamCollector::sample(RamData& outData) {
+    if (!readMeminfo(outData)) {
+        return false;
+    }
+
+    if (outData.totalBytes == 0) {
+        LOG_E("RAM read failed: MemTotal missing in %s", mMeminfoFile.path().c_str());
+        return false;
+    }
+
+    outData.usedBytes = outData.totalBytes >= outData.availableBytes ? outData.totalBytes - outData.availableBytes : 0;
+    outData.usagePercent = static_cast<double>(outData.usedBytes) * 100.0 / static_cast<double>(outData.totalBytes);
+
+    const std::uint64_t nowNs = monotonicNowNs();
+    std::uint64_t counters[VMSTAT_SLOT_COUNT] = {};
+    if (readVmstat(counters)) {
+        if (mPreviousSampleNs != 0) {
+            const std::uint64_t windowNs = nowNs - mPreviousSampleNs;
+            outData.pageFaultsPerSec = ratePerSecond(counters[VMSTAT_PGFAULT], mPreviousCounters[VMSTAT_PGFAULT], windowNs);
+            outData.majorFaultsPerSec =
+                ratePerSecond(counters[VMSTAT_PGMAJFAULT], mPreviousCounters[VMSTAT_PGMAJFAULT], windowNs);
+            outData.pagesScannedPerSec = ratePerSecond(counters[VMSTAT_PGSCAN], mPreviousCounters[VMSTAT_PGSCAN], windowNs);
+            outData.pagesStolenPerSec =
+                ratePerSecond(counters[VMSTAT_PGSTEAL], mPreviousCounters[VMSTAT_PGSTEAL], windowNs);
+            outData.swapInPagesPerSec = ratePerSecond(counters[VMSTAT_PSWPIN], mPreviousCounters[VMSTAT_PSWPIN], windowNs);
+            outData.swapOutPagesPerSec =
+                ratePerSecond(counters[VMSTAT_PSWPOUT], mPreviousCounters[VMSTAT_PSWPOUT], windowNs);
+        }
+        outData.oomKills = counters[VMSTAT_OOM_KILL];
+        std::copy(counters, counters + VMSTAT_SLOT_COUNT, mPreviousCounters);
+        mPreviousSampleNs = nowNs;
+    }
+    outData.trace.sampleNs = nowNs;
+
+    static int sampleCounter = 0;
+    ++sampleCounter;
+    if (sampleCounter % 10 == 0) {
+        LOG_D("RAM read ok: usage=%.2f used=%llu total=%llu available=%llu pgscan/s=%.0f pswpin/s=%.0f",
+              outData.usagePercent,
+              static_cast<unsigned long long>(outData.usedBytes),
+              static_cast<unsigned long long>(outData.totalBytes),
+              static_cast<unsigned long long>(outData.availableBytes),
+              outData.pagesScannedPerSec,
+              outData.swapInPagesPerSec);
+    }
+
+    return true;
+}
+
+} // namespace xmonitor
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+#include "common/ProcFile.h"
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// System memory from <procRoot>/meminfo and reclaim/swap activity from
+// <procRoot>/vmstat. Each file is scanned once per sample and every line is
+// resolved against a sorted key table, so adding a field costs nothing extra.
+class RamCollector {
+public:
+    RamCollector();
+
+    bool sample(RamData& outData);
+
+    // Counter slots filled from /proc/vmstat; several kernel keys (e.g. the
+    // kswapd/direct/khugepaged variants of pgscan) accumulate into one slot.
+    enum VmstatSlot : std::size_t {
+        VMSTAT_PGFAULT = 0,
+        VMSTAT_PGMAJFAULT,
+        VMSTAT_PGSCAN,
+        VMSTAT_PGSTEAL,
+        VMSTAT_PSWPIN,
+        VMSTAT_PSWPOUT,
+        VMSTAT_OOM_KILL,
+        VMSTAT_SLOT_COUNT
+    };
+
+private:
+    bool readMeminfo(RamData& outData);
+    bool readVmstat(std::uint64_t (&outCounters)[VMSTAT_SLOT_COUNT]);
+
+    ProcFile mMeminfoFile;
+    ProcFile mVmstatFile;
+    std::uint64_t mPreviousCounters[VMSTAT_SLOT_COUNT];
+    std::uint64_t mPreviousSampleNs;
+};
+
+} // namespace xmonitor
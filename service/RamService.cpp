@@ -1,79 +1,89 @@
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <csignal>
 #include <cstdint>
-#include <fstream>
-#include <sstream>
-#include <string>
-#include <thread>
 
 #include "Logger.h"
 #include "ipc/BinderProtocol.h"
-#include "ipc/BinderClientAdapter.h"
+#include "service/RamCollector.h"
+#include "service/ServiceSession.h"
 
 namespace {
 volatile std::sig_atomic_t gRunning = 1;
 
+constexpr auto kSamplePeriod = std::chrono::milliseconds(100);
+
+// Sizes are published on any change unless a deadband is set by policy.
+constexpr double kDeadbandBytes = 0.0;
+// Relative change of a *PerSec rate that is worth a publish.
+constexpr double kRateDeadband = 0.05;
+
 void signalHandler(int) {
     gRunning = 0;
 }
 
-bool readRam(xmonitor::RamData& outData) {
-    std::ifstream meminfo("/proc/meminfo");
-    if (!meminfo.is_open()) {
-        LOG_E("RAM read failed: cannot open /proc/meminfo");
-        return false;
-    }
-
-    std::string line;
-    std::uint64_t memTotalKb = 0;
-    std::uint64_t memAvailableKb = 0;
-
-    while (std::getline(meminfo, line)) {
-        std::istringstream stream(line);
-        std::string key;
-        std::uint64_t value = 0;
-        std::string unit;
-        stream >> key >> value >> unit;
-
-        if (key == "MemTotal:") {
-            memTotalKb = value;
-        } else if (key == "MemAvailable:") {
-            memAvailableKb = value;
-        }
+constexpr std::uint64_t xmonitor::RamData::*kSizeFields[] = {
+    &xmonitor::RamData::totalBytes,
+    &xmonitor::RamData::usedBytes,
+    &xmonitor::RamData::availableBytes,
+    &xmonitor::RamData::freeBytes,
+    &xmonitor::RamData::buffersBytes,
+    &xmonitor::RamData::cachedBytes,
+    &xmonitor::RamData::swapCachedBytes,
+    &xmonitor::RamData::activeBytes,
+    &xmonitor::RamData::inactiveBytes,
+    &xmonitor::RamData::anonBytes,
+    &xmonitor::RamData::mappedBytes,
+    &xmonitor::RamData::shmemBytes,
+    &xmonitor::RamData::dirtyBytes,
+    &xmonitor::RamData::writebackBytes,
+    &xmonitor::RamData::slabBytes,
+    &xmonitor::RamData::slabReclaimableBytes,
+    &xmonitor::RamData::slabUnreclaimableBytes,
+    &xmonitor::RamData::swapTotalBytes,
+    &xmonitor::RamData::swapFreeBytes,
+    &xmonitor::RamData::committedBytes,
+    &xmonitor::RamData::commitLimitBytes,
+};
+
+constexpr double xmonitor::RamData::*kRateFields[] = {
+    &xmonitor::RamData::pageFaultsPerSec,
+    &xmonitor::RamData::majorFaultsPerSec,
+    &xmonitor::RamData::pagesScannedPerSec,
+    &xmonitor::RamData::pagesStolenPerSec,
+    &xmonitor::RamData::swapInPagesPerSec,
+    &xmonitor::RamData::swapOutPagesPerSec,
+};
+
+bool bytesChanged(std::uint64_t current, std::uint64_t previous, double deadband) {
+    const std::uint64_t delta = current > previous ? current - previous : previous - current;
+    return delta != 0 && static_cast<double>(delta) >= deadband;
+}
 
-        if (memTotalKb > 0 && memAvailableKb > 0) {
-            break;
-        }
+// Rates are counter deltas over a window that varies by a few microseconds,
+// so on a live host they differ on every sample; only a start, a stop or a
+// relative move of kRateDeadband counts.
+bool rateChanged(double current, double previous) {
+    if ((current == 0.0) != (previous == 0.0)) {
+        return true;
     }
+    return std::fabs(current - previous) > kRateDeadband * std::max(current, previous);
+}
 
-    if (memTotalKb == 0) {
-        LOG_E("RAM read failed: MemTotal missing in /proc/meminfo");
-        return false;
+bool ramChanged(const xmonitor::RamData& current, const xmonitor::RamData& previous, double deadband) {
+    // usagePercent follows usedBytes; a deadband of 0 counts any change.
+    for (std::uint64_t xmonitor::RamData::*field : kSizeFields) {
+        if (bytesChanged(current.*field, previous.*field, deadband)) {
+            return true;
+        }
     }
-
-    const std::uint64_t totalBytes = memTotalKb * 1024;
-    const std::uint64_t availableBytes = memAvailableKb * 1024;
-    const std::uint64_t usedBytes = totalBytes >= availableBytes ? totalBytes - availableBytes : 0;
-    const double usagePercent = totalBytes > 0
-        ? static_cast<double>(usedBytes) * 100.0 / static_cast<double>(totalBytes)
-        : 0.0;
-
-    outData.totalBytes = totalBytes;
-    outData.usedBytes = usedBytes;
-    outData.availableBytes = availableBytes;
-    outData.usagePercent = usagePercent;
-
-    static int sampleCounter = 0;
-    ++sampleCounter;
-    if (sampleCounter % 10 == 0) {
-        LOG_D("RAM read ok: usage=%.2f used=%llu total=%llu available=%llu",
-              outData.usagePercent,
-              static_cast<unsigned long long>(outData.usedBytes),
-              static_cast<unsigned long long>(outData.totalBytes),
-              static_cast<unsigned long long>(outData.availableBytes));
+    for (double xmonitor::RamData::*field : kRateFields) {
+        if (rateChanged(current.*field, previous.*field)) {
+            return true;
+        }
     }
-
-    return true;
+    return current.oomKills != previous.oomKills;
 }
 }
 
@@ -84,84 +94,50 @@ int main() {
     setLogFilePath("logs/xMonitor-ram.log");
     LOG_I("RAM service start");
 
-    xmonitor::BinderClientAdapter binder;
+    xmonitor::ServiceSession session("RAM",
+                                     xmonitor::BinderTransactionCode::RegisterRamService,
+                                     xmonitor::ProcessRole::RamService);
 
+    xmonitor::RamCollector collector;
     xmonitor::RamData lastPublished{};
     bool hasLastPublished = false;
 
-    if (!binder.initialize()) {
-        LOG_E("RAM service binder initialize failed");
+    if (!session.start(gRunning)) {
         return 1;
     }
 
-    LOG_I("RAM service binder initialize success");
-
-    {
-        xmonitor::BinderAck ack{};
-        const std::uint32_t request = 1;
-        std::size_t replySize = 0;
-        if (!binder.transact(static_cast<std::uint32_t>(xmonitor::BinderTransactionCode::RegisterRamService),
-                     &request,
-                     sizeof(request),
-                     &ack,
-                     sizeof(ack),
-                     replySize) ||
-            replySize != sizeof(ack) || ack.ok == 0) {
-            LOG_E("RAM service register to lifecycle failed");
-            binder.shutdown();
-            return 1;
-        }
-    }
-
-    while (gRunning != 0) {
-        xmonitor::BinderAck ack{};
-        const std::uint32_t request = 1;
-        std::size_t replySize = 0;
-        if (binder.transact(static_cast<std::uint32_t>(xmonitor::BinderTransactionCode::WaitStart),
-                            &request,
-                            sizeof(request),
-                            &ack,
-                            sizeof(ack),
-                            replySize) &&
-            replySize == sizeof(ack) && ack.ok != 0 && ack.startGranted != 0) {
-            break;
-        }
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
-
     if (gRunning == 0) {
-        binder.shutdown();
+        session.stop();
         LOG_I("RAM service stop");
         return 0;
     }
 
-    LOG_I("RAM service start streaming");
-
     while (gRunning != 0) {
+        if (session.takePolicyChange()) {
+            hasLastPublished = false;
+        }
+
         xmonitor::RamData current{};
-        if (readRam(current)) {
-            if (!hasLastPublished ||
-                current.totalBytes != lastPublished.totalBytes ||
-                current.usedBytes != lastPublished.usedBytes ||
-                current.availableBytes != lastPublished.availableBytes) {
+        if (session.sectionEnabled(xmonitor::BinderTransactionCode::RamUpdated) && collector.sample(current)) {
+            if (!hasLastPublished || ramChanged(current, lastPublished, session.deadband(kDeadbandBytes))) {
                 hasLastPublished = true;
                 lastPublished = current;
-                const bool sent = binder.send(static_cast<std::uint32_t>(xmonitor::BinderTransactionCode::RamUpdated),
-                                              &current,
-                                              sizeof(current));
-                if (!sent) {
-                    LOG_E("RAM service binder send failed");
-                    binder.shutdown();
+                if (!session.publish(xmonitor::BinderTransactionCode::RamUpdated, &current, sizeof(current))) {
+                    session.stop();
                     return 1;
                 }
             }
         }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (!session.onSampleTick()) {
+            session.stop();
+            return 1;
+        }
+
+        session.sleepUntilNextTick(kSamplePeriod);
     }
 
-    binder.shutdown();
+    session.stop();
     LOG_I("RAM service stop");
     return 0;
 }
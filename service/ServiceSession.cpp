@@ -0,0 +1,215 @@
+#include "service/ServiceSession.h"
+
+#include <chrono>
+#include <thread>
+
+#include "Logger.h"
+#include "common/Config.h"
+#include "common/MonotonicClock.h"
+#include "common/SamplingPolicy.h"
+
+namespace xmonitor {
+
+ServiceSession::ServiceSession(const char* name, BinderTransactionCode registerCode, ProcessRole role)
+    : mName(name),
+      mRegisterCode(registerCode),
+      mRole(role),
+      mSelfUsage(role),
+      mTicks(0),
+      mLastSelfUsageNs(0),
+      mLastPolicyPollNs(0),
+      mPolledVersion(0),
+      mPendingPolicy{},
+      mPolicyPending(false),
+      mDisabledSections(0),
+      mPolicy{},
+      mPolicyChanged(false) {}
+
+ServiceSession::~ServiceSession() {
+    stop();
+}
+
+bool ServiceSession::start(const volatile std::sig_atomic_t& running) {
+    // Before any thread is started, so they all inherit it.
+    mLowJitter = lowJitterOptionsFromEnv();
+    if (mLowJitter.enabled) {
+        applyLowJitterScheduling(mLowJitter);
+    }
+
+    if (!mBinder.initialize()) {
+        LOG_E("%s service binder initialize failed", mName);
+        return false;
+    }
+
+    LOG_I("%s service binder initialize success", mName);
+
+    {
+        BinderAck ack{};
+        const std::uint32_t request = 1;
+        std::size_t replySize = 0;
+        if (!mBinder.transact(static_cast<std::uint32_t>(mRegisterCode),
+                              &request,
+                              sizeof(request),
+                              &ack,
+                              sizeof(ack),
+                              replySize) ||
+            replySize != sizeof(ack) || ack.ok == 0) {
+            LOG_E("%s service register to lifecycle failed", mName);
+            mBinder.shutdown();
+            return false;
+        }
+    }
+
+    while (running != 0) {
+        BinderAck ack{};
+        const std::uint32_t request = 1;
+        std::size_t replySize = 0;
+        if (mBinder.transact(static_cast<std::uint32_t>(BinderTransactionCode::WaitStart),
+                             &request,
+                             sizeof(request),
+                             &ack,
+                             sizeof(ack),
+                             replySize) &&
+            replySize == sizeof(ack) && ack.ok != 0 && ack.startGranted != 0) {
+            LOG_I("%s service start streaming", mName);
+            pollPolicy();
+            applyPendingPolicy();
+            mPolicyChanged = false;
+            mLastPolicyPollNs = monotonicNowNs();
+            if (envBool("XMONITOR_ASYNC_SEND", true)) {
+                mBinder.setSenderTask(kPolicyPollIntervalNs, [this]() { pollPolicy(); });
+                mBinder.startAsyncSender();
+            }
+            if (mLowJitter.enabled) {
+                lockLowJitterMemory(mLowJitter);
+            }
+            SelfUsageData baseline{};
+            mSelfUsage.sample(mTicks, mBinder.transactionCount(), baseline);
+            mLastSelfUsageNs = monotonicNowNs();
+            break;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    return true;
+}
+
+void ServiceSession::stop() {
+    mBinder.shutdown();
+}
+
+bool ServiceSession::publish(BinderTransactionCode code, const void* payload, std::size_t payloadSize) {
+    if (!mBinder.send(static_cast<std::uint32_t>(code), payload, payloadSize)) {
+        LOG_E("%s service binder send failed", mName);
+        return false;
+    }
+    return true;
+}
+
+bool ServiceSession::query(BinderTransactionCode code,
+                           const void* request,
+                           std::size_t requestSize,
+                           void* reply,
+                           std::size_t replySize) {
+    std::size_t receivedSize = 0;
+    if (!mBinder.transact(static_cast<std::uint32_t>(code), request, requestSize, reply, replySize, receivedSize) ||
+        receivedSize != replySize) {
+        LOG_E("%s service query failed: code=%u", mName, static_cast<unsigned>(code));
+        return false;
+    }
+    return true;
+}
+
+bool ServiceSession::onSampleTick() {
+    ++mTicks;
+    const std::uint64_t nowNs = monotonicNowNs();
+    if (!mBinder.isAsync() && nowNs - mLastPolicyPollNs >= kPolicyPollIntervalNs) {
+        mLastPolicyPollNs = nowNs;
+        pollPolicy();
+    }
+    applyPendingPolicy();
+    if (nowNs - mLastSelfUsageNs < kSelfUsageIntervalNs) {
+        return true;
+    }
+    mLastSelfUsageNs = nowNs;
+
+    SelfUsageData usage{};
+    if (!mSelfUsage.sample(mTicks, mBinder.transactionCount(), usage)) {
+        return true;
+    }
+    const BinderClientAdapter::AsyncSendStats sendStats = mBinder.asyncSendStats();
+    usage.sendsCoalesced = sendStats.coalesced;
+    usage.sendsDropped = sendStats.dropped;
+    mTicker.report(usage);
+    usage.lowJitter = mLowJitter.enabled ? 1u : 0u;
+
+    return publish(BinderTransactionCode::SelfUsageUpdated, &usage, sizeof(usage));
+}
+
+bool ServiceSession::sectionEnabled(BinderTransactionCode code) const {
+    return (mDisabledSections & policySectionBit(code)) == 0;
+}
+
+std::chrono::milliseconds ServiceSession::samplePeriod(std::chrono::milliseconds compiledIn) const {
+    return mPolicy.periodMs != 0 ? std::chrono::milliseconds(mPolicy.periodMs) : compiledIn;
+}
+
+double ServiceSession::deadband(double compiledIn) const {
+    return mPolicy.deadband >= 0.0 ? mPolicy.deadband : compiledIn;
+}
+
+void ServiceSession::sleepUntilNextTick(std::chrono::milliseconds compiledIn) {
+    mTicker.wait(samplePeriod(compiledIn));
+}
+
+bool ServiceSession::takePolicyChange() {
+    const bool changed = mPolicyChanged;
+    mPolicyChanged = false;
+    return changed;
+}
+
+// A failed poll keeps the current policy; lifecycle going away is noticed
+// by the next publish.
+void ServiceSession::pollPolicy() {
+    const std::uint32_t request = 1;
+    SamplingPolicy policy{};
+    std::size_t replySize = 0;
+    if (!mBinder.transact(static_cast<std::uint32_t>(BinderTransactionCode::QueryPolicy),
+                          &request,
+                          sizeof(request),
+                          &policy,
+                          sizeof(policy),
+                          replySize) ||
+        replySize != sizeof(policy) || policy.version == mPolledVersion) {
+        return;
+    }
+
+    mPolledVersion = policy.version;
+    {
+        std::lock_guard<std::mutex> lock(mPendingPolicyMutex);
+        mPendingPolicy = policy;
+    }
+    mPolicyPending.store(true, std::memory_order_release);
+}
+
+void ServiceSession::applyPendingPolicy() {
+    if (!mPolicyPending.exchange(false, std::memory_order_acquire)) {
+        return;
+    }
+
+    SamplingPolicy policy{};
+    {
+        std::lock_guard<std::mutex> lock(mPendingPolicyMutex);
+        policy = mPendingPolicy;
+    }
+    mDisabledSections = policy.disabledSections;
+    mPolicy = policy.services[static_cast<std::size_t>(mRole)];
+    mPolicyChanged = true;
+    LOG_I("%s service policy v%llu: %s",
+          mName,
+          static_cast<unsigned long long>(policy.version),
+          formatPolicy(policy).c_str());
+}
+
+} // namespace xmonitor
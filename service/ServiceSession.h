@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "common/LowJitter.h"
+#include "common/SelfUsage.h"
+#include "common/TickTimer.h"
+#include "ipc/BinderClientAdapter.h"
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// Binder session shared by every service process: registers with lifecycle,
+// waits for the start grant, publishes samples and periodically reports the
+// service's own overhead through the normal update path. Once streaming,
+// publish() goes through the adapter's async sender unless
+// XMONITOR_ASYNC_SEND=0, so a slow lifecycle never stalls sampling.
+//
+// The runtime sampling policy (SetPolicy, see SamplingPolicy) is read at
+// start and then once a second by the async sender thread, so the sampling
+// thread never waits on the QueryPolicy round trip (with inline sends it
+// polls from onSampleTick instead). A new policy is handed over and applied
+// by the next onSampleTick, replacing the service's whole entry between two
+// samples; services read it through sectionEnabled/samplePeriod/deadband
+// instead of their compiled-in values.
+//
+// Ticks run on absolute CLOCK_MONOTONIC deadlines (sleepUntilNextTick), and
+// their wakeup latency is reported with the self usage. XMONITOR_LOW_JITTER
+// additionally pins and reprioritizes the sampling thread (and the async
+// sender it starts) and locks the process' memory once streaming.
+class ServiceSession {
+public:
+    ServiceSession(const char* name, BinderTransactionCode registerCode, ProcessRole role);
+    ~ServiceSession();
+
+    ServiceSession(const ServiceSession&) = delete;
+    ServiceSession& operator=(const ServiceSession&) = delete;
+
+    // Returns false on binder/register failure. Returns true once start is
+    // granted or when running drops to zero while waiting.
+    bool start(const volatile std::sig_atomic_t& running);
+    void stop();
+
+    bool publish(BinderTransactionCode code, const void* payload, std::size_t payloadSize);
+
+    // Two-way transaction to lifecycle; false unless the reply is exactly replySize bytes.
+    bool query(BinderTransactionCode code,
+               const void* request,
+               std::size_t requestSize,
+               void* reply,
+               std::size_t replySize);
+
+    // Call once per sampling tick; sends a SelfUsageUpdated at most once per
+    // kSelfUsageIntervalNs whatever the service's sampling period is.
+    bool onSampleTick();
+
+    bool sectionEnabled(BinderTransactionCode code) const;
+    std::chrono::milliseconds samplePeriod(std::chrono::milliseconds compiledIn) const;
+    double deadband(double compiledIn) const;
+
+    // Sleeps until the next tick of samplePeriod(compiledIn); returns early
+    // when a signal arrives so the caller can check its running flag.
+    void sleepUntilNextTick(std::chrono::milliseconds compiledIn);
+
+    // True once after a new policy took effect, so the caller can drop its
+    // last-published state and send a fresh sample under the new settings.
+    bool takePolicyChange();
+
+private:
+    static constexpr std::uint64_t kSelfUsageIntervalNs = 1000000000ull;
+    static constexpr std::uint64_t kPolicyPollIntervalNs = 1000000000ull;
+
+    // Fetches the policy and, when its version changed, leaves it for
+    // applyPendingPolicy(). Sender thread once streaming asynchronously.
+    void pollPolicy();
+    // Sampling thread.
+    void applyPendingPolicy();
+
+    const char* mName;
+    BinderTransactionCode mRegisterCode;
+    ProcessRole mRole;
+    BinderClientAdapter mBinder;
+    SelfUsageSampler mSelfUsage;
+    LowJitterOptions mLowJitter;
+    TickTimer mTicker;
+    std::uint64_t mTicks;
+    std::uint64_t mLastSelfUsageNs;
+    std::uint64_t mLastPolicyPollNs;
+    // Polling thread only.
+    std::uint64_t mPolledVersion;
+    std::mutex mPendingPolicyMutex;
+    SamplingPolicy mPendingPolicy;
+    std::atomic<bool> mPolicyPending;
+    // Sampling thread only.
+    std::uint32_t mDisabledSections;
+    ServicePolicy mPolicy;
+    bool mPolicyChanged;
+};
+
+} // namespace xmonitor
@@ -0,0 +1,273 @@
+#include "service/ThreadCollector.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+#include "common/ProcfsRoot.h"
+#include "common/TextScan.h"
+
+namespace xmonitor {
+namespace {
+
+// stat/schedstat are one line; status is ~1.5KB and grows once.
+constexpr std::size_t kThreadFileCapacity = 512;
+
+std::uint64_t counterDelta(std::uint64_t current, std::uint64_t previous) {
+    return current >= previous ? current - previous : 0;
+}
+
+double percentOf(std::uint64_t deltaNs, std::uint64_t windowNs) {
+    return windowNs > 0 ? static_cast<double>(deltaNs) * 100.0 / static_cast<double>(windowNs) : 0.0;
+}
+
+double perSecond(std::uint64_t delta, std::uint64_t windowNs) {
+    return windowNs > 0 ? static_cast<double>(delta) * 1e9 / static_cast<double>(windowNs) : 0.0;
+}
+
+void copyName(const char* name, std::size_t length, char (&outName)[kProcessNameLength]) {
+    std::memset(outName, 0, sizeof(outName));
+    std::memcpy(outName, name, std::min(length, kProcessNameLength - 1));
+}
+
+// "Key:\tvalue" lines of a status file.
+bool findStatusValue(const ProcFile& file, const char* key, std::uint64_t& outValue) {
+    const char* cursor = file.data();
+    const char* end = file.end();
+    while (cursor < end) {
+        if (consume(cursor, end, key)) {
+            return parseU64(cursor, end, outValue);
+        }
+        skipLine(cursor, end);
+    }
+    return false;
+}
+
+} // namespace
+
+ThreadCollector::ThreadCollector()
+    : mPid(0),
+      mNeedsDiscovery(true),
+      mNsPerTick(1e9 / static_cast<double>(std::max(1L, ::sysconf(_SC_CLK_TCK)))),
+      mPreviousSampleNs(0) {}
+
+void ThreadCollector::setTarget(std::uint32_t pid) {
+    if (pid == mPid) {
+        return;
+    }
+
+    mPid = pid;
+    mThreads.clear();
+    mNeedsDiscovery = true;
+    mPreviousSampleNs = 0;
+    if (pid == 0) {
+        mProcessStatus.close();
+        return;
+    }
+    mProcessStatus.open(procPath((std::to_string(pid) + "/status").c_str()));
+    LOG_I("Thread watch target set to pid %u", pid);
+}
+
+std::uint32_t ThreadCollector::target() const {
+    return mPid;
+}
+
+bool ThreadCollector::readProcessStatus(ThreadData& outData, std::uint64_t& outThreadCount) {
+    if (!mProcessStatus.isOpen() || !mProcessStatus.read()) {
+        return false;
+    }
+
+    const char* cursor = mProcessStatus.data();
+    const char* end = mProcessStatus.end();
+    if (consume(cursor, end, "Name:")) {
+        skipBlanks(cursor, end);
+        const char* name = cursor;
+        while (cursor < end && *cursor != '\n') {
+            ++cursor;
+        }
+        copyName(name, static_cast<std::size_t>(cursor - name), outData.processName);
+    }
+    return findStatusValue(mProcessStatus, "Threads:", outThreadCount);
+}
+
+void ThreadCollector::discover() {
+    const std::string taskPath = procPath((std::to_string(mPid) + "/task").c_str());
+    mListedTids.clear();
+    if (DIR* directory = ::opendir(taskPath.c_str())) {
+        while (const dirent* entry = ::readdir(directory)) {
+            const char* cursor = entry->d_name;
+            std::uint64_t tid = 0;
+            if (parseU64(cursor, cursor + std::strlen(entry->d_name), tid) && *cursor == '\0') {
+                mListedTids.push_back(static_cast<std::uint32_t>(tid));
+            }
+        }
+        ::closedir(directory);
+    }
+    std::sort(mListedTids.begin(), mListedTids.end());
+
+    // Both lists are sorted by tid: known threads keep their files and
+    // previous counters, only new ones are opened.
+    std::vector<ThreadState> threads;
+    threads.reserve(mListedTids.size());
+    auto known = mThreads.begin();
+    for (std::uint32_t tid : mListedTids) {
+        while (known != mThreads.end() && known->tid < tid) {
+            ++known;
+        }
+        if (known != mThreads.end() && known->tid == tid) {
+            threads.push_back(std::move(*known));
+            continue;
+        }
+
+        ThreadState state;
+        state.tid = tid;
+        const std::string base = taskPath + "/" + std::to_string(tid) + "/";
+        state.stat = ProcFile(base + "stat", kThreadFileCapacity);
+        state.schedstat = ProcFile(base + "schedstat", kThreadFileCapacity);
+        state.status = ProcFile(base + "status", kThreadFileCapacity);
+        threads.push_back(std::move(state));
+    }
+
+    mThreads.swap(threads);
+    mNeedsDiscovery = false;
+}
+
+bool ThreadCollector::readThread(ThreadState& state, std::uint64_t windowNs, ThreadStats& outStats) {
+    if (!state.stat.read()) {
+        return false;
+    }
+
+    // "tid (comm) S ppid ..." -- comm may contain spaces and parentheses, so
+    // fields are counted from the last ')'.
+    const char* begin = state.stat.data();
+    const char* end = state.stat.end();
+    const char* open = static_cast<const char*>(std::memchr(begin, '(', static_cast<std::size_t>(end - begin)));
+    const char* close = end;
+    while (close > begin && *(close - 1) != ')') {
+        --close;
+    }
+    if (open == nullptr || close <= open + 1) {
+        return false;
+    }
+    copyName(open + 1, static_cast<std::size_t>(close - 1 - (open + 1)), outStats.name);
+
+    // After ')': state is field 3, utime/stime are 14/15, processor is 39.
+    const char* cursor = close;
+    std::uint64_t userTicks = 0;
+    std::uint64_t systemTicks = 0;
+    std::int64_t processor = -1;
+    for (int field = 3; field < 14; ++field) {
+        skipToken(cursor, end);
+    }
+    parseU64(cursor, end, userTicks);
+    parseU64(cursor, end, systemTicks);
+    for (int field = 16; field < 39; ++field) {
+        skipToken(cursor, end);
+    }
+    parseI64(cursor, end, processor);
+
+    // "run_ns wait_ns timeslices"
+    std::uint64_t runNs = 0;
+    std::uint64_t waitNs = 0;
+    const bool hasSchedstat = state.schedstat.isOpen() && state.schedstat.read();
+    if (hasSchedstat) {
+        const char* schedCursor = state.schedstat.data();
+        parseU64(schedCursor, state.schedstat.end(), runNs);
+        parseU64(schedCursor, state.schedstat.end(), waitNs);
+    }
+
+    std::uint64_t voluntary = 0;
+    std::uint64_t involuntary = 0;
+    if (state.status.isOpen() && state.status.read()) {
+        findStatusValue(state.status, "voluntary_ctxt_switches:", voluntary);
+        findStatusValue(state.status, "nonvoluntary_ctxt_switches:", involuntary);
+    }
+
+    outStats.tid = state.tid;
+    outStats.lastCpu = static_cast<std::int32_t>(processor);
+    if (state.hasPrevious && windowNs > 0) {
+        const std::uint64_t userDelta = counterDelta(userTicks, state.userTicks);
+        const std::uint64_t systemDelta = counterDelta(systemTicks, state.systemTicks);
+        const std::uint64_t tickDelta = userDelta + systemDelta;
+        outStats.cpuPercent = hasSchedstat
+                                  ? percentOf(counterDelta(runNs, state.runNs), windowNs)
+                                  : percentOf(static_cast<std::uint64_t>(static_cast<double>(tickDelta) * mNsPerTick),
+                                              windowNs);
+        if (tickDelta > 0) {
+            outStats.userPercent = outStats.cpuPercent * static_cast<double>(userDelta) / static_cast<double>(tickDelta);
+            outStats.systemPercent = outStats.cpuPercent - outStats.userPercent;
+        } else {
+            outStats.userPercent = outStats.cpuPercent;
+        }
+        outStats.runQueueWaitPercent = percentOf(counterDelta(waitNs, state.waitNs), windowNs);
+        outStats.voluntarySwitchesPerSec = perSecond(counterDelta(voluntary, state.voluntarySwitches), windowNs);
+        outStats.involuntarySwitchesPerSec = perSecond(counterDelta(involuntary, state.involuntarySwitches), windowNs);
+    }
+
+    state.userTicks = userTicks;
+    state.systemTicks = systemTicks;
+    state.runNs = runNs;
+    state.waitNs = waitNs;
+    state.voluntarySwitches = voluntary;
+    state.involuntarySwitches = involuntary;
+    state.hasPrevious = true;
+    return true;
+}
+
+bool ThreadCollector::sample(ThreadData& outData) {
+    if (mPid == 0) {
+        return false;
+    }
+
+    const std::uint64_t nowNs = monotonicNowNs();
+    const std::uint64_t windowNs = mPreviousSampleNs != 0 ? nowNs - mPreviousSampleNs : 0;
+    outData.pid = mPid;
+    outData.trace.sampleNs = nowNs;
+
+    std::uint64_t threadCount = 0;
+    if (!readProcessStatus(outData, threadCount)) {
+        // Exited (or not ours to read): report it once as unavailable.
+        mThreads.clear();
+        mNeedsDiscovery = true;
+        return true;
+    }
+
+    if (mNeedsDiscovery || threadCount != mThreads.size()) {
+        discover();
+    }
+
+    mRanked.clear();
+    for (ThreadState& state : mThreads) {
+        ThreadStats stats;
+        if (readThread(state, windowNs, stats)) {
+            mRanked.push_back(stats);
+        } else {
+            mNeedsDiscovery = true;
+        }
+    }
+
+    const std::size_t kept = std::min(mRanked.size(), kMaxWatchedThreads);
+    std::partial_sort(mRanked.begin(), mRanked.begin() + static_cast<std::ptrdiff_t>(kept), mRanked.end(),
+                      [](const ThreadStats& left, const ThreadStats& right) {
+                          if (left.cpuPercent != right.cpuPercent) {
+                              return left.cpuPercent > right.cpuPercent;
+                          }
+                          return left.tid < right.tid;
+                      });
+
+    outData.available = 1;
+    outData.totalThreads = static_cast<std::uint32_t>(mRanked.size());
+    outData.threadCount = static_cast<std::uint32_t>(kept);
+    std::copy(mRanked.begin(), mRanked.begin() + static_cast<std::ptrdiff_t>(kept), outData.threads);
+    std::fill(outData.threads + kept, outData.threads + kMaxWatchedThreads, ThreadStats{});
+    mPreviousSampleNs = nowNs;
+    return true;
+}
+
+} // namespace xmonitor
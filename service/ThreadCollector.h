@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common/ProcFile.h"
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// Per-thread CPU, run-queue wait, context switches and last CPU of one
+// process from <procRoot>/<pid>/task/<tid>/{stat,schedstat,status}. Threads
+// keep their files open; the task directory is listed again only when the
+// process's thread count changes or a thread's files stop reading (it
+// exited), so a steady process costs three preads per thread per sample.
+class ThreadCollector {
+public:
+    ThreadCollector();
+
+    // Switches to another process (0 = none) and drops all per-thread state.
+    void setTarget(std::uint32_t pid);
+    std::uint32_t target() const;
+
+    bool sample(ThreadData& outData);
+
+private:
+    struct ThreadState {
+        std::uint32_t tid{0};
+        ProcFile stat;
+        ProcFile schedstat;
+        ProcFile status;
+        bool hasPrevious{false};
+        std::uint64_t userTicks{0};
+        std::uint64_t systemTicks{0};
+        std::uint64_t runNs{0};
+        std::uint64_t waitNs{0};
+        std::uint64_t voluntarySwitches{0};
+        std::uint64_t involuntarySwitches{0};
+    };
+
+    bool readProcessStatus(ThreadData& outData, std::uint64_t& outThreadCount);
+    void discover();
+    bool readThread(ThreadState& state, std::uint64_t windowNs, ThreadStats& outStats);
+
+    std::uint32_t mPid;
+    ProcFile mProcessStatus;
+    std::vector<ThreadState> mThreads;
+    std::vector<std::uint32_t> mListedTids;
+    std::vector<ThreadStats> mRanked;
+    bool mNeedsDiscovery;
+    double mNsPerTick;
+    std::uint64_t mPreviousSampleNs;
+};
+
+} // namespace xmonitor
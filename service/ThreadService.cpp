@@ -0,0 +1,102 @@
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+#include "ipc/BinderProtocol.h"
+#include "service/ServiceSession.h"
+#include "service/ThreadCollector.h"
+
+namespace {
+volatile std::sig_atomic_t gRunning = 1;
+
+// The thread table is a live view, so it refreshes at 10 Hz.
+constexpr auto kSamplePeriod = std::chrono::milliseconds(100);
+
+// The watch target changes only when someone runs `xMonitor --watch`, so
+// lifecycle is asked once a second rather than every tick.
+constexpr std::uint64_t kWatchPollIntervalNs = 1000000000ull;
+
+void signalHandler(int) {
+    gRunning = 0;
+}
+
+bool threadsChanged(const xmonitor::ThreadData& current, const xmonitor::ThreadData& previous) {
+    return std::memcmp(&current, &previous, offsetof(xmonitor::ThreadData, trace)) != 0;
+}
+}
+
+int main() {
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+
+    setLogFilePath("logs/xMonitor-thread.log");
+    LOG_I("Thread service start");
+
+    xmonitor::ServiceSession session("Thread",
+                                     xmonitor::BinderTransactionCode::RegisterThreadService,
+                                     xmonitor::ProcessRole::ThreadService);
+
+    xmonitor::ThreadCollector collector;
+    xmonitor::ThreadData lastPublished{};
+    bool hasLastPublished = false;
+    std::uint64_t lastWatchPollNs = 0;
+
+    if (!session.start(gRunning)) {
+        return 1;
+    }
+
+    if (gRunning == 0) {
+        session.stop();
+        LOG_I("Thread service stop");
+        return 0;
+    }
+
+    while (gRunning != 0) {
+        if (session.takePolicyChange()) {
+            hasLastPublished = false;
+        }
+
+        const std::uint64_t nowNs = xmonitor::monotonicNowNs();
+        if (nowNs - lastWatchPollNs >= kWatchPollIntervalNs) {
+            lastWatchPollNs = nowNs;
+            const std::uint32_t request = 1;
+            xmonitor::WatchTarget target{};
+            if (session.query(xmonitor::BinderTransactionCode::QueryWatchTarget,
+                              &request,
+                              sizeof(request),
+                              &target,
+                              sizeof(target)) &&
+                target.pid != collector.target()) {
+                collector.setTarget(target.pid);
+                hasLastPublished = false;
+            }
+        }
+
+        xmonitor::ThreadData current{};
+        if (session.sectionEnabled(xmonitor::BinderTransactionCode::ThreadUpdated) && collector.sample(current)) {
+            if (!hasLastPublished || threadsChanged(current, lastPublished)) {
+                hasLastPublished = true;
+                lastPublished = current;
+                if (!session.publish(xmonitor::BinderTransactionCode::ThreadUpdated, &current, sizeof(current))) {
+                    session.stop();
+                    return 1;
+                }
+            }
+        }
+
+        if (!session.onSampleTick()) {
+            session.stop();
+            return 1;
+        }
+
+        session.sleepUntilNextTick(kSamplePeriod);
+    }
+
+    session.stop();
+    LOG_I("Thread service stop");
+    return 0;
+}
@@ -0,0 +1,328 @@
+#include "service/TopologyCollector.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include <dirent.h>
+
+#include "Logger.h"
+#include "common/MonotonicClock.h"
+#include "common/ProcfsRoot.h"
+#include "common/TextScan.h"
+
+namespace xmonitor {
+namespace {
+
+// scaling_cur_freq, ids and numastat are a few bytes to a few lines.
+constexpr std::size_t kSmallFileCapacity = 256;
+
+// /proc/stat cpuN columns.
+constexpr std::size_t kColumnIdle = 3;
+constexpr std::size_t kColumnIowait = 4;
+constexpr std::size_t kColumnSteal = 7;
+
+const char* kNumaCounterNames[] = {
+    "numa_hit",
+    "numa_miss",
+    "numa_foreign",
+    "interleave_hit",
+    "local_node",
+    "other_node",
+};
+
+// "0-3,8-11\n" -> 0 1 2 3 8 9 10 11
+std::vector<std::uint32_t> readCpuList(const std::string& path) {
+    std::vector<std::uint32_t> cpus;
+    ProcFile file(path, kSmallFileCapacity);
+    if (!file.read()) {
+        return cpus;
+    }
+
+    const char* cursor = file.data();
+    const char* end = file.end();
+    std::uint64_t first = 0;
+    while (parseU64(cursor, end, first)) {
+        std::uint64_t last = first;
+        if (consume(cursor, end, "-")) {
+            parseU64(cursor, end, last);
+        }
+        for (std::uint64_t cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(static_cast<std::uint32_t>(cpu));
+        }
+        if (!consume(cursor, end, ",")) {
+            break;
+        }
+    }
+    return cpus;
+}
+
+std::uint32_t readId(const std::string& path) {
+    ProcFile file(path, kSmallFileCapacity);
+    std::int64_t value = 0;
+    if (!file.read()) {
+        return 0;
+    }
+    const char* cursor = file.data();
+    // physical_package_id is -1 on some virtual machines.
+    return parseI64(cursor, file.end(), value) && value > 0 ? static_cast<std::uint32_t>(value) : 0;
+}
+
+double perSecond(std::uint64_t current, std::uint64_t previous, double windowSec) {
+    return current >= previous && windowSec > 0.0 ? static_cast<double>(current - previous) / windowSec : 0.0;
+}
+
+} // namespace
+
+TopologyCollector::TopologyCollector()
+    : mStatFile(procPath("stat")),
+      mPackageCount(0),
+      mPreviousSampleNs(0) {
+    discover();
+}
+
+void TopologyCollector::discover() {
+    std::vector<std::uint32_t> online = readCpuList(sysPath("devices/system/cpu/online"));
+    if (online.empty() && mStatFile.read()) {
+        // No sysfs (e.g. a procfs-only fixture): take the cpuN lines.
+        const char* cursor = mStatFile.data();
+        const char* end = mStatFile.end();
+        skipLine(cursor, end);
+        std::uint64_t cpu = 0;
+        while (consume(cursor, end, "cpu") && parseU64(cursor, end, cpu)) {
+            online.push_back(static_cast<std::uint32_t>(cpu));
+            skipLine(cursor, end);
+        }
+    }
+
+    mCpus.clear();
+    mCpus.reserve(online.size());
+    std::vector<std::uint32_t> packages;
+    for (std::uint32_t cpu : online) {
+        const std::string base = "devices/system/cpu/cpu" + std::to_string(cpu) + "/";
+        CpuState state;
+        state.cpu = cpu;
+        state.package = readId(sysPath((base + "topology/physical_package_id").c_str()));
+        state.core = readId(sysPath((base + "topology/core_id").c_str()));
+        state.frequency = ProcFile(sysPath((base + "cpufreq/scaling_cur_freq").c_str()), kSmallFileCapacity);
+        packages.push_back(state.package);
+        mCpus.push_back(std::move(state));
+    }
+    std::sort(packages.begin(), packages.end());
+    mPackageCount = static_cast<std::uint32_t>(std::unique(packages.begin(), packages.end()) - packages.begin());
+
+    const std::uint32_t maxCpu = online.empty() ? 0 : *std::max_element(online.begin(), online.end());
+    mIndexByCpu.assign(static_cast<std::size_t>(maxCpu) + 1, -1);
+    for (std::size_t i = 0; i < mCpus.size(); ++i) {
+        mIndexByCpu[mCpus[i].cpu] = static_cast<std::int32_t>(i);
+    }
+
+    std::vector<std::uint32_t> nodeIds;
+    const std::string nodeRoot = sysPath("devices/system/node");
+    if (DIR* directory = ::opendir(nodeRoot.c_str())) {
+        while (const dirent* entry = ::readdir(directory)) {
+            const char* cursor = entry->d_name;
+            const char* end = cursor + std::strlen(entry->d_name);
+            std::uint64_t node = 0;
+            if (consume(cursor, end, "node") && parseU64(cursor, end, node) && cursor == end) {
+                nodeIds.push_back(static_cast<std::uint32_t>(node));
+            }
+        }
+        ::closedir(directory);
+    }
+    std::sort(nodeIds.begin(), nodeIds.end());
+    if (nodeIds.empty()) {
+        // Non-NUMA kernel: one node holding every CPU, without memory stats.
+        nodeIds.push_back(0);
+    }
+
+    mNodes.clear();
+    mNodes.reserve(nodeIds.size());
+    for (std::uint32_t node : nodeIds) {
+        const std::string base = nodeRoot + "/node" + std::to_string(node) + "/";
+        for (std::uint32_t cpu : readCpuList(base + "cpulist")) {
+            if (cpu < mIndexByCpu.size() && mIndexByCpu[cpu] >= 0) {
+                mCpus[static_cast<std::size_t>(mIndexByCpu[cpu])].node = node;
+            }
+        }
+
+        NodeState state;
+        state.node = node;
+        state.meminfo = ProcFile(base + "meminfo");
+        state.numastat = ProcFile(base + "numastat", kSmallFileCapacity);
+        mNodes.push_back(std::move(state));
+    }
+
+    const bool hasFrequency = std::any_of(mCpus.begin(), mCpus.end(), [](const CpuState& state) {
+        return state.frequency.isOpen();
+    });
+    LOG_I("Topology: %zu CPUs, %zu nodes, %u packages, cpufreq %s",
+          mCpus.size(), mNodes.size(), mPackageCount, hasFrequency ? "yes" : "no");
+}
+
+bool TopologyCollector::readCpuUsage() {
+    if (!mStatFile.isOpen() || !mStatFile.read()) {
+        LOG_E("Topology read failed: cannot read %s", mStatFile.path().c_str());
+        return false;
+    }
+
+    // CPUs that went offline have no line and read as idle.
+    for (CpuState& state : mCpus) {
+        state.usagePercent = 0.0;
+    }
+
+    const char* cursor = mStatFile.data();
+    const char* end = mStatFile.end();
+    skipLine(cursor, end);
+    std::uint64_t cpu = 0;
+    while (consume(cursor, end, "cpu") && parseU64(cursor, end, cpu)) {
+        std::uint64_t columns[kStatColumns] = {};
+        std::size_t parsed = 0;
+        while (parsed < kStatColumns && parseU64(cursor, end, columns[parsed])) {
+            ++parsed;
+        }
+        skipLine(cursor, end);
+        if (cpu >= mIndexByCpu.size() || mIndexByCpu[cpu] < 0) {
+            continue;
+        }
+
+        // guest/guest_nice are already included in user/nice.
+        std::uint64_t total = 0;
+        for (std::size_t column = 0; column <= kColumnSteal; ++column) {
+            total += columns[column];
+        }
+        const std::uint64_t busy = total - columns[kColumnIdle] - columns[kColumnIowait];
+
+        CpuState& state = mCpus[static_cast<std::size_t>(mIndexByCpu[cpu])];
+        if (state.hasPrevious && total > state.totalTicks && busy >= state.busyTicks) {
+            state.usagePercent = static_cast<double>(busy - state.busyTicks) * 100.0 /
+                                 static_cast<double>(total - state.totalTicks);
+        }
+        state.busyTicks = busy;
+        state.totalTicks = total;
+        state.hasPrevious = true;
+    }
+    return true;
+}
+
+void TopologyCollector::readNode(NodeState& state, double windowSec, NumaNodeStats& outStats) {
+    outStats.node = state.node;
+
+    // "Node 0 MemTotal:        4292344 kB"
+    if (state.meminfo.isOpen() && state.meminfo.read()) {
+        const char* cursor = state.meminfo.data();
+        const char* end = state.meminfo.end();
+        while (cursor < end) {
+            skipToken(cursor, end);
+            skipToken(cursor, end);
+            skipBlanks(cursor, end);
+            std::uint64_t* target = nullptr;
+            if (consume(cursor, end, "MemTotal:")) {
+                target = &outStats.memTotalBytes;
+            } else if (consume(cursor, end, "MemFree:")) {
+                target = &outStats.memFreeBytes;
+            } else if (consume(cursor, end, "FilePages:")) {
+                target = &outStats.filePagesBytes;
+            } else if (consume(cursor, end, "AnonPages:")) {
+                target = &outStats.anonPagesBytes;
+            }
+            std::uint64_t kilobytes = 0;
+            if (target != nullptr && parseU64(cursor, end, kilobytes)) {
+                *target = kilobytes * 1024;
+            }
+            skipLine(cursor, end);
+        }
+    }
+
+    // "numa_hit 6844083"
+    if (!state.numastat.isOpen() || !state.numastat.read()) {
+        return;
+    }
+    std::uint64_t counters[NUMA_COUNTER_COUNT] = {};
+    const char* cursor = state.numastat.data();
+    const char* end = state.numastat.end();
+    while (cursor < end) {
+        const char* name = nullptr;
+        const std::size_t nameLength = readToken(cursor, end, name);
+        for (std::size_t counter = 0; counter < NUMA_COUNTER_COUNT; ++counter) {
+            if (std::strlen(kNumaCounterNames[counter]) == nameLength &&
+                std::memcmp(kNumaCounterNames[counter], name, nameLength) == 0) {
+                parseU64(cursor, end, counters[counter]);
+                break;
+            }
+        }
+        skipLine(cursor, end);
+    }
+
+    if (state.hasPrevious) {
+        outStats.localAllocsPerSec = perSecond(counters[NUMA_LOCAL_NODE], state.counters[NUMA_LOCAL_NODE], windowSec);
+        outStats.remoteAllocsPerSec = perSecond(counters[NUMA_OTHER_NODE], state.counters[NUMA_OTHER_NODE], windowSec);
+        outStats.missesPerSec = perSecond(counters[NUMA_MISS], state.counters[NUMA_MISS], windowSec);
+        outStats.foreignPerSec = perSecond(counters[NUMA_FOREIGN], state.counters[NUMA_FOREIGN], windowSec);
+    }
+    std::memcpy(state.counters, counters, sizeof(counters));
+    state.hasPrevious = true;
+}
+
+bool TopologyCollector::sample(TopologyData& outData) {
+    if (!readCpuUsage()) {
+        return false;
+    }
+
+    const std::uint64_t nowNs = monotonicNowNs();
+    const double windowSec = mPreviousSampleNs != 0 ? static_cast<double>(nowNs - mPreviousSampleNs) / 1e9 : 0.0;
+
+    for (CpuState& state : mCpus) {
+        std::uint64_t kilohertz = 0;
+        if (state.frequency.isOpen() && state.frequency.read()) {
+            const char* cursor = state.frequency.data();
+            parseU64(cursor, state.frequency.end(), kilohertz);
+        }
+        state.frequencyMhz = static_cast<std::uint32_t>(kilohertz / 1000);
+    }
+
+    const std::size_t nodeCount = std::min(mNodes.size(), kMaxNumaNodes);
+    for (std::size_t i = 0; i < nodeCount; ++i) {
+        NumaNodeStats& stats = outData.nodes[i];
+        readNode(mNodes[i], windowSec, stats);
+
+        double usage = 0.0;
+        double frequency = 0.0;
+        std::uint32_t frequencyCpus = 0;
+        for (const CpuState& state : mCpus) {
+            if (state.node != stats.node) {
+                continue;
+            }
+            ++stats.cpuCount;
+            usage += state.usagePercent;
+            if (state.frequencyMhz != 0) {
+                frequency += state.frequencyMhz;
+                ++frequencyCpus;
+            }
+        }
+        stats.usagePercent = stats.cpuCount > 0 ? usage / stats.cpuCount : 0.0;
+        stats.averageFrequencyMhz = frequencyCpus > 0 ? frequency / frequencyCpus : 0.0;
+    }
+
+    const std::size_t coreCount = std::min(mCpus.size(), kMaxTopologyCpus);
+    for (std::size_t i = 0; i < coreCount; ++i) {
+        const CpuState& state = mCpus[i];
+        CoreStats& core = outData.cores[i];
+        core.cpu = state.cpu;
+        core.node = state.node;
+        core.package = state.package;
+        core.core = state.core;
+        core.usagePercent = state.usagePercent;
+        core.frequencyMhz = state.frequencyMhz;
+    }
+
+    outData.cpuCount = static_cast<std::uint32_t>(mCpus.size());
+    outData.coreCount = static_cast<std::uint32_t>(coreCount);
+    outData.nodeCount = static_cast<std::uint32_t>(nodeCount);
+    outData.packageCount = mPackageCount;
+    outData.trace.sampleNs = nowNs;
+    mPreviousSampleNs = nowNs;
+    return true;
+}
+
+} // namespace xmonitor
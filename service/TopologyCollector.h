@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common/ProcFile.h"
+#include "ipc/BinderProtocol.h"
+
+namespace xmonitor {
+
+// Per-CPU usage (<procRoot>/stat cpuN lines) and current frequency
+// (cpufreq/scaling_cur_freq), plus per-node memory and numastat, laid out
+// by socket/node/core. The topology (online CPUs, package/core ids, node
+// cpulists) is read once at construction; after that only the files that
+// change are re-read, each through its own persistent fd.
+class TopologyCollector {
+public:
+    TopologyCollector();
+
+    // Returns false when <procRoot>/stat cannot be read.
+    bool sample(TopologyData& outData);
+
+private:
+    // Column count of a cpuN line (user .. guest_nice).
+    static constexpr std::size_t kStatColumns = 10;
+
+    struct CpuState {
+        std::uint32_t cpu{0};
+        std::uint32_t node{0};
+        std::uint32_t package{0};
+        std::uint32_t core{0};
+        ProcFile frequency;
+        bool hasPrevious{false};
+        std::uint64_t busyTicks{0};
+        std::uint64_t totalTicks{0};
+        double usagePercent{0.0};
+        std::uint32_t frequencyMhz{0};
+    };
+
+    enum NumaCounter : std::size_t {
+        NUMA_HIT = 0,
+        NUMA_MISS,
+        NUMA_FOREIGN,
+        NUMA_INTERLEAVE_HIT,
+        NUMA_LOCAL_NODE,
+        NUMA_OTHER_NODE,
+        NUMA_COUNTER_COUNT
+    };
+
+    struct NodeState {
+        std::uint32_t node{0};
+        ProcFile meminfo;
+        ProcFile numastat;
+        bool hasPrevious{false};
+        std::uint64_t counters[NUMA_COUNTER_COUNT]{};
+    };
+
+    void discover();
+    bool readCpuUsage();
+    void readNode(NodeState& state, double windowSec, NumaNodeStats& outStats);
+
+    ProcFile mStatFile;
+    std::vector<CpuState> mCpus;
+    std::vector<std::int32_t> mIndexByCpu;
+    std::vector<NodeState> mNodes;
+    std::uint32_t mPackageCount;
+    std::uint64_t mPreviousSampleNs;
+};
+
+} // namespace xmonitor